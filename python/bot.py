@@ -0,0 +1,131 @@
+# Plays the games of snakesim bot with a greedy player, speaking the binary
+# protocol of src/bot.h over pipes:
+#
+#     python bot.py [snakesim bot options]
+#
+# The simulator reports the round trip per tick to stderr once it is done.
+
+import os
+import struct
+import subprocess
+import sys
+
+SIM = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "bin", "snakesim")
+
+HELLO  = struct.Struct("<IIBBBBHHI")
+FRAME  = struct.Struct("<IIII")
+RECORD = struct.Struct("<IHHHHHBBB3x")
+CHANGE = struct.Struct("<HBx")
+
+BOT_MAGIC      = 0x54424E53
+BOT_LAST_FRAME = 0x0001
+BOT_FULL_FIELD = 0x02
+
+EMPTY, FOOD, HEAD, BODY = range(4)
+RUNNING = 1
+STEPS = ((1, 0), (0, 1), (-1, 0), (0, -1))  # RIGHT, UP, LEFT, DOWN
+NO_COMMAND = 0xFF
+
+
+def read_exactly(stream, size):
+    data = stream.read(size)
+    if len(data) != size:
+        raise EOFError("snakesim closed the pipe")
+    return data
+
+
+class Slot:
+    def __init__(self, width, height):
+        self.blocks = bytearray(width * height)
+        self.head = (0, 0)
+        self.food = (0, 0)
+        self.direction = 0
+        self.running = False
+
+
+def plan(slot, width, height, wrap, ticks):
+    """Heads for the food, never into a block of the snake or a wall, planning
+    every tick of the round from where the head would be."""
+    x, y = slot.head
+    direction = slot.direction
+    taken = set()
+    moves = bytearray()
+
+    for _ in range(ticks):
+        best, best_distance = NO_COMMAND, None
+        for d, (dx, dy) in enumerate(STEPS):
+            if d == (direction + 2) % 4:
+                continue
+            nx, ny = x + dx, y + dy
+            if wrap:
+                nx, ny = nx % width, ny % height
+            elif not (0 <= nx < width and 0 <= ny < height):
+                continue
+            if slot.blocks[ny * width + nx] >= HEAD or (nx, ny) in taken:
+                continue
+            distance = abs(nx - slot.food[0]) + abs(ny - slot.food[1])
+            if best_distance is None or distance < best_distance:
+                best, best_distance = d, distance
+        if best == NO_COMMAND:
+            moves.append(NO_COMMAND)
+            continue
+        moves.append(best)
+        direction = best
+        x, y = (x + STEPS[best][0]) % width if wrap else x + STEPS[best][0], \
+               (y + STEPS[best][1]) % height if wrap else y + STEPS[best][1]
+        taken.add((x, y))
+
+    return moves
+
+
+def main():
+    process = subprocess.Popen([SIM, "bot"] + sys.argv[1:], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    output, answers = process.stdout, process.stdin
+
+    magic, version, width, height, wrap, _, slot_count, ticks, games = HELLO.unpack(read_exactly(output, HELLO.size))
+    if magic != BOT_MAGIC:
+        raise ValueError("not a snakesim bot session")
+
+    slots = [Slot(width, height) for _ in range(slot_count)]
+    sizes = []
+
+    while True:
+        size, record_count, _, flags = FRAME.unpack(read_exactly(output, FRAME.size))
+        frame = read_exactly(output, size - FRAME.size)
+        offset = 0
+
+        for _ in range(record_count):
+            game, index, change_count, head, food, snake_size, state, direction, record_flags = \
+                RECORD.unpack_from(frame, offset)
+            offset += RECORD.size
+            slot = slots[index]
+
+            if record_flags & BOT_FULL_FIELD:
+                slot.blocks = bytearray(width * height)
+            for _ in range(change_count):
+                position, block = CHANGE.unpack_from(frame, offset)
+                offset += CHANGE.size
+                slot.blocks[(position >> 8) * width + (position & 0xFF)] = block
+
+            slot.head = (head & 0xFF, head >> 8)
+            slot.food = (food & 0xFF, food >> 8)
+            slot.direction = direction
+            if slot.running and state != RUNNING:
+                sizes.append(snake_size)
+            slot.running = state == RUNNING
+
+        if flags & BOT_LAST_FRAME:
+            break
+
+        answers.write(b"".join(plan(slot, width, height, wrap, ticks) if slot.running else bytes(ticks)
+                               for slot in slots))
+        answers.flush()
+
+    answers.close()
+    process.wait()
+    if sizes:
+        print("%d games, mean final size %.1f" % (len(sizes), sum(sizes) / len(sizes)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+# Builds the snake extension module against the core in ../src:
+#
+#     python setup.py build_ext --inplace
+
+import os
+from setuptools import setup, Extension
+
+SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+
+setup(
+    name="snake",
+    version="1.0",
+    ext_modules=[
+        Extension(
+            "snake",
+            sources=["snakemodule.c"] + [os.path.relpath(os.path.join(SRC, f)) for f in ("snake.c", "encoder.c", "heatmap.c", "pipeline.c", "planner.c", "symmetry.c", "replay.c", "outcome.c", "hamilton.c", "common.c")],
+            include_dirs=[os.path.relpath(SRC)],
+            extra_compile_args=["-O3"],
+        )
+    ],
+)
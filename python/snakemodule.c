@@ -0,0 +1,1436 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+//Python bindings for the Snake core. A Batch owns a number of games stepped
+//together, and exposes their observation planes, status records and packed
+//fields through the buffer protocol, so numpy.asarray() wraps them without
+//copying anything.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include <string.h>
+#include "snake.h"
+#include "encoder.h"
+#include "heatmap.h"
+#include "pipeline.h"
+#include "planner.h"
+#include "symmetry.h"
+#include "replay.h"
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _BATCH_OBJECT
+{
+    PyObject_HEAD
+    SNAKE_GAME*   games;
+    BYTE*         planes;
+    SNAKE_STATUS* statuses;
+    UINT          count;
+    UINT          fieldWidth;
+    UINT          fieldHeight;
+    Py_ssize_t    fieldExports;     //Field views alive, which pin the field buffers
+    HEATMAP       heatmap;          //Counts of every game, none unless created with heatmap=True
+    BOOL          busy;             //A call is using the games without holding the GIL
+} BATCH_OBJECT;
+
+//Exports a region of memory owned by another object, which it keeps alive.
+//When exports is set, the owner refuses to free the region while it is > 0.
+typedef struct _VIEW_OBJECT
+{
+    PyObject_HEAD
+    PyObject*   owner;
+    void*       buffer;
+    Py_ssize_t* exports;
+    int         ndim;
+    Py_ssize_t  itemSize;
+    Py_ssize_t  shape[3];
+    Py_ssize_t  strides[3];
+} VIEW_OBJECT;
+
+typedef struct _PIPELINE_OBJECT
+{
+    PyObject_HEAD
+    SNAKE_GAME*    games;
+    SNAKE_PIPELINE pipeline;
+    BOOL           created;
+    UINT           count;
+    UINT           fieldWidth;
+    UINT           fieldHeight;
+} PIPELINE_OBJECT;
+
+typedef struct _PLANNER_OBJECT
+{
+    PyObject_HEAD
+    SNAKE_PLANNER planner;
+    BOOL          created;
+} PLANNER_OBJECT;
+
+typedef struct _REPLAY_OBJECT
+{
+    PyObject_HEAD
+    REPLAY replay;
+    BOOL   opened;
+} REPLAY_OBJECT;
+
+static PyTypeObject BatchType;
+static PyTypeObject PipelineType;
+static PyTypeObject PlannerType;
+static PyTypeObject ReplayType;
+static PyTypeObject ViewType;
+
+//Every game created takes the next stream of the seed, so a run seeded the
+//same way replays the same food whichever threads step the games
+static UINT64 masterSeed = 1;
+static UINT64 nextStream = 0;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static PyObject* RaiseResult(SNAKE_RESULT Result)
+{
+    if (Result == SR_MEMORY_ERROR) return PyErr_NoMemory();
+
+    PyErr_SetString(PyExc_ValueError, ResultToString(Result));
+    return NULL;
+}
+
+static PyObject* CreateView(PyObject* Owner, void* Buffer, Py_ssize_t ItemSize, Py_ssize_t* Exports,
+                            int Ndim, Py_ssize_t Shape0, Py_ssize_t Shape1, Py_ssize_t Shape2)
+{
+    VIEW_OBJECT* view;
+    PyObject*    memory;
+
+    view = PyObject_New(VIEW_OBJECT, &ViewType);
+    if (view == NULL) return NULL;
+
+    Py_INCREF(Owner);
+    view->owner    = Owner;
+    view->buffer   = Buffer;
+    view->exports  = Exports;
+    view->ndim     = Ndim;
+    view->itemSize = ItemSize;
+    view->shape[0] = Shape0;
+    view->shape[1] = Shape1;
+    view->shape[2] = Shape2;
+
+    //Contiguous row-major strides
+    view->strides[Ndim - 1] = ItemSize;
+    if (Ndim > 1) view->strides[Ndim - 2] = view->shape[Ndim - 1] * ItemSize;
+    if (Ndim > 2) view->strides[0]        = view->shape[1] * view->strides[1];
+
+    memory = PyMemoryView_FromObject((PyObject*) view);
+    Py_DECREF(view);
+
+    return memory;
+}
+
+//Whether a call released the GIL while using the games of the batch, which
+//nothing else may touch until it's done. Raises RuntimeError when it did.
+static BOOL IsBatchBusy(BATCH_OBJECT* Batch)
+{
+    if (Batch->busy) PyErr_SetString(PyExc_RuntimeError, "Batch is in use by another thread");
+
+    return Batch->busy;
+}
+
+//Claims the games for a call about to release the GIL, FALSE when busy
+static BOOL ClaimBatch(BATCH_OBJECT* Batch)
+{
+    if (IsBatchBusy(Batch)) return FALSE;
+
+    Batch->busy = TRUE;
+    return TRUE;
+}
+
+static SNAKE_RESULT ResetGames(BATCH_OBJECT* Batch, UINT First, UINT Last)
+{
+    SNAKE_RESULT result = SR_OK;
+    UINT         i;
+
+    for (i = First; i < Last && result == SR_OK; i++)
+    {
+        result = ResetGame(Batch->games + i);
+
+        WriteObservation(Batch->games + i, Batch->planes + (size_t) i * Batch->fieldWidth * Batch->fieldHeight);
+        WriteStatus     (Batch->games + i, Batch->statuses + i);
+    }
+
+    return result;
+}
+
+
+//*****************************************************************************
+//
+//                                VIEW TYPE
+//
+//*****************************************************************************
+
+static int View_GetBuffer(VIEW_OBJECT* Self, Py_buffer* View, int Flags)
+{
+    if ((Flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "engine buffers are read-only");
+        View->obj = NULL;
+        return -1;
+    }
+
+    Py_INCREF(Self);
+
+    View->buf        = Self->buffer;
+    View->obj        = (PyObject*) Self;
+    View->len        = Self->shape[0] * Self->strides[0];
+    View->itemsize   = Self->itemSize;
+    View->readonly   = 1;
+    View->ndim       = Self->ndim;
+    View->format     = (Flags & PyBUF_FORMAT)  ? (Self->itemSize == 1 ? "B" : Self->itemSize == 8 ? "Q" : "I") : NULL;
+    View->shape      = (Flags & PyBUF_ND)      ? Self->shape   : NULL;
+    View->strides    = (Flags & PyBUF_STRIDES) ? Self->strides : NULL;
+    View->suboffsets = NULL;
+    View->internal   = NULL;
+
+    if (Self->exports != NULL) (*Self->exports)++;
+
+    return 0;
+}
+
+static void View_ReleaseBuffer(VIEW_OBJECT* Self, Py_buffer* View)
+{
+    if (Self->exports != NULL) (*Self->exports)--;
+}
+
+static void View_Dealloc(VIEW_OBJECT* Self)
+{
+    Py_XDECREF(Self->owner);
+    PyObject_Del(Self);
+}
+
+static PyBufferProcs ViewBufferProcs =
+{
+    (getbufferproc)     View_GetBuffer,
+    (releasebufferproc) View_ReleaseBuffer
+};
+
+static PyTypeObject ViewType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "snake._View",
+    .tp_basicsize = sizeof(VIEW_OBJECT),
+    .tp_dealloc   = (destructor) View_Dealloc,
+    .tp_as_buffer = &ViewBufferProcs,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Buffer exporter for memory owned by a Batch.",
+};
+
+
+//*****************************************************************************
+//
+//                                BATCH TYPE
+//
+//*****************************************************************************
+
+static int Batch_Init(BATCH_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "count", "width", "height", "pass_through_walls", "heatmap", NULL };
+
+    unsigned int count;
+    unsigned int width            = FIELD_WIDTH;
+    unsigned int height           = FIELD_HEIGHT;
+    int          passThroughWalls = PASS_THROUGH_WALLS;
+    int          heatmap          = FALSE;
+    SNAKE_RESULT result;
+    UINT         i;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "I|IIpp", keywords, &count, &width, &height, &passThroughWalls, &heatmap))
+        return -1;
+
+    if (Self->games != NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Batch is already initialized");
+        return -1;
+    }
+
+    if (count == 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "count must be positive");
+        return -1;
+    }
+
+    Self->games    = (SNAKE_GAME*)   PyMem_Calloc(count, sizeof(SNAKE_GAME));
+    Self->planes   = (BYTE*)         PyMem_Calloc((size_t) count * width * height, 1);
+    Self->statuses = (SNAKE_STATUS*) PyMem_Calloc(count, sizeof(SNAKE_STATUS));
+
+    if (Self->games == NULL || Self->planes == NULL || Self->statuses == NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    Self->count       = count;
+    Self->fieldWidth  = width;
+    Self->fieldHeight = height;
+
+    //Every game is stepped by the thread stepping the batch, so they share one
+    if (heatmap && (result = CreateHeatmap(&Self->heatmap, width, height)) != SR_OK)
+    {
+        RaiseResult(result);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        Self->games[i].fieldWidth       = width;
+        Self->games[i].fieldHeight      = height;
+        Self->games[i].snakeSpeed       = SNAKE_SPEED;
+        Self->games[i].passThroughWalls = passThroughWalls;
+        Self->games[i].pHeatmap         = heatmap ? &Self->heatmap : NULL;
+
+        SeedGame(Self->games + i, masterSeed, nextStream++);
+    }
+
+    result = ResetGames(Self, 0, count);
+
+    if (result != SR_OK)
+    {
+        RaiseResult(result);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void Batch_Dealloc(BATCH_OBJECT* Self)
+{
+    UINT i;
+
+    if (Self->games != NULL)
+        for (i = 0; i < Self->count; i++) EndingCleanUp(Self->games + i);
+
+    PyMem_Free(Self->games);
+    PyMem_Free(Self->planes);
+    PyMem_Free(Self->statuses);
+
+    if (Self->heatmap.counts != NULL) DestroyHeatmap(&Self->heatmap);
+
+    Py_TYPE(Self)->tp_free((PyObject*) Self);
+}
+
+static PyObject* Batch_Reset(BATCH_OBJECT* Self, PyObject* Args)
+{
+    int          index = -1;
+    UINT         first, last;
+    SNAKE_RESULT result;
+
+    if (!PyArg_ParseTuple(Args, "|i", &index)) return NULL;
+
+    if (index >= (int) Self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    //A game that fails to reset loses its packed field, and the next reset
+    //allocates another, so views could be left pointing at freed memory
+    if (Self->fieldExports > 0)
+    {
+        PyErr_SetString(PyExc_BufferError, "cannot reset while field views are exported");
+        return NULL;
+    }
+
+    if (!ClaimBatch(Self)) return NULL;
+
+    first = index < 0 ? 0           : (UINT) index;
+    last  = index < 0 ? Self->count : (UINT) index + 1;
+
+    Py_BEGIN_ALLOW_THREADS
+    result = ResetGames(Self, first, last);
+    Py_END_ALLOW_THREADS
+
+    Self->busy = FALSE;
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Batch_Step(BATCH_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "actions", "out", NULL };
+
+    PyObject*    actionsObject = Py_None;
+    PyObject*    outObject     = Py_None;
+    Py_buffer    actions       = { 0 };
+    Py_buffer    out           = { 0 };
+    BYTE*        planes        = Self->planes;
+    size_t       planeBytes    = (size_t) Self->count * Self->fieldWidth * Self->fieldHeight;
+    SNAKE_RESULT result;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "|OO", keywords, &actionsObject, &outObject))
+        return NULL;
+
+    if (actionsObject != Py_None)
+    {
+        if (PyObject_GetBuffer(actionsObject, &actions, PyBUF_C_CONTIGUOUS) < 0) return NULL;
+
+        if (actions.len != (Py_ssize_t) Self->count)
+        {
+            PyErr_Format(PyExc_ValueError, "expected %u actions, got %zd bytes", Self->count, actions.len);
+            PyBuffer_Release(&actions);
+            return NULL;
+        }
+    }
+
+    //Caller-owned observations: planes go straight into the given buffer
+    if (outObject != Py_None)
+    {
+        if (PyObject_GetBuffer(outObject, &out, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE) < 0)
+        {
+            PyBuffer_Release(&actions);
+            return NULL;
+        }
+
+        if ((size_t) out.len < planeBytes)
+        {
+            PyErr_Format(PyExc_ValueError, "out must hold at least %zu bytes", planeBytes);
+            PyBuffer_Release(&actions);
+            PyBuffer_Release(&out);
+            return NULL;
+        }
+
+        planes = (BYTE*) out.buf;
+    }
+
+    if (!ClaimBatch(Self))
+    {
+        PyBuffer_Release(&actions);
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = StepBatch(Self->games, Self->count, (const BYTE*) actions.buf, planes, Self->statuses);
+    Py_END_ALLOW_THREADS
+
+    Self->busy = FALSE;
+
+    PyBuffer_Release(&actions);
+    PyBuffer_Release(&out);
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Batch_Encode(BATCH_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "out", "radius", NULL };
+
+    PyObject*    outObject;
+    Py_buffer    out;
+    unsigned int radius = 0;
+    PLANE_TYPE   type;
+    size_t       area;
+    size_t       needed;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "O|I", keywords, &outObject, &radius))
+        return NULL;
+
+    if (PyObject_GetBuffer(outObject, &out, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT) < 0)
+        return NULL;
+
+    //The element type follows the buffer: uint8 or float32
+    if      (out.format == NULL || strcmp(out.format, "B") == 0) type = PLANE_UINT8;
+    else if (strcmp(out.format, "f") == 0)                        type = PLANE_FLOAT;
+    else
+    {
+        PyErr_SetString(PyExc_TypeError, "out must hold uint8 or float32 elements");
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    area   = radius ? (size_t) CROP_SIZE(radius) * CROP_SIZE(radius) : (size_t) Self->fieldWidth * Self->fieldHeight;
+    needed = (size_t) Self->count * PLANE_COUNT * area * (type == PLANE_FLOAT ? sizeof(float) : 1);
+
+    if ((size_t) out.len < needed)
+    {
+        PyErr_Format(PyExc_ValueError, "out must hold at least %zu bytes", needed);
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    if (!ClaimBatch(Self))
+    {
+        PyBuffer_Release(&out);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    EncodeBatch(Self->games, Self->count, radius, out.buf, type);
+    Py_END_ALLOW_THREADS
+
+    Self->busy = FALSE;
+
+    PyBuffer_Release(&out);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Batch_Field(BATCH_OBJECT* Self, PyObject* Args)
+{
+    unsigned int index;
+    SNAKE_GAME*  game;
+    void*        buffer;
+
+    if (!PyArg_ParseTuple(Args, "I", &index)) return NULL;
+
+    if (index >= Self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    if (IsBatchBusy(Self)) return NULL;
+
+    game = Self->games + index;
+
+    if (game->hFieldBuffer == NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "game has no field");
+        return NULL;
+    }
+
+    //GlobalLock only maps the handle onto its memory here, the block never moves
+    buffer = GlobalLock(game->hFieldBuffer);
+    GlobalUnlock(game->hFieldBuffer);
+
+    return CreateView((PyObject*) Self, buffer, 1, &Self->fieldExports, 1, FIELD_BUFFER_SIZE(game), 0, 0);
+}
+
+static PyObject* Batch_Hash(BATCH_OBJECT* Self, PyObject* Args)
+{
+    unsigned int index;
+
+    if (!PyArg_ParseTuple(Args, "I", &index)) return NULL;
+
+    if (index >= Self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    if (IsBatchBusy(Self)) return NULL;
+
+    return PyLong_FromUnsignedLongLong(GameHash(Self->games + index));
+}
+
+static PyObject* Batch_Canonical(BATCH_OBJECT* Self, PyObject* Args)
+{
+    CANONICAL_STATE state;
+    unsigned int    index;
+
+    if (!PyArg_ParseTuple(Args, "I", &index)) return NULL;
+
+    if (index >= Self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    if (IsBatchBusy(Self)) return NULL;
+
+    CanonicalizeGame(Self->games + index, &state);
+
+    return Py_BuildValue("KI", (unsigned long long) state.hash, state.symmetry);
+}
+
+static PyObject* Batch_GetObservations(BATCH_OBJECT* Self, void* Closure)
+{
+    return CreateView((PyObject*) Self, Self->planes, 1, NULL, 3, Self->count, Self->fieldHeight, Self->fieldWidth);
+}
+
+static PyObject* Batch_GetStatus(BATCH_OBJECT* Self, void* Closure)
+{
+    return CreateView((PyObject*) Self, Self->statuses, sizeof(UINT), NULL,
+                      2, Self->count, sizeof(SNAKE_STATUS) / sizeof(UINT), 0);
+}
+
+static PyObject* Batch_GetHeatmap(BATCH_OBJECT* Self, void* Closure)
+{
+    if (Self->heatmap.counts == NULL) Py_RETURN_NONE;
+
+    return CreateView((PyObject*) Self, Self->heatmap.counts, sizeof(UINT64), NULL,
+                      3, HEATMAP_KINDS, Self->fieldHeight, Self->fieldWidth);
+}
+
+static PyMethodDef BatchMethods[] =
+{
+    { "reset", (PyCFunction) Batch_Reset, METH_VARARGS,
+      "reset(index=-1)\n\nStart new games, all of them or only the given one." },
+    { "step",  (PyCFunction) Batch_Step,  METH_VARARGS | METH_KEYWORDS,
+      "step(actions=None, out=None)\n\nMove every running snake one block. actions holds one direction byte\n"
+      "per game (255 keeps the current direction). Observation planes go to out\n"
+      "when given, otherwise to the batch's own observations buffer." },
+    { "encode", (PyCFunction) Batch_Encode, METH_VARARGS | METH_KEYWORDS,
+      "encode(out, radius=0)\n\nWrite one-hot planes (empty, food, head, body) of every game into out,\n"
+      "shaped (count, 4, height, width), or (count, 4, 2r+1, 2r+1) head-centered\n"
+      "crops rotated to the current direction when radius is given. out holds\n"
+      "uint8 or float32 elements." },
+    { "field", (PyCFunction) Batch_Field, METH_VARARGS,
+      "field(index)\n\nRead-only view of the packed 2-bit field of one game." },
+    { "hash",  (PyCFunction) Batch_Hash,  METH_VARARGS,
+      "hash(index)\n\n64-bit Zobrist hash of the state of one game." },
+    { "canonical", (PyCFunction) Batch_Canonical, METH_VARARGS,
+      "canonical(index)\n\n(hash, symmetry) of one game in its canonical orientation. The hash is\n"
+      "the same for every rotation and mirror of the state, and symmetry holds\n"
+      "the flags taking the game there: 1 mirrors x, 2 mirrors y, 4 swaps x and y." },
+    { NULL }
+};
+
+static PyGetSetDef BatchGetSet[] =
+{
+    { "observations", (getter) Batch_GetObservations, NULL, "Read-only uint8 view shaped (count, height, width).", NULL },
+    { "status",       (getter) Batch_GetStatus,       NULL, "Read-only uint32 view shaped (count, 4): state, size, empty blocks, direction.", NULL },
+    { "heatmap",      (getter) Batch_GetHeatmap,      NULL, "Read-only uint64 view shaped (3, height, width) counting head visits, deaths and\n"
+                                                            "food placed on every block over every game, or None without heatmap=True.", NULL },
+    { NULL }
+};
+
+static PyMemberDef BatchMembers[] =
+{
+    { "count",  T_UINT, offsetof(BATCH_OBJECT, count),       READONLY, "Number of games." },
+    { "width",  T_UINT, offsetof(BATCH_OBJECT, fieldWidth),  READONLY, "Field width." },
+    { "height", T_UINT, offsetof(BATCH_OBJECT, fieldHeight), READONLY, "Field height." },
+    { NULL }
+};
+
+static PyTypeObject BatchType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "snake.Batch",
+    .tp_basicsize = sizeof(BATCH_OBJECT),
+    .tp_dealloc   = (destructor) Batch_Dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Batch(count, width=21, height=15, pass_through_walls=False, heatmap=False)\n\nGames stepped together.",
+    .tp_methods   = BatchMethods,
+    .tp_members   = BatchMembers,
+    .tp_getset    = BatchGetSet,
+    .tp_init      = (initproc) Batch_Init,
+    .tp_new       = PyType_GenericNew,
+};
+
+
+//*****************************************************************************
+//
+//                               PIPELINE TYPE
+//
+//*****************************************************************************
+
+static int Pipeline_CheckSlot(PIPELINE_OBJECT* Self, unsigned int Slot)
+{
+    if (!Self->created)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline is not initialized");
+        return -1;
+    }
+
+    if (Slot >= PIPELINE_SLOTS)
+    {
+        PyErr_SetString(PyExc_IndexError, "slot must be 0 or 1");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int Pipeline_Init(PIPELINE_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "count", "threads", "width", "height", "pass_through_walls", NULL };
+
+    unsigned int count;
+    unsigned int threads          = 0;
+    unsigned int width            = FIELD_WIDTH;
+    unsigned int height           = FIELD_HEIGHT;
+    int          passThroughWalls = PASS_THROUGH_WALLS;
+    SNAKE_RESULT result           = SR_OK;
+    UINT         i;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "I|IIIp", keywords, &count, &threads, &width, &height, &passThroughWalls))
+        return -1;
+
+    if (Self->games != NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Pipeline is already initialized");
+        return -1;
+    }
+
+    if (count < PIPELINE_SLOTS)
+    {
+        PyErr_SetString(PyExc_ValueError, "count must be at least 2");
+        return -1;
+    }
+
+    Self->games = (SNAKE_GAME*) PyMem_Calloc(count, sizeof(SNAKE_GAME));
+    if (Self->games == NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    Self->count       = count;
+    Self->fieldWidth  = width;
+    Self->fieldHeight = height;
+
+    for (i = 0; i < count && result == SR_OK; i++)
+    {
+        Self->games[i].fieldWidth       = width;
+        Self->games[i].fieldHeight      = height;
+        Self->games[i].snakeSpeed       = SNAKE_SPEED;
+        Self->games[i].passThroughWalls = passThroughWalls;
+
+        SeedGame(Self->games + i, masterSeed, nextStream++);
+
+        result = Initialize(Self->games + i, FALSE);
+    }
+
+    if (result == SR_OK) result = CreatePipeline(&Self->pipeline, Self->games, count, threads);
+
+    if (result != SR_OK)
+    {
+        RaiseResult(result);
+        return -1;
+    }
+
+    Self->created = TRUE;
+    return 0;
+}
+
+static void Pipeline_Dealloc(PIPELINE_OBJECT* Self)
+{
+    UINT i;
+
+    if (Self->created)
+    {
+        Py_BEGIN_ALLOW_THREADS
+        DestroyPipeline(&Self->pipeline);
+        Py_END_ALLOW_THREADS
+    }
+
+    if (Self->games != NULL)
+        for (i = 0; i < Self->count; i++) EndingCleanUp(Self->games + i);
+
+    PyMem_Free(Self->games);
+
+    Py_TYPE(Self)->tp_free((PyObject*) Self);
+}
+
+static PyObject* Pipeline_Submit(PIPELINE_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "slot", "actions", NULL };
+
+    unsigned int slot;
+    PyObject*    actionsObject = Py_None;
+    Py_buffer    actions       = { 0 };
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "I|O", keywords, &slot, &actionsObject)) return NULL;
+    if (Pipeline_CheckSlot(Self, slot) < 0) return NULL;
+
+    if (actionsObject != Py_None)
+    {
+        if (PyObject_GetBuffer(actionsObject, &actions, PyBUF_C_CONTIGUOUS) < 0) return NULL;
+
+        if (actions.len != (Py_ssize_t) SlotCount(&Self->pipeline, slot))
+        {
+            PyErr_Format(PyExc_ValueError, "expected %u actions, got %zd bytes",
+                         SlotCount(&Self->pipeline, slot), actions.len);
+            PyBuffer_Release(&actions);
+            return NULL;
+        }
+    }
+
+    //Submitting may have to wait for the other slot first
+    Py_BEGIN_ALLOW_THREADS
+    SubmitStep(&Self->pipeline, slot, (const BYTE*) actions.buf);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&actions);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Pipeline_Wait(PIPELINE_OBJECT* Self, PyObject* Args)
+{
+    unsigned int slot;
+    SNAKE_RESULT result;
+
+    if (!PyArg_ParseTuple(Args, "I", &slot)) return NULL;
+    if (Pipeline_CheckSlot(Self, slot) < 0) return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    result = WaitStep(&Self->pipeline, slot);
+    Py_END_ALLOW_THREADS
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Pipeline_Reset(PIPELINE_OBJECT* Self, PyObject* Args)
+{
+    unsigned int index;
+    SNAKE_GAME*  game;
+    SNAKE_RESULT result;
+
+    if (!PyArg_ParseTuple(Args, "I", &index)) return NULL;
+    if (Pipeline_CheckSlot(Self, 0) < 0) return NULL;
+
+    if (index >= Self->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    //Games of the slot in flight belong to the workers until it is waited on
+    if (Self->pipeline.busySlot >= 0 &&
+        index >= Self->pipeline.slotFirst[Self->pipeline.busySlot] &&
+        index <  Self->pipeline.slotFirst[Self->pipeline.busySlot + 1])
+    {
+        PyErr_SetString(PyExc_RuntimeError, "cannot reset a game of the slot in flight");
+        return NULL;
+    }
+
+    game   = Self->games + index;
+    result = ResetGame(game);
+
+    WriteObservation(game, Self->pipeline.planes + (size_t) index * Self->fieldWidth * Self->fieldHeight);
+    WriteStatus     (game, Self->pipeline.statuses + index);
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Pipeline_Observations(PIPELINE_OBJECT* Self, PyObject* Args)
+{
+    unsigned int slot;
+
+    if (!PyArg_ParseTuple(Args, "I", &slot)) return NULL;
+    if (Pipeline_CheckSlot(Self, slot) < 0) return NULL;
+
+    return CreateView((PyObject*) Self, SlotPlanes(&Self->pipeline, slot), 1, NULL,
+                      3, SlotCount(&Self->pipeline, slot), Self->fieldHeight, Self->fieldWidth);
+}
+
+static PyObject* Pipeline_Status(PIPELINE_OBJECT* Self, PyObject* Args)
+{
+    unsigned int slot;
+
+    if (!PyArg_ParseTuple(Args, "I", &slot)) return NULL;
+    if (Pipeline_CheckSlot(Self, slot) < 0) return NULL;
+
+    return CreateView((PyObject*) Self, SlotStatuses(&Self->pipeline, slot), sizeof(UINT), NULL,
+                      2, SlotCount(&Self->pipeline, slot), sizeof(SNAKE_STATUS) / sizeof(UINT), 0);
+}
+
+static PyObject* Pipeline_GetOverlap(PIPELINE_OBJECT* Self, void* Closure)
+{
+    if (Pipeline_CheckSlot(Self, 0) < 0) return NULL;
+
+    return PyFloat_FromDouble(PipelineOverlap(&Self->pipeline));
+}
+
+static PyMethodDef PipelineMethods[] =
+{
+    { "submit",       (PyCFunction) Pipeline_Submit,       METH_VARARGS | METH_KEYWORDS,
+      "submit(slot, actions=None)\n\nStart stepping the games of a slot on the worker threads and return." },
+    { "wait",         (PyCFunction) Pipeline_Wait,         METH_VARARGS,
+      "wait(slot)\n\nBlock until the slot is stepped; its observations and status are then current." },
+    { "reset",        (PyCFunction) Pipeline_Reset,        METH_VARARGS,
+      "reset(index)\n\nStart a new game in place of a finished one. Not allowed while its slot is in flight." },
+    { "observations", (PyCFunction) Pipeline_Observations, METH_VARARGS,
+      "observations(slot)\n\nRead-only uint8 view shaped (slot count, height, width)." },
+    { "status",       (PyCFunction) Pipeline_Status,       METH_VARARGS,
+      "status(slot)\n\nRead-only uint32 view shaped (slot count, 4)." },
+    { NULL }
+};
+
+static PyGetSetDef PipelineGetSet[] =
+{
+    { "overlap", (getter) Pipeline_GetOverlap, NULL, "Share of the stepping time hidden behind the caller's work.", NULL },
+    { NULL }
+};
+
+static PyMemberDef PipelineMembers[] =
+{
+    { "count",  T_UINT, offsetof(PIPELINE_OBJECT, count),       READONLY, "Number of games over both slots." },
+    { "width",  T_UINT, offsetof(PIPELINE_OBJECT, fieldWidth),  READONLY, "Field width." },
+    { "height", T_UINT, offsetof(PIPELINE_OBJECT, fieldHeight), READONLY, "Field height." },
+    { NULL }
+};
+
+static PyTypeObject PipelineType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "snake.Pipeline",
+    .tp_basicsize = sizeof(PIPELINE_OBJECT),
+    .tp_dealloc   = (destructor) Pipeline_Dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Pipeline(count, threads=0, width=21, height=15, pass_through_walls=False)\n\n"
+                    "Games split in two slots, one stepped by worker threads while the caller\n"
+                    "works on the observations of the other.",
+    .tp_methods   = PipelineMethods,
+    .tp_members   = PipelineMembers,
+    .tp_getset    = PipelineGetSet,
+    .tp_init      = (initproc) Pipeline_Init,
+    .tp_new       = PyType_GenericNew,
+};
+
+
+//*****************************************************************************
+//
+//                               PLANNER TYPE
+//
+//*****************************************************************************
+
+static int Planner_Init(PLANNER_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "threads", "nodes", NULL };
+
+    unsigned int threads = 0;
+    unsigned int nodes   = 0;
+    SNAKE_RESULT result;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "|II", keywords, &threads, &nodes)) return -1;
+
+    if (Self->created)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Planner is already initialized");
+        return -1;
+    }
+
+    result = CreatePlanner(&Self->planner, threads, nodes);
+
+    if (result != SR_OK)
+    {
+        RaiseResult(result);
+        return -1;
+    }
+
+    Self->created = TRUE;
+    return 0;
+}
+
+static void Planner_Dealloc(PLANNER_OBJECT* Self)
+{
+    if (Self->created) DestroyPlanner(&Self->planner);
+
+    Py_TYPE(Self)->tp_free((PyObject*) Self);
+}
+
+static PyObject* Planner_Plan(PLANNER_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "batch", "index", "budget", NULL };
+
+    BATCH_OBJECT*   batch;
+    unsigned int    index;
+    double          budget = 0.0;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "O!I|d", keywords, &BatchType, &batch, &index, &budget))
+        return NULL;
+
+    if (!Self->created)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Planner is not initialized");
+        return NULL;
+    }
+
+    if (index >= batch->count)
+    {
+        PyErr_SetString(PyExc_IndexError, "game index out of range");
+        return NULL;
+    }
+
+    if (!ClaimBatch(batch)) return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    result = PlanMove(&Self->planner, batch->games + index, budget, &direction);
+    Py_END_ALLOW_THREADS
+
+    batch->busy = FALSE;
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    return PyLong_FromLong(direction);
+}
+
+static PyObject* Planner_GetPlayouts(PLANNER_OBJECT* Self, void* Closure)
+{
+    return PyLong_FromUnsignedLongLong(Self->planner.playouts);
+}
+
+static PyObject* Planner_GetPlayoutRate(PLANNER_OBJECT* Self, void* Closure)
+{
+    return PyFloat_FromDouble(PlayoutRate(&Self->planner));
+}
+
+static PyMethodDef PlannerMethods[] =
+{
+    { "plan", (PyCFunction) Planner_Plan, METH_VARARGS | METH_KEYWORDS,
+      "plan(batch, index, budget=0.0)\n\nSearch from a game of the batch for budget seconds, or most of a tick\n"
+      "when zero, and return the direction to play." },
+    { NULL }
+};
+
+static PyGetSetDef PlannerGetSet[] =
+{
+    { "playouts",             (getter) Planner_GetPlayouts,    NULL, "Playouts run for the last move.", NULL },
+    { "playouts_per_second",  (getter) Planner_GetPlayoutRate, NULL, "Playout rate over every move planned.", NULL },
+    { NULL }
+};
+
+static PyMemberDef PlannerMembers[] =
+{
+    { "threads", T_UINT, offsetof(PLANNER_OBJECT, planner.threadCount), READONLY, "Search threads." },
+    { NULL }
+};
+
+static PyTypeObject PlannerType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "snake.Planner",
+    .tp_basicsize = sizeof(PLANNER_OBJECT),
+    .tp_dealloc   = (destructor) Planner_Dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Planner(threads=0, nodes=0)\n\n"
+                    "Monte Carlo tree search over copies of a game, on every processor by default.",
+    .tp_methods   = PlannerMethods,
+    .tp_members   = PlannerMembers,
+    .tp_getset    = PlannerGetSet,
+    .tp_init      = (initproc) Planner_Init,
+    .tp_new       = PyType_GenericNew,
+};
+
+
+//*****************************************************************************
+//
+//                                REPLAY TYPE
+//
+//*****************************************************************************
+
+//Takes a writable contiguous buffer holding at least Count elements of
+//ItemSize bytes. Returns FALSE with an exception set otherwise.
+static BOOL GetArray(PyObject* Object, Py_buffer* Buffer, Py_ssize_t ItemSize, Py_ssize_t Count, const char* Name)
+{
+    if (PyObject_GetBuffer(Object, Buffer, PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE | PyBUF_FORMAT) < 0) return FALSE;
+
+    if (Buffer->itemsize != ItemSize || Buffer->len < ItemSize * Count)
+    {
+        PyErr_Format(PyExc_ValueError, "%s must hold at least %zd elements of %zd bytes", Name, Count, ItemSize);
+        PyBuffer_Release(Buffer);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static int Replay_Init(REPLAY_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "path", "capacity", "width", "height", "pass_through_walls", "alpha", NULL };
+
+    const char*        path;
+    unsigned long long capacity         = 0;
+    unsigned int       width            = FIELD_WIDTH;
+    unsigned int       height           = FIELD_HEIGHT;
+    int                passThroughWalls = PASS_THROUGH_WALLS;
+    double             alpha            = 0.0;
+    SNAKE_RESULT       result;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "s|KIIpd", keywords, &path, &capacity, &width, &height,
+                                     &passThroughWalls, &alpha))
+        return -1;
+
+    if (Self->opened)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is already initialized");
+        return -1;
+    }
+
+    result = OpenReplay(&Self->replay, path, capacity, width, height, passThroughWalls);
+
+    if (result == SR_OK && alpha > 0.0 && (result = EnablePriorities(&Self->replay, alpha)) != SR_OK)
+        CloseReplay(&Self->replay);
+
+    if (result != SR_OK)
+    {
+        RaiseResult(result);
+        return -1;
+    }
+
+    Self->opened = TRUE;
+    return 0;
+}
+
+static void Replay_Dealloc(REPLAY_OBJECT* Self)
+{
+    if (Self->opened) CloseReplay(&Self->replay);
+
+    Py_TYPE(Self)->tp_free((PyObject*) Self);
+}
+
+static PyObject* Replay_Record(REPLAY_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char* keywords[] = { "batch", "actions", NULL };
+
+    BATCH_OBJECT* batch;
+    PyObject*     actionsObject = Py_None;
+    Py_buffer     actions       = { 0 };
+    BYTE*         planes;
+    SNAKE_GAME*   game;
+    SNAKE_RESULT  result        = SR_OK;
+    UINT          i;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "O!|O", keywords, &BatchType, &batch, &actionsObject)) return NULL;
+
+    if (!Self->opened)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is not initialized");
+        return NULL;
+    }
+
+    if (batch->fieldWidth != Self->replay.pHeader->fieldWidth || batch->fieldHeight != Self->replay.pHeader->fieldHeight)
+        return RaiseResult(SR_BAD_FIELD_SIZE);
+
+    if (actionsObject != Py_None)
+    {
+        if (PyObject_GetBuffer(actionsObject, &actions, PyBUF_C_CONTIGUOUS) < 0) return NULL;
+
+        if (actions.len != (Py_ssize_t) batch->count)
+        {
+            PyErr_Format(PyExc_ValueError, "expected %u actions, got %zd bytes", batch->count, actions.len);
+            PyBuffer_Release(&actions);
+            return NULL;
+        }
+    }
+
+    if (!ClaimBatch(batch))
+    {
+        PyBuffer_Release(&actions);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0, planes = batch->planes; i < batch->count && result == SR_OK; i++)
+    {
+        game = batch->games + i;
+
+        if (game->snakeState == RUNNING && actions.buf != NULL && ((const BYTE*) actions.buf)[i] != NO_COMMAND)
+            result = ReceiveCommand(game, (SNAKE_DIRECTION) (((const BYTE*) actions.buf)[i] & 3));
+
+        if (result == SR_OK) result = RecordMove(&Self->replay, game);
+
+        WriteObservation(game, planes);
+        WriteStatus(game, batch->statuses + i);
+
+        planes += batch->fieldWidth * batch->fieldHeight;
+    }
+    Py_END_ALLOW_THREADS
+
+    batch->busy = FALSE;
+
+    PyBuffer_Release(&actions);
+
+    if (result != SR_OK) return RaiseResult(result);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* Replay_Sample(REPLAY_OBJECT* Self, PyObject* Args, PyObject* Kwds)
+{
+    static char*       keywords[]  = { "states", "next_states", "actions", "rewards", "terminals", "indices", "weights",
+                                       "beta", NULL };
+    static const char* names[7]    = { "states", "next_states", "actions", "rewards", "terminals", "indices", "weights" };
+
+    PyObject*    objects[7] = { NULL, NULL, NULL, NULL, NULL, Py_None, Py_None };
+    Py_buffer    buffers[7];
+    Py_ssize_t   itemSizes[7];
+    Py_ssize_t   counts[7];
+    REPLAY_BATCH batch;
+    double       beta       = 0.4;
+    Py_ssize_t   count;
+    UINT         taken, sampled = 0, i;
+
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwds, "OOOOO|OOd", keywords, objects, objects + 1, objects + 2,
+                                     objects + 3, objects + 4, objects + 5, objects + 6, &beta))
+        return NULL;
+
+    if (!Self->opened)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay is not initialized");
+        return NULL;
+    }
+
+    //The batch is as long as the actions, and the planes are uint8 or float32
+    //like the states given
+    if (PyObject_GetBuffer(objects[2], buffers, PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    count = buffers[0].len;
+    PyBuffer_Release(buffers);
+
+    if (PyObject_GetBuffer(objects[0], buffers, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) return NULL;
+    memset(&batch, 0, sizeof(batch));
+    batch.type = buffers[0].itemsize == sizeof(float) ? PLANE_FLOAT : PLANE_UINT8;
+    PyBuffer_Release(buffers);
+
+    itemSizes[0] = itemSizes[1] = batch.type == PLANE_FLOAT ? sizeof(float) : 1;
+    itemSizes[2] = itemSizes[4] = 1;
+    itemSizes[3] = itemSizes[6] = sizeof(float);
+    itemSizes[5] = sizeof(UINT64);
+
+    counts[0] = counts[1] = count * PLANE_COUNT * Self->replay.pHeader->fieldWidth * Self->replay.pHeader->fieldHeight;
+    counts[2] = counts[3] = counts[4] = counts[5] = counts[6] = count;
+
+    for (i = 0, taken = 0; i < 7; i++, taken++)
+        if (objects[i] != Py_None && !GetArray(objects[i], buffers + i, itemSizes[i], counts[i], names[i])) break;
+
+    if (taken == 7)
+    {
+        batch.states     = buffers[0].buf;
+        batch.nextStates = buffers[1].buf;
+        batch.actions    = (BYTE*) buffers[2].buf;
+        batch.rewards    = (float*) buffers[3].buf;
+        batch.terminals  = (BYTE*) buffers[4].buf;
+        batch.indices    = objects[5] != Py_None ? (UINT64*) buffers[5].buf : NULL;
+        batch.weights    = objects[6] != Py_None ? (float*) buffers[6].buf : NULL;
+
+        Py_BEGIN_ALLOW_THREADS
+        sampled = Self->replay.pTree ? SamplePrioritized(&Self->replay, &batch, (UINT) count, beta) :
+                                       SampleReplay(&Self->replay, &batch, (UINT) count);
+        Py_END_ALLOW_THREADS
+    }
+
+    for (i = 0; i < taken; i++)
+        if (objects[i] != Py_None) PyBuffer_Release(buffers + i);
+
+    if (taken < 7) return NULL;
+
+    return PyLong_FromUnsignedLong(sampled);
+}
+
+static PyObject* Replay_Update(REPLAY_OBJECT* Self, PyObject* Args)
+{
+    PyObject*  indicesObject;
+    PyObject*  prioritiesObject;
+    Py_buffer  indices;
+    Py_buffer  priorities;
+    Py_ssize_t count;
+
+    if (!PyArg_ParseTuple(Args, "OO", &indicesObject, &prioritiesObject)) return NULL;
+
+    if (!Self->opened || Self->replay.pTree == NULL)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "Replay has no priorities, open it with alpha > 0");
+        return NULL;
+    }
+
+    if (PyObject_GetBuffer(indicesObject, &indices, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) return NULL;
+
+    count = indices.len / sizeof(UINT64);
+
+    if (indices.itemsize != sizeof(UINT64) ||
+        PyObject_GetBuffer(prioritiesObject, &priorities, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0)
+    {
+        if (!PyErr_Occurred()) PyErr_SetString(PyExc_ValueError, "indices must hold uint64 elements");
+        PyBuffer_Release(&indices);
+        return NULL;
+    }
+
+    if (priorities.itemsize != sizeof(float) || priorities.len != count * (Py_ssize_t) sizeof(float))
+    {
+        PyErr_SetString(PyExc_ValueError, "priorities must hold a float32 per index");
+        PyBuffer_Release(&indices);
+        PyBuffer_Release(&priorities);
+        return NULL;
+    }
+
+    SetPriorities(&Self->replay, (const UINT64*) indices.buf, (const float*) priorities.buf, (UINT) count);
+
+    PyBuffer_Release(&indices);
+    PyBuffer_Release(&priorities);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Replay_Seed(REPLAY_OBJECT* Self, PyObject* Args)
+{
+    unsigned long long seed;
+
+    if (!PyArg_ParseTuple(Args, "K", &seed)) return NULL;
+
+    SeedReplay(&Self->replay, seed);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Replay_GetSize(REPLAY_OBJECT* Self, void* Closure)
+{
+    return PyLong_FromUnsignedLongLong(ReplaySize(&Self->replay));
+}
+
+static PyObject* Replay_GetAppended(REPLAY_OBJECT* Self, void* Closure)
+{
+    return PyLong_FromUnsignedLongLong(Self->opened ? __atomic_load_n(&Self->replay.pHeader->claimed, __ATOMIC_ACQUIRE) : 0);
+}
+
+static PyObject* Replay_GetCapacity(REPLAY_OBJECT* Self, void* Closure)
+{
+    return PyLong_FromUnsignedLongLong(Self->opened ? Self->replay.pHeader->capacity : 0);
+}
+
+static PyMethodDef ReplayMethods[] =
+{
+    { "record", (PyCFunction) Replay_Record, METH_VARARGS | METH_KEYWORDS,
+      "record(batch, actions=None)\n\nStep the batch like Batch.step(actions), appending the move of every\n"
+      "running game to the replay." },
+    { "sample", (PyCFunction) Replay_Sample, METH_VARARGS | METH_KEYWORDS,
+      "sample(states, next_states, actions, rewards, terminals, indices=None, weights=None, beta=0.4)\n\n"
+      "Draw len(actions) transitions into the arrays and return how many were drawn. The\n"
+      "states are one-hot planes shaped (count, 4, height, width) of uint8 or float32,\n"
+      "rewards float32 and indices uint64. With priorities, transitions are drawn by them\n"
+      "and weights gets their importance weights raised to beta." },
+    { "update", (PyCFunction) Replay_Update, METH_VARARGS,
+      "update(indices, priorities)\n\nSet the float32 priorities of the sampled transitions." },
+    { "seed", (PyCFunction) Replay_Seed, METH_VARARGS,
+      "seed(value)\n\nSeed the draws of sample()." },
+    { NULL }
+};
+
+static PyGetSetDef ReplayGetSet[] =
+{
+    { "size",     (getter) Replay_GetSize,     NULL, "Transitions that can be sampled.", NULL },
+    { "appended", (getter) Replay_GetAppended, NULL, "Transitions appended since the file was created.", NULL },
+    { "capacity", (getter) Replay_GetCapacity, NULL, "Transitions kept before the oldest are overwritten.", NULL },
+    { NULL }
+};
+
+static PyTypeObject ReplayType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "snake.Replay",
+    .tp_basicsize = sizeof(REPLAY_OBJECT),
+    .tp_dealloc   = (destructor) Replay_Dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Replay(path, capacity=0, width=21, height=15, pass_through_walls=False, alpha=0.0)\n\n"
+                    "Transitions of the games recorded through it, kept in a file mapped into memory.\n"
+                    "Sampling is uniform, or by priorities raised to alpha when it is positive.",
+    .tp_methods   = ReplayMethods,
+    .tp_getset    = ReplayGetSet,
+    .tp_init      = (initproc) Replay_Init,
+    .tp_new       = PyType_GenericNew,
+};
+
+
+//*****************************************************************************
+//
+//                                  MODULE
+//
+//*****************************************************************************
+
+static PyObject* Snake_Seed(PyObject* Module, PyObject* Args)
+{
+    unsigned long long seed;
+
+    if (!PyArg_ParseTuple(Args, "K", &seed)) return NULL;
+
+    masterSeed = seed;
+    nextStream = 0;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef SnakeMethods[] =
+{
+    { "seed", Snake_Seed, METH_VARARGS, "seed(value)\n\nSeed the food of the games created from now on, each drawing from a stream of its own." },
+    { NULL }
+};
+
+static struct PyModuleDef SnakeModule =
+{
+    PyModuleDef_HEAD_INIT,
+    "snake",
+    "Bindings for the Snake game core.",
+    -1,
+    SnakeMethods
+};
+
+PyMODINIT_FUNC PyInit_snake(void)
+{
+    PyObject* module;
+
+    if (PyType_Ready(&BatchType) < 0 || PyType_Ready(&PipelineType) < 0 || PyType_Ready(&PlannerType) < 0 ||
+        PyType_Ready(&ReplayType) < 0 || PyType_Ready(&ViewType) < 0)
+        return NULL;
+
+    module = PyModule_Create(&SnakeModule);
+    if (module == NULL) return NULL;
+
+    Py_INCREF(&BatchType);
+    if (PyModule_AddObject(module, "Batch", (PyObject*) &BatchType) < 0)
+    {
+        Py_DECREF(&BatchType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    Py_INCREF(&PipelineType);
+    if (PyModule_AddObject(module, "Pipeline", (PyObject*) &PipelineType) < 0)
+    {
+        Py_DECREF(&PipelineType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    Py_INCREF(&PlannerType);
+    if (PyModule_AddObject(module, "Planner", (PyObject*) &PlannerType) < 0)
+    {
+        Py_DECREF(&PlannerType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    Py_INCREF(&ReplayType);
+    if (PyModule_AddObject(module, "Replay", (PyObject*) &ReplayType) < 0)
+    {
+        Py_DECREF(&ReplayType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    PyModule_AddIntConstant(module, "API_VERSION", SNAKE_API_VERSION);
+    PyModule_AddIntConstant(module, "NO_COMMAND",  NO_COMMAND);
+
+    PyModule_AddIntConstant(module, "EMPTY",      EMPTY);
+    PyModule_AddIntConstant(module, "FOOD",       FOOD);
+    PyModule_AddIntConstant(module, "SNAKE_HEAD", SNAKE_HEAD);
+    PyModule_AddIntConstant(module, "SNAKE_BODY", SNAKE_BODY);
+
+    PyModule_AddIntConstant(module, "RIGHT", RIGHT);
+    PyModule_AddIntConstant(module, "UP",    UP);
+    PyModule_AddIntConstant(module, "LEFT",  LEFT);
+    PyModule_AddIntConstant(module, "DOWN",  DOWN);
+
+    PyModule_AddIntConstant(module, "IDLE",    IDLE);
+    PyModule_AddIntConstant(module, "RUNNING", RUNNING);
+    PyModule_AddIntConstant(module, "PAUSED",  PAUSED);
+    PyModule_AddIntConstant(module, "LOST",    LOST);
+    PyModule_AddIntConstant(module, "WON",     WON);
+
+    return module;
+}
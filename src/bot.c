@@ -0,0 +1,503 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bot.h"
+#include "common.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define NO_GAME                     0xFFFFFFFF
+#define INPUT_BYTES                 4096
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _OUTPUT_BUFFER
+{
+    BYTE*  data;
+    size_t size;
+    size_t capacity;
+} OUTPUT_BUFFER;
+
+typedef struct _BOT_SLOT
+{
+    SNAKE_GAME  game;
+    CELL_EVENTS events;         //Of the last move of the game
+    UINT        number;         //Game played, or NO_GAME once the slot is done
+    UINT        ticks;
+} BOT_SLOT;
+
+//What a session keeps while it plays
+typedef struct _BOT_STATE
+{
+    BOT_SLOT*     slots;
+    BYTE*         replies;
+    UINT          nextGame;
+    UINT          recordCount;
+    OUTPUT_BUFFER records;
+    OUTPUT_BUFFER output;
+    char          input[INPUT_BYTES]; //Text read past the answer it was part of
+    UINT          inputStart;
+    UINT          inputEnd;
+} BOT_STATE;
+
+
+//*****************************************************************************
+//
+//                              GLOBAL VARIABLES
+//
+//*****************************************************************************
+
+static const char* stateNames[] = { "IDLE", "RUNNING", "PAUSED", "LOST", "WON" };
+static const char  directionLetters[] = "RULD";
+static const char  blockLetters[]     = ".FHB";
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static BOOL Append(OUTPUT_BUFFER* Buffer, const void* Data, size_t Size)
+{
+    size_t capacity = Buffer->capacity ? Buffer->capacity : 4096;
+    BYTE*  data;
+
+    if (Buffer->size + Size > Buffer->capacity)
+    {
+        while (capacity < Buffer->size + Size) capacity *= 2;
+
+        data = (BYTE*) realloc(Buffer->data, capacity);
+        if (data == NULL) return FALSE;
+
+        Buffer->data     = data;
+        Buffer->capacity = capacity;
+    }
+
+    memcpy(Buffer->data + Buffer->size, Data, Size);
+    Buffer->size += Size;
+
+    return TRUE;
+}
+
+static BOOL AppendText(OUTPUT_BUFFER* Buffer, const char* Format, ...)
+{
+    char    text[128];
+    va_list arguments;
+    int     length;
+
+    va_start(arguments, Format);
+    length = vsnprintf(text, sizeof(text), Format, arguments);
+    va_end(arguments);
+
+    return length >= 0 && Append(Buffer, text, (size_t) length < sizeof(text) ? (size_t) length : sizeof(text) - 1);
+}
+
+static BOOL WriteAll(int Output, const BYTE* Data, size_t Size)
+{
+    int written;
+
+    while (Size > 0)
+    {
+        written = (int) write(Output, Data, (UINT) (Size < 0x40000000 ? Size : 0x40000000));
+        if (written <= 0) return FALSE;
+
+        Data += written;
+        Size -= written;
+    }
+
+    return TRUE;
+}
+
+static BOOL ReadAll(int Input, BYTE* Data, size_t Size)
+{
+    int count;
+
+    while (Size > 0)
+    {
+        count = (int) read(Input, Data, (UINT) (Size < 0x40000000 ? Size : 0x40000000));
+        if (count <= 0) return FALSE;
+
+        Data += count;
+        Size -= count;
+    }
+
+    return TRUE;
+}
+
+//Fills the replies from letters, keeping whatever was read past them for the
+//next answer
+static BOOL ReadLetters(BOT_SESSION* Session, BOT_STATE* State, int Input, UINT Count)
+{
+    const char* letter;
+    char        c;
+    UINT        got = 0;
+    int         count;
+
+    while (got < Count)
+    {
+        if (State->inputStart == State->inputEnd)
+        {
+            count = (int) read(Input, State->input, sizeof(State->input));
+            if (count <= 0) return FALSE;
+
+            State->inputStart    = 0;
+            State->inputEnd      = (UINT) count;
+            Session->bytesRead  += count;
+        }
+
+        c = State->input[State->inputStart++];
+
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+
+        letter = strchr(directionLetters, c);
+
+        if      (c == '.')           State->replies[got++] = NO_COMMAND;
+        else if (letter && c != 0)   State->replies[got++] = (BYTE) (letter - directionLetters);
+        else                         return FALSE;
+    }
+
+    return TRUE;
+}
+
+//Appends a change to the record being written
+static BOOL AppendChange(BOT_SESSION* Session, OUTPUT_BUFFER* Records, WORD Position, BYTE State)
+{
+    BLOCK_CHANGE change;
+
+    if (Session->text)
+        return AppendText(Records, " %u,%u:%c", BLOCK_X(Position), BLOCK_Y(Position), blockLetters[State]);
+
+    change.blockPosition = Position;
+    change.state         = State;
+    change.reserved      = 0;
+
+    return Append(Records, &change, sizeof(change));
+}
+
+//Appends a record of the slot, listing the cell events of its last move, or
+//every block that isn't empty for a new game or when the events overflowed
+static BOOL WriteRecord(BOT_SESSION* Session, BOT_STATE* State, UINT Slot, BYTE Flags)
+{
+    BOT_SLOT*      pSlot   = State->slots + Slot;
+    SNAKE_GAME*    game    = &pSlot->game;
+    OUTPUT_BUFFER* records = &State->records;
+    const BYTE*    field;
+    BOT_RECORD     record;
+    UINT64         word, taken;
+    size_t         offset  = records->size;
+    UINT           bytes   = FIELD_BUFFER_SIZE(game);
+    UINT           count   = 0;
+    UINT           i, bit, block;
+    BOOL           ok;
+
+    if (pSlot->events.overflow) Flags |= BOT_FULL_FIELD;
+
+    memset(&record, 0, sizeof(record));
+    record.game              = pSlot->number;
+    record.slot              = (WORD) Slot;
+    record.headPosition      = game->headPosition;
+    record.foodPosition      = game->foodPosition;
+    record.snakeSize         = (WORD) game->snakeSize;
+    record.snakeState        = (BYTE) game->snakeState;
+    record.previousDirection = (BYTE) game->previousDirection;
+    record.flags             = Flags;
+
+    if (Session->text)
+        ok = AppendText(records, "game %u slot %u%s%s %s size %u direction %c head %d,%d food %d,%d changes",
+                        record.game, Slot, Flags & BOT_NEW_GAME ? " new" : "", Flags & BOT_FULL_FIELD ? " full" : "",
+                        stateNames[game->snakeState], game->snakeSize, directionLetters[game->previousDirection],
+                        BLOCK_X(game->headPosition), BLOCK_Y(game->headPosition),
+                        BLOCK_X(game->foodPosition), BLOCK_Y(game->foodPosition));
+    else ok = Append(records, &record, sizeof(record));
+
+    if (Flags & BOT_FULL_FIELD)
+    {
+        field = (const BYTE*) GlobalLock(game->hFieldBuffer);
+
+        for (i = 0; i < bytes && ok; i += 8)
+        {
+            word = 0;
+            memcpy(&word, field + i, bytes - i < 8 ? bytes - i : 8);
+
+            //One bit per block that isn't empty
+            for (taken = (word | word >> 1) & 0x5555555555555555ULL; taken != 0 && ok; taken &= taken - 1, count++)
+            {
+                bit   = __builtin_ctzll(taken);
+                block = i * 4 + bit / 2;
+                ok    = AppendChange(Session, records, BLOCK_POSITION(block % game->fieldWidth,
+                                     block / game->fieldWidth), (BYTE) (word >> bit & 3));
+            }
+        }
+
+        GlobalUnlock(game->hFieldBuffer);
+    }
+    else for (; count < pSlot->events.count && ok; count++)
+        ok = AppendChange(Session, records, pSlot->events.events[count].blockPosition,
+                          pSlot->events.events[count].newState);
+
+    if (Session->text) ok = ok && Append(records, "\n", 1);
+    else
+    {
+        record.changeCount = (WORD) count;
+        memcpy(records->data + offset, &record, sizeof(record));
+    }
+
+    State->recordCount++;
+    return ok;
+}
+
+//Starts the next game in the slot, or leaves it done when there is none
+static BOOL StartGame(BOT_SESSION* Session, BOT_STATE* State, UINT Slot)
+{
+    BOT_SLOT* pSlot = State->slots + Slot;
+
+    if (State->nextGame >= Session->games)
+    {
+        pSlot->number = NO_GAME;
+        EndingCleanUp(&pSlot->game);
+        return TRUE;
+    }
+
+    pSlot->number = State->nextGame++;
+    pSlot->ticks  = 0;
+
+    pSlot->game.fieldWidth       = Session->game.fieldWidth;
+    pSlot->game.fieldHeight      = Session->game.fieldHeight;
+    pSlot->game.snakeSpeed       = Session->game.snakeSpeed;
+    pSlot->game.passThroughWalls = Session->game.passThroughWalls;
+    pSlot->game.pEvents          = &pSlot->events;
+
+    SeedGame(&pSlot->game, Session->seed, pSlot->number);
+
+    //The field of the slot is reused from its game before
+    if (ResetGame(&pSlot->game) != SR_OK)
+    {
+        Session->failure = "the game can't start on this field";
+        return FALSE;
+    }
+
+    return WriteRecord(Session, State, Slot, BOT_NEW_GAME | BOT_FULL_FIELD);
+}
+
+//Writes the records of the round behind a frame header, with the hello in
+//front of the first frame, in a single call
+static BOOL WriteFrame(BOT_SESSION* Session, BOT_STATE* State, int Output, UINT Flags)
+{
+    BOT_HELLO hello;
+    BOT_FRAME frame;
+    SNAKE_GAME* game = &Session->game;
+    BOOL      ok     = TRUE;
+
+    State->output.size = 0;
+
+    if (Session->rounds == 0)
+    {
+        if (Session->text)
+            ok = AppendText(&State->output, "snake %u field %ux%u%s slots %u ticks %u games %u\n", BOT_VERSION,
+                            game->fieldWidth, game->fieldHeight, game->passThroughWalls ? "w" : "",
+                            Session->slots, Session->ticksPerRound, Session->games);
+        else
+        {
+            memset(&hello, 0, sizeof(hello));
+            hello.magic            = BOT_MAGIC;
+            hello.version          = BOT_VERSION;
+            hello.fieldWidth       = (BYTE) game->fieldWidth;
+            hello.fieldHeight      = (BYTE) game->fieldHeight;
+            hello.passThroughWalls = (BYTE) (game->passThroughWalls != FALSE);
+            hello.slots            = (WORD) Session->slots;
+            hello.ticksPerRound    = (WORD) Session->ticksPerRound;
+            hello.games            = Session->games;
+
+            ok = Append(&State->output, &hello, sizeof(hello));
+        }
+    }
+
+    if (Session->text)
+        ok = ok && AppendText(&State->output, "frame %u records %u%s\n", Session->rounds, State->recordCount,
+                              Flags & BOT_LAST_FRAME ? " last" : "");
+    else
+    {
+        frame.size        = (UINT) (sizeof(frame) + State->records.size);
+        frame.recordCount = State->recordCount;
+        frame.round       = Session->rounds;
+        frame.flags       = Flags;
+
+        ok = ok && Append(&State->output, &frame, sizeof(frame));
+    }
+
+    ok = ok && Append(&State->output, State->records.data, State->records.size);
+
+    if (!ok)
+    {
+        Session->failure = "out of memory";
+        return FALSE;
+    }
+
+    if (!WriteAll(Output, State->output.data, State->output.size))
+    {
+        Session->failure = "the bot stopped reading";
+        return FALSE;
+    }
+
+    Session->bytesWritten += State->output.size;
+    State->records.size    = 0;
+    State->recordCount     = 0;
+
+    return TRUE;
+}
+
+//Moves the games of every slot through the ticks of the answer, starting new
+//games in place of those that are over
+static BOOL PlayRound(BOT_SESSION* Session, BOT_STATE* State)
+{
+    BOT_SLOT* pSlot;
+    BYTE      direction;
+    UINT      tick, slot;
+
+    for (tick = 0; tick < Session->ticksPerRound; tick++)
+        for (slot = 0; slot < Session->slots; slot++)
+        {
+            pSlot = State->slots + slot;
+
+            if (pSlot->number == NO_GAME || pSlot->game.snakeState != RUNNING || pSlot->ticks >= Session->maxTicks)
+                continue;
+
+            direction = State->replies[slot * Session->ticksPerRound + tick];
+
+            if (direction <= DOWN) ReceiveCommand(&pSlot->game, (SNAKE_DIRECTION) direction);
+
+            if (MoveSnake(&pSlot->game) != SR_OK)
+            {
+                Session->failure = "out of memory";
+                return FALSE;
+            }
+
+            pSlot->ticks++;
+            Session->ticks++;
+
+            if (!WriteRecord(Session, State, slot, 0))
+            {
+                Session->failure = "out of memory";
+                return FALSE;
+            }
+        }
+
+    for (slot = 0; slot < Session->slots; slot++)
+    {
+        pSlot = State->slots + slot;
+
+        if (pSlot->number == NO_GAME) continue;
+        if (pSlot->game.snakeState == RUNNING && pSlot->ticks < Session->maxTicks) continue;
+
+        Session->won  += pSlot->game.snakeState == WON;
+        Session->lost += pSlot->game.snakeState == LOST;
+
+        if (!StartGame(Session, State, slot)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+//*****************************************************************************
+//
+//                               BOT FUNCTIONS
+//
+//*****************************************************************************
+
+BOOL PlayBotSession(BOT_SESSION* Session, int Input, int Output)
+{
+    BOT_STATE state;
+    double    start = Now(), asked;
+    UINT      active, slot;
+    BOOL      playing = TRUE;
+
+    Session->rounds       = 0;
+    Session->ticks        = 0;
+    Session->won          = 0;
+    Session->lost         = 0;
+    Session->bytesWritten = 0;
+    Session->bytesRead    = 0;
+    Session->waiting      = 0.0;
+    Session->failure      = NULL;
+
+    if (Session->slots == 0 || Session->slots > BOT_MAX_SLOTS || Session->games == 0 ||
+        Session->ticksPerRound == 0 || Session->ticksPerRound > BOT_MAX_TICKS_PER_ROUND)
+    {
+        Session->failure = "bad session parameters";
+        return FALSE;
+    }
+
+#ifdef _WIN32
+    _setmode(Input,  _O_BINARY);
+    _setmode(Output, _O_BINARY);
+#endif
+
+    memset(&state, 0, sizeof(state));
+    state.slots   = (BOT_SLOT*) calloc(Session->slots, sizeof(BOT_SLOT));
+    state.replies = (BYTE*) malloc((size_t) Session->slots * Session->ticksPerRound);
+
+    if (state.slots == NULL || state.replies == NULL)
+    {
+        Session->failure = "out of memory";
+        playing          = FALSE;
+    }
+
+    for (slot = 0; slot < Session->slots && playing; slot++) playing = StartGame(Session, &state, slot);
+
+    while (playing)
+    {
+        for (slot = 0, active = 0; slot < Session->slots; slot++) active += state.slots[slot].number != NO_GAME;
+
+        if (!WriteFrame(Session, &state, Output, active ? 0 : BOT_LAST_FRAME) || active == 0) break;
+
+        asked = Now();
+
+        if (Session->text) playing = ReadLetters(Session, &state, Input, Session->slots * Session->ticksPerRound);
+        else               playing = ReadAll(Input, state.replies, (size_t) Session->slots * Session->ticksPerRound);
+
+        Session->waiting += Now() - asked;
+        Session->rounds++;
+
+        if (!Session->text) Session->bytesRead += (UINT64) Session->slots * Session->ticksPerRound;
+
+        if (!playing) Session->failure = "the bot stopped answering";
+        else          playing          = PlayRound(Session, &state);
+    }
+
+    for (slot = 0; state.slots && slot < Session->slots; slot++) EndingCleanUp(&state.slots[slot].game);
+
+    free(state.slots);
+    free(state.replies);
+    free(state.records.data);
+    free(state.output.data);
+
+    Session->elapsed = Now() - start;
+    return Session->failure == NULL;
+}
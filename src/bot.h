@@ -0,0 +1,129 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef BOT_H
+#define BOT_H
+
+#include "snake.h"
+#include "broadcast.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define BOT_MAGIC                   0x54424E53 //"SNBT" in the first bytes of the hello
+#define BOT_VERSION                 2
+#define BOT_MAX_SLOTS               4096
+#define BOT_MAX_TICKS_PER_ROUND     256
+
+//Flags of a frame
+#define BOT_LAST_FRAME              0x0001 //Every game is over, no reply is read
+
+//Flags of a record
+#define BOT_NEW_GAME                0x01  //First record of a game, always with BOT_FULL_FIELD
+#define BOT_FULL_FIELD              0x02  //The changes list every block that isn't empty, the others are empty
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Written once before the first frame. All the integers of the protocol are
+//little endian and the structures have no padding.
+typedef struct _BOT_HELLO
+{
+    UINT magic;
+    UINT version;
+    BYTE fieldWidth;
+    BYTE fieldHeight;
+    BYTE passThroughWalls;
+    BYTE reserved;
+    WORD slots;                 //Games played at once
+    WORD ticksPerRound;
+    UINT games;                 //Played over the whole session
+} BOT_HELLO;
+
+//A frame is written every round, holding recordCount records, each one
+//followed by changeCount BLOCK_CHANGE entries. The bot answers it with
+//slots * ticksPerRound direction bytes, those of slot 0 first: a
+//SNAKE_DIRECTION per tick, applied through ReceiveCommand, or NO_COMMAND to go
+//straight. Bytes of slots whose game is over are ignored.
+typedef struct _BOT_FRAME
+{
+    UINT size;                  //Bytes of the frame, header included
+    UINT recordCount;
+    UINT round;
+    UINT flags;
+} BOT_FRAME;
+
+//A game after one tick, or as it started with BOT_NEW_GAME. A slot plays
+//games one after the other, so a new game in a slot ends the one before,
+//over when its state isn't RUNNING or when it ran out of ticks.
+typedef struct _BOT_RECORD
+{
+    UINT game;                  //Counted from 0 over the session, stream of the seed placing its food
+    WORD slot;
+    WORD changeCount;           //Blocks changed by the tick in the order they changed, a block may come twice
+    WORD headPosition;
+    WORD foodPosition;
+    WORD snakeSize;
+    BYTE snakeState;
+    BYTE previousDirection;
+    BYTE flags;
+    BYTE reserved[3];
+} BOT_RECORD;
+
+//A session plays games against a bot reading frames from Output and
+//answering on Input, either the binary frames above or, with text, lines
+//meant to be read by people:
+//
+//    snake 1 field 21x15 slots 2 ticks 1 games 10
+//    frame 0 records 2
+//    game 0 slot 0 new full RUNNING size 5 direction R head 10,7 food 3,2 changes 10,7:H 9,7:B ...
+//
+//and answered with one of R, U, L, D or . per direction byte, whitespace
+//being skipped. Fields one passes through are written as "field 21x15w".
+typedef struct _BOT_SESSION
+{
+    //Parameters, set by the caller before PlayBotSession
+    SNAKE_GAME  game;           //Field and speed of every game
+    UINT        slots;
+    UINT        ticksPerRound;
+    UINT        games;
+    UINT        maxTicks;       //A game still running after them is over
+    UINT64      seed;
+    BOOL        text;
+
+    //Statistics
+    UINT        rounds;
+    UINT64      ticks;
+    UINT        won;
+    UINT        lost;
+    UINT64      bytesWritten;
+    UINT64      bytesRead;
+    double      waiting;        //Seconds from writing a frame to reading the whole answer
+    double      elapsed;
+    const char* failure;        //Why the session stopped early, NULL when every game was played
+} BOT_SESSION;
+
+
+//*****************************************************************************
+//
+//                               BOT FUNCTIONS
+//
+//*****************************************************************************
+
+//Plays every game of the session, writing to the Output file descriptor and
+//reading from Input, and returns FALSE when it had to stop early
+BOOL            PlayBotSession     (BOT_SESSION* Session, int Input, int Output);
+
+#endif
@@ -0,0 +1,492 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+#include "broadcast.h"
+#include "shared.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define BROADCAST_MAGIC             0x54534342 //"BCST"
+#define MIN_RING_BYTES              4096
+#define MAX_CHANGES                 64    //More changes in a tick are sent as a snapshot
+#define SNAPSHOT_TRIES              16
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _RECORD_BUFFER
+{
+    BROADCAST_RECORD record;
+    BLOCK_CHANGE     changes[MAX_CHANGES];
+} RECORD_BUFFER;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+#ifndef _WIN32
+//POSIX shared memory names start with a slash
+static void SharedName(const char* Name, char* Out, size_t Size)
+{
+    snprintf(Out, Size, "%s%s", Name[0] == '/' ? "" : "/", Name);
+}
+#endif
+
+static void WriteCounters(SNAKE_GAME* Game, UINT64 Tick, BROADCAST_COUNTERS* Counters)
+{
+    memset(Counters, 0, sizeof(BROADCAST_COUNTERS));
+
+    Counters->tick              = Tick;
+    Counters->snakeState        = Game->snakeState;
+    Counters->snakeSize         = Game->snakeSize;
+    Counters->emptyBlocks       = Game->emptyBlocks;
+    Counters->previousDirection = (BYTE) Game->previousDirection;
+    Counters->fieldWidth        = (BYTE) Game->fieldWidth;
+    Counters->fieldHeight       = (BYTE) Game->fieldHeight;
+    Counters->passThroughWalls  = (BYTE) (Game->passThroughWalls != FALSE);
+    Counters->headPosition      = Game->headPosition;
+    Counters->foodPosition      = Game->foodPosition;
+}
+
+//Brings the copy of the writer up to Field, listing the blocks that changed.
+//Returns FALSE when there were more than MAX_CHANGES, the copy being updated
+//all the same.
+static BOOL FindChanges(BROADCAST* Broadcast, const BYTE* Field, UINT Bytes, BLOCK_CHANGE* Changes, UINT* Count)
+{
+    UINT64 previous, current, changed;
+    UINT   width = Broadcast->fieldWidth;
+    UINT   i, bit, block;
+
+    *Count = 0;
+
+    for (i = 0; i < Bytes; i += 8)
+    {
+        previous = current = 0;
+        memcpy(&previous, Broadcast->field + i, Bytes - i < 8 ? Bytes - i : 8);
+        memcpy(&current,  Field + i,            Bytes - i < 8 ? Bytes - i : 8);
+
+        if (previous == current) continue;
+
+        memcpy(Broadcast->field + i, &current, Bytes - i < 8 ? Bytes - i : 8);
+
+        //One bit per block whose two bits differ
+        changed = previous ^ current;
+        changed = (changed | changed >> 1) & 0x5555555555555555ULL;
+
+        for (; changed != 0 && *Count <= MAX_CHANGES; changed &= changed - 1)
+        {
+            bit   = __builtin_ctzll(changed);
+            block = i * 4 + bit / 2;
+
+            if (*Count < MAX_CHANGES)
+            {
+                Changes[*Count].blockPosition = BLOCK_POSITION(block % width, block / width);
+                Changes[*Count].state         = (BYTE) (current >> bit & 3);
+                Changes[*Count].reserved      = 0;
+            }
+
+            (*Count)++;
+        }
+    }
+
+    return *Count <= MAX_CHANGES;
+}
+
+//Writes Size bytes of Data at Position of the ring. Claiming the bytes first
+//lets readers tell whether a record was overwritten while they copied it.
+static void WriteRecord(BROADCAST* Broadcast, UINT64 Position, const void* Data, UINT Size, UINT Written)
+{
+    BROADCAST_HEADER* pHeader = Broadcast->pHeader;
+
+    STORE(&pHeader->claimed, Position + Size);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    WriteShared(Broadcast->pRing + (Position & (pHeader->ringBytes - 1)), Data, Written);
+
+    STORE_RELEASE(&pHeader->published, Position + Size);
+}
+
+static void WriteSnapshot(BROADCAST* Broadcast, const BROADCAST_COUNTERS* Counters, UINT64 RingPosition)
+{
+    BROADCAST_HEADER*   pHeader  = Broadcast->pHeader;
+    UINT64              count    = LOAD(&pHeader->snapshots);
+    BROADCAST_SNAPSHOT* pSlot    = pHeader->slots + count % 2;
+    UINT64              sequence = LOAD(&pSlot->sequence);
+    UINT                bytes    = (Counters->fieldWidth * Counters->fieldHeight + 3) / 4;
+
+    STORE(&pSlot->sequence, sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    WriteShared(&pSlot->ringPosition, &RingPosition, sizeof(UINT64));
+    WriteShared(&pSlot->counters, Counters, sizeof(BROADCAST_COUNTERS));
+    WriteShared(pSlot->field, Broadcast->field, ROUND_TO_WORDS(bytes));
+
+    STORE_RELEASE(&pSlot->sequence, sequence + 2);
+    STORE_RELEASE(&pHeader->snapshots, count + 1);
+}
+
+//Takes the latest snapshot, unless it's older than MinimumTick or keeps
+//changing under the reader
+static BOOL TakeSnapshot(SPECTATOR* Spectator, UINT64 MinimumTick)
+{
+    const BROADCAST_HEADER*   pHeader = Spectator->pHeader;
+    const BROADCAST_SNAPSHOT* pSlot;
+    UINT64                    count, sequence, position;
+    UINT                      tries;
+
+    Spectator->synced = FALSE;
+
+    for (tries = 0; tries < SNAPSHOT_TRIES; tries++)
+    {
+        if ((count = LOAD_ACQUIRE(&pHeader->snapshots)) == 0) return FALSE;
+
+        pSlot    = pHeader->slots + (count - 1) % 2;
+        sequence = LOAD_ACQUIRE(&pSlot->sequence);
+
+        if (sequence & 1) continue;
+
+        ReadShared(&position, &pSlot->ringPosition, sizeof(UINT64));
+        ReadShared(&Spectator->counters, &pSlot->counters, sizeof(BROADCAST_COUNTERS));
+        ReadShared(Spectator->field, pSlot->field, BROADCAST_FIELD_BYTES);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (LOAD(&pSlot->sequence) != sequence) continue;
+        if (Spectator->counters.tick < MinimumTick) return FALSE;
+
+        Spectator->position = position;
+        Spectator->synced   = TRUE;
+        Spectator->resyncs++;
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+//*****************************************************************************
+//
+//                            BROADCAST FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT OpenBroadcast(BROADCAST* Broadcast, const char* Name, UINT RingBytes, UINT SnapshotInterval)
+{
+    BROADCAST_HEADER* pHeader;
+    UINT64            ringBytes = MIN_RING_BYTES;
+    size_t            bytes;
+#ifndef _WIN32
+    int               file;
+#endif
+
+    memset(Broadcast, 0, sizeof(BROADCAST));
+
+    if (RingBytes == 0)        RingBytes        = BROADCAST_RING_BYTES;
+    if (SnapshotInterval == 0) SnapshotInterval = SNAPSHOT_INTERVAL;
+
+    while (ringBytes < RingBytes) ringBytes *= 2;
+
+    bytes = sizeof(BROADCAST_HEADER) + ringBytes;
+
+#ifdef _WIN32
+    Broadcast->hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD) bytes, Name);
+
+    if (Broadcast->hMapping == NULL) return SR_MEMORY_ERROR;
+
+    pHeader = (BROADCAST_HEADER*) MapViewOfFile(Broadcast->hMapping, FILE_MAP_WRITE, 0, 0, bytes);
+
+    if (pHeader == NULL)
+    {
+        CloseHandle(Broadcast->hMapping);
+        Broadcast->hMapping = NULL;
+        return SR_MEMORY_ERROR;
+    }
+#else
+    //A segment left by an earlier writer, which may have crashed, is unlinked
+    //and made anew. Spectators still attached to it see it go quiet.
+    SharedName(Name, Broadcast->name, sizeof(Broadcast->name));
+    shm_unlink(Broadcast->name);
+
+    if ((file = shm_open(Broadcast->name, O_CREAT | O_EXCL | O_RDWR, 0644)) < 0) return SR_MEMORY_ERROR;
+
+    if (ftruncate(file, (off_t) bytes) != 0)
+    {
+        close(file);
+        shm_unlink(Broadcast->name);
+        return SR_MEMORY_ERROR;
+    }
+
+    pHeader = (BROADCAST_HEADER*) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+
+    if (pHeader == (BROADCAST_HEADER*) MAP_FAILED)
+    {
+        shm_unlink(Broadcast->name);
+        return SR_MEMORY_ERROR;
+    }
+#endif
+
+    //New memory is zeroed and gets its header here. On Windows the mapping may
+    //instead be one still held open by spectators of an earlier writer, and
+    //one of the same size is carried on from where it stopped, so they keep
+    //following.
+    if (LOAD_ACQUIRE(&pHeader->magic) != BROADCAST_MAGIC || pHeader->version != BROADCAST_VERSION ||
+        pHeader->ringBytes != ringBytes)
+    {
+        memset(pHeader, 0, sizeof(BROADCAST_HEADER));
+
+        pHeader->version   = BROADCAST_VERSION;
+        pHeader->ringBytes = ringBytes;
+        STORE_RELEASE(&pHeader->magic, BROADCAST_MAGIC);
+    }
+
+    Broadcast->pHeader          = pHeader;
+    Broadcast->pRing            = (BYTE*) (pHeader + 1);
+    Broadcast->snapshotInterval = SnapshotInterval;
+
+    return SR_OK;
+}
+
+void PublishGame(BROADCAST* Broadcast, SNAKE_GAME* Game)
+{
+    BROADCAST_HEADER* pHeader = Broadcast->pHeader;
+    RECORD_BUFFER     buffer;
+    BROADCAST_RECORD  padding;
+    UINT64            position, left;
+    UINT              bytes = FIELD_BUFFER_SIZE(Game);
+    UINT              count = 0;
+    BOOL              resync;
+
+    if (pHeader == NULL || Game->hFieldBuffer == NULL) return;
+
+    memset(&buffer.record, 0, sizeof(BROADCAST_RECORD));
+    WriteCounters(Game, ++Broadcast->tick, &buffer.record.counters);
+
+    //A new field size is sent whole
+    resync = Game->fieldWidth != Broadcast->fieldWidth || Game->fieldHeight != Broadcast->fieldHeight;
+
+    if (resync)
+    {
+        memset(Broadcast->field, 0, sizeof(Broadcast->field));
+        memcpy(Broadcast->field, GlobalLock(Game->hFieldBuffer), bytes);
+
+        Broadcast->fieldWidth  = (BYTE) Game->fieldWidth;
+        Broadcast->fieldHeight = (BYTE) Game->fieldHeight;
+    }
+    else resync = !FindChanges(Broadcast, (const BYTE*) GlobalLock(Game->hFieldBuffer), bytes, buffer.changes, &count);
+
+    GlobalUnlock(Game->hFieldBuffer);
+
+    if (resync) count = 0;
+
+    buffer.record.size        = sizeof(BROADCAST_RECORD) + ROUND_TO_WORDS(count * sizeof(BLOCK_CHANGE));
+    buffer.record.changeCount = (WORD) count;
+    buffer.record.flags       = resync ? RECORD_RESYNC : 0;
+
+    //Records never wrap around the end of the ring, what is left of it is
+    //skipped with a padding record of which only the first word is written
+    position = LOAD(&pHeader->published);
+    left     = pHeader->ringBytes - (position & (pHeader->ringBytes - 1));
+
+    if (left < buffer.record.size)
+    {
+        memset(&padding, 0, sizeof(BROADCAST_RECORD));
+        padding.size  = (UINT) left;
+        padding.flags = RECORD_PADDING;
+
+        WriteRecord(Broadcast, position, &padding, (UINT) left, 8);
+        position += left;
+    }
+
+    WriteRecord(Broadcast, position, &buffer, buffer.record.size, buffer.record.size);
+
+    //Spectators that reach a resync record wait for its snapshot
+    if (resync || Broadcast->tick % Broadcast->snapshotInterval == 0)
+        WriteSnapshot(Broadcast, &buffer.record.counters, position + buffer.record.size);
+}
+
+void CloseBroadcast(BROADCAST* Broadcast)
+{
+    if (Broadcast->pHeader == NULL) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(Broadcast->pHeader);
+    CloseHandle(Broadcast->hMapping);
+#else
+    munmap(Broadcast->pHeader, sizeof(BROADCAST_HEADER) + Broadcast->pHeader->ringBytes);
+    shm_unlink(Broadcast->name);
+#endif
+
+    Broadcast->pHeader = NULL;
+}
+
+BOOL AttachSpectator(SPECTATOR* Spectator, const char* Name)
+{
+    const BROADCAST_HEADER* pHeader;
+#ifndef _WIN32
+    struct stat             status;
+    char                    name[64];
+    int                     file;
+#endif
+
+    memset(Spectator, 0, sizeof(SPECTATOR));
+
+#ifdef _WIN32
+    if ((Spectator->hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name)) == NULL) return FALSE;
+
+    pHeader = (const BROADCAST_HEADER*) MapViewOfFile(Spectator->hMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (pHeader == NULL || LOAD_ACQUIRE(&pHeader->magic) != BROADCAST_MAGIC || pHeader->version != BROADCAST_VERSION)
+    {
+        if (pHeader != NULL) UnmapViewOfFile(pHeader);
+        CloseHandle(Spectator->hMapping);
+        return FALSE;
+    }
+#else
+    SharedName(Name, name, sizeof(name));
+
+    if ((file = shm_open(name, O_RDONLY, 0)) < 0) return FALSE;
+
+    if (fstat(file, &status) != 0 || (size_t) status.st_size < sizeof(BROADCAST_HEADER))
+    {
+        close(file);
+        return FALSE;
+    }
+
+    pHeader = (const BROADCAST_HEADER*) mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (pHeader == (const BROADCAST_HEADER*) MAP_FAILED) return FALSE;
+
+    if (LOAD_ACQUIRE(&pHeader->magic) != BROADCAST_MAGIC || pHeader->version != BROADCAST_VERSION ||
+        (size_t) status.st_size < sizeof(BROADCAST_HEADER) + pHeader->ringBytes)
+    {
+        munmap((void*) pHeader, status.st_size);
+        return FALSE;
+    }
+#endif
+
+    Spectator->pHeader = pHeader;
+    Spectator->pRing   = (const BYTE*) (pHeader + 1);
+
+    return TRUE;
+}
+
+UINT FollowBroadcast(SPECTATOR* Spectator)
+{
+    const BROADCAST_HEADER* pHeader   = Spectator->pHeader;
+    UINT64                  ringBytes = pHeader->ringBytes;
+    RECORD_BUFFER           buffer;
+    UINT64                  published, offset;
+    UINT                    followed = 0;
+    UINT                    size, block, i;
+    BYTE*                   pByte;
+    BOOL                    valid;
+
+    if (!Spectator->synced && !TakeSnapshot(Spectator, 0)) return 0;
+
+    while ((published = LOAD_ACQUIRE(&pHeader->published)) != Spectator->position)
+    {
+        //A whole ring behind, or the writer started over
+        if (published < Spectator->position || published - Spectator->position > ringBytes)
+        {
+            if (!TakeSnapshot(Spectator, 0)) break;
+            continue;
+        }
+
+        offset = Spectator->position & (ringBytes - 1);
+
+        ReadShared(&buffer.record, Spectator->pRing + offset, 8);
+        size = buffer.record.size;
+
+        if (buffer.record.flags & RECORD_PADDING) valid = offset + size == ringBytes;
+        else valid = size >= sizeof(BROADCAST_RECORD) && size <= sizeof(RECORD_BUFFER) &&
+                     size % 8 == 0 && offset + size <= ringBytes;
+
+        if (valid && !(buffer.record.flags & RECORD_PADDING)) ReadShared(&buffer, Spectator->pRing + offset, size);
+
+        //Whatever was read is only good if the writer hasn't claimed its bytes
+        //again since
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (!valid || LOAD(&pHeader->claimed) - Spectator->position > ringBytes)
+        {
+            if (!TakeSnapshot(Spectator, 0)) break;
+            continue;
+        }
+
+        if (buffer.record.flags & RECORD_PADDING)
+        {
+            Spectator->position += size;
+            continue;
+        }
+
+        if (buffer.record.flags & RECORD_RESYNC)
+        {
+            if (!TakeSnapshot(Spectator, buffer.record.counters.tick)) break;
+
+            followed++;
+            continue;
+        }
+
+        for (i = 0; i < buffer.record.changeCount; i++)
+        {
+            block  = BLOCK_BUFFER_POSITION(&buffer.record.counters, buffer.changes[i].blockPosition);
+            pByte  = Spectator->field + block / 4;
+            *pByte = (BYTE) ((*pByte & ~(3 << block % 4 * 2)) | buffer.changes[i].state << block % 4 * 2);
+        }
+
+        Spectator->counters  = buffer.record.counters;
+        Spectator->position += size;
+        followed++;
+    }
+
+    return followed;
+}
+
+void DetachSpectator(SPECTATOR* Spectator)
+{
+    if (Spectator->pHeader == NULL) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(Spectator->pHeader);
+    CloseHandle(Spectator->hMapping);
+#else
+    munmap((void*) Spectator->pHeader, sizeof(BROADCAST_HEADER) + Spectator->pHeader->ringBytes);
+#endif
+
+    Spectator->pHeader = NULL;
+}
+
+BLOCK_STATE SpectatorBlock(const SPECTATOR* Spectator, UINT X, UINT Y)
+{
+    UINT block = Y * Spectator->counters.fieldWidth + X;
+
+    return (BLOCK_STATE) (Spectator->field[block / 4] >> block % 4 * 2 & 3);
+}
@@ -0,0 +1,156 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define BROADCAST_NAME              "SnakeBroadcast" //Shared memory the window game publishes to
+#define BROADCAST_VERSION           1
+#define BROADCAST_RING_BYTES        (1 << 20)  //Default ring size, thousands of ticks
+#define SNAPSHOT_INTERVAL           64         //Default ticks between full snapshots
+#define BROADCAST_FIELD_BYTES       4040       //Largest packed field, rounded up to whole words
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Everything about a tick but its blocks. Ticks count the calls to
+//PublishGame, whatever game was playing.
+typedef struct _BROADCAST_COUNTERS
+{
+    UINT64 tick;
+    UINT   snakeState;
+    UINT   snakeSize;
+    UINT   emptyBlocks;
+    BYTE   previousDirection;
+    BYTE   fieldWidth;
+    BYTE   fieldHeight;
+    BYTE   passThroughWalls;
+    WORD   headPosition;
+    WORD   foodPosition;
+    UINT   reserved;
+} BROADCAST_COUNTERS;
+
+//Full copy of a game, written under a sequence number that is odd while the
+//snapshot changes
+typedef struct _BROADCAST_SNAPSHOT
+{
+    UINT64             sequence;
+    UINT64             ringPosition;    //Where the records following the snapshot start
+    BROADCAST_COUNTERS counters;
+    BYTE               field[BROADCAST_FIELD_BYTES];
+} BROADCAST_SNAPSHOT;
+
+//Start of the shared memory, followed by the ring of records. Ring positions
+//count the bytes ever written and wrap around by the ring size.
+typedef struct _BROADCAST_HEADER
+{
+    UINT               magic;
+    UINT               version;
+    UINT64             ringBytes;       //A power of two
+    UINT64             claimed;         //Records below it are complete or being written
+    UINT64             published;       //Records below it are complete
+    UINT64             snapshots;       //Snapshots written, the latest in slot (snapshots - 1) % 2
+    BROADCAST_SNAPSHOT slots[2];
+} BROADCAST_HEADER;
+
+//One tick in the ring: the counters and the blocks that changed since the
+//tick before, as BLOCK_CHANGE entries right after the record
+typedef struct _BROADCAST_RECORD
+{
+    UINT               size;            //Bytes of the record and its changes, a multiple of 8
+    WORD               changeCount;
+    WORD               flags;           //RECORD_PADDING or RECORD_RESYNC
+    BROADCAST_COUNTERS counters;
+} BROADCAST_RECORD;
+
+#define RECORD_PADDING              0x0001 //Fills the ring up to its end, skipped
+#define RECORD_RESYNC               0x0002 //Too much changed, take the latest snapshot
+
+typedef struct _BLOCK_CHANGE
+{
+    WORD blockPosition;
+    BYTE state;                         //BLOCK_STATE
+    BYTE reserved;
+} BLOCK_CHANGE;
+
+//The single writer. Readers map the memory read-only and never write to it,
+//so any number of them costs the writer nothing.
+typedef struct _BROADCAST
+{
+    BROADCAST_HEADER* pHeader;
+    BYTE*             pRing;
+    UINT              snapshotInterval;
+    UINT64            tick;
+    BYTE              fieldWidth;       //Of the field as last published
+    BYTE              fieldHeight;
+    BYTE              field[BROADCAST_FIELD_BYTES + 8];
+#ifdef _WIN32
+    HANDLE            hMapping;
+#else
+    char              name[64];
+#endif
+} BROADCAST;
+
+//A reader following a broadcast, with its own copy of the game as of the
+//last tick it followed
+typedef struct _SPECTATOR
+{
+    const BROADCAST_HEADER* pHeader;
+    const BYTE*             pRing;
+    UINT64                  position;       //Next record to read
+    BOOL                    synced;
+    BROADCAST_COUNTERS      counters;
+    BYTE                    field[BROADCAST_FIELD_BYTES];
+    UINT64                  resyncs;        //Snapshots taken, the first one included
+#ifdef _WIN32
+    HANDLE                  hMapping;
+#endif
+} SPECTATOR;
+
+
+//*****************************************************************************
+//
+//                            BROADCAST FUNCTIONS
+//
+//*****************************************************************************
+
+//Creates the shared memory under Name, replacing any broadcast left there.
+//Only one writer may publish under a name at a time. RingBytes is rounded up
+//to a power of two, zero taking BROADCAST_RING_BYTES, and a zero
+//SnapshotInterval takes SNAPSHOT_INTERVAL.
+SNAKE_RESULT    OpenBroadcast    (BROADCAST* Broadcast, const char* Name, UINT RingBytes, UINT SnapshotInterval);
+
+//Publishes the game as the next tick. Does nothing on a broadcast that
+//failed to open.
+void            PublishGame      (BROADCAST* Broadcast, SNAKE_GAME* Game);
+void            CloseBroadcast   (BROADCAST* Broadcast);
+
+BOOL            AttachSpectator  (SPECTATOR* Spectator, const char* Name);
+
+//Brings the copy of the spectator up to the latest tick published, and
+//returns how many ticks were followed. A spectator that fell a whole ring
+//behind jumps to the latest snapshot instead.
+UINT            FollowBroadcast  (SPECTATOR* Spectator);
+void            DetachSpectator  (SPECTATOR* Spectator);
+
+//State of a block in the copy of the spectator
+BLOCK_STATE     SpectatorBlock   (const SPECTATOR* Spectator, UINT X, UINT Y);
+
+#endif
@@ -0,0 +1,52 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <time.h>
+#include "common.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              COMMON FUNCTIONS
+//
+//*****************************************************************************
+
+double Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+UINT ProcessorCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (UINT) count : 1;
+#endif
+}
+
+UINT64 SplitMix64(UINT64* State)
+{
+    UINT64 z = (*State += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
@@ -0,0 +1,42 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define MAX_THREADS                 64    //Most threads a tool starts
+
+//Actions turn left, keep going and turn right, in that order
+#define TURN(d, a)                  ((SNAKE_DIRECTION) (((int) (d) + 1 - (int) (a)) & 3))
+
+
+//*****************************************************************************
+//
+//                              COMMON FUNCTIONS
+//
+//*****************************************************************************
+
+//Seconds of a monotonic clock, for timing and deadlines
+double          Now            (void);
+
+//Processors online, at least one
+UINT            ProcessorCount (void);
+
+//splitmix64: steps State and returns its next value. Any seed will do, zero
+//included, and a key copied into a state and stepped once comes out hashed.
+UINT64          SplitMix64     (UINT64* State);
+
+#endif
@@ -0,0 +1,236 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <string.h>
+#include "encoder.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define ELEMENT_SIZE(t)             ((t) == PLANE_FLOAT ? sizeof(float) : sizeof(BYTE))
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+#ifdef __SSE2__
+//Turns 4 packed bytes into the states of 16 blocks. Each byte is spread over
+//4 lanes, and each lane keeps only its own bit pair, whose low and high bits
+//are then tested separately, which avoids per-lane shifts.
+static __m128i Unpack16(const BYTE* Packed)
+{
+    const __m128i lowBits  = _mm_set1_epi32(0x40100401);
+    const __m128i highBits = _mm_set1_epi32((int) 0x80200802);
+    __m128i       bytes;
+    __m128i       low, high;
+    int           word;
+
+    memcpy(&word, Packed, sizeof(int));
+
+    bytes = _mm_cvtsi32_si128(word);
+    bytes = _mm_unpacklo_epi8 (bytes, bytes);
+    bytes = _mm_unpacklo_epi16(bytes, bytes);
+
+    low  = _mm_cmpeq_epi8(_mm_and_si128(bytes, lowBits),  lowBits);
+    high = _mm_cmpeq_epi8(_mm_and_si128(bytes, highBits), highBits);
+
+    return _mm_or_si128(_mm_and_si128(low,  _mm_set1_epi8(1)),
+                        _mm_and_si128(high, _mm_set1_epi8(2)));
+}
+
+//Writes 16 one-hot values from a 0x00/0xFF byte mask
+static void Store16(void* Plane, __m128i Mask, PLANE_TYPE Type)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128i      half, quarter;
+    float*       pFloat = (float*) Plane;
+
+    if (Type == PLANE_UINT8)
+    {
+        _mm_storeu_si128((__m128i*) Plane, _mm_and_si128(Mask, _mm_set1_epi8(1)));
+        return;
+    }
+
+    half    = _mm_unpacklo_epi8 (Mask, Mask);
+    quarter = _mm_unpacklo_epi16(half, half);
+    _mm_storeu_ps(pFloat,      _mm_and_ps(_mm_castsi128_ps(quarter), one));
+    quarter = _mm_unpackhi_epi16(half, half);
+    _mm_storeu_ps(pFloat + 4,  _mm_and_ps(_mm_castsi128_ps(quarter), one));
+
+    half    = _mm_unpackhi_epi8 (Mask, Mask);
+    quarter = _mm_unpacklo_epi16(half, half);
+    _mm_storeu_ps(pFloat + 8,  _mm_and_ps(_mm_castsi128_ps(quarter), one));
+    quarter = _mm_unpackhi_epi16(half, half);
+    _mm_storeu_ps(pFloat + 12, _mm_and_ps(_mm_castsi128_ps(quarter), one));
+}
+#endif
+
+static void SetPlaneValue(void* Planes, UINT Index, PLANE_TYPE Type)
+{
+    if (Type == PLANE_FLOAT) ((float*) Planes)[Index] = 1.0f;
+    else                     ((BYTE*)  Planes)[Index] = 1;
+}
+
+
+//*****************************************************************************
+//
+//                             ENCODER FUNCTIONS
+//
+//*****************************************************************************
+
+void UnpackField(SNAKE_GAME* Game, BYTE* States)
+{
+    BYTE* pFieldBuffer;
+    UINT  blocks = Game->fieldWidth * Game->fieldHeight;
+    UINT  i      = 0;
+
+    pFieldBuffer = (BYTE*) GlobalLock(Game->hFieldBuffer);
+
+#ifdef __SSE2__
+    //The buffer holds whole rows back to back, so it unpacks linearly
+    for (; i + 16 <= blocks; i += 16)
+        _mm_storeu_si128((__m128i*) (States + i), Unpack16(pFieldBuffer + i / 4));
+#endif
+
+    for (; i < blocks; i++)
+        States[i] = (pFieldBuffer[i / 4] >> 2 * (i % 4)) & 0x03;
+
+    GlobalUnlock(Game->hFieldBuffer);
+}
+
+void EncodePlanes(SNAKE_GAME* Game, void* Planes, PLANE_TYPE Type)
+{
+    UINT blocks = Game->fieldWidth * Game->fieldHeight;
+
+    if (Game->hFieldBuffer == NULL)
+    {
+        memset(Planes, 0, PLANE_COUNT * blocks * ELEMENT_SIZE(Type));
+        return;
+    }
+
+    EncodePacked((const BYTE*) GlobalLock(Game->hFieldBuffer), blocks, Planes, Type);
+    GlobalUnlock(Game->hFieldBuffer);
+}
+
+void EncodePacked(const BYTE* Packed, UINT Blocks, void* Planes, PLANE_TYPE Type)
+{
+    BYTE*  pPlanes     = (BYTE*) Planes;
+    size_t elementSize = ELEMENT_SIZE(Type);
+    size_t planeBytes  = Blocks * elementSize;
+    UINT   i           = 0;
+    int    state;
+
+#ifdef __SSE2__
+    for (; i + 16 <= Blocks; i += 16)
+    {
+        __m128i states = Unpack16(Packed + i / 4);
+
+        for (state = 0; state < PLANE_COUNT; state++)
+            Store16(pPlanes + state * planeBytes + i * elementSize,
+                    _mm_cmpeq_epi8(states, _mm_set1_epi8((char) state)), Type);
+    }
+#endif
+
+    for (; i < Blocks; i++)
+    {
+        for (state = 0; state < PLANE_COUNT; state++)
+        {
+            if (Type == PLANE_FLOAT) ((float*) (pPlanes + state * planeBytes))[i] = 0.0f;
+            else                     pPlanes[state * planeBytes + i]              = 0;
+        }
+
+        state = (Packed[i / 4] >> 2 * (i % 4)) & 0x03;
+        SetPlaneValue(pPlanes + state * planeBytes, i, Type);
+    }
+}
+
+void EncodeCrop(SNAKE_GAME* Game, UINT Radius, void* Planes, PLANE_TYPE Type)
+{
+    static const int directionX[4] = { 1, 0, -1,  0 };
+    static const int directionY[4] = { 0, 1,  0, -1 };
+
+    BYTE*  pFieldBuffer;
+    BYTE*  pPlanes    = (BYTE*) Planes;
+    int    size       = CROP_SIZE(Radius);
+    int    width      = (int) Game->fieldWidth;
+    int    height     = (int) Game->fieldHeight;
+    size_t planeBytes = (size_t) size * size * ELEMENT_SIZE(Type);
+    int    forwardX, forwardY, rightX, rightY;
+    int    headX, headY;
+    int    row, column, x, y;
+    UINT   index;
+
+    memset(Planes, 0, PLANE_COUNT * planeBytes);
+
+    if (Game->hFieldBuffer == NULL || Game->snakeSize == 0) return;
+
+    //Crop rows advance along the current direction, columns to its right
+    forwardX = directionX[Game->previousDirection];
+    forwardY = directionY[Game->previousDirection];
+    rightX   =  forwardY;
+    rightY   = -forwardX;
+    headX    = BLOCK_X(Game->headPosition);
+    headY    = BLOCK_Y(Game->headPosition);
+
+    //Only the blocks of the crop are read, straight from the packed field
+    pFieldBuffer = (BYTE*) GlobalLock(Game->hFieldBuffer);
+
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            x = headX + (column - (int) Radius) * rightX + (row - (int) Radius) * forwardX;
+            y = headY + (column - (int) Radius) * rightY + (row - (int) Radius) * forwardY;
+
+            if (Game->passThroughWalls)
+            {
+                x = ((x % width)  + width)  % width;
+                y = ((y % height) + height) % height;
+            }
+            else if (x < 0 || x >= width || y < 0 || y >= height) continue;
+
+            index = (UINT) (y * width + x);
+            SetPlaneValue(pPlanes + (pFieldBuffer[index / 4] >> 2 * (index % 4) & 0x03) * planeBytes,
+                          row * size + column, Type);
+        }
+    }
+
+    GlobalUnlock(Game->hFieldBuffer);
+}
+
+void EncodeBatch(SNAKE_GAME* Games, UINT Count, UINT Radius, void* Planes, PLANE_TYPE Type)
+{
+    BYTE*  pPlanes = (BYTE*) Planes;
+    size_t gameBytes;
+    UINT   i;
+
+    if (Count == 0) return;
+
+    if (Radius == 0) gameBytes = (size_t) Games->fieldWidth * Games->fieldHeight;
+    else             gameBytes = (size_t) CROP_SIZE(Radius) * CROP_SIZE(Radius);
+
+    gameBytes *= PLANE_COUNT * ELEMENT_SIZE(Type);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Radius == 0) EncodePlanes(Games + i, pPlanes, Type);
+        else             EncodeCrop  (Games + i, Radius, pPlanes, Type);
+
+        pPlanes += gameBytes;
+    }
+}
@@ -0,0 +1,64 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define PLANE_COUNT                 4     //One plane per BLOCK_STATE
+#define CROP_SIZE(r)                (2 * (r) + 1)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _PLANE_TYPE
+{
+    PLANE_UINT8,                //Planes hold 0 or 1 bytes
+    PLANE_FLOAT                 //Planes hold 0.0f or 1.0f
+} PLANE_TYPE;
+
+
+//*****************************************************************************
+//
+//                             ENCODER FUNCTIONS
+//
+//*****************************************************************************
+
+//Expands the packed field into one byte per block, row by row.
+void    UnpackField  (SNAKE_GAME* Game, BYTE* States);
+
+//One-hot planes shaped [PLANE_COUNT][fieldHeight][fieldWidth], plane k being
+//set where the block state equals k.
+void    EncodePlanes (SNAKE_GAME* Game, void* Planes, PLANE_TYPE Type);
+
+//The same planes from a packed field of Blocks blocks kept anywhere, such as
+//a replay file
+void    EncodePacked (const BYTE* Packed, UINT Blocks, void* Planes, PLANE_TYPE Type);
+
+//One-hot planes shaped [PLANE_COUNT][2R+1][2R+1] centered on the head and
+//rotated so that the current direction always points to the last row. Blocks
+//beyond the walls wrap around in Pass Through Walls Mode, otherwise all their
+//planes are zero.
+void    EncodeCrop   (SNAKE_GAME* Game, UINT Radius, void* Planes, PLANE_TYPE Type);
+
+//Encodes every game of a batch one after another into Planes, as full planes
+//when Radius is zero or as crops otherwise. All games must share the field size.
+void    EncodeBatch  (SNAKE_GAME* Games, UINT Count, UINT Radius, void* Planes, PLANE_TYPE Type);
+
+#endif
@@ -0,0 +1,674 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "evolve.h"
+#include "common.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define ARENA_ALIGNMENT             64
+#define TOURNAMENT_SIZE             3
+#define SURVIVAL_WEIGHT             0.001f //Fitness of a tick survived, next to 1 per food
+#define STARVATION_BLOCKS           2     //Games end after this many field areas without food
+#define CHECKPOINT_MAGIC            0x56454E53 //"SNEV"
+#define CHECKPOINT_VERSION          2
+
+//Rows of a genome, see GENOME_WEIGHT
+#define HIDDEN_WEIGHT(h, f)         ((h) * EVOLVE_FEATURES + (f))
+#define HIDDEN_BIAS(h)              (EVOLVE_HIDDEN * EVOLVE_FEATURES + (h))
+#define OUTPUT_WEIGHT(o, h)         (HIDDEN_BIAS(EVOLVE_HIDDEN) + (o) * EVOLVE_HIDDEN + (h))
+#define OUTPUT_BIAS(o)              (OUTPUT_WEIGHT(EVOLVE_OUTPUTS, 0) + (o))
+
+#define BLOCK_FLOATS                (GENOME_WEIGHTS * EVOLVE_LANES)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _EVOLUTION_WORKER
+{
+    EVOLUTION*   evolution;
+    UINT*        nextBlock;
+    SNAKE_RESULT result;
+} EVOLUTION_WORKER;
+
+typedef struct _CHECKPOINT_HEADER
+{
+    UINT   magic;
+    UINT   version;
+    UINT   population;
+    UINT   features;
+    UINT   hidden;
+    UINT   outputs;
+    UINT   gamesPerGenome;
+    UINT   fieldWidth;
+    UINT   fieldHeight;
+    UINT   passThroughWalls;
+    float  mutationRate;
+    float  mutationScale;
+    float  eliteShare;
+    UINT   generation;
+    UINT64 random;
+    double elapsed;
+    float  bestFitness;         //Of the generation the saved one was bred from
+    float  meanFitness;
+} CHECKPOINT_HEADER;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static float* AllocateArena(size_t Floats)
+{
+    void* arena = NULL;
+
+#ifdef _WIN32
+    arena = _aligned_malloc(Floats * sizeof(float), ARENA_ALIGNMENT);
+#else
+    if (posix_memalign(&arena, ARENA_ALIGNMENT, Floats * sizeof(float)) != 0) arena = NULL;
+#endif
+
+    return (float*) arena;
+}
+
+static void FreeArena(float* Arena)
+{
+#ifdef _WIN32
+    _aligned_free(Arena);
+#else
+    free(Arena);
+#endif
+}
+
+static float UniformRandom(UINT64* State)
+{
+    return (SplitMix64(State) >> 40) * (1.0f / 16777216.0f);
+}
+
+static float GaussianRandom(UINT64* State)
+{
+    float u = UniformRandom(State) + 1e-7f;
+    float v = UniformRandom(State);
+
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+//Blocks that can be crossed from the head in a direction before hitting
+//something, at most the larger side of the field
+static UINT FreeRun(SNAKE_GAME* Game, SNAKE_DIRECTION Direction)
+{
+    UINT limit = Game->fieldWidth > Game->fieldHeight ? Game->fieldWidth : Game->fieldHeight;
+    WORD position = Game->headPosition;
+    UINT run;
+
+    for (run = 0; run < limit; run++)
+    {
+        position = NewPosition(Game, position, 1, Direction);
+
+        if (!IsInsideField(Game, position) || !IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position))) break;
+    }
+
+    return run;
+}
+
+//Features seen from the head, relative to the current direction: whether the
+//blocks to the left, ahead and to the right are blocked, how far each way is
+//free, where the food lies ahead and to the right, the length of the snake
+//and the time since it last ate.
+static void WriteFeatures(SNAKE_GAME* Game, UINT Hunger, float* Features, UINT Lane)
+{
+    static const int directionX[4] = { 1, 0, -1,  0 };
+    static const int directionY[4] = { 0, 1,  0, -1 };
+
+    float blocks = (float) (Game->fieldWidth * Game->fieldHeight);
+    float span   = (float) (Game->fieldWidth > Game->fieldHeight ? Game->fieldWidth : Game->fieldHeight);
+    int   forwardX = directionX[Game->previousDirection];
+    int   forwardY = directionY[Game->previousDirection];
+    int   dx = BLOCK_X(Game->foodPosition) - BLOCK_X(Game->headPosition);
+    int   dy = BLOCK_Y(Game->foodPosition) - BLOCK_Y(Game->headPosition);
+    UINT  action, run;
+
+    for (action = 0; action < EVOLVE_OUTPUTS; action++)
+    {
+        run = FreeRun(Game, TURN(Game->previousDirection, action));
+
+        Features[action * EVOLVE_LANES + Lane]                        = run == 0 ? 1.0f : 0.0f;
+        Features[(EVOLVE_OUTPUTS + action) * EVOLVE_LANES + Lane]     = run / span;
+    }
+
+    //Without walls the food is reached the shorter way around
+    if (Game->passThroughWalls)
+    {
+        if (2 * dx >  (int) Game->fieldWidth)  dx -= Game->fieldWidth;
+        if (2 * dx < -(int) Game->fieldWidth)  dx += Game->fieldWidth;
+        if (2 * dy >  (int) Game->fieldHeight) dy -= Game->fieldHeight;
+        if (2 * dy < -(int) Game->fieldHeight) dy += Game->fieldHeight;
+    }
+
+    Features[6 * EVOLVE_LANES + Lane] = (dx * forwardX + dy * forwardY) / span;
+    Features[7 * EVOLVE_LANES + Lane] = (dx * forwardY - dy * forwardX) / span;
+    Features[8 * EVOLVE_LANES + Lane] = Game->snakeSize / blocks;
+    Features[9 * EVOLVE_LANES + Lane] = Hunger / blocks;
+}
+
+//Forward pass of a block of genomes. Features and outputs are stored row by
+//row with one lane per genome, like the weights, so every operation is a
+//vertical one over all the lanes.
+static void ForwardBlock(const float* Block, const float* Features, float* Outputs)
+{
+    float hidden[EVOLVE_HIDDEN * EVOLVE_LANES] __attribute__((aligned(32)));
+    UINT  h, f, o;
+
+#if defined(__AVX__)
+    for (h = 0; h < EVOLVE_HIDDEN; h++)
+    {
+        __m256 sum = _mm256_load_ps(Block + HIDDEN_BIAS(h) * EVOLVE_LANES);
+
+        for (f = 0; f < EVOLVE_FEATURES; f++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_load_ps(Block + HIDDEN_WEIGHT(h, f) * EVOLVE_LANES),
+                                                   _mm256_load_ps(Features + f * EVOLVE_LANES)));
+
+        _mm256_store_ps(hidden + h * EVOLVE_LANES, _mm256_max_ps(sum, _mm256_setzero_ps()));
+    }
+
+    for (o = 0; o < EVOLVE_OUTPUTS; o++)
+    {
+        __m256 sum = _mm256_load_ps(Block + OUTPUT_BIAS(o) * EVOLVE_LANES);
+
+        for (h = 0; h < EVOLVE_HIDDEN; h++)
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_load_ps(Block + OUTPUT_WEIGHT(o, h) * EVOLVE_LANES),
+                                                   _mm256_load_ps(hidden + h * EVOLVE_LANES)));
+
+        _mm256_store_ps(Outputs + o * EVOLVE_LANES, sum);
+    }
+#elif defined(__SSE__)
+    UINT half;
+
+    //Two halves of four lanes each
+    for (half = 0; half < EVOLVE_LANES; half += 4)
+    {
+        for (h = 0; h < EVOLVE_HIDDEN; h++)
+        {
+            __m128 sum = _mm_load_ps(Block + HIDDEN_BIAS(h) * EVOLVE_LANES + half);
+
+            for (f = 0; f < EVOLVE_FEATURES; f++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(Block + HIDDEN_WEIGHT(h, f) * EVOLVE_LANES + half),
+                                                 _mm_load_ps(Features + f * EVOLVE_LANES + half)));
+
+            _mm_store_ps(hidden + h * EVOLVE_LANES + half, _mm_max_ps(sum, _mm_setzero_ps()));
+        }
+
+        for (o = 0; o < EVOLVE_OUTPUTS; o++)
+        {
+            __m128 sum = _mm_load_ps(Block + OUTPUT_BIAS(o) * EVOLVE_LANES + half);
+
+            for (h = 0; h < EVOLVE_HIDDEN; h++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(Block + OUTPUT_WEIGHT(o, h) * EVOLVE_LANES + half),
+                                                 _mm_load_ps(hidden + h * EVOLVE_LANES + half)));
+
+            _mm_store_ps(Outputs + o * EVOLVE_LANES + half, sum);
+        }
+    }
+#else
+    UINT  lane;
+    float sum;
+
+    for (lane = 0; lane < EVOLVE_LANES; lane++)
+    {
+        for (h = 0; h < EVOLVE_HIDDEN; h++)
+        {
+            sum = Block[HIDDEN_BIAS(h) * EVOLVE_LANES + lane];
+
+            for (f = 0; f < EVOLVE_FEATURES; f++)
+                sum += Block[HIDDEN_WEIGHT(h, f) * EVOLVE_LANES + lane] * Features[f * EVOLVE_LANES + lane];
+
+            hidden[h * EVOLVE_LANES + lane] = sum > 0.0f ? sum : 0.0f;
+        }
+
+        for (o = 0; o < EVOLVE_OUTPUTS; o++)
+        {
+            sum = Block[OUTPUT_BIAS(o) * EVOLVE_LANES + lane];
+
+            for (h = 0; h < EVOLVE_HIDDEN; h++)
+                sum += Block[OUTPUT_WEIGHT(o, h) * EVOLVE_LANES + lane] * hidden[h * EVOLVE_LANES + lane];
+
+            Outputs[o * EVOLVE_LANES + lane] = sum;
+        }
+    }
+#endif
+}
+
+//Plays the games of a block of genomes side by side, adding the fitness of
+//each game to its genome
+static SNAKE_RESULT PlayBlock(EVOLUTION* Evolution, UINT Block)
+{
+    float        features[EVOLVE_FEATURES * EVOLVE_LANES] __attribute__((aligned(32)));
+    float        outputs[EVOLVE_OUTPUTS * EVOLVE_LANES]   __attribute__((aligned(32)));
+    SNAKE_GAME   games[EVOLVE_LANES];
+    UINT         hunger[EVOLVE_LANES];
+    UINT         ticks[EVOLVE_LANES];
+    UINT         eaten[EVOLVE_LANES];
+    BOOL         playing[EVOLVE_LANES];
+    const float* weights    = Evolution->weights + (size_t) Block * BLOCK_FLOATS;
+    float*       fitness    = Evolution->fitness + Block * EVOLVE_LANES;
+    UINT         starvation = STARVATION_BLOCKS * Evolution->fieldWidth * Evolution->fieldHeight;
+    SNAKE_RESULT result     = SR_OK;
+    UINT         round, lane, action, best, active, size;
+
+    memset(games,   0, sizeof(games));
+    memset(fitness, 0, EVOLVE_LANES * sizeof(float));
+
+    for (round = 0; round < Evolution->gamesPerGenome && result == SR_OK; round++)
+    {
+        for (lane = 0; lane < EVOLVE_LANES; lane++)
+        {
+            games[lane].fieldWidth       = Evolution->fieldWidth;
+            games[lane].fieldHeight      = Evolution->fieldHeight;
+            games[lane].snakeSpeed       = SNAKE_SPEED;
+            games[lane].passThroughWalls = Evolution->passThroughWalls;
+
+            //Every genome meets the same food in the same round, as long as
+            //their snakes go the same way
+            SeedGame(games + lane, Evolution->foodSeed, round);
+
+            //Initialized in the first round and reset in place afterwards
+            if ((result = ResetGame(games + lane)) != SR_OK) break;
+
+            hunger[lane]  = 0;
+            ticks[lane]   = 0;
+            eaten[lane]   = 0;
+            playing[lane] = TRUE;
+        }
+
+        for (active = result == SR_OK ? EVOLVE_LANES : 0; active > 0; )
+        {
+            memset(features, 0, sizeof(features));
+
+            for (lane = 0; lane < EVOLVE_LANES; lane++)
+                if (playing[lane]) WriteFeatures(games + lane, hunger[lane], features, lane);
+
+            ForwardBlock(weights, features, outputs);
+
+            for (lane = 0; lane < EVOLVE_LANES; lane++)
+            {
+                if (!playing[lane]) continue;
+
+                for (best = 0, action = 1; action < EVOLVE_OUTPUTS; action++)
+                    if (outputs[action * EVOLVE_LANES + lane] > outputs[best * EVOLVE_LANES + lane]) best = action;
+
+                //Steered through previousDirection, which MoveSnake follows
+                //when no command is waiting
+                size                          = games[lane].snakeSize;
+                games[lane].previousDirection = TURN(games[lane].previousDirection, best);
+
+                if ((result = MoveSnake(games + lane)) != SR_OK) break;
+
+                ticks[lane]++;
+
+                if (games[lane].snakeSize > size)
+                {
+                    eaten[lane]++;
+                    hunger[lane] = 0;
+                }
+                else hunger[lane]++;
+
+                if (games[lane].snakeState != RUNNING || hunger[lane] > starvation)
+                {
+                    playing[lane] = FALSE;
+                    active--;
+
+                    fitness[lane] += (eaten[lane] + SURVIVAL_WEIGHT * ticks[lane]) / Evolution->gamesPerGenome;
+                }
+            }
+
+            if (result != SR_OK) break;
+        }
+    }
+
+    for (lane = 0; lane < EVOLVE_LANES; lane++) EndingCleanUp(games + lane);
+
+    return result;
+}
+
+static void* EvolutionWorker(void* Argument)
+{
+    EVOLUTION_WORKER* worker    = (EVOLUTION_WORKER*) Argument;
+    EVOLUTION*        evolution = worker->evolution;
+    UINT              blocks    = evolution->population / EVOLVE_LANES;
+    UINT              block;
+
+    //Game lengths vary a lot, so blocks are handed out one at a time
+    while ((block = __atomic_fetch_add(worker->nextBlock, 1, __ATOMIC_RELAXED)) < blocks)
+    {
+        worker->result = PlayBlock(evolution, block);
+        if (worker->result != SR_OK) break;
+    }
+
+    return NULL;
+}
+
+static UINT Tournament(EVOLUTION* Evolution)
+{
+    UINT best = (UINT) (SplitMix64(&Evolution->random) % Evolution->population);
+    UINT rival, i;
+
+    for (i = 1; i < TOURNAMENT_SIZE; i++)
+    {
+        rival = (UINT) (SplitMix64(&Evolution->random) % Evolution->population);
+        if (Evolution->fitness[rival] > Evolution->fitness[best]) best = rival;
+    }
+
+    return best;
+}
+
+static void Breed(EVOLUTION* Evolution)
+{
+    UINT   population = Evolution->population;
+    UINT   elites     = (UINT) (Evolution->eliteShare * population);
+    UINT*  ranking;
+    float* swap;
+    float  weight;
+    UINT   child, first, second, k, i, j;
+
+    if (elites < 1) elites = 1;
+
+    //Elites are found by partial selection, there are only a few of them
+    ranking = (UINT*) malloc(elites * sizeof(UINT));
+
+    for (i = 0; ranking && i < elites; i++)
+    {
+        ranking[i] = population;
+
+        for (j = 0; j < population; j++)
+        {
+            for (k = 0; k < i && ranking[k] != j; k++);
+            if (k < i) continue;
+
+            if (ranking[i] == population || Evolution->fitness[j] > Evolution->fitness[ranking[i]]) ranking[i] = j;
+        }
+    }
+
+    for (child = 0; child < population; child++)
+    {
+        if (ranking && child < elites)
+        {
+            for (k = 0; k < GENOME_WEIGHTS; k++)
+                GENOME_WEIGHT(Evolution->offspring, child, k) = GENOME_WEIGHT(Evolution->weights, ranking[child], k);
+
+            continue;
+        }
+
+        first  = Tournament(Evolution);
+        second = Tournament(Evolution);
+
+        for (k = 0; k < GENOME_WEIGHTS; k++)
+        {
+            weight = GENOME_WEIGHT(Evolution->weights, SplitMix64(&Evolution->random) >> 63 ? first : second, k);
+
+            if (UniformRandom(&Evolution->random) < Evolution->mutationRate)
+                weight += Evolution->mutationScale * GaussianRandom(&Evolution->random);
+
+            GENOME_WEIGHT(Evolution->offspring, child, k) = weight;
+        }
+    }
+
+    free(ranking);
+
+    swap                 = Evolution->weights;
+    Evolution->weights   = Evolution->offspring;
+    Evolution->offspring = swap;
+}
+
+static SNAKE_RESULT AllocateEvolution(EVOLUTION* Evolution)
+{
+    size_t floats;
+
+    Evolution->population = (Evolution->population + EVOLVE_LANES - 1) / EVOLVE_LANES * EVOLVE_LANES;
+    if (Evolution->population == 0) Evolution->population = EVOLVE_LANES;
+
+    floats = (size_t) Evolution->population * GENOME_WEIGHTS;
+
+    Evolution->weights   = AllocateArena(floats);
+    Evolution->offspring = AllocateArena(floats);
+    Evolution->fitness   = (float*) calloc(Evolution->population, sizeof(float));
+
+    if (!Evolution->weights || !Evolution->offspring || !Evolution->fitness)
+    {
+        DestroyEvolution(Evolution);
+        return SR_MEMORY_ERROR;
+    }
+
+    return SR_OK;
+}
+
+
+//*****************************************************************************
+//
+//                             EVOLUTION FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateEvolution(EVOLUTION* Evolution, UINT64 Seed)
+{
+    SNAKE_RESULT result;
+    size_t       floats, i;
+    float        scale;
+
+    Evolution->weights     = NULL;
+    Evolution->offspring   = NULL;
+    Evolution->fitness     = NULL;
+    Evolution->generation  = 0;
+    Evolution->elapsed     = 0.0;
+    Evolution->bestFitness = 0.0f;
+    Evolution->meanFitness = 0.0f;
+    Evolution->bestGenome  = 0;
+    Evolution->random      = Seed;
+
+    if ((result = AllocateEvolution(Evolution)) != SR_OK) return result;
+
+    //Weights start small enough not to saturate the hidden layer
+    floats = (size_t) Evolution->population * GENOME_WEIGHTS;
+    scale  = 1.0f / sqrtf((float) EVOLVE_FEATURES);
+
+    for (i = 0; i < floats; i++) Evolution->weights[i] = scale * GaussianRandom(&Evolution->random);
+
+    return SR_OK;
+}
+
+void DestroyEvolution(EVOLUTION* Evolution)
+{
+    FreeArena(Evolution->weights);
+    FreeArena(Evolution->offspring);
+    free(Evolution->fitness);
+
+    Evolution->weights   = NULL;
+    Evolution->offspring = NULL;
+    Evolution->fitness   = NULL;
+}
+
+SNAKE_RESULT RunGeneration(EVOLUTION* Evolution)
+{
+    EVOLUTION_WORKER workers[MAX_THREADS];
+    pthread_t        threads[MAX_THREADS];
+    BOOL             started[MAX_THREADS];
+    UINT             threadCount = Evolution->threadCount ? Evolution->threadCount : ProcessorCount();
+    UINT             nextBlock   = 0;
+    SNAKE_RESULT     result      = SR_OK;
+    double           start       = Now();
+    double           sum         = 0.0;
+    UINT             i;
+
+    if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+
+    Evolution->foodSeed = SplitMix64(&Evolution->random);
+
+    for (i = 0; i < threadCount; i++)
+    {
+        workers[i].evolution = Evolution;
+        workers[i].nextBlock = &nextBlock;
+        workers[i].result    = SR_OK;
+    }
+
+    //The calling thread is the first worker
+    for (i = 1; i < threadCount; i++)
+        started[i] = pthread_create(threads + i, NULL, EvolutionWorker, workers + i) == 0;
+
+    EvolutionWorker(workers);
+
+    for (i = 1; i < threadCount; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+
+    for (i = 0; i < threadCount; i++)
+        if (workers[i].result != SR_OK) result = workers[i].result;
+
+    if (result != SR_OK) return result;
+
+    Evolution->bestGenome = 0;
+
+    for (i = 0; i < Evolution->population; i++)
+    {
+        sum += Evolution->fitness[i];
+        if (Evolution->fitness[i] > Evolution->fitness[Evolution->bestGenome]) Evolution->bestGenome = i;
+    }
+
+    Evolution->bestFitness = Evolution->fitness[Evolution->bestGenome];
+    Evolution->meanFitness = (float) (sum / Evolution->population);
+
+    //Breeding puts the elites first, best one included
+    Breed(Evolution);
+
+    Evolution->bestGenome = 0;
+    Evolution->generation++;
+    Evolution->elapsed += Now() - start;
+
+    return SR_OK;
+}
+
+BOOL SaveEvolution(EVOLUTION* Evolution, const char* File)
+{
+    CHECKPOINT_HEADER header;
+    FILE*             file;
+    BOOL              written;
+
+    memset(&header, 0, sizeof(header));
+
+    header.magic            = CHECKPOINT_MAGIC;
+    header.version          = CHECKPOINT_VERSION;
+    header.population       = Evolution->population;
+    header.features         = EVOLVE_FEATURES;
+    header.hidden           = EVOLVE_HIDDEN;
+    header.outputs          = EVOLVE_OUTPUTS;
+    header.gamesPerGenome   = Evolution->gamesPerGenome;
+    header.fieldWidth       = Evolution->fieldWidth;
+    header.fieldHeight      = Evolution->fieldHeight;
+    header.passThroughWalls = Evolution->passThroughWalls;
+    header.mutationRate     = Evolution->mutationRate;
+    header.mutationScale    = Evolution->mutationScale;
+    header.eliteShare       = Evolution->eliteShare;
+    header.generation       = Evolution->generation;
+    header.random           = Evolution->random;
+    header.elapsed          = Evolution->elapsed;
+    header.bestFitness      = Evolution->bestFitness;
+    header.meanFitness      = Evolution->meanFitness;
+
+    file = fopen(File, "wb");
+    if (file == NULL) return FALSE;
+
+    written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(Evolution->weights, sizeof(float) * GENOME_WEIGHTS, Evolution->population, file) == Evolution->population;
+
+    return fclose(file) == 0 && written;
+}
+
+BOOL LoadEvolution(EVOLUTION* Evolution, const char* File)
+{
+    CHECKPOINT_HEADER header;
+    FILE*             file;
+    BOOL              read;
+
+    Evolution->weights   = NULL;
+    Evolution->offspring = NULL;
+    Evolution->fitness   = NULL;
+
+    file = fopen(File, "rb");
+    if (file == NULL) return FALSE;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != CHECKPOINT_MAGIC ||
+        header.version != CHECKPOINT_VERSION || header.features != EVOLVE_FEATURES ||
+        header.hidden != EVOLVE_HIDDEN || header.outputs != EVOLVE_OUTPUTS ||
+        header.population == 0 || header.population % EVOLVE_LANES)
+    {
+        fclose(file);
+        return FALSE;
+    }
+
+    //The thread count is the only parameter left to the caller. The fitness of
+    //the saved generation is only known once it is played.
+    Evolution->population       = header.population;
+    Evolution->gamesPerGenome   = header.gamesPerGenome;
+    Evolution->fieldWidth       = header.fieldWidth;
+    Evolution->fieldHeight      = header.fieldHeight;
+    Evolution->passThroughWalls = header.passThroughWalls;
+    Evolution->mutationRate     = header.mutationRate;
+    Evolution->mutationScale    = header.mutationScale;
+    Evolution->eliteShare       = header.eliteShare;
+    Evolution->generation       = header.generation;
+    Evolution->random           = header.random;
+    Evolution->elapsed          = header.elapsed;
+    Evolution->bestFitness      = header.bestFitness;
+    Evolution->meanFitness      = header.meanFitness;
+    Evolution->bestGenome       = 0;
+
+    if (AllocateEvolution(Evolution) != SR_OK)
+    {
+        fclose(file);
+        return FALSE;
+    }
+
+    read = fread(Evolution->weights, sizeof(float) * GENOME_WEIGHTS, Evolution->population, file) == Evolution->population;
+
+    fclose(file);
+
+    if (!read)
+    {
+        DestroyEvolution(Evolution);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+double GenerationsPerHour(EVOLUTION* Evolution)
+{
+    if (Evolution->elapsed <= 0.0) return 0.0;
+
+    return Evolution->generation / Evolution->elapsed * 3600.0;
+}
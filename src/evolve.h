@@ -0,0 +1,94 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef EVOLVE_H
+#define EVOLVE_H
+
+#include <pthread.h>
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define EVOLVE_FEATURES             10    //Inputs of a controller, see WriteFeatures
+#define EVOLVE_HIDDEN               16
+#define EVOLVE_OUTPUTS              3     //Turn left, keep going, turn right
+#define EVOLVE_LANES                8     //Genomes evaluated side by side
+
+#define GENOME_WEIGHTS              (EVOLVE_HIDDEN * EVOLVE_FEATURES + EVOLVE_HIDDEN + \
+                                     EVOLVE_OUTPUTS * EVOLVE_HIDDEN + EVOLVE_OUTPUTS)
+
+//Weights are interleaved by blocks of EVOLVE_LANES genomes: weight k of genome
+//g sits at block g / EVOLVE_LANES, row k, lane g % EVOLVE_LANES. Each vector
+//operation of the forward pass then serves a whole block of genomes.
+#define GENOME_WEIGHT(a, g, k)      ((a)[((size_t) ((g) / EVOLVE_LANES) * GENOME_WEIGHTS + (k)) * EVOLVE_LANES + \
+                                         (g) % EVOLVE_LANES])
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Evolves a population of small perceptrons that steer the snake. Every
+//genome plays gamesPerGenome games per generation, and the fittest ones are
+//kept and bred by uniform crossover and Gaussian mutation.
+typedef struct _EVOLUTION
+{
+    //Parameters, set by the caller before CreateEvolution
+    UINT         population;    //Rounded up to a multiple of EVOLVE_LANES
+    UINT         threadCount;   //Zero uses every processor
+    UINT         gamesPerGenome;
+    UINT         fieldWidth;
+    UINT         fieldHeight;
+    BOOL         passThroughWalls;
+    float        mutationRate;  //Chance of a weight being mutated
+    float        mutationScale; //Standard deviation of a mutation
+    float        eliteShare;    //Share of the population kept unchanged
+
+    //State
+    float*       weights;       //Aligned arena of population * GENOME_WEIGHTS floats
+    float*       offspring;     //Same size, the next generation is bred into it
+    float*       fitness;
+    UINT         generation;
+    UINT64       random;
+    UINT64       foodSeed;      //Drawn from random every generation, round r of a genome plays stream r
+    float        bestFitness;   //Of the last generation evaluated
+    float        meanFitness;
+    UINT         bestGenome;
+    double       elapsed;       //Seconds spent in RunGeneration, kept in checkpoints
+} EVOLUTION;
+
+
+//*****************************************************************************
+//
+//                             EVOLUTION FUNCTIONS
+//
+//*****************************************************************************
+
+//Allocates the arenas and fills them with random weights drawn from Seed
+SNAKE_RESULT    CreateEvolution    (EVOLUTION* Evolution, UINT64 Seed);
+void            DestroyEvolution   (EVOLUTION* Evolution);
+
+//Plays every genome on the worker threads, then breeds the next generation
+SNAKE_RESULT    RunGeneration      (EVOLUTION* Evolution);
+
+//Checkpoints hold the parameters, the weights of the population, the best and
+//mean fitness of the generation it was bred from and the breeding random
+//state, so a loaded run carries on where it stopped.
+//LoadEvolution allocates the arenas itself and keeps only threadCount.
+BOOL            SaveEvolution      (EVOLUTION* Evolution, const char* File);
+BOOL            LoadEvolution      (EVOLUTION* Evolution, const char* File);
+
+double          GenerationsPerHour (EVOLUTION* Evolution);
+
+#endif
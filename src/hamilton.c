@@ -0,0 +1,323 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "hamilton.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define NO_DIRECTION                4
+#define CYCLE_VARIANTS              8     //Mirrored horizontally, vertically, and reversed
+#define BUFFER_INDEX(x, y, w)       ((WORD) ((y) * (w) + (x)))
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+//Rows 1 to Width - 1 are swept back and forth, and column 0 leads back to the
+//start. Needs an even number of rows unless there are only two columns. When
+//transposed, Width and Height are those of the transposed field.
+static void BuildSerpentine(WORD* Path, UINT Width, UINT Height, BOOL Transpose)
+{
+    UINT count = 0;
+    UINT x, y;
+
+    for (y = 0; y < Height; y++)
+    {
+        for (x = 1; x < Width; x++)
+        {
+            UINT column = y % 2 ? Width - x : x;
+
+            Path[count++] = Transpose ? BUFFER_INDEX(y, column, Height) : BUFFER_INDEX(column, y, Width);
+        }
+    }
+
+    for (y = Height; y > 0; y--)
+        Path[count++] = Transpose ? BUFFER_INDEX(y - 1, 0, Height) : BUFFER_INDEX(0, y - 1, Width);
+}
+
+//Without walls every line wraps around, so each one can be swept completely
+//from any block, ending next to where it started. Sweeping a line forwards
+//moves the start of the next one back by a block and sweeping it backwards
+//moves it ahead, so with Count lines of Length blocks, (Count - Length) / 2
+//of them swept backwards bring the last line back to the first block.
+static void BuildTorus(WORD* Path, UINT Width, UINT Height, BOOL Transpose)
+{
+    UINT length    = Transpose ? Height : Width;
+    UINT lines     = Transpose ? Width  : Height;
+    UINT backwards = lines > length ? (lines - length) / 2 : 0;
+    UINT start     = 0;
+    UINT count     = 0;
+    UINT line, i, offset;
+
+    for (line = 0; line < lines; line++)
+    {
+        for (i = 0; i < length; i++)
+        {
+            offset = line < backwards ? (start + length - i) % length : (start + i) % length;
+
+            Path[count++] = Transpose ? BUFFER_INDEX(line, offset, Width) : BUFFER_INDEX(offset, line, Width);
+        }
+
+        start = line < backwards ? (start + 1) % length : (start + length - 1) % length;
+    }
+}
+
+static WORD BufferToPosition(SNAKE_GAME* Game, UINT Index)
+{
+    return BLOCK_POSITION(Index % Game->fieldWidth, Index / Game->fieldWidth);
+}
+
+static BYTE StepDirection(SNAKE_GAME* Game, UINT From, UINT To)
+{
+    WORD position;
+    int  direction;
+
+    for (direction = RIGHT; direction <= DOWN; direction++)
+    {
+        position = NewPosition(Game, BufferToPosition(Game, From), 1, (SNAKE_DIRECTION) direction);
+
+        if (IsInsideField(Game, position) && (UINT) BLOCK_BUFFER_POSITION(Game, position) == To)
+            return (BYTE) direction;
+    }
+
+    return NO_DIRECTION;
+}
+
+//Lays the path on the field, mirrored and reversed as the variant says.
+//Returns FALSE if two consecutive blocks of the path aren't neighbours.
+static BOOL LayCycle(HAMILTON_SOLVER* Solver, SNAKE_GAME* Game, const WORD* Path, UINT Variant)
+{
+    UINT width    = Game->fieldWidth;
+    UINT height   = Game->fieldHeight;
+    UINT first    = 0;
+    UINT previous = 0;
+    UINT k, index, x, y;
+
+    for (k = 0; k < Solver->blocks; k++)
+    {
+        index = Path[Variant & 4 ? Solver->blocks - 1 - k : k];
+        x     = index % width;
+        y     = index / width;
+
+        if (Variant & 1) x = width  - 1 - x;
+        if (Variant & 2) y = height - 1 - y;
+
+        index                = BUFFER_INDEX(x, y, width);
+        Solver->order[index] = (WORD) k;
+
+        if (k == 0) first = index;
+        else if ((Solver->nextDirection[previous] = StepDirection(Game, previous, index)) == NO_DIRECTION)
+            return FALSE;
+
+        previous = index;
+    }
+
+    Solver->nextDirection[previous] = StepDirection(Game, previous, first);
+
+    return Solver->nextDirection[previous] != NO_DIRECTION;
+}
+
+//TRUE if every element of the snake comes right after the previous one along
+//the cycle, so the whole body lies behind the head
+static BOOL IsBodyAligned(HAMILTON_SOLVER* Solver, SNAKE_GAME* Game)
+{
+    GLOBALHANDLE   hNextElement = Game->hSnakeStack;
+    GLOBALHANDLE   hCurrentElement;
+    SNAKE_ELEMENT* pCurrentElement;
+    UINT           place;
+    UINT           previousPlace = Solver->blocks;
+
+    while (hNextElement)
+    {
+        hCurrentElement = hNextElement;
+        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
+        place           = Solver->order[BLOCK_BUFFER_POSITION(Game, pCurrentElement->blockPosition)];
+        hNextElement    = pCurrentElement->hNextElement;
+
+        GlobalUnlock(hCurrentElement);
+
+        if (previousPlace != Solver->blocks && place != (previousPlace + 1) % Solver->blocks) return FALSE;
+
+        previousPlace = place;
+    }
+
+    return TRUE;
+}
+
+static BOOL CanFollow(HAMILTON_SOLVER* Solver, SNAKE_GAME* Game)
+{
+    SNAKE_DIRECTION direction = (SNAKE_DIRECTION) Solver->nextDirection[BLOCK_BUFFER_POSITION(Game, Game->headPosition)];
+
+    if (direction == OPPOSITE_DIRECTION(Game->previousDirection)) return FALSE;
+
+    return IS_BLOCK_AVAILABLE(GetFieldBlock(Game, NewPosition(Game, Game->headPosition, 1, direction)));
+}
+
+
+//*****************************************************************************
+//
+//                              SOLVER FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateHamiltonSolver(HAMILTON_SOLVER* Solver, SNAKE_GAME* Game, BOOL Shortcuts)
+{
+    UINT  width  = Game->fieldWidth;
+    UINT  height = Game->fieldHeight;
+    WORD* path;
+    UINT  variant;
+    int   fallback = -1;
+
+    memset(Solver, 0, sizeof(HAMILTON_SOLVER));
+
+    Solver->blocks    = width * height;
+    Solver->shortcuts = Shortcuts;
+
+    if (Solver->blocks < 3 || Game->hSnakeStack == NULL) return SR_NO_CYCLE;
+    if (Solver->blocks % 2 && !Game->passThroughWalls) return SR_NO_CYCLE;
+
+    path                  = (WORD*) malloc(Solver->blocks * sizeof(WORD));
+    Solver->order         = (WORD*) malloc(Solver->blocks * sizeof(WORD));
+    Solver->nextDirection = (BYTE*) malloc(Solver->blocks);
+
+    if (!path || !Solver->order || !Solver->nextDirection)
+    {
+        free(path);
+        DestroyHamiltonSolver(Solver);
+        return SR_MEMORY_ERROR;
+    }
+
+    //Odd sized fields, or fields a single block wide, only close up around
+    //the walls
+    if (Game->passThroughWalls && (Solver->blocks % 2 || width == 1 || height == 1))
+        BuildTorus(path, width, height, width > height);
+    else if (width == 1 || height == 1)
+    {
+        free(path);
+        DestroyHamiltonSolver(Solver);
+        return SR_NO_CYCLE;
+    }
+    else if (height % 2 && width != 2) BuildSerpentine(path, height, width, TRUE);
+    else                               BuildSerpentine(path, width, height, FALSE);
+
+    //Prefers the variant that already runs along the body, then any variant
+    //whose next block is free
+    for (variant = 0; variant < CYCLE_VARIANTS; variant++)
+    {
+        if (!LayCycle(Solver, Game, path, variant)) continue;
+
+        if (IsBodyAligned(Solver, Game) && CanFollow(Solver, Game))
+        {
+            Solver->aligned = TRUE;
+            break;
+        }
+
+        if (fallback < 0 && CanFollow(Solver, Game)) fallback = (int) variant;
+    }
+
+    if (variant == CYCLE_VARIANTS && (fallback < 0 || !LayCycle(Solver, Game, path, (UINT) fallback)))
+    {
+        free(path);
+        DestroyHamiltonSolver(Solver);
+        return SR_NO_CYCLE;
+    }
+
+    free(path);
+    return SR_OK;
+}
+
+void DestroyHamiltonSolver(HAMILTON_SOLVER* Solver)
+{
+    free(Solver->order);
+    free(Solver->nextDirection);
+
+    Solver->order         = NULL;
+    Solver->nextDirection = NULL;
+}
+
+SNAKE_DIRECTION HamiltonDirection(HAMILTON_SOLVER* Solver, SNAKE_GAME* Game)
+{
+    SNAKE_ELEMENT*  pTailElement;
+    SNAKE_DIRECTION best;
+    WORD            position;
+    WORD            tailPosition;
+    UINT            head = BLOCK_BUFFER_POSITION(Game, Game->headPosition);
+    UINT            place = Solver->order[head];
+    UINT            distance, bestDistance = 1;
+    UINT            tailDistance, foodDistance;
+    UINT            direction;
+
+    best = (SNAKE_DIRECTION) Solver->nextDirection[head];
+
+    //Follows the cycle until the body is stretched along it, stepping aside
+    //whenever an old part of the body is still in the way
+    if (!Solver->aligned)
+    {
+        if (CanFollow(Solver, Game))
+        {
+            if (++Solver->followed >= Game->snakeSize) Solver->aligned = TRUE;
+            return best;
+        }
+
+        Solver->followed = 0;
+
+        for (direction = RIGHT; direction <= DOWN; direction++)
+        {
+            if (direction == OPPOSITE_DIRECTION(Game->previousDirection)) continue;
+
+            position = NewPosition(Game, Game->headPosition, 1, (SNAKE_DIRECTION) direction);
+
+            if (IsInsideField(Game, position) && IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position)))
+                return (SNAKE_DIRECTION) direction;
+        }
+
+        return best;
+    }
+
+    if (!Solver->shortcuts) return best;
+
+    pTailElement = (SNAKE_ELEMENT*) GlobalLock(Game->hSnakeStack);
+    tailPosition = pTailElement->blockPosition;
+    GlobalUnlock(Game->hSnakeStack);
+
+    //Distances are counted forwards along the cycle from the head
+    tailDistance = (Solver->order[BLOCK_BUFFER_POSITION(Game, tailPosition)] + Solver->blocks - place) % Solver->blocks;
+    foodDistance = (Solver->order[BLOCK_BUFFER_POSITION(Game, Game->foodPosition)] + Solver->blocks - place) % Solver->blocks;
+
+    if (tailDistance == 0) tailDistance = Solver->blocks;
+
+    //A shortcut never passes the food, and leaves at least one free block
+    //before the tail, which stays put for a move whenever the snake eats
+    for (direction = RIGHT; direction <= DOWN; direction++)
+    {
+        if (direction == OPPOSITE_DIRECTION(Game->previousDirection)) continue;
+
+        position = NewPosition(Game, Game->headPosition, 1, (SNAKE_DIRECTION) direction);
+
+        if (!IsInsideField(Game, position) || !IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position))) continue;
+
+        distance = (Solver->order[BLOCK_BUFFER_POSITION(Game, position)] + Solver->blocks - place) % Solver->blocks;
+
+        if (distance > bestDistance && distance <= foodDistance && distance + 1 < tailDistance)
+        {
+            best         = (SNAKE_DIRECTION) direction;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,59 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef HAMILTON_H
+#define HAMILTON_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Plays a game to the end by following a Hamiltonian cycle, a closed path that
+//visits every block once. As long as the body lies behind the head along the
+//cycle, the blocks ahead of the head up to the tail are all empty, so the head
+//may also jump to any neighbour between itself and the tail (a shortcut)
+//without ever closing the path behind it.
+//
+//A cycle exists when the field has an even number of blocks, and on any field
+//when the snake passes through walls. Fields with odd width and height and
+//walls have none, since every step alternates between the two colours of a
+//chessboard and those fields have one more block of one colour.
+typedef struct _HAMILTON_SOLVER
+{
+    UINT  blocks;
+    WORD* order;                //Place of each block along the cycle, by buffer position
+    BYTE* nextDirection;        //Direction from each block to the next one along the cycle
+    BOOL  shortcuts;
+
+    //The body is known to lie behind the head once the snake has followed the
+    //cycle for as long as it is; until then no shortcut is taken
+    BOOL  aligned;
+    UINT  followed;             //Consecutive moves made along the cycle
+} HAMILTON_SOLVER;
+
+
+//*****************************************************************************
+//
+//                              SOLVER FUNCTIONS
+//
+//*****************************************************************************
+
+//Builds a cycle for the game's field, oriented to match the snake when it can.
+//The game must be running and from then on be driven by HamiltonDirection only.
+SNAKE_RESULT    CreateHamiltonSolver  (HAMILTON_SOLVER* Solver, SNAKE_GAME* Game, BOOL Shortcuts);
+void            DestroyHamiltonSolver (HAMILTON_SOLVER* Solver);
+
+//Direction for the next move, decided in constant time. Only a direction that
+//differs from Game->previousDirection needs to be passed to ReceiveCommand.
+SNAKE_DIRECTION HamiltonDirection     (HAMILTON_SOLVER* Solver, SNAKE_GAME* Game);
+
+#endif
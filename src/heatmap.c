@@ -0,0 +1,200 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "heatmap.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define LINE_COUNTS                 (HEATMAP_ALIGNMENT / sizeof(UINT64))
+#define PLANE_SIZE(h)               ((size_t) (h)->fieldWidth * (h)->fieldHeight)
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static void PutLittleEndian(BYTE* Bytes, UINT Value, UINT Size)
+{
+    UINT i;
+
+    for (i = 0; i < Size; i++) Bytes[i] = (BYTE) (Value >> 8 * i);
+}
+
+//Black to red, yellow and white as Level goes from 0 to 1
+static void RampColor(double Level, BYTE* Pixel)
+{
+    double channel;
+    int    i;
+
+    //Bitmaps store blue, green and red
+    for (i = 0; i < 3; i++)
+    {
+        channel      = 3.0 * Level - i;
+        channel      = channel < 0.0 ? 0.0 : channel > 1.0 ? 1.0 : channel;
+        Pixel[2 - i] = (BYTE) (channel * 255.0 + 0.5);
+    }
+}
+
+
+//*****************************************************************************
+//
+//                            HEATMAP FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateHeatmap(HEATMAP* Heatmap, UINT Width, UINT Height)
+{
+    void* counts = NULL;
+
+    memset(Heatmap, 0, sizeof(HEATMAP));
+
+    if (Width == 0 || Width > 127 || Height == 0 || Height > 127) return SR_BAD_FIELD_SIZE;
+
+    Heatmap->fieldWidth  = Width;
+    Heatmap->fieldHeight = Height;
+    Heatmap->padded      = (HEATMAP_KINDS * PLANE_SIZE(Heatmap) + LINE_COUNTS - 1) / LINE_COUNTS * LINE_COUNTS;
+
+#ifdef _WIN32
+    counts = _aligned_malloc(Heatmap->padded * sizeof(UINT64), HEATMAP_ALIGNMENT);
+#else
+    if (posix_memalign(&counts, HEATMAP_ALIGNMENT, Heatmap->padded * sizeof(UINT64)) != 0) counts = NULL;
+#endif
+
+    if (counts == NULL) return SR_MEMORY_ERROR;
+
+    Heatmap->counts = (UINT64*) counts;
+    ClearHeatmap(Heatmap);
+
+    return SR_OK;
+}
+
+void DestroyHeatmap(HEATMAP* Heatmap)
+{
+#ifdef _WIN32
+    _aligned_free(Heatmap->counts);
+#else
+    free(Heatmap->counts);
+#endif
+
+    Heatmap->counts = NULL;
+}
+
+void ClearHeatmap(HEATMAP* Heatmap)
+{
+    memset(Heatmap->counts, 0, Heatmap->padded * sizeof(UINT64));
+}
+
+//Both heatmaps are padded to whole cache lines of zeros, so the sums run
+//over full aligned vectors
+void MergeHeatmap(HEATMAP* Total, const HEATMAP* Part)
+{
+    UINT64*       total = Total->counts;
+    const UINT64* part  = Part->counts;
+    size_t        i;
+
+#if defined(__AVX2__)
+    for (i = 0; i < Total->padded; i += 4)
+        _mm256_store_si256((__m256i*) (total + i), _mm256_add_epi64(_mm256_load_si256((const __m256i*) (total + i)),
+                                                                    _mm256_load_si256((const __m256i*) (part + i))));
+#elif defined(__SSE2__)
+    for (i = 0; i < Total->padded; i += 2)
+        _mm_store_si128((__m128i*) (total + i), _mm_add_epi64(_mm_load_si128((const __m128i*) (total + i)),
+                                                              _mm_load_si128((const __m128i*) (part + i))));
+#else
+    for (i = 0; i < Total->padded; i++) total[i] += part[i];
+#endif
+}
+
+UINT64 HeatmapCount(const HEATMAP* Heatmap, HEATMAP_KIND Kind, UINT X, UINT Y)
+{
+    return Heatmap->counts[Kind * PLANE_SIZE(Heatmap) + (size_t) Y * Heatmap->fieldWidth + X];
+}
+
+UINT64 HeatmapTotal(const HEATMAP* Heatmap, HEATMAP_KIND Kind)
+{
+    const UINT64* plane = Heatmap->counts + Kind * PLANE_SIZE(Heatmap);
+    UINT64        total = 0;
+    size_t        i;
+
+    for (i = 0; i < PLANE_SIZE(Heatmap); i++) total += plane[i];
+
+    return total;
+}
+
+BOOL WriteHeatmapImage(const HEATMAP* Heatmap, HEATMAP_KIND Kind, const char* File)
+{
+    const UINT64* plane      = Heatmap->counts + Kind * PLANE_SIZE(Heatmap);
+    UINT          width      = Heatmap->fieldWidth  * HEATMAP_SCALE;
+    UINT          height     = Heatmap->fieldHeight * HEATMAP_SCALE;
+    UINT          rowBytes   = (3 * width + 3) & ~3U;
+    BYTE          header[54] = { 'B', 'M' };
+    BYTE*         row;
+    BYTE          pixel[3];
+    UINT64        largest    = 0;
+    FILE*         file;
+    BOOL          written    = TRUE;
+    size_t        i;
+    UINT          x, y;
+
+    for (i = 0; i < PLANE_SIZE(Heatmap); i++)
+        if (plane[i] > largest) largest = plane[i];
+
+    PutLittleEndian(header + 2,  54 + rowBytes * height, 4);
+    PutLittleEndian(header + 10, 54, 4);
+    PutLittleEndian(header + 14, 40, 4);
+    PutLittleEndian(header + 18, width, 4);
+    PutLittleEndian(header + 22, height, 4);    //Positive, so rows go bottom up like the field
+    PutLittleEndian(header + 26, 1, 2);
+    PutLittleEndian(header + 28, 24, 2);
+    PutLittleEndian(header + 34, rowBytes * height, 4);
+
+    row  = (BYTE*) calloc(rowBytes, 1);
+    file = row ? fopen(File, "wb") : NULL;
+
+    if (file == NULL)
+    {
+        free(row);
+        return FALSE;
+    }
+
+    written = fwrite(header, sizeof(header), 1, file) == 1;
+
+    for (y = 0; y < height && written; y++)
+    {
+        //Rows of the same block are the same, built once per block
+        if (y % HEATMAP_SCALE == 0)
+            for (x = 0; x < width; x++)
+            {
+                i = (size_t) (y / HEATMAP_SCALE) * Heatmap->fieldWidth + x / HEATMAP_SCALE;
+
+                RampColor(largest ? sqrt((double) plane[i] / largest) : 0.0, pixel);
+                memcpy(row + 3 * x, pixel, 3);
+            }
+
+        written = fwrite(row, rowBytes, 1, file) == 1;
+    }
+
+    written = fclose(file) == 0 && written;
+    free(row);
+
+    return written;
+}
@@ -0,0 +1,81 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define HEATMAP_ALIGNMENT           64    //Bytes of a cache line
+#define HEATMAP_SCALE               8     //Pixels per block side in images
+
+//Bumps the count of a kind on a block, which must lie on the field of the
+//heatmap. MoveSnake and CreateNewFood call it for games with a heatmap.
+#define HEATMAP_COUNT(h, k, p)      ((h)->counts[(size_t) (k) * (h)->fieldWidth * (h)->fieldHeight + \
+                                                 BLOCK_BUFFER_POSITION(h, p)]++)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _HEATMAP_KIND
+{
+    HM_VISITS = 0,              //The head moved onto the block
+    HM_DEATHS,                  //The head was on the block when the game was lost
+    HM_FOOD,                    //Food was placed on the block
+    HEATMAP_KINDS
+} HEATMAP_KIND;
+
+//Counts of every kind on every block, one plane after the other, each plane
+//stored row by row like an observation. A game counts into the heatmap of
+//SNAKE_GAME::pHeatmap, which only the thread stepping the game may write to,
+//so every thread keeps its own and they are merged once the games are over.
+//The counts are aligned and padded to whole cache lines, so the heatmaps of
+//different threads never share one. CopyGame leaves the heatmap of the copy
+//as it was, so the playouts of a planner are not counted.
+typedef struct _HEATMAP
+{
+    UINT    fieldWidth;
+    UINT    fieldHeight;
+    UINT64* counts;
+    size_t  padded;             //Counts allocated, a multiple of a cache line
+} HEATMAP;
+
+
+//*****************************************************************************
+//
+//                            HEATMAP FUNCTIONS
+//
+//*****************************************************************************
+
+//Every count starts at zero
+SNAKE_RESULT    CreateHeatmap      (HEATMAP* Heatmap, UINT Width, UINT Height);
+void            DestroyHeatmap     (HEATMAP* Heatmap);
+void            ClearHeatmap       (HEATMAP* Heatmap);
+
+//Adds the counts of Part to Total, which must have the same field size
+void            MergeHeatmap       (HEATMAP* Total, const HEATMAP* Part);
+
+UINT64          HeatmapCount       (const HEATMAP* Heatmap, HEATMAP_KIND Kind, UINT X, UINT Y);
+UINT64          HeatmapTotal       (const HEATMAP* Heatmap, HEATMAP_KIND Kind);
+
+//Writes a kind as a 24-bit bitmap, HEATMAP_SCALE pixels a block, the largest
+//count in white and the rest along a black, red and yellow ramp by the square
+//root of their share of it. Row 0 of the field is the bottom of the image.
+BOOL            WriteHeatmapImage  (const HEATMAP* Heatmap, HEATMAP_KIND Kind, const char* File);
+
+#endif
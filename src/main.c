@@ -8,8 +8,12 @@
 #include <windows.h>
 #include <commdlg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "resources.h"
+#include "snake.h"
+#include "trace.h"
+#include "broadcast.h"
 
 
 //*****************************************************************************
@@ -18,26 +22,18 @@
 //
 //*****************************************************************************
 
-#define FIELD_WIDTH                 21    //Max: 127
-#define FIELD_HEIGHT                15    //Max: 127
 #define GRID_WIDTH                  1
 #define GRID_COLOR                  RGB(0xFF, 0xFF, 0x00)
 #define FIELD_COLOR                 RGB(0x00, 0xC0, 0x00)
 #define FOOD_COLOR                  RGB(0xC0, 0x00, 0x00)
 #define SNAKE_HEAD_COLOR            RGB(0x20, 0x20, 0x20)
 #define SNAKE_BODY_COLOR            RGB(0x40, 0x40, 0x40)
-#define SNAKE_SPEED                 15    //Blocks per second
-#define INITIAL_DIRECTION           RIGHT
-#define INITIAL_SNAKE_SIZE          5
-#define PASS_THROUGH_WALLS          FALSE
 
-#define BLOCK_X(p)                  ((char) (p & 0x00FF))
-#define BLOCK_Y(p)                  ((char) ((p >> 8) & 0x00FF))
-#define BLOCK_POSITION(x, y)        ((WORD) (((x) & 0x00FF) | ((y) << 8 & 0xFF00)))
-#define BLOCK_BUFFER_POSITION(p)    ((int) BLOCK_Y(p) * fieldWidth + (int) BLOCK_X(p))
-#define OPPOSITE_DIRECTION(d)       ((SNAKE_DIRECTION) (((int) d + 2) & 3))
-#define IS_PERPENDICULAR(d1, d2)    ((BOOL) ((d1 ^ d2) & 0x01))
-#define IS_BLOCK_AVAILABLE(s)       ((BOOL) (~s & 0x02))
+#define WM_GAME_OVER                WM_APP        //Posted by the simulation thread, WParam is the SNAKE_STATE
+#define WM_GAME_ERROR               (WM_APP + 1)  //WParam is the SNAKE_RESULT
+#define FRAME_NEW                   4             //Set in latestFrame until the window takes the frame
+#define FRAME_BLOCK(f, x, y)        ((BLOCK_STATE) ((f)->field[((y) * (f)->fieldWidth + (x)) / 4] >> \
+                                                    ((y) * (f)->fieldWidth + (x)) % 4 * 2 & 3))
 
 
 //*****************************************************************************
@@ -46,53 +42,18 @@
 //
 //*****************************************************************************
 
-typedef enum _BLOCK_STATE
+//What the window draws of the game, copied at the end of a tick so painting
+//never touches the game itself
+typedef struct _FRAME
 {
-    EMPTY       = 0,
-    FOOD        = 1,
-    SNAKE_HEAD  = 2,
-    SNAKE_BODY  = 3
-} BLOCK_STATE;
-
-typedef enum _SNAKE_DIRECTION
-{
-    RIGHT   = 0,
-    UP      = 1,
-    LEFT    = 2,
-    DOWN    = 3
-} SNAKE_DIRECTION;
-
-typedef enum _SNAKE_RESULT
-{
-    SR_OK = 0,                  //No error.
-    SR_MEMORY_ERROR,            //An error occurred while allocating memory.
-    SR_BAD_FIELD_SIZE,          //Field width and height must be between 0 and 127.
-    SR_BAD_SNAKE_SIZE,          //Snake size must be greater than zero.
-    SR_BAD_INITIAL_POSITION,    //Snake doesn't fit into the field. Change the initial position or the initial direction.
-    SR_BAD_SNAKE_SPEED,         //The speed of the snake must be a positive integer.
-    SR_NO_SPACE_FOR_FOOD        //There is no empty space for the food.
-} SNAKE_RESULT;
-
-typedef enum _SNAKE_STATE
-{
-    IDLE,
-    RUNNING,
-    PAUSED,
-    LOST,
-    WON
-} SNAKE_STATE;
-
-typedef struct _SNAKE_ELEMENT
-{
-    WORD         blockPosition;
-    GLOBALHANDLE hNextElement;
-} SNAKE_ELEMENT;
-
-typedef struct _DIRECTION_COMMAND
-{
-    SNAKE_DIRECTION direction;
-    GLOBALHANDLE    hNextCommand;
-} DIRECTION_COMMAND;
+    UINT fieldWidth;
+    UINT fieldHeight;
+    UINT snakeSpeed;
+    UINT snakeSize;
+    UINT tick;                  //Ticks traced when it was copied, for TRACE_FRAME
+    BOOL hasField;
+    BYTE field[(127 * 127 + 3) / 4];
+} FRAME;
 
 
 //*****************************************************************************
@@ -101,19 +62,31 @@ typedef struct _DIRECTION_COMMAND
 //
 //*****************************************************************************
 
-UINT fieldWidth       = FIELD_WIDTH;
-UINT fieldHeight      = FIELD_HEIGHT;
-UINT snakeSpeed       = SNAKE_SPEED;
-BOOL passThroughWalls = PASS_THROUGH_WALLS;
-
-GLOBALHANDLE    hFieldBuffer;
-GLOBALHANDLE    hSnakeStack;
-GLOBALHANDLE    hCommandsBeginning;
-GLOBALHANDLE    hCommandsEnding;
-SNAKE_DIRECTION previousDirection;
-SNAKE_STATE     snakeState;
-UINT            emptyBlocks;
-UINT            snakeSize;
+SNAKE_GAME game = { FIELD_WIDTH, FIELD_HEIGHT, SNAKE_SPEED, PASS_THROUGH_WALLS };
+
+//Spectators attach to it by BROADCAST_NAME. The game plays on without it when
+//the shared memory can't be created.
+BROADCAST broadcast;
+
+//The simulation thread moves the snake on time and publishes frames, and the
+//window thread draws them. gameLock guards the game and is never held while
+//painting or showing a message box.
+CRITICAL_SECTION gameLock;
+HANDLE           hSimulationThread;
+HANDLE           hWakeSimulation;       //Auto-reset, set on every change the thread must notice
+volatile LONG    quitSimulation;
+volatile LONG    frameRequested;
+
+//Triple buffering: the simulation thread fills backFrame and swaps it with
+//latestFrame, the window thread swaps frontFrame with latestFrame when it has
+//FRAME_NEW. Frames replaced before the window took them are dropped.
+FRAME            frames[3];
+volatile LONG    latestFrame = 1;
+LONG             backFrame   = 2;
+LONG             frontFrame  = 0;
+volatile LONG    framesDropped;
+UINT             framesPresented;
+BOOL             showFrameStats;
 
 COLORREF gridColor      = GRID_COLOR;
 COLORREF fieldColor     = FIELD_COLOR;
@@ -124,499 +97,208 @@ COLORREF snakeBodyColor = SNAKE_BODY_COLOR;
 
 //*****************************************************************************
 //
-//                             SNAKE CORE FUNCTIONS
+//                            SIMULATION FUNCTIONS
 //
 //*****************************************************************************
 
-GLOBALHANDLE CreateSnakeBlock(WORD BlockPosition, GLOBALHANDLE NextElement)
-{
-    GLOBALHANDLE   hNewSnakeBlock;
-    SNAKE_ELEMENT* pNewSnakeBlock;
-
-    hNewSnakeBlock = GlobalAlloc(GMEM_MOVEABLE, sizeof(SNAKE_ELEMENT));
-    
-    if (hNewSnakeBlock)
-    {
-        pNewSnakeBlock = (SNAKE_ELEMENT*) GlobalLock(hNewSnakeBlock);
-
-        pNewSnakeBlock->blockPosition = BlockPosition;
-        pNewSnakeBlock->hNextElement  = NextElement;
-
-        GlobalUnlock(hNewSnakeBlock);
-    }
-
-    return hNewSnakeBlock;
-}
-
-void DestroySnakeStack(GLOBALHANDLE SnakeStack)
+//The caller holds gameLock
+void WriteFrame(FRAME* Frame)
 {
-    GLOBALHANDLE   hNextElement = SnakeStack;
-    GLOBALHANDLE   hCurrentElement;
-    SNAKE_ELEMENT* pCurrentElement;
+    Frame->fieldWidth  = game.fieldWidth;
+    Frame->fieldHeight = game.fieldHeight;
+    Frame->snakeSpeed  = game.snakeSpeed;
+    Frame->snakeSize   = game.snakeSize;
+    Frame->tick        = TRACE_TICKS();
+    Frame->hasField    = game.hFieldBuffer != NULL;
 
-    while (hNextElement)
+    if (Frame->hasField)
     {
-        hCurrentElement = hNextElement;
-        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
-        hNextElement    = pCurrentElement->hNextElement;
-        
-        GlobalUnlock(hCurrentElement);
-        GlobalFree  (hCurrentElement);
+        memcpy(Frame->field, GlobalLock(game.hFieldBuffer), FIELD_BUFFER_SIZE(&game));
+        GlobalUnlock(game.hFieldBuffer);
     }
 }
 
-WORD NewPosition(WORD Position, char Steps, SNAKE_DIRECTION Direction)
+//Called by the simulation thread only
+void PublishFrame(void)
 {
-    char x, y;
-
-    x = BLOCK_X(Position);
-    y = BLOCK_Y(Position);
-
-    if (passThroughWalls) switch (Direction)
-    {
-        case RIGHT: x = (x               + Steps) % fieldWidth;  break;
-        case LEFT:  x = (x + fieldWidth  - Steps) % fieldWidth;  break;
-        case UP:    y = (y               + Steps) % fieldHeight; break;
-        case DOWN:  y = (y + fieldHeight - Steps) % fieldHeight; break;
-    }
-    else switch (Direction)
-    {
-        case RIGHT: x += Steps; break;
-        case LEFT:  x -= Steps; break;
-        case UP:    y += Steps; break;
-        case DOWN:  y -= Steps; break;
-    }
-
-    return BLOCK_POSITION(x, y);
-}
+    LONG previous;
 
-BOOL IsInsideField(WORD Position)
-{
-    BYTE x, y;
+    WriteFrame(frames + backFrame);
 
-    x = BLOCK_X(Position);
-    y = BLOCK_Y(Position);
+    previous  = InterlockedExchange(&latestFrame, backFrame | FRAME_NEW);
+    backFrame = previous & ~FRAME_NEW;
 
-    return x < fieldWidth && y < fieldHeight;
+    if (previous & FRAME_NEW) InterlockedIncrement(&framesDropped);
 }
 
-BLOCK_STATE GetFieldBlock(WORD Position)
+//Called by the window thread only
+FRAME* TakeLatestFrame(void)
 {
-    BYTE*       pFieldBuffer;
-    BLOCK_STATE state;
-    BYTE*       pBlockByte;
-    int         shift;
-    int         bufferPosition = BLOCK_BUFFER_POSITION(Position);
-
-    pFieldBuffer = (BYTE *) GlobalLock(hFieldBuffer);
-    pBlockByte   = pFieldBuffer + bufferPosition / 4;
-    shift        = 2 * (bufferPosition % 4);
-    state        = (BLOCK_STATE) ((*pBlockByte >> shift) & 0x03);
+    if (latestFrame & FRAME_NEW)
+    {
+        frontFrame = InterlockedExchange(&latestFrame, frontFrame) & ~FRAME_NEW;
+        framesPresented++;
+    }
 
-    GlobalUnlock(hFieldBuffer);
-    return state;
+    return frames + frontFrame;
 }
 
-void SetFieldBlock(WORD Position, BLOCK_STATE NewState)
+DWORD WINAPI SimulationThread(LPVOID Parameter)
 {
-    BYTE*       pFieldBuffer;
-    BLOCK_STATE previousState;
-    BYTE*       pBlockByte;
-    BYTE        mask;
-    int         shift;
-    int         bufferPosition = BLOCK_BUFFER_POSITION(Position);
+    HWND          hwnd    = (HWND) Parameter;
+    BOOL          running = FALSE;
+    BOOL          ticked, newFrame;
+    DWORD         wait    = INFINITE;
+    LARGE_INTEGER frequency, now, deadline;
+    LONGLONG      period;
+    SNAKE_RESULT  result;
+    SNAKE_STATE   state;
 
-    pFieldBuffer = (BYTE *) GlobalLock(hFieldBuffer);
-    pBlockByte   = pFieldBuffer + bufferPosition / 4;
+    QueryPerformanceFrequency(&frequency);
+    deadline.QuadPart = 0;
 
-    shift         = 2 * (bufferPosition % 4);
-    mask          = 0x03 << shift;
-    previousState = (BLOCK_STATE) ((*pBlockByte & mask) >> shift);
+    while (TRUE)
+    {
+        WaitForSingleObject(hWakeSimulation, wait);
 
-    *pBlockByte &= ~mask;
-    *pBlockByte |= (NewState << shift) & mask;
+        if (quitSimulation) break;
 
-    GlobalUnlock(hFieldBuffer);
+        ticked = FALSE;
+        result = SR_OK;
 
-    if (previousState == EMPTY) emptyBlocks--;
-    if (NewState      == EMPTY) emptyBlocks++;
-}
+        EnterCriticalSection(&gameLock);
 
-SNAKE_RESULT BuildSnakeStack()
-{
-    WORD            tailPosition;
-    WORD            headPosition;
-    SNAKE_DIRECTION tailDirection = OPPOSITE_DIRECTION(INITIAL_DIRECTION);
-    WORD            currentPosition;
-    GLOBALHANDLE    hPreviousBlock;
-    GLOBALHANDLE    hCurrentBlock;
-    SNAKE_ELEMENT*  pCurrentBlock;
-    int             i;
-
-    // Check if the snake has an appropriate size
-    if (INITIAL_SNAKE_SIZE == 0) return SR_BAD_SNAKE_SIZE;
-    
-    // Calculate head position
-    headPosition = BLOCK_POSITION(INITIAL_SNAKE_SIZE + (fieldWidth - INITIAL_SNAKE_SIZE) / 3 - 1, (fieldHeight - 1) / 2);
+        QueryPerformanceCounter(&now);
+        period = frequency.QuadPart / game.snakeSpeed;
 
-    // Check if the snake's both head and tail are inside the field
-    if (!IsInsideField(headPosition)) return SR_BAD_INITIAL_POSITION;
-    
-    tailPosition = NewPosition(headPosition, INITIAL_SNAKE_SIZE - 1, tailDirection);
+        if (game.snakeState != RUNNING) running = FALSE;
+        else if (!running)
+        {
+            //Started or resumed, the first move comes a whole tick later
+            running           = TRUE;
+            deadline.QuadPart = now.QuadPart + period;
+        }
+        else if (now.QuadPart >= deadline.QuadPart)
+        {
+            if ((result = MoveSnake(&game)) == SR_OK) PublishGame(&broadcast, &game);
 
-    if (!IsInsideField(tailPosition)) return SR_BAD_INITIAL_POSITION;
+            //Ticks missed while the machine was busy are skipped, not caught up
+            deadline.QuadPart += period;
+            if (deadline.QuadPart <= now.QuadPart) deadline.QuadPart = now.QuadPart + period;
 
-    //Create the head of the snake
-    hCurrentBlock   = GlobalAlloc(GMEM_MOVEABLE, sizeof(SNAKE_ELEMENT));
-    currentPosition = headPosition;
+            ticked  = TRUE;
+            running = game.snakeState == RUNNING;
+        }
 
-    if (!hCurrentBlock) return SR_MEMORY_ERROR;
+        state    = game.snakeState;
+        newFrame = ticked || InterlockedExchange(&frameRequested, 0);
 
-    pCurrentBlock                = (SNAKE_ELEMENT*) GlobalLock(hCurrentBlock);
-    pCurrentBlock->blockPosition = headPosition;
-    pCurrentBlock->hNextElement  = NULL;
-    
-    GlobalUnlock(hCurrentBlock);
+        if (newFrame) PublishFrame();
 
-    SetFieldBlock(headPosition, SNAKE_HEAD);
+        LeaveCriticalSection(&gameLock);
 
-    //Create the remaining body elements
-    for (i = 1; i < INITIAL_SNAKE_SIZE; i++)
-    {
-        hPreviousBlock  = hCurrentBlock;
-        currentPosition = NewPosition(currentPosition, 1, tailDirection);
-        hCurrentBlock   = GlobalAlloc(GMEM_MOVEABLE, sizeof(SNAKE_ELEMENT));
+        if (newFrame) InvalidateRect(hwnd, NULL, FALSE);
 
-        if (!hCurrentBlock)
-        {
-            DestroySnakeStack(hPreviousBlock);
-            return SR_MEMORY_ERROR;
-        }
+        if (result != SR_OK) PostMessage(hwnd, WM_GAME_ERROR, result, 0);
+        else if (ticked && (state == LOST || state == WON)) PostMessage(hwnd, WM_GAME_OVER, state, 0);
 
-        pCurrentBlock                = (SNAKE_ELEMENT*) GlobalLock(hCurrentBlock);
-        pCurrentBlock->blockPosition = currentPosition;
-        pCurrentBlock->hNextElement  = hPreviousBlock;
-        GlobalUnlock(hCurrentBlock);
+        QueryPerformanceCounter(&now);
 
-        SetFieldBlock(currentPosition, SNAKE_BODY);
+        if (!running) wait = INFINITE;
+        else if (now.QuadPart >= deadline.QuadPart) wait = 0;
+        else wait = (DWORD) ((deadline.QuadPart - now.QuadPart) * 1000 / frequency.QuadPart) + 1;
     }
 
-    hSnakeStack = hCurrentBlock;
-    snakeSize   = INITIAL_SNAKE_SIZE;
-    return SR_OK;
+    return 0;
 }
 
-void CreateNewFood()
+//Has the simulation thread look at the game again, after the window thread
+//changed it. NewFrame also has it publish a frame of the game.
+void WakeSimulation(BOOL NewFrame)
 {
-    BLOCK_STATE state;
-    BYTE*       pBlockByte;
-    BYTE        mask;
-    int         fieldBytes   = (fieldWidth * fieldHeight + 3) / 4;
-    int         foodIndex    = rand() % emptyBlocks;
-    int         currentIndex = 0;
-    int         i, j;
-
-    pBlockByte = (BYTE*) GlobalLock(hFieldBuffer);
+    if (NewFrame) InterlockedExchange(&frameRequested, 1);
 
-    //Sweep all the bytes of the field buffer
-    for (i = 0; i < fieldBytes; i++)
-    {
-        //Sweep all the bit pairs of each byte
-        for (j = 0; j < 4; j++)
-        {
-            mask  = 0x03 << 2 * j;
-            state = (BLOCK_STATE) ((*pBlockByte & mask) >> 2 * j);
-
-            if (state != EMPTY) continue;
-
-            if (currentIndex == foodIndex)
-            {
-                *pBlockByte &= ~mask;
-                *pBlockByte |= (FOOD << 2 * j) & mask;
-                emptyBlocks--;
+    SetEvent(hWakeSimulation);
+}
 
-                i = fieldBytes; // Forces break of outer loop
-                break;
-            }
+BOOL StartSimulation(HWND HWnd)
+{
+    hWakeSimulation = CreateEvent(NULL, FALSE, FALSE, NULL);
 
-            currentIndex++;
-        }
+    if (hWakeSimulation == NULL) return FALSE;
 
-        pBlockByte++;
-    }
+    hSimulationThread = CreateThread(NULL, 0, SimulationThread, (LPVOID) HWnd, 0, NULL);
 
-    GlobalUnlock(hFieldBuffer);
+    return hSimulationThread != NULL;
 }
 
-SNAKE_RESULT ReceiveCommand(SNAKE_DIRECTION Direction)
+void StopSimulation(void)
 {
-    GLOBALHANDLE       hNewCommand = NULL;
-    DIRECTION_COMMAND* pNewCommand;
-    DIRECTION_COMMAND* pPreviousCommand = NULL;
-    SNAKE_DIRECTION    lastDirection;
-    
-    if (snakeState != RUNNING) return SR_OK;
-    
-    if (hCommandsEnding == NULL) lastDirection = previousDirection;
-    else
+    if (hSimulationThread != NULL)
     {
-        pPreviousCommand = (DIRECTION_COMMAND*) GlobalLock(hCommandsEnding);
-        lastDirection    = pPreviousCommand->direction;
+        InterlockedExchange(&quitSimulation, 1);
+        SetEvent(hWakeSimulation);
+        WaitForSingleObject(hSimulationThread, INFINITE);
+        CloseHandle(hSimulationThread);
+        hSimulationThread = NULL;
     }
-    
-    if (IS_PERPENDICULAR(Direction, lastDirection))
-    {
-        hNewCommand = GlobalAlloc(GMEM_MOVEABLE, sizeof(DIRECTION_COMMAND));
-        
-        if (hNewCommand == NULL)
-        {
-            if (hCommandsEnding != NULL) GlobalUnlock(hCommandsEnding);
 
-            return SR_MEMORY_ERROR;
-        }
-        
-        pNewCommand               = (DIRECTION_COMMAND*) GlobalLock(hNewCommand);
-        pNewCommand->hNextCommand = NULL;
-        pNewCommand->direction    = Direction;
-        
-        GlobalUnlock(hNewCommand);
-    }
-    
-    if (pPreviousCommand == NULL)
-    {
-        if (hNewCommand != NULL)
-        {
-            hCommandsBeginning = hNewCommand;
-            hCommandsEnding    = hNewCommand;
-        }
-    }
-    else
-    {
-        if (hNewCommand != NULL)
-        {
-            pPreviousCommand->hNextCommand = hNewCommand;
-            hCommandsEnding                = hNewCommand;
-        }
-        
-        GlobalUnlock(hCommandsEnding);
-    }
-    
-    return SR_OK;
+    if (hWakeSimulation != NULL) CloseHandle(hWakeSimulation);
+    hWakeSimulation = NULL;
 }
 
-SNAKE_DIRECTION PickDirection()
+void PauseGame(HWND HWnd)
 {
-    DIRECTION_COMMAND* pFirstCommand;
-    GLOBALHANDLE       hSecondCommand;
-    SNAKE_DIRECTION    ret;
-    
-    if (hCommandsBeginning == NULL) return previousDirection;
-    
-    pFirstCommand  = (DIRECTION_COMMAND*) GlobalLock(hCommandsBeginning);
-    ret            = pFirstCommand->direction;
-    hSecondCommand = pFirstCommand->hNextCommand;
-    
-    GlobalUnlock(hCommandsBeginning);
-    GlobalFree  (hCommandsBeginning);
-    
-    if (hSecondCommand == NULL)
-    {
-        hCommandsBeginning = NULL;
-        hCommandsEnding    = NULL;
-    }
-    else hCommandsBeginning = hSecondCommand;
-    
-    return ret;
-}
+    BOOL paused = FALSE;
 
-void DestroyCommandsList(GLOBALHANDLE CommandsList)
-{
-    GLOBALHANDLE       hNextCommand = CommandsList;
-    GLOBALHANDLE       hCurrentCommand;
-    DIRECTION_COMMAND* pCurrentCommand;
+    EnterCriticalSection(&gameLock);
 
-    while (hNextCommand)
+    if (game.snakeState == RUNNING)
     {
-        hCurrentCommand = hNextCommand;
-        pCurrentCommand = (DIRECTION_COMMAND*) GlobalLock(hCurrentCommand);
-        hNextCommand    = pCurrentCommand->hNextCommand;
-        
-        GlobalUnlock(hCurrentCommand);
-        GlobalFree  (hCurrentCommand);
+        game.snakeState = PAUSED;
+        paused          = TRUE;
     }
-}
 
-SNAKE_RESULT MoveSnake()
-{
-    GLOBALHANDLE   hNextElement = hSnakeStack;
-    GLOBALHANDLE   hCurrentElement;
-    SNAKE_ELEMENT* pCurrentElement;
-    SNAKE_ELEMENT* pNextElement;
-    WORD           nextPosition;
-    WORD           tailPreviousPosition;
-    BLOCK_STATE    nextState;
-    BOOL           isInside;
-    BOOL           isAvailable;
-    BOOL           gotFood;
-    BOOL           isTail = TRUE;
-
-    while (hNextElement)
-    {
-        hCurrentElement = hNextElement;
-        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
-        
-        if (isTail) tailPreviousPosition = pCurrentElement->blockPosition;
-        
-        hNextElement = pCurrentElement->hNextElement;
-    
-        if (hNextElement)
-        {
-            pNextElement = (SNAKE_ELEMENT*) GlobalLock(hNextElement);
-            
-            if (isTail) SetFieldBlock(pCurrentElement->blockPosition, EMPTY);
-            
-            pCurrentElement->blockPosition = pNextElement->blockPosition;
-            GlobalUnlock(hNextElement);
-        }
-        else //Current element is the head
-        {
-            previousDirection = PickDirection();
-            nextPosition      = NewPosition(pCurrentElement->blockPosition, 1, previousDirection);
-            
-            if (isTail) SetFieldBlock(pCurrentElement->blockPosition, EMPTY);
-            else        SetFieldBlock(pCurrentElement->blockPosition, SNAKE_BODY);
-            
-            isInside = IsInsideField(nextPosition);
-
-            if (isInside)
-            {
-                nextState   = GetFieldBlock(nextPosition);
-                isAvailable = IS_BLOCK_AVAILABLE(nextState);
-                gotFood     = nextState == FOOD;
-
-                pCurrentElement->blockPosition = nextPosition;
-                SetFieldBlock(nextPosition, SNAKE_HEAD);
+    LeaveCriticalSection(&gameLock);
 
-                if (gotFood)
-                {
-                    hSnakeStack = CreateSnakeBlock(tailPreviousPosition, hSnakeStack);
-                    
-                    if (hSnakeStack == NULL)
-                    {
-                        GlobalUnlock(hCurrentElement);
-                        return SR_MEMORY_ERROR;
-                    }
-                    
-                    SetFieldBlock(tailPreviousPosition, SNAKE_BODY);
-                    snakeSize++;
-                    
-                    if (emptyBlocks) CreateNewFood();
-                    else snakeState = WON;
-                }
-            }
-
-            if (!isInside || !isAvailable) snakeState = LOST;
-        }
-
-        GlobalUnlock(hCurrentElement);
-        
-        if (isTail) isTail = FALSE;
+    if (paused)
+    {
+        WakeSimulation(FALSE);
+        SetWindowText(HWnd, TEXT("Snake (Paused)"));
     }
-    
-    return SR_OK;
 }
 
-SNAKE_RESULT Initialize(BOOL EmptyField)
+//Pauses a running game or resumes a paused one, the state being read and
+//changed under a single hold of gameLock
+void TogglePause(HWND HWnd)
 {
-    SNAKE_RESULT result;
-
-    //Create field
-    if (fieldWidth <= 0 || fieldWidth > 127 || fieldHeight <= 0 || fieldHeight > 127)
-        return SR_BAD_FIELD_SIZE;
-    
-    if (snakeSpeed <= 0) return SR_BAD_SNAKE_SPEED;
-
-    hFieldBuffer = GlobalAlloc(GHND, (fieldWidth * fieldHeight + 3) / 4);
+    SNAKE_STATE state;
 
-    if (!hFieldBuffer) return SR_MEMORY_ERROR;
+    EnterCriticalSection(&gameLock);
 
-    emptyBlocks = fieldWidth * fieldHeight;
-    
-    //Initialize direction commands list
-    hCommandsBeginning = NULL;
-    hCommandsEnding    = NULL;
-    previousDirection  = INITIAL_DIRECTION;
-    
-    if (EmptyField)
-    {
-        hSnakeStack = NULL;
-        snakeState  = IDLE;
-        snakeSize   = 0;
+    state = game.snakeState;
 
-        return SR_OK;
-    }
+    if      (state == RUNNING) game.snakeState = PAUSED;
+    else if (state == PAUSED)  game.snakeState = RUNNING;
 
-    result = BuildSnakeStack();
+    LeaveCriticalSection(&gameLock);
 
-    if (result)
+    if (state == RUNNING || state == PAUSED)
     {
-        GlobalFree(hFieldBuffer);
-        hFieldBuffer = NULL;
-        return result;
+        WakeSimulation(FALSE);
+        SetWindowText(HWnd, state == RUNNING ? TEXT("Snake (Paused)") : TEXT("Snake"));
     }
-
-    //Create first food block
-    if (emptyBlocks) CreateNewFood();
-    else
-    {
-        DestroySnakeStack(hSnakeStack);
-        hSnakeStack = NULL;
-        GlobalFree(hFieldBuffer);
-        hFieldBuffer = NULL;
-
-        return SR_NO_SPACE_FOR_FOOD;
-    }
-
-    snakeState = RUNNING;
-
-    return SR_OK;
 }
 
-void EndingCleanUp()
+SNAKE_RESULT SteerSnake(SNAKE_DIRECTION Direction)
 {
-    if (hSnakeStack != NULL)
-    {
-        DestroySnakeStack(hSnakeStack);
-        hSnakeStack = NULL;
-    }
-    
-    if (hFieldBuffer != NULL)
-    {
-        GlobalFree(hFieldBuffer);
-        hFieldBuffer = NULL;
-    }
-    
-    if (hCommandsBeginning != NULL)
-    {
-        DestroyCommandsList(hCommandsBeginning);
-        hCommandsBeginning = NULL;
-        hCommandsEnding    = NULL;
-    }
-}
+    SNAKE_RESULT result;
 
-const LPCTSTR ResultToString(SNAKE_RESULT Result)
-{
-    switch (Result)
-    {
-        case SR_OK:                      return TEXT("No error.");
-        case SR_MEMORY_ERROR:            return TEXT("An error occurred while allocating memory.");
-        case SR_BAD_FIELD_SIZE:          return TEXT("Field width and height must be between 1 and 127.");
-        case SR_BAD_SNAKE_SIZE:          return TEXT("Snake size must be greater than zero.");
-        case SR_BAD_INITIAL_POSITION:    return TEXT("Snake doesn't fit into the field.");
-        case SR_BAD_SNAKE_SPEED:         return TEXT("The speed of the snake must be a positive integer.");
-        case SR_NO_SPACE_FOR_FOOD:       return TEXT("There is no empty space for the food.");
-        default:                         return TEXT("");
-    }
+    EnterCriticalSection(&gameLock);
+    result = ReceiveCommand(&game, Direction);
+    LeaveCriticalSection(&gameLock);
+
+    return result;
 }
 
 
@@ -626,7 +308,7 @@ const LPCTSTR ResultToString(SNAKE_RESULT Result)
 //
 //*****************************************************************************
 
-RECT CalculateFieldRect(RECT ClientRect, TEXTMETRIC TextMetric)
+RECT CalculateFieldRect(RECT ClientRect, TEXTMETRIC TextMetric, FRAME* Frame)
 {
     int  clientWidth;
     int  clientHeight;
@@ -639,16 +321,16 @@ RECT CalculateFieldRect(RECT ClientRect, TEXTMETRIC TextMetric)
     
     clientWidth     = ClientRect.right - ClientRect.left;
     clientHeight    = ClientRect.bottom - ClientRect.top;
-    blockAreaWidth  = clientWidth  - (fieldWidth  + 1) * GRID_WIDTH;
-    blockAreaHeight = clientHeight - (fieldHeight + 1) * GRID_WIDTH;
+    blockAreaWidth  = clientWidth  - (Frame->fieldWidth  + 1) * GRID_WIDTH;
+    blockAreaHeight = clientHeight - (Frame->fieldHeight + 1) * GRID_WIDTH;
     
-    if (blockAreaWidth * fieldHeight >= blockAreaHeight * fieldWidth)
+    if (blockAreaWidth * Frame->fieldHeight >= blockAreaHeight * Frame->fieldWidth)
     //Block area is wider than the field
     {
         fieldRect.top    = 0;
         fieldRect.bottom = clientHeight;
 
-        fieldDelta = blockAreaHeight * fieldWidth / fieldHeight + (fieldWidth + 1) * GRID_WIDTH;
+        fieldDelta = blockAreaHeight * Frame->fieldWidth / Frame->fieldHeight + (Frame->fieldWidth + 1) * GRID_WIDTH;
 
         fieldRect.left  = (clientWidth - fieldDelta) / 2;
         fieldRect.right = fieldRect.left + fieldDelta;
@@ -658,7 +340,7 @@ RECT CalculateFieldRect(RECT ClientRect, TEXTMETRIC TextMetric)
         fieldRect.left  = 0;
         fieldRect.right = clientWidth;
 
-        fieldDelta = blockAreaWidth * fieldHeight / fieldWidth + (fieldHeight + 1) * GRID_WIDTH;
+        fieldDelta = blockAreaWidth * Frame->fieldHeight / Frame->fieldWidth + (Frame->fieldHeight + 1) * GRID_WIDTH;
 
         fieldRect.top    = (clientHeight - fieldDelta) / 2;
         fieldRect.bottom = fieldRect.top + fieldDelta;
@@ -677,16 +359,17 @@ void RenderSnake(HWND HWnd)
     BLOCK_STATE state;
     UINT        x, y, usableWidth, usableHeight, accumBorders;
     TEXTMETRIC  textMetric;
-    TCHAR       bottomText[32];
+    TCHAR       bottomText[48];
+    FRAME*      frame = TakeLatestFrame();
 
     hdcWindow = GetDC(HWnd);
 
     //Calculate measures
     GetTextMetrics(hdcWindow, &textMetric);
     GetClientRect(HWnd, &clientRect);
-    fieldRect    = CalculateFieldRect(clientRect, textMetric);
-    usableWidth  = fieldRect.right  - fieldRect.left - (fieldWidth  + 1) * GRID_WIDTH;
-    usableHeight = fieldRect.bottom - fieldRect.top  - (fieldHeight + 1) * GRID_WIDTH;
+    fieldRect    = CalculateFieldRect(clientRect, textMetric, frame);
+    usableWidth  = fieldRect.right  - fieldRect.left - (frame->fieldWidth  + 1) * GRID_WIDTH;
+    usableHeight = fieldRect.bottom - fieldRect.top  - (frame->fieldHeight + 1) * GRID_WIDTH;
 
     //Create memory device context
     hdcMemory = CreateCompatibleDC(hdcWindow);
@@ -716,32 +399,37 @@ void RenderSnake(HWND HWnd)
     
     SetTextAlign(hdcMemory, TA_LEFT);
     TextOut(hdcMemory, 2, clientRect.bottom - textMetric.tmHeight - 2, bottomText,
-            wsprintf(bottomText, TEXT("Snake Size: %u"), snakeSize));
+            wsprintf(bottomText, TEXT("Snake Size: %u"), frame->snakeSize));
             
     SetTextAlign(hdcMemory, TA_CENTER);
     TextOut(hdcMemory, clientRect.right / 2, clientRect.bottom - textMetric.tmHeight - 2, bottomText,
-            wsprintf(bottomText, TEXT("%u x %u"), fieldWidth, fieldHeight));
+            wsprintf(bottomText, TEXT("%u x %u"), frame->fieldWidth, frame->fieldHeight));
     
     SetTextAlign(hdcMemory, TA_RIGHT);
-    TextOut(hdcMemory, clientRect.right - 2, clientRect.bottom - textMetric.tmHeight - 2, bottomText,
-            wsprintf(bottomText, TEXT("Speed: %u"), snakeSpeed));
+
+    if (showFrameStats)
+        TextOut(hdcMemory, clientRect.right - 2, clientRect.bottom - textMetric.tmHeight - 2, bottomText,
+                wsprintf(bottomText, TEXT("Frames: %u shown, %u dropped"), framesPresented, (UINT) framesDropped));
+    else
+        TextOut(hdcMemory, clientRect.right - 2, clientRect.bottom - textMetric.tmHeight - 2, bottomText,
+                wsprintf(bottomText, TEXT("Speed: %u"), frame->snakeSpeed));
 
     //Paint blocks
-    if (hFieldBuffer)
+    if (frame->hasField)
     {
-        for (x = 0; x < fieldWidth; x++)
+        for (x = 0; x < frame->fieldWidth; x++)
         {
-            for (y = 0; y < fieldHeight; y++)
+            for (y = 0; y < frame->fieldHeight; y++)
             {
-                state = GetFieldBlock(BLOCK_POSITION(x, y));
+                state = FRAME_BLOCK(frame, x, y);
 
                 accumBorders    = fieldRect.left + (x + 1) * GRID_WIDTH;
-                blockRect.left  = accumBorders +  x      * usableWidth / fieldWidth;
-                blockRect.right = accumBorders + (x + 1) * usableWidth / fieldWidth;
+                blockRect.left  = accumBorders +  x      * usableWidth / frame->fieldWidth;
+                blockRect.right = accumBorders + (x + 1) * usableWidth / frame->fieldWidth;
 
                 accumBorders     = fieldRect.bottom - (y + 1) * GRID_WIDTH;
-                blockRect.top    = accumBorders -  y      * usableHeight / fieldHeight;
-                blockRect.bottom = accumBorders - (y + 1) * usableHeight / fieldHeight;
+                blockRect.top    = accumBorders -  y      * usableHeight / frame->fieldHeight;
+                blockRect.bottom = accumBorders - (y + 1) * usableHeight / frame->fieldHeight;
 
                 FillRect(hdcMemory, &blockRect, brushArray[(int) state]);
             }
@@ -749,17 +437,17 @@ void RenderSnake(HWND HWnd)
     }
     else
     {
-        for (x = 0; x < fieldWidth; x++)
+        for (x = 0; x < frame->fieldWidth; x++)
         {
-            for (y = 0; y < fieldHeight; y++)
+            for (y = 0; y < frame->fieldHeight; y++)
             {
                 accumBorders    = fieldRect.left + (x + 1) * GRID_WIDTH;
-                blockRect.left  = accumBorders +  x      * usableWidth / fieldWidth;
-                blockRect.right = accumBorders + (x + 1) * usableWidth / fieldWidth;
+                blockRect.left  = accumBorders +  x      * usableWidth / frame->fieldWidth;
+                blockRect.right = accumBorders + (x + 1) * usableWidth / frame->fieldWidth;
 
                 accumBorders     = fieldRect.bottom - (y + 1) * GRID_WIDTH;
-                blockRect.top    = accumBorders -  y      * usableHeight / fieldHeight;
-                blockRect.bottom = accumBorders - (y + 1) * usableHeight / fieldHeight;
+                blockRect.top    = accumBorders -  y      * usableHeight / frame->fieldHeight;
+                blockRect.bottom = accumBorders - (y + 1) * usableHeight / frame->fieldHeight;
 
                 FillRect(hdcMemory, &blockRect, blockBrush);
             }
@@ -769,6 +457,8 @@ void RenderSnake(HWND HWnd)
     BitBlt(hdcWindow, 0, 0, clientRect.right - clientRect.left, clientRect.bottom - clientRect.top,
            hdcMemory, 0, 0, SRCCOPY);
 
+    TRACE_FRAME(frame->tick);
+
     //Clean-up and finish
     DeleteObject(gridBrush);
     DeleteObject(blockBrush);
@@ -808,7 +498,7 @@ int WINAPI WinMain(HINSTANCE HInstance, HINSTANCE HPrevInstance, PSTR CmdLine, i
     WNDCLASSEX wndclass;
     HANDLE     hAccel;
     
-    srand((UINT) time(NULL));
+    SeedGame(&game, (UINT64) time(NULL), 0);
 
     wndclass.cbSize         = sizeof(WNDCLASSEX);
     wndclass.style          = CS_HREDRAW | CS_VREDRAW;
@@ -868,7 +558,16 @@ LRESULT CALLBACK WndProc(HWND HWnd, UINT Message, WPARAM WParam, LPARAM LParam)
     {
         case WM_CREATE:
             hInstance = ((LPCREATESTRUCT) LParam)->hInstance;
-            if ((result = Initialize(TRUE)) != SR_OK) CriticalEnd(HWnd, result);
+            InitializeCriticalSection(&gameLock);
+
+            if ((result = Initialize(&game, TRUE)) != SR_OK) CriticalEnd(HWnd, result);
+            OpenBroadcast(&broadcast, BROADCAST_NAME, 0, 0);
+            PublishGame(&broadcast, &game);
+
+            //No other thread runs yet
+            WriteFrame(frames + frontFrame);
+
+            if (!StartSimulation(HWnd)) CriticalEnd(HWnd, SR_MEMORY_ERROR);
             return 0;
             
         case WM_COMMAND:
@@ -886,26 +585,25 @@ LRESULT CALLBACK WndProc(HWND HWnd, UINT Message, WPARAM WParam, LPARAM LParam)
             if (HandleKeyDown(HWnd, WParam)) return 0;
             else return DefWindowProc(HWnd, Message, WParam, LParam);
 
-        case WM_TIMER:
-            if ((result = MoveSnake()) == SR_OK)
-            {
-                if (snakeState != RUNNING)
-                {
-                    KillTimer(HWnd, 1);
-                    
-                    if (snakeState == LOST) wsprintf(string, TEXT("You lost!"));
-                    else wsprintf(string, TEXT("Congratulations! The snake filled all the empty spaces, good job!"));
-                    
-                    MessageBox(HWnd, string, TEXT("Snake"), MB_OK | MB_ICONINFORMATION);
-                }
-            }
-            else CriticalEnd(HWnd, result);
-            InvalidateRect(HWnd, NULL, FALSE);
+        case WM_GAME_OVER:
+            if (WParam == LOST) wsprintf(string, TEXT("You lost!"));
+            else wsprintf(string, TEXT("Congratulations! The snake filled all the empty spaces, good job!"));
+            
+            MessageBox(HWnd, string, TEXT("Snake"), MB_OK | MB_ICONINFORMATION);
+            return 0;
+
+        case WM_GAME_ERROR:
+            CriticalEnd(HWnd, (SNAKE_RESULT) WParam);
             return 0;
 
         case WM_DESTROY:
-            KillTimer(HWnd, 1);
-            EndingCleanUp();
+            StopSimulation();
+            EndingCleanUp(&game);
+            CloseBroadcast(&broadcast);
+            DeleteCriticalSection(&gameLock);
+#ifdef SNAKE_TRACE
+            WriteTrace("snake_trace.json", "snake_trace.txt");
+#endif
             PostQuitMessage(0);
             return 0;
     }
@@ -972,16 +670,16 @@ BOOL CALLBACK PreferencesDlgProc(HWND HDlg, UINT Message, WPARAM WParam, LPARAM
             FillColorButton(HDlg, IDC_BODY_COLOR,  snakeBodyColor);
             FillColorButton(HDlg, IDC_GRID_COLOR,  gridColor);
             
-            wsprintf(editText, TEXT("%u"), fieldWidth);
+            wsprintf(editText, TEXT("%u"), game.fieldWidth);
             SetWindowText(hwndWidth, editText);
             
-            wsprintf(editText, TEXT("%u"), fieldHeight);
+            wsprintf(editText, TEXT("%u"), game.fieldHeight);
             SetWindowText(hwndHeight, editText);
             
-            wsprintf(editText, TEXT("%u"), snakeSpeed);
+            wsprintf(editText, TEXT("%u"), game.snakeSpeed);
             SetWindowText(hwndSpeed, editText);
             
-            CheckDlgButton(HDlg, IDC_PASS_THROUGH_WALLS, passThroughWalls);
+            CheckDlgButton(HDlg, IDC_PASS_THROUGH_WALLS, game.passThroughWalls);
             return TRUE;
         }
         
@@ -1024,10 +722,10 @@ BOOL CALLBACK PreferencesDlgProc(HWND HDlg, UINT Message, WPARAM WParam, LPARAM
                 
                 checkPassThroughWalls = (BOOL) SendMessage(hwndPassWallThrough, BM_GETCHECK, 0, 0);
                 
-                if (editWidth != fieldWidth || editHeight            != fieldHeight ||
-                    editSpeed != snakeSpeed || checkPassThroughWalls != passThroughWalls)
+                if (editWidth != game.fieldWidth || editHeight            != game.fieldHeight ||
+                    editSpeed != game.snakeSpeed || checkPassThroughWalls != game.passThroughWalls)
                 {
-                    if (snakeState == PAUSED)
+                    if (game.snakeState == PAUSED)
                     {
                         dialogResult = MessageBox(HDlg, TEXT("Changing these preferences requires the current game to be finished. Do you want to proceed?"), TEXT("Snake"), MB_YESNO | MB_DEFBUTTON2 | MB_ICONWARNING);
                         
@@ -1036,21 +734,27 @@ BOOL CALLBACK PreferencesDlgProc(HWND HDlg, UINT Message, WPARAM WParam, LPARAM
                     
                     SetWindowText(hwndParent, TEXT("Snake"));
                     
-                    EndingCleanUp();
-                    snakeState = IDLE;
+                    EnterCriticalSection(&gameLock);
+                    EndingCleanUp(&game);
+                    game.snakeState = IDLE;
+                    
+                    game.fieldWidth       = editWidth;
+                    game.fieldHeight      = editHeight;
+                    game.snakeSpeed       = editSpeed;
+                    game.passThroughWalls = checkPassThroughWalls;
                     
-                    fieldWidth       = editWidth;
-                    fieldHeight      = editHeight;
-                    snakeSpeed       = editSpeed;
-                    passThroughWalls = checkPassThroughWalls;
+                    result = Initialize(&game, TRUE);
                     
-                    result = Initialize(TRUE);
+                    if (result == SR_OK) PublishGame(&broadcast, &game);
+                    LeaveCriticalSection(&gameLock);
                                     
                     if (result != SR_OK)
                     {
                         CriticalEnd(hwndParent, result);
                         return TRUE;
                     }
+
+                    WakeSimulation(TRUE);
                 }
                 
                 InvalidateRect(hwndParent, NULL, FALSE);
@@ -1095,34 +799,36 @@ BOOL HandleCommand(HINSTANCE HInstance, HWND HWnd, WPARAM WParam)
 {
     int dialogResult;
     SNAKE_RESULT result;
+    BOOL playing;
     
     switch (LOWORD(WParam))
     {
         case IDM_GAME_NEW:
         {
-            if (snakeState == RUNNING || snakeState == PAUSED)
+            //The simulation thread ends games, so the state is read under the lock
+            EnterCriticalSection(&gameLock);
+            playing = game.snakeState == RUNNING || game.snakeState == PAUSED;
+            LeaveCriticalSection(&gameLock);
+            
+            if (playing)
             {
-                if (snakeState == RUNNING)
-                {
-                    KillTimer(HWnd, 1);
-                    snakeState = PAUSED;
-                    SetWindowText(HWnd, TEXT("Snake (Paused)"));
-                }
+                PauseGame(HWnd);
                 
                 dialogResult = MessageBox(HWnd, TEXT("Are you sure to finish the current game and start a new one?"), TEXT("Snake"), MB_YESNO | MB_DEFBUTTON2 | MB_ICONWARNING);
                 
                 if (dialogResult == IDNO) return TRUE;
             }
             
-            EndingCleanUp();
+            EnterCriticalSection(&gameLock);
+            EndingCleanUp(&game);
             
-            result = Initialize(FALSE);
+            result = Initialize(&game, FALSE);
             
-            if (result == SR_OK)
-            {
-                SetTimer(HWnd, 1, 1000 / snakeSpeed, NULL);
-                InvalidateRect(HWnd, NULL, FALSE);
-            }
+            if (result == SR_OK) PublishGame(&broadcast, &game);
+            LeaveCriticalSection(&gameLock);
+            
+            //The simulation thread publishes a frame of the new game and starts moving it
+            if (result == SR_OK) WakeSimulation(TRUE);
             else CriticalEnd(HWnd, result);
             
             return TRUE;
@@ -1133,23 +839,13 @@ BOOL HandleCommand(HINSTANCE HInstance, HWND HWnd, WPARAM WParam)
             return TRUE;
             
         case IDM_GAME_PREFERENCES:
-            if (snakeState == RUNNING)
-            {
-                KillTimer(HWnd, 1);
-                snakeState = PAUSED;
-                SetWindowText(HWnd, TEXT("Snake (Paused)"));
-            }
+            PauseGame(HWnd);
             
             DialogBox(HInstance, MAKEINTRESOURCE(IDD_PREFERENCES), HWnd, PreferencesDlgProc);
             return TRUE;
             
         case IDM_ABOUT:
-            if (snakeState == RUNNING)
-            {
-                KillTimer(HWnd, 1);
-                snakeState = PAUSED;
-                SetWindowText(HWnd, TEXT("Snake (Paused)"));
-            }
+            PauseGame(HWnd);
             
             DialogBox(HInstance, MAKEINTRESOURCE(IDD_ABOUTBOX), HWnd, AboutDlgProc);
             return TRUE;
@@ -1167,43 +863,34 @@ BOOL HandleKeyDown(HWND HWnd, WPARAM WParam)
     {
         case 'D':
         case VK_RIGHT:
-            if ((result = ReceiveCommand(RIGHT)) != SR_OK) CriticalEnd(HWnd, result);
+            if ((result = SteerSnake(RIGHT)) != SR_OK) CriticalEnd(HWnd, result);
             return TRUE;
 
         case 'W':
         case VK_UP:
-            if ((result = ReceiveCommand(UP)) != SR_OK) CriticalEnd(HWnd, result);
+            if ((result = SteerSnake(UP)) != SR_OK) CriticalEnd(HWnd, result);
             return TRUE;
 
         case 'A':
         case VK_LEFT:
-            if ((result = ReceiveCommand(LEFT)) != SR_OK) CriticalEnd(HWnd, result);
+            if ((result = SteerSnake(LEFT)) != SR_OK) CriticalEnd(HWnd, result);
             return TRUE;
 
         case 'S':
         case VK_DOWN:
-            if ((result = ReceiveCommand(DOWN)) != SR_OK) CriticalEnd(HWnd, result);
+            if ((result = SteerSnake(DOWN)) != SR_OK) CriticalEnd(HWnd, result);
             return TRUE;
             
         case 'P':
         case VK_SPACE:
         case VK_PAUSE:
-        {
-            if (snakeState == RUNNING)
-            {
-                KillTimer(HWnd, 1);
-                snakeState = PAUSED;
-                SetWindowText(HWnd, TEXT("Snake (Paused)"));
-            }
-            else if (snakeState == PAUSED)
-            {
-                SetTimer(HWnd, 1, 1000 / snakeSpeed, NULL);
-                snakeState = RUNNING;
-                SetWindowText(HWnd, TEXT("Snake"));
-            }
-            
+            TogglePause(HWnd);
+            return TRUE;
+
+        case 'F':
+            showFrameStats = !showFrameStats;
+            InvalidateRect(HWnd, NULL, FALSE);
             return TRUE;
-        }
         
         default:
             return FALSE;
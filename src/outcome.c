@@ -0,0 +1,236 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "outcome.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define FIELD_STATE(f, i)           ((BLOCK_STATE) ((f)[(i) / 4] >> 2 * ((i) % 4) & 0x03))
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+//Buffer position of the block next to X, Y in Direction, or -1 beyond a wall
+static int NeighbourIndex(SNAKE_GAME* Game, int X, int Y, UINT Direction)
+{
+    int width  = (int) Game->fieldWidth;
+    int height = (int) Game->fieldHeight;
+
+    switch (Direction)
+    {
+        case RIGHT: X++; break;
+        case UP:    Y++; break;
+        case LEFT:  X--; break;
+        default:    Y--; break;
+    }
+
+    if (Game->passThroughWalls)
+    {
+        if      (X < 0)       X += width;
+        else if (X >= width)  X -= width;
+        if      (Y < 0)       Y += height;
+        else if (Y >= height) Y -= height;
+    }
+    else if (X < 0 || Y < 0 || X >= width || Y >= height) return -1;
+
+    return Y * width + X;
+}
+
+//Fills the region of the head straight from the packed field, marking it, the
+//head and the body blocks next to them with a new stamp. Returns the size of
+//the region, or Limit as soon as it gets that large.
+static UINT FillRegion(OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game, UINT Limit)
+{
+    BYTE*       pFieldBuffer = (BYTE*) GlobalLock(Game->hFieldBuffer);
+    UINT        stamp        = Detector->stamp;
+    UINT        first = 0, last = 0;
+    UINT        region = 0;
+    UINT        direction;
+    int         index, neighbour;
+    BLOCK_STATE state;
+
+    index                   = BLOCK_BUFFER_POSITION(Game, Game->headPosition);
+    Detector->marks[index]  = stamp;
+    Detector->queue[last++] = (WORD) index;
+
+    while (first < last && region < Limit)
+    {
+        index = Detector->queue[first++];
+
+        for (direction = 0; direction < 4; direction++)
+        {
+            neighbour = NeighbourIndex(Game, index % (int) Game->fieldWidth, index / (int) Game->fieldWidth, direction);
+
+            if (neighbour < 0 || Detector->marks[neighbour] == stamp) continue;
+
+            state = FIELD_STATE(pFieldBuffer, neighbour);
+
+            if (IS_BLOCK_AVAILABLE(state))
+            {
+                Detector->marks[neighbour] = stamp;
+                Detector->queue[last++]    = (WORD) neighbour;
+
+                if (++region >= Limit) break;
+            }
+            else if (state == SNAKE_BODY) Detector->marks[neighbour] = stamp;
+        }
+    }
+
+    GlobalUnlock(Game->hFieldBuffer);
+
+    return region;
+}
+
+//Whether one of the first Count blocks of the snake, from the tail, was marked
+static BOOL IsTailMarked(OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game, UINT Count)
+{
+    GLOBALHANDLE   hNextElement = Game->hSnakeStack;
+    GLOBALHANDLE   hCurrentElement;
+    SNAKE_ELEMENT* pCurrentElement;
+    BOOL           marked = FALSE;
+
+    while (hNextElement && Count-- && !marked)
+    {
+        hCurrentElement = hNextElement;
+        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
+        marked          = Detector->marks[BLOCK_BUFFER_POSITION(Game, pCurrentElement->blockPosition)] == Detector->stamp;
+        hNextElement    = pCurrentElement->hNextElement;
+
+        GlobalUnlock(hCurrentElement);
+    }
+
+    return marked;
+}
+
+//Whether every block of the snake, from the tail, is further along the cycle
+//than the one before, all within a lap from the tail
+static BOOL IsInCycleOrder(const HAMILTON_SOLVER* Cycle, SNAKE_GAME* Game)
+{
+    GLOBALHANDLE   hNextElement = Game->hSnakeStack;
+    GLOBALHANDLE   hCurrentElement;
+    SNAKE_ELEMENT* pCurrentElement;
+    UINT           place, tailPlace = 0, distance;
+    UINT           previousDistance = 0;
+    BOOL           ordered          = TRUE;
+
+    while (hNextElement && ordered)
+    {
+        hCurrentElement = hNextElement;
+        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
+        place           = Cycle->order[BLOCK_BUFFER_POSITION(Game, pCurrentElement->blockPosition)];
+        hNextElement    = pCurrentElement->hNextElement;
+
+        GlobalUnlock(hCurrentElement);
+
+        if (hCurrentElement == Game->hSnakeStack) tailPlace = place;
+
+        distance         = (place + Cycle->blocks - tailPlace) % Cycle->blocks;
+        ordered          = hCurrentElement == Game->hSnakeStack || distance > previousDistance;
+        previousDistance = distance;
+    }
+
+    return ordered;
+}
+
+
+//*****************************************************************************
+//
+//                              OUTCOME FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateOutcomeDetector(OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game, UINT MaxRegion)
+{
+    memset(Detector, 0, sizeof(OUTCOME_DETECTOR));
+
+    Detector->blocks    = Game->fieldWidth * Game->fieldHeight;
+    Detector->maxRegion = MaxRegion;
+    Detector->minSnake  = OUTCOME_MIN_SNAKE;
+    Detector->marks     = (UINT*) calloc(Detector->blocks, sizeof(UINT));
+    Detector->queue     = (WORD*) malloc(Detector->blocks * sizeof(WORD));
+
+    if (!Detector->marks || !Detector->queue)
+    {
+        DestroyOutcomeDetector(Detector);
+        return SR_MEMORY_ERROR;
+    }
+
+    return SR_OK;
+}
+
+void DestroyOutcomeDetector(OUTCOME_DETECTOR* Detector)
+{
+    free(Detector->marks);
+    free(Detector->queue);
+
+    Detector->marks  = NULL;
+    Detector->queue  = NULL;
+    Detector->blocks = 0;
+}
+
+SNAKE_STATE PredictOutcome(OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game)
+{
+    UINT freeBlocks, limit, region;
+    BOOL winnable;
+
+    if (Game->snakeState == LOST || Game->snakeState == WON) return Game->snakeState;
+    if (Detector->blocks == 0 || Detector->blocks != Game->fieldWidth * Game->fieldHeight) return RUNNING;
+
+    freeBlocks = Game->emptyBlocks + (GetFieldBlock(Game, Game->foodPosition) == FOOD);
+    winnable   = Detector->pCycle != NULL && Detector->pCycle->blocks == Detector->blocks &&
+                 Detector->pCycle->aligned && freeBlocks <= Game->snakeSize;
+
+    if (!winnable && Game->snakeSize < Detector->minSnake) return RUNNING;
+
+    Detector->checks++;
+
+    //Following the cycle keeps a way out, so no region can be sealed then
+    if (winnable && IsInCycleOrder(Detector->pCycle, Game))
+    {
+        Detector->wins++;
+        return WON;
+    }
+
+    if (Game->snakeSize < Detector->minSnake) return RUNNING;
+
+    //A region holding every empty block, or as large as the snake, decides nothing
+    limit = Game->snakeSize < freeBlocks ? Game->snakeSize : freeBlocks;
+
+    if (Detector->maxRegion && Detector->maxRegion < limit) limit = Detector->maxRegion;
+
+    if (++Detector->stamp == 0)
+    {
+        memset(Detector->marks, 0, Detector->blocks * sizeof(UINT));
+        Detector->stamp = 1;
+    }
+
+    region = FillRegion(Detector, Game, limit);
+
+    if (region < limit && !IsTailMarked(Detector, Game, region + 1))
+    {
+        Detector->losses++;
+        return LOST;
+    }
+
+    return RUNNING;
+}
+
+UINT OutcomeInterval(SNAKE_GAME* Game, UINT Interval)
+{
+    return Interval + Game->snakeSize;
+}
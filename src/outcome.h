@@ -0,0 +1,92 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef OUTCOME_H
+#define OUTCOME_H
+
+#include "snake.h"
+#include "hamilton.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define OUTCOME_INTERVAL            8     //Fewest ticks between checks of a game being played out
+#define OUTCOME_MIN_SNAKE           16    //Default length below which a snake is never called lost
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Tells games whose end is already decided from those still open, so they can
+//be stopped early.
+//
+//A loss is certain when the head is sealed in a region too small for the snake
+//to last in. Let R be the m empty blocks the head reaches through empty ones,
+//fewer than the snake's blocks. Until it gets out of R the head visits a new
+//block of R on every move, since those it left are still body, so it must get
+//out within m + 1 moves. Blocks next to R that aren't in it all belong to the
+//snake, and the one counted j from the tail is freed on move j + 1 at the
+//soonest, later if the snake eats. The loss is certain when none of the m + 1
+//blocks nearest the tail borders R or the head, unless R holds every empty
+//block, when filling it could still win the game.
+//
+//A win is only certain for a player following a Hamiltonian cycle, as
+//HamiltonDirection does, once it is aligned and the body lies in the order
+//of the cycle within a lap from the tail to the head: every block ahead of
+//the head is then empty up to the tail, and the shortcuts it takes keep that
+//order. Other players may still lose from there, so pCycle is left NULL for
+//them. Such a player gets there early on, when calling the game says more
+//about the player than about the game, so a win is only called in the end
+//game, once the snake is at least as long as the empty blocks left.
+typedef struct _OUTCOME_DETECTOR
+{
+    UINT*                  marks;       //By buffer position, the stamp of the last check that reached the block
+    WORD*                  queue;
+    UINT                   blocks;      //Of the field the detector was made for
+    UINT                   stamp;
+    UINT                   maxRegion;   //Regions at least this large are left undecided, zero for no limit
+    UINT                   minSnake;    //Shorter snakes are never called lost, their losses being a few ticks off
+    const HAMILTON_SOLVER* pCycle;      //Cycle the player follows, or NULL
+
+    //Statistics
+    UINT64                 checks;
+    UINT64                 losses;      //Checks that found a certain loss
+    UINT64                 wins;
+} OUTCOME_DETECTOR;
+
+
+//*****************************************************************************
+//
+//                              OUTCOME FUNCTIONS
+//
+//*****************************************************************************
+
+//Makes a detector for fields the size of the game's. Looking for a loss walks
+//at most MaxRegion blocks of the region and as many of the snake, zero
+//bounding the region by the snake's size alone; looking for a win walks the
+//whole snake. pCycle starts NULL and minSnake at OUTCOME_MIN_SNAKE.
+SNAKE_RESULT    CreateOutcomeDetector  (OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game, UINT MaxRegion);
+void            DestroyOutcomeDetector (OUTCOME_DETECTOR* Detector);
+
+//LOST or WON when the game will end that way, or already has, and RUNNING
+//while it is undecided. Any field of another size leaves it undecided.
+SNAKE_STATE     PredictOutcome         (OUTCOME_DETECTOR* Detector, SNAKE_GAME* Game);
+
+//Ticks a game being played out goes before its next check, at least
+//Interval. A check walks up to the whole snake, and a loss is never called
+//more ticks before the end than the snake has blocks, so checks are spaced
+//out as the snake grows.
+UINT            OutcomeInterval        (SNAKE_GAME* Game, UINT Interval);
+
+#endif
@@ -0,0 +1,288 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <string.h>
+#include "pipeline.h"
+#include "common.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define SPIN_ITERATIONS             4096  //Polls before WaitStep goes to sleep
+#define FIELD_AREA(g)               ((size_t) (g)->fieldWidth * (g)->fieldHeight)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX()                 __builtin_ia32_pause()
+#else
+#define CPU_RELAX()                 ((void) 0)
+#endif
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static void RunChunks(SNAKE_PIPELINE* Pipeline, UINT Generation)
+{
+    UINT64       state;
+    UINT         chunk, first, count, slot;
+    SNAKE_RESULT result;
+
+    for (;;)
+    {
+        //Chunks are claimed together with the generation they belong to, so a
+        //worker waking up late can never take a chunk of the next submission
+        state = __atomic_load_n(&Pipeline->chunkState, __ATOMIC_ACQUIRE);
+        chunk = (UINT) state;
+
+        if ((UINT) (state >> 32) != Generation) break;
+        if (chunk >= __atomic_load_n(&Pipeline->chunkCount, __ATOMIC_RELAXED)) break;
+
+        if (!__atomic_compare_exchange_n(&Pipeline->chunkState, &state, state + 1, FALSE,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+
+        slot  = (UINT) Pipeline->busySlot;
+        first = Pipeline->slotFirst[slot] + chunk * PIPELINE_CHUNK;
+        count = Pipeline->slotFirst[slot + 1] - first;
+
+        if (count > PIPELINE_CHUNK) count = PIPELINE_CHUNK;
+
+        result = StepBatch(Pipeline->games + first, count, Pipeline->directions + first,
+                           Pipeline->planes + first * FIELD_AREA(Pipeline->games), Pipeline->statuses + first);
+
+        if (result != SR_OK) __atomic_store_n(&Pipeline->jobResult, result, __ATOMIC_RELAXED);
+
+        //The worker finishing the last chunk completes the job
+        if (__atomic_sub_fetch(&Pipeline->pendingChunks, 1, __ATOMIC_ACQ_REL) == 0)
+        {
+            pthread_mutex_lock(&Pipeline->lock);
+            Pipeline->completeTime = Now();
+            __atomic_store_n(&Pipeline->jobDone, TRUE, __ATOMIC_RELEASE);
+            pthread_cond_broadcast(&Pipeline->workDone);
+            pthread_mutex_unlock(&Pipeline->lock);
+        }
+    }
+}
+
+static void* PipelineWorker(void* Argument)
+{
+    SNAKE_PIPELINE* pipeline = (SNAKE_PIPELINE*) Argument;
+    UINT            seen     = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pipeline->lock);
+
+        while (!pipeline->quit && pipeline->generation == seen)
+            pthread_cond_wait(&pipeline->workReady, &pipeline->lock);
+
+        seen = pipeline->generation;
+
+        if (pipeline->quit)
+        {
+            pthread_mutex_unlock(&pipeline->lock);
+            break;
+        }
+
+        pthread_mutex_unlock(&pipeline->lock);
+
+        RunChunks(pipeline, seen);
+    }
+
+    return NULL;
+}
+
+
+//*****************************************************************************
+//
+//                             PIPELINE FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreatePipeline(SNAKE_PIPELINE* Pipeline, SNAKE_GAME* Games, UINT Count, UINT Threads)
+{
+    UINT i;
+
+    memset(Pipeline, 0, sizeof(SNAKE_PIPELINE));
+
+    Pipeline->games        = Games;
+    Pipeline->count        = Count;
+    Pipeline->busySlot     = -1;
+    Pipeline->slotFirst[0] = 0;
+    Pipeline->slotFirst[1] = Count / 2;
+    Pipeline->slotFirst[2] = Count;
+
+    Pipeline->directions = (BYTE*)         malloc(Count);
+    Pipeline->planes     = (BYTE*)         calloc(Count, FIELD_AREA(Games));
+    Pipeline->statuses   = (SNAKE_STATUS*) calloc(Count, sizeof(SNAKE_STATUS));
+    Pipeline->threads    = (pthread_t*)    calloc(Threads ? Threads : 1, sizeof(pthread_t));
+
+    pthread_mutex_init(&Pipeline->lock, NULL);
+    pthread_cond_init (&Pipeline->workReady, NULL);
+    pthread_cond_init (&Pipeline->workDone, NULL);
+
+    if (!Pipeline->directions || !Pipeline->planes || !Pipeline->statuses || !Pipeline->threads)
+    {
+        DestroyPipeline(Pipeline);
+        return SR_MEMORY_ERROR;
+    }
+
+    memset(Pipeline->directions, NO_COMMAND, Count);
+
+    for (i = 0; i < Count; i++)
+    {
+        WriteObservation(Games + i, Pipeline->planes + i * FIELD_AREA(Games));
+        WriteStatus     (Games + i, Pipeline->statuses + i);
+    }
+
+    for (i = 0; i < Threads; i++)
+    {
+        if (pthread_create(Pipeline->threads + i, NULL, PipelineWorker, Pipeline) != 0)
+        {
+            DestroyPipeline(Pipeline);
+            return SR_MEMORY_ERROR;
+        }
+
+        Pipeline->threadCount++;
+    }
+
+    return SR_OK;
+}
+
+void DestroyPipeline(SNAKE_PIPELINE* Pipeline)
+{
+    UINT i;
+
+    if (Pipeline->busySlot >= 0) WaitStep(Pipeline, (UINT) Pipeline->busySlot);
+
+    pthread_mutex_lock(&Pipeline->lock);
+    Pipeline->quit = TRUE;
+    pthread_cond_broadcast(&Pipeline->workReady);
+    pthread_mutex_unlock(&Pipeline->lock);
+
+    for (i = 0; i < Pipeline->threadCount; i++) pthread_join(Pipeline->threads[i], NULL);
+
+    pthread_mutex_destroy(&Pipeline->lock);
+    pthread_cond_destroy (&Pipeline->workReady);
+    pthread_cond_destroy (&Pipeline->workDone);
+
+    free(Pipeline->directions);
+    free(Pipeline->planes);
+    free(Pipeline->statuses);
+    free(Pipeline->threads);
+
+    Pipeline->directions = NULL;
+    Pipeline->planes     = NULL;
+    Pipeline->statuses   = NULL;
+    Pipeline->threads    = NULL;
+}
+
+void SubmitStep(SNAKE_PIPELINE* Pipeline, UINT Slot, const BYTE* Directions)
+{
+    UINT first = Pipeline->slotFirst[Slot];
+    UINT count = Pipeline->slotFirst[Slot + 1] - first;
+
+    if (Pipeline->busySlot >= 0) WaitStep(Pipeline, (UINT) Pipeline->busySlot);
+
+    if (Directions != NULL) memcpy(Pipeline->directions + first, Directions, count);
+    else                    memset(Pipeline->directions + first, NO_COMMAND, count);
+
+    Pipeline->busySlot   = (int) Slot;
+    Pipeline->jobResult  = SR_OK;
+    __atomic_store_n(&Pipeline->chunkCount, (count + PIPELINE_CHUNK - 1) / PIPELINE_CHUNK, __ATOMIC_RELAXED);
+    Pipeline->submitTime = Now();
+
+    if (Pipeline->threadCount == 0 || Pipeline->chunkCount == 0)
+    {
+        Pipeline->jobResult = StepBatch(Pipeline->games + first, count, Pipeline->directions + first,
+                                        Pipeline->planes + first * FIELD_AREA(Pipeline->games),
+                                        Pipeline->statuses + first);
+        Pipeline->completeTime = Now();
+        Pipeline->jobDone      = TRUE;
+        return;
+    }
+
+    pthread_mutex_lock(&Pipeline->lock);
+
+    Pipeline->jobDone       = FALSE;
+    Pipeline->pendingChunks = Pipeline->chunkCount;
+    Pipeline->generation++;
+    __atomic_store_n(&Pipeline->chunkState, (UINT64) Pipeline->generation << 32, __ATOMIC_RELEASE);
+
+    pthread_cond_broadcast(&Pipeline->workReady);
+    pthread_mutex_unlock(&Pipeline->lock);
+}
+
+SNAKE_RESULT WaitStep(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    double waitTime;
+    int    i;
+
+    if (Pipeline->busySlot != (int) Slot) return SR_OK;
+
+    waitTime = Now();
+
+    //Completion usually comes soon after the caller is done, so poll a little
+    //before paying for a sleep and a wake-up
+    for (i = 0; i < SPIN_ITERATIONS && !__atomic_load_n(&Pipeline->jobDone, __ATOMIC_ACQUIRE); i++)
+        CPU_RELAX();
+
+    if (!__atomic_load_n(&Pipeline->jobDone, __ATOMIC_ACQUIRE))
+    {
+        pthread_mutex_lock(&Pipeline->lock);
+        while (!Pipeline->jobDone) pthread_cond_wait(&Pipeline->workDone, &Pipeline->lock);
+        pthread_mutex_unlock(&Pipeline->lock);
+    }
+
+    //Only the part of the wait that came after submission counts as exposed
+    if (waitTime < Pipeline->submitTime) waitTime = Pipeline->submitTime;
+    if (Pipeline->completeTime > waitTime) Pipeline->blockedTime += Pipeline->completeTime - waitTime;
+
+    Pipeline->simulationTime += Pipeline->completeTime - Pipeline->submitTime;
+    Pipeline->busySlot        = -1;
+
+    return Pipeline->jobResult;
+}
+
+UINT SlotCount(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    return Pipeline->slotFirst[Slot + 1] - Pipeline->slotFirst[Slot];
+}
+
+SNAKE_GAME* SlotGames(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    return Pipeline->games + Pipeline->slotFirst[Slot];
+}
+
+BYTE* SlotDirections(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    return Pipeline->directions + Pipeline->slotFirst[Slot];
+}
+
+BYTE* SlotPlanes(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    return Pipeline->planes + Pipeline->slotFirst[Slot] * FIELD_AREA(Pipeline->games);
+}
+
+SNAKE_STATUS* SlotStatuses(SNAKE_PIPELINE* Pipeline, UINT Slot)
+{
+    return Pipeline->statuses + Pipeline->slotFirst[Slot];
+}
+
+double PipelineOverlap(SNAKE_PIPELINE* Pipeline)
+{
+    if (Pipeline->simulationTime <= 0.0) return 0.0;
+
+    return 1.0 - Pipeline->blockedTime / Pipeline->simulationTime;
+}
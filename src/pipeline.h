@@ -0,0 +1,106 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <pthread.h>
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define PIPELINE_SLOTS              2     //Halves of the games, stepped in turns
+#define PIPELINE_CHUNK              16    //Games taken by a worker at a time
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Steps games on worker threads while the caller is busy with something else.
+//The games are split into two slots with separate direction, plane and status
+//arrays: while one slot is being stepped, the caller reads the observations
+//of the other one and computes its next directions, so neither side idles.
+//
+//    SubmitStep(&pipeline, 0, NULL);
+//    for (;;)
+//    {
+//        Policy(SlotPlanes(&pipeline, 1), directions1);   //Overlaps slot 0
+//        WaitStep  (&pipeline, 0);
+//        SubmitStep(&pipeline, 1, directions1);
+//        Policy(SlotPlanes(&pipeline, 0), directions0);   //Overlaps slot 1
+//        WaitStep  (&pipeline, 1);
+//        SubmitStep(&pipeline, 0, directions0);
+//    }
+typedef struct _SNAKE_PIPELINE
+{
+    SNAKE_GAME*     games;
+    UINT            count;
+    UINT            slotFirst[PIPELINE_SLOTS + 1];
+    BYTE*           directions;
+    BYTE*           planes;
+    SNAKE_STATUS*   statuses;
+
+    //Workers
+    pthread_t*      threads;
+    UINT            threadCount;
+    pthread_mutex_t lock;
+    pthread_cond_t  workReady;
+    pthread_cond_t  workDone;
+    UINT            generation;         //Bumped on every submission
+    BOOL            quit;
+
+    //Job in flight, the counters are updated atomically
+    int             busySlot;           //-1 when idle
+    UINT64          chunkState;         //Generation in the high half, next chunk in the low one
+    UINT            pendingChunks;
+    UINT            chunkCount;
+    BOOL            jobDone;
+    SNAKE_RESULT    jobResult;
+
+    //Timing, in seconds
+    double          submitTime;
+    double          completeTime;
+    double          simulationTime;     //Accumulated from submission to completion
+    double          blockedTime;        //Accumulated inside WaitStep
+} SNAKE_PIPELINE;
+
+
+//*****************************************************************************
+//
+//                             PIPELINE FUNCTIONS
+//
+//*****************************************************************************
+
+//Games must already be initialized. With zero threads, steps run inside
+//SubmitStep itself.
+SNAKE_RESULT    CreatePipeline   (SNAKE_PIPELINE* Pipeline, SNAKE_GAME* Games, UINT Count, UINT Threads);
+void            DestroyPipeline  (SNAKE_PIPELINE* Pipeline);
+
+//Starts stepping a slot with one direction byte per game of the slot (NULL or
+//NO_COMMAND keeps the direction). Waits first if the other slot is in flight.
+void            SubmitStep       (SNAKE_PIPELINE* Pipeline, UINT Slot, const BYTE* Directions);
+SNAKE_RESULT    WaitStep         (SNAKE_PIPELINE* Pipeline, UINT Slot);
+
+UINT            SlotCount        (SNAKE_PIPELINE* Pipeline, UINT Slot);
+SNAKE_GAME*     SlotGames        (SNAKE_PIPELINE* Pipeline, UINT Slot);
+BYTE*           SlotDirections   (SNAKE_PIPELINE* Pipeline, UINT Slot);
+BYTE*           SlotPlanes       (SNAKE_PIPELINE* Pipeline, UINT Slot);
+SNAKE_STATUS*   SlotStatuses     (SNAKE_PIPELINE* Pipeline, UINT Slot);
+
+//Share of the stepping time that was hidden behind the caller's own work,
+//from 0 (fully serial) to 1 (fully overlapped).
+double          PipelineOverlap  (SNAKE_PIPELINE* Pipeline);
+
+#endif
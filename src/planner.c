@@ -0,0 +1,462 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "planner.h"
+#include "common.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define MAX_DEPTH                   256   //Tree levels a playout may descend
+#define ROLLOUT_DEPTH               32    //Random moves played below the tree
+#define EXPANDING                   0xFFFFFFFF //firstChild while a thread takes the children
+#define VALUE_SCALE                 65536.0
+#define EXPLORATION                 0.3
+#define FOOD_DISCOUNT               0.95  //Food eaten later is worth less
+#define FOOD_CLOSENESS              0.5   //Worth of ending a playout next to the food
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _PLANNER_WORKER
+{
+    SNAKE_PLANNER*    planner;
+    SNAKE_GAME*       game;
+    SNAKE_GAME*       copy;
+    OUTCOME_DETECTOR* detector;
+    double            deadline;
+    UINT              random;
+    UINT64            playouts;
+    UINT64            settled;
+    SNAKE_RESULT      result;
+} PLANNER_WORKER;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static UINT NextRandom(UINT* State)
+{
+    *State ^= *State << 13;
+    *State ^= *State >> 17;
+    *State ^= *State << 5;
+
+    return *State;
+}
+
+//Copies are steered through previousDirection, which is what MoveSnake
+//follows when no command is waiting
+static SNAKE_RESULT PlayMove(SNAKE_GAME* Copy, SNAKE_DIRECTION Direction, double* Eaten, double* Discount)
+{
+    UINT         size = Copy->snakeSize;
+    SNAKE_RESULT result;
+
+    Copy->previousDirection = Direction;
+    result                  = MoveSnake(Copy);
+
+    if (Copy->snakeSize > size) *Eaten += *Discount;
+    *Discount *= FOOD_DISCOUNT;
+
+    return result;
+}
+
+//Random move among those that don't hit anything right away
+static SNAKE_DIRECTION RandomMove(SNAKE_GAME* Copy, UINT* Random)
+{
+    SNAKE_DIRECTION moves[PLANNER_ACTIONS];
+    SNAKE_DIRECTION direction;
+    WORD            position;
+    UINT            count = 0;
+    UINT            action;
+
+    for (action = 0; action < PLANNER_ACTIONS; action++)
+    {
+        direction = TURN(Copy->previousDirection, action);
+        position  = NewPosition(Copy, Copy->headPosition, 1, direction);
+
+        if (IsInsideField(Copy, position) && IS_BLOCK_AVAILABLE(GetFieldBlock(Copy, position)))
+            moves[count++] = direction;
+    }
+
+    if (count == 0) return Copy->previousDirection;
+
+    return moves[NextRandom(Random) % count];
+}
+
+//Blocks between the head and the food, around the walls when there are none
+static UINT FoodDistance(SNAKE_GAME* Copy)
+{
+    int dx = abs(BLOCK_X(Copy->headPosition) - BLOCK_X(Copy->foodPosition));
+    int dy = abs(BLOCK_Y(Copy->headPosition) - BLOCK_Y(Copy->foodPosition));
+
+    if (Copy->passThroughWalls)
+    {
+        if (dx > (int) Copy->fieldWidth  - dx) dx = (int) Copy->fieldWidth  - dx;
+        if (dy > (int) Copy->fieldHeight - dy) dy = (int) Copy->fieldHeight - dy;
+    }
+
+    return (UINT) (dx + dy);
+}
+
+//Half the value for staying alive, the other half for the food eaten. Random
+//playouts seldom reach the food, so getting closer to it counts a little too.
+static double PlayoutValue(SNAKE_GAME* Copy, double Eaten, double Discount)
+{
+    double closeness;
+
+    if (Copy->snakeState == WON)  return 1.0;
+    if (Copy->snakeState == LOST) return 0.5 * Eaten / (Eaten + 1.0);
+
+    closeness = 1.0 - (double) FoodDistance(Copy) / (Copy->fieldWidth + Copy->fieldHeight);
+    Eaten    += FOOD_CLOSENESS * Discount * closeness;
+
+    return 0.5 + 0.5 * Eaten / (Eaten + 1.0);
+}
+
+static UINT SelectChild(SNAKE_PLANNER* Planner, UINT Node, UINT First)
+{
+    PLANNER_NODE* pChild;
+    double        logVisits;
+    double        score, bestScore = -1.0;
+    UINT          visits;
+    UINT          action;
+    UINT          best = First;
+
+    logVisits = log((double) __atomic_load_n(&Planner->nodes[Node].visits, __ATOMIC_RELAXED) + 1.0);
+
+    for (action = 0; action < PLANNER_ACTIONS; action++)
+    {
+        pChild = Planner->nodes + First + action;
+        visits = __atomic_load_n(&pChild->visits, __ATOMIC_RELAXED);
+
+        if (visits == 0) return First + action;
+
+        score = __atomic_load_n(&pChild->value, __ATOMIC_RELAXED) / VALUE_SCALE / visits +
+                EXPLORATION * sqrt(logVisits / visits);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best      = First + action;
+        }
+    }
+
+    return best;
+}
+
+//Runs playouts until the deadline of the move
+static void Search(PLANNER_WORKER* Worker)
+{
+    SNAKE_PLANNER*    planner  = Worker->planner;
+    SNAKE_GAME*       copy     = Worker->copy;
+    PLANNER_NODE*     nodes    = planner->nodes;
+    OUTCOME_DETECTOR* detector = Worker->detector;
+    UINT              path[MAX_DEPTH];
+    UINT              depth, node, child, first, expected;
+    UINT              move;
+    UINT64            value;
+    double            eaten, discount;
+    BOOL              expanded;
+
+    while (Now() < Worker->deadline)
+    {
+        if ((Worker->result = CopyGame(copy, Worker->game)) != SR_OK) break;
+
+        //Copies would all place the food where the game will, so every
+        //playout draws it from a stream of its own
+        SeedGame(copy, NextRandom(&Worker->random), Worker->playouts);
+
+        eaten    = 0.0;
+        discount = 1.0;
+        expanded = FALSE;
+        node     = 0;
+        depth    = 0;
+
+        __atomic_add_fetch(&nodes[0].visits, 1, __ATOMIC_RELAXED);
+        path[depth++] = 0;
+
+        //Descends the tree, expanding at most one node
+        while (copy->snakeState == RUNNING && depth < MAX_DEPTH && !expanded)
+        {
+            first = __atomic_load_n(&nodes[node].firstChild, __ATOMIC_ACQUIRE);
+
+            if (first == 0)
+            {
+                expected = 0;
+
+                if (!__atomic_compare_exchange_n(&nodes[node].firstChild, &expected, EXPANDING, FALSE,
+                                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+                    break;
+
+                //A full pool leaves the node marked, so it stays a leaf
+                first = __atomic_fetch_add(&planner->nodeCount, PLANNER_ACTIONS, __ATOMIC_RELAXED);
+                if (first + PLANNER_ACTIONS > planner->capacity) break;
+
+                __atomic_store_n(&nodes[node].firstChild, first, __ATOMIC_RELEASE);
+                expanded = TRUE;
+            }
+
+            if (first == EXPANDING) break;
+
+            child = SelectChild(planner, node, first);
+
+            //Virtual loss, turned into a real visit when the value is added
+            __atomic_add_fetch(&nodes[child].visits, 1, __ATOMIC_RELAXED);
+            path[depth++] = child;
+
+            Worker->result = PlayMove(copy, TURN(copy->previousDirection, child - first), &eaten, &discount);
+            if (Worker->result != SR_OK) return;
+
+            node = child;
+        }
+
+        for (move = 0; move < ROLLOUT_DEPTH && copy->snakeState == RUNNING; move++)
+        {
+            Worker->result = PlayMove(copy, RandomMove(copy, &Worker->random), &eaten, &discount);
+            if (Worker->result != SR_OK) return;
+        }
+
+        //A snake sealed in for good is worth the loss it is heading for. The
+        //copy is thrown away, so it is simply marked lost.
+        if (copy->snakeState == RUNNING && PredictOutcome(detector, copy) == LOST)
+        {
+            copy->snakeState = LOST;
+            Worker->settled++;
+        }
+
+        value = (UINT64) (PlayoutValue(copy, eaten, discount) * VALUE_SCALE);
+
+        while (depth) __atomic_add_fetch(&nodes[path[--depth]].value, value, __ATOMIC_RELAXED);
+
+        Worker->playouts++;
+    }
+}
+
+static void* PlannerWorker(void* Argument)
+{
+    PLANNER_WORKER* worker  = (PLANNER_WORKER*) Argument;
+    SNAKE_PLANNER*  planner = worker->planner;
+    UINT            seen    = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&planner->lock);
+
+        while (!planner->quit && planner->generation == seen)
+            pthread_cond_wait(&planner->workReady, &planner->lock);
+
+        seen = planner->generation;
+
+        if (planner->quit)
+        {
+            pthread_mutex_unlock(&planner->lock);
+            break;
+        }
+
+        pthread_mutex_unlock(&planner->lock);
+
+        Search(worker);
+
+        pthread_mutex_lock(&planner->lock);
+        if (--planner->searching == 0) pthread_cond_signal(&planner->workDone);
+        pthread_mutex_unlock(&planner->lock);
+    }
+
+    return NULL;
+}
+
+
+//*****************************************************************************
+//
+//                              PLANNER FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreatePlanner(SNAKE_PLANNER* Planner, UINT Threads, UINT Capacity)
+{
+    UINT i;
+
+    memset(Planner, 0, sizeof(SNAKE_PLANNER));
+
+    if (Threads == 0) Threads = ProcessorCount();
+    if (Threads > MAX_THREADS) Threads = MAX_THREADS;
+
+    Planner->threadCount = 1;
+    Planner->capacity    = Capacity ? Capacity : PLANNER_NODES;
+    Planner->nodes       = (PLANNER_NODE*)     calloc(Planner->capacity, sizeof(PLANNER_NODE));
+    Planner->copies      = (SNAKE_GAME*)       calloc(Threads, sizeof(SNAKE_GAME));
+    Planner->detectors   = (OUTCOME_DETECTOR*) calloc(Threads, sizeof(OUTCOME_DETECTOR));
+    Planner->workers     = (PLANNER_WORKER*)   calloc(Threads, sizeof(PLANNER_WORKER));
+    Planner->threads     = (pthread_t*)        calloc(Threads, sizeof(pthread_t));
+    Planner->nodeCount   = 1;
+
+    pthread_mutex_init(&Planner->lock, NULL);
+    pthread_cond_init (&Planner->workReady, NULL);
+    pthread_cond_init (&Planner->workDone, NULL);
+
+    if (!Planner->nodes || !Planner->copies || !Planner->detectors || !Planner->workers || !Planner->threads ||
+        Planner->capacity < 1 + PLANNER_ACTIONS)
+    {
+        DestroyPlanner(Planner);
+        return SR_MEMORY_ERROR;
+    }
+
+    for (i = 0; i < Threads; i++)
+    {
+        Planner->workers[i].planner  = Planner;
+        Planner->workers[i].copy     = Planner->copies + i;
+        Planner->workers[i].detector = Planner->detectors + i;
+    }
+
+    //The calling thread is the first worker, the pool makes do without the
+    //threads that can't be started
+    for (i = 1; i < Threads; i++)
+    {
+        if (pthread_create(Planner->threads + i, NULL, PlannerWorker, Planner->workers + i) != 0) break;
+
+        Planner->threadCount++;
+    }
+
+    return SR_OK;
+}
+
+void DestroyPlanner(SNAKE_PLANNER* Planner)
+{
+    UINT i;
+
+    pthread_mutex_lock(&Planner->lock);
+    Planner->quit = TRUE;
+    pthread_cond_broadcast(&Planner->workReady);
+    pthread_mutex_unlock(&Planner->lock);
+
+    for (i = 1; i < Planner->threadCount; i++) pthread_join(Planner->threads[i], NULL);
+
+    pthread_mutex_destroy(&Planner->lock);
+    pthread_cond_destroy (&Planner->workReady);
+    pthread_cond_destroy (&Planner->workDone);
+
+    for (i = 0; Planner->copies && i < Planner->threadCount; i++) EndingCleanUp(Planner->copies + i);
+    for (i = 0; Planner->detectors && i < Planner->threadCount; i++) DestroyOutcomeDetector(Planner->detectors + i);
+
+    free(Planner->nodes);
+    free(Planner->copies);
+    free(Planner->detectors);
+    free(Planner->workers);
+    free(Planner->threads);
+
+    Planner->nodes       = NULL;
+    Planner->copies      = NULL;
+    Planner->detectors   = NULL;
+    Planner->workers     = NULL;
+    Planner->threads     = NULL;
+    Planner->threadCount = 0;
+}
+
+SNAKE_RESULT PlanMove(SNAKE_PLANNER* Planner, SNAKE_GAME* Game, double Budget, SNAKE_DIRECTION* Move)
+{
+    PLANNER_WORKER* workers = Planner->workers;
+    PLANNER_NODE*   root    = Planner->nodes;
+    double          start   = Now();
+    SNAKE_RESULT    result  = SR_OK;
+    UINT64          micros;
+    UINT            used, first, action, best = 1;
+    UINT            i;
+
+    *Move = Game->previousDirection;
+
+    if (Game->snakeState != RUNNING || Game->hCommandsBeginning != NULL) return SR_OK;
+
+    if (Budget <= 0.0) Budget = PLANNER_BUDGET_SHARE / Game->snakeSpeed;
+
+    //Converted through 64 bits, since the microseconds outgrow a UINT after
+    //71 minutes of uptime, and folded so both halves change the seeds
+    micros  = (UINT64) (start * 1e6);
+    micros ^= micros >> 32;
+
+    //The pool only holds the tree of the current move
+    used = Planner->nodeCount < Planner->capacity ? Planner->nodeCount : Planner->capacity;
+    memset(Planner->nodes, 0, used * sizeof(PLANNER_NODE));
+    Planner->nodeCount = 1;
+
+    for (i = 0; i < Planner->threadCount; i++)
+    {
+        //Without the memory for a detector the playouts just run their full length
+        if (Planner->detectors[i].blocks != Game->fieldWidth * Game->fieldHeight)
+        {
+            DestroyOutcomeDetector(Planner->detectors + i);
+            CreateOutcomeDetector(Planner->detectors + i, Game, PLANNER_REGION);
+
+            //A playout is checked once, to be valued, however short the snake
+            Planner->detectors[i].minSnake = 0;
+        }
+
+        workers[i].game     = Game;
+        workers[i].deadline = start + Budget;
+        workers[i].random   = (UINT) micros * 2654435761u + i + 1;
+        workers[i].playouts = 0;
+        workers[i].settled  = 0;
+        workers[i].result   = SR_OK;
+
+        if (workers[i].random == 0) workers[i].random = 1;
+    }
+
+    pthread_mutex_lock(&Planner->lock);
+    Planner->searching = Planner->threadCount - 1;
+    Planner->generation++;
+    pthread_cond_broadcast(&Planner->workReady);
+    pthread_mutex_unlock(&Planner->lock);
+
+    Search(workers);
+
+    pthread_mutex_lock(&Planner->lock);
+    while (Planner->searching) pthread_cond_wait(&Planner->workDone, &Planner->lock);
+    pthread_mutex_unlock(&Planner->lock);
+
+    Planner->playouts = 0;
+
+    for (i = 0; i < Planner->threadCount; i++)
+    {
+        Planner->playouts     += workers[i].playouts;
+        Planner->totalSettled += workers[i].settled;
+
+        if (workers[i].result != SR_OK) result = workers[i].result;
+    }
+
+    Planner->elapsed        = Now() - start;
+    Planner->totalPlayouts += Planner->playouts;
+    Planner->totalTime     += Planner->elapsed;
+
+    first = root->firstChild;
+    if (result != SR_OK || first == 0 || first == EXPANDING) return result;
+
+    for (action = 0; action < PLANNER_ACTIONS; action++)
+        if (Planner->nodes[first + action].visits > Planner->nodes[first + best].visits) best = action;
+
+    *Move = TURN(Game->previousDirection, best);
+    return SR_OK;
+}
+
+double PlayoutRate(SNAKE_PLANNER* Planner)
+{
+    if (Planner->totalTime <= 0.0) return 0.0;
+
+    return Planner->totalPlayouts / Planner->totalTime;
+}
@@ -0,0 +1,98 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <pthread.h>
+#include "snake.h"
+#include "outcome.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define PLANNER_NODES               (1 << 20) //Default size of the node pool
+#define PLANNER_BUDGET_SHARE        0.8       //Share of a tick spent planning by default
+#define PLANNER_ACTIONS             3         //Turn left, go straight, turn right
+#define PLANNER_REGION              64        //Largest region the outcome detector of a playout fills
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Nodes stand for sequences of moves from the current position, not for game
+//states, so the random food of each playout never splits the tree. The
+//children of a node are three consecutive nodes of the pool, one per action.
+typedef struct _PLANNER_NODE
+{
+    UINT   firstChild;          //0 until expanded
+    UINT   visits;              //Counted on the way down, so a playout in flight reads as a loss
+    UINT64 value;               //Sum of playout values, in 1/65536ths
+} PLANNER_NODE;
+
+//Monte Carlo tree search over copies of the game. Every thread descends the
+//same tree, adding a virtual loss to the nodes it passes so the others spread
+//over different moves, and plays random moves from the first new node on.
+//A playout that ends with the snake alive but sealed in is valued as a loss.
+//The threads are started once, the caller of PlanMove being the first one,
+//and wait between moves.
+typedef struct _SNAKE_PLANNER
+{
+    PLANNER_NODE*            nodes;
+    UINT                     capacity;
+    UINT                     nodeCount;     //Taken atomically, the pool is emptied every move
+    UINT                     threadCount;
+    SNAKE_GAME*              copies;        //One per thread, kept between moves to reuse their memory
+    OUTCOME_DETECTOR*        detectors;     //One per thread, made again when the field changes size
+
+    //Workers
+    struct _PLANNER_WORKER*  workers;       //One per thread
+    pthread_t*               threads;       //Of workers 1 on
+    pthread_mutex_t          lock;
+    pthread_cond_t           workReady;
+    pthread_cond_t           workDone;
+    UINT                     generation;    //Bumped on every move
+    UINT                     searching;     //Threads still searching the move
+    BOOL                     quit;
+
+    //Statistics
+    UINT64                   playouts;      //Of the last move
+    double                   elapsed;
+    UINT64                   totalPlayouts;
+    UINT64                   totalSettled;  //Playouts ended alive and valued as a certain loss
+    double                   totalTime;
+} SNAKE_PLANNER;
+
+
+//*****************************************************************************
+//
+//                              PLANNER FUNCTIONS
+//
+//*****************************************************************************
+
+//Zero threads uses every processor, fewer being used when some can't be
+//started. Capacity is the size of the node pool, or zero for PLANNER_NODES.
+SNAKE_RESULT    CreatePlanner  (SNAKE_PLANNER* Planner, UINT Threads, UINT Capacity);
+void            DestroyPlanner (SNAKE_PLANNER* Planner);
+
+//Searches for Budget seconds, or for PLANNER_BUDGET_SHARE of a tick at the
+//game's snakeSpeed when Budget is zero, and writes the most visited move to
+//Move. While commands are waiting in the game, that is previousDirection.
+//Returns the error of any thread whose playout failed.
+SNAKE_RESULT    PlanMove       (SNAKE_PLANNER* Planner, SNAKE_GAME* Game, double Budget, SNAKE_DIRECTION* Move);
+
+//Playouts per second over every move planned so far
+double          PlayoutRate    (SNAKE_PLANNER* Planner);
+
+#endif
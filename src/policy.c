@@ -0,0 +1,479 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "policy.h"
+#include "common.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define WEIGHT_ALIGNMENT            32
+#define MAX_RADIUS                  (1 + POLICY_MAX_LAYERS)
+#define MAX_WINDOW                  (2 * MAX_RADIUS + 1)
+#define MAX_ROW_BYTES               (9 * POLICY_MAX_CHANNELS)
+#define ROUND_UP(n, m)              (((n) + (m) - 1) / (m) * (m))
+
+//Channels between the inputs of neighbouring blocks, the padded outputs of
+//the layer before
+#define INPUT_STRIDE(p, l)          ((l) == 0 ? PLANE_COUNT : (p)->outputs[(l) - 1])
+
+//Scores of the neighbours of the head in the 3x3 window the last layer
+//writes, whose rows go up like the field
+static const UINT neighbourScores[4] = { 5, 7, 3, 1 };
+
+//u8 activations times s8 weights, four products at a time into every 32-bit
+//lane. Activations never passing 127 keep vpmaddubsw from saturating.
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+#define POLICY_KERNEL               "AVX512-VNNI"
+#define DOT_BYTES(s, a, w)          _mm256_dpbusd_epi32((s), (a), (w))
+#elif defined(__AVXVNNI__)
+#define POLICY_KERNEL               "AVX-VNNI"
+#define DOT_BYTES(s, a, w)          _mm256_dpbusd_avx_epi32((s), (a), (w))
+#elif defined(__AVX2__)
+#define POLICY_KERNEL               "AVX2"
+#define DOT_BYTES(s, a, w)          _mm256_add_epi32((s), _mm256_madd_epi16(_mm256_maddubs_epi16((a), (w)), \
+                                                                             _mm256_set1_epi16(1)))
+#else
+#define POLICY_KERNEL               "scalar"
+#endif
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static void* AllocateAligned(size_t Bytes)
+{
+    void* memory = NULL;
+
+#ifdef _WIN32
+    memory = _aligned_malloc(Bytes, WEIGHT_ALIGNMENT);
+#else
+    if (posix_memalign(&memory, WEIGHT_ALIGNMENT, Bytes) != 0) memory = NULL;
+#endif
+
+    if (memory != NULL) memset(memory, 0, Bytes);
+
+    return memory;
+}
+
+static void FreeAligned(void* Memory)
+{
+#ifdef _WIN32
+    _aligned_free(Memory);
+#else
+    free(Memory);
+#endif
+}
+
+//Checks the shape of a layer against the one before and allocates it, zeroed
+static BOOL AllocateLayer(POLICY* Policy, UINT Layer)
+{
+    POLICY_LAYER* layer = Policy->layers + Layer;
+
+    if (layer->kernel != 1 && layer->kernel != 3) return FALSE;
+    if (layer->outChannels == 0 || layer->outChannels > POLICY_MAX_CHANNELS) return FALSE;
+    if (layer->inChannels != (Layer == 0 ? PLANE_COUNT : Policy->layers[Layer - 1].outChannels)) return FALSE;
+
+    Policy->radius          = (Layer == 0 ? 1 : Policy->radius) + layer->kernel / 2;
+    Policy->outputs[Layer]  = ROUND_UP(layer->outChannels, 8);
+    Policy->rowBytes[Layer] = ROUND_UP(layer->kernel * layer->kernel * INPUT_STRIDE(Policy, Layer), 32);
+    Policy->weights[Layer]  = (signed char*) AllocateAligned((size_t) Policy->outputs[Layer] * Policy->rowBytes[Layer]);
+    Policy->biases[Layer]   = (int*)   AllocateAligned(Policy->outputs[Layer] * sizeof(int));
+    Policy->scales[Layer]   = (float*) AllocateAligned(Policy->outputs[Layer] * sizeof(float));
+
+    return Policy->weights[Layer] != NULL && Policy->biases[Layer] != NULL && Policy->scales[Layer] != NULL;
+}
+
+//Where weight [o][row][column][c] of a layer is kept
+static signed char* PaddedWeight(const POLICY* Policy, UINT Layer, UINT O, UINT Tap, UINT C)
+{
+    return Policy->weights[Layer] + (size_t) O * Policy->rowBytes[Layer] + Tap * INPUT_STRIDE(Policy, Layer) + C;
+}
+
+//Writes the one-hot planes of the blocks around the head straight from the
+//packed field, one byte per plane
+static void FillWindow(const POLICY* Policy, SNAKE_GAME* Game, BYTE* Window)
+{
+    const BYTE* pFieldBuffer;
+    int         radius = (int) Policy->radius;
+    int         side   = 2 * radius + 1;
+    int         width  = (int) Game->fieldWidth;
+    int         height = (int) Game->fieldHeight;
+    int         headX  = BLOCK_X(Game->headPosition);
+    int         headY  = BLOCK_Y(Game->headPosition);
+    int         x, y, column, row;
+    UINT        i;
+
+    memset(Window, 0, (size_t) side * side * PLANE_COUNT);
+
+    if (Game->hFieldBuffer == NULL) return;
+
+    pFieldBuffer = (const BYTE*) GlobalLock(Game->hFieldBuffer);
+
+    for (row = 0; row < side; row++)
+    {
+        y = headY + row - radius;
+
+        if (Game->passThroughWalls) y = (y % height + height) % height;
+        else if (y < 0 || y >= height) continue;
+
+        for (column = 0; column < side; column++)
+        {
+            x = headX + column - radius;
+
+            if (Game->passThroughWalls) x = (x % width + width) % width;
+            else if (x < 0 || x >= width) continue;
+
+            i = (UINT) (y * width + x);
+            Window[(row * side + column) * PLANE_COUNT + ((pFieldBuffer[i / 4] >> 2 * (i % 4)) & 0x03)] = 1;
+        }
+    }
+
+    GlobalUnlock(Game->hFieldBuffer);
+}
+
+//Dot products of Row with 8 rows of weights RowBytes apart
+static void DotRows8(const BYTE* Row, const signed char* Weights, UINT RowBytes, int* Sums)
+{
+#if defined(__AVX2__)
+    __m256i sums[8];
+    __m256i row, low, high;
+    UINT    i, k;
+
+    for (i = 0; i < 8; i++) sums[i] = _mm256_setzero_si256();
+
+    for (k = 0; k < RowBytes; k += 32)
+    {
+        row = _mm256_load_si256((const __m256i*) (Row + k));
+
+        for (i = 0; i < 8; i++)
+            sums[i] = DOT_BYTES(sums[i], row, _mm256_load_si256((const __m256i*) (Weights + (size_t) i * RowBytes + k)));
+    }
+
+    //Pairwise adds leave the halves of sums 0-3 in one vector and of 4-7 in the other
+    low  = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]), _mm256_hadd_epi32(sums[2], sums[3]));
+    high = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[4], sums[5]), _mm256_hadd_epi32(sums[6], sums[7]));
+
+    _mm256_storeu_si256((__m256i*) Sums, _mm256_add_epi32(_mm256_permute2x128_si256(low, high, 0x20),
+                                                          _mm256_permute2x128_si256(low, high, 0x31)));
+#else
+    UINT i, k;
+    int  sum;
+
+    for (i = 0; i < 8; i++)
+    {
+        for (k = 0, sum = 0; k < RowBytes; k++) sum += (int) Row[k] * Weights[(size_t) i * RowBytes + k];
+
+        Sums[i] = sum;
+    }
+#endif
+}
+
+//Activations of 8 outputs from their sums, rounded to even like cvtps2dq
+static void Activate8(const int* Sums, const int* Biases, const float* Scales, BYTE* Outputs)
+{
+#if defined(__AVX2__)
+    __m256i value = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) Sums), _mm256_load_si256((const __m256i*) Biases));
+    __m128i words;
+
+    value = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(value), _mm256_load_ps(Scales)));
+    value = _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(POLICY_MAX_ACTIVATION));
+    words = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+
+    _mm_storel_epi64((__m128i*) Outputs, _mm_packus_epi16(words, words));
+#else
+    long value;
+    UINT i;
+
+    for (i = 0; i < 8; i++)
+    {
+        value      = lrintf((float) (Sums[i] + Biases[i]) * Scales[i]);
+        Outputs[i] = (BYTE) (value < 0 ? 0 : value > POLICY_MAX_ACTIVATION ? POLICY_MAX_ACTIVATION : value);
+    }
+#endif
+}
+
+//Runs a layer over a window Side blocks wide, writing the outputs of the
+//window Side - kernel + 1 blocks wide inside it
+static void RunLayer(const POLICY* Policy, UINT Layer, const BYTE* Input, UINT Side, BYTE* Output, float* Scores)
+{
+    BYTE                rowBuffer[MAX_ROW_BYTES] __attribute__((aligned(32)));
+    const POLICY_LAYER* layer   = Policy->layers + Layer;
+    UINT                stride  = INPUT_STRIDE(Policy, Layer);
+    UINT                kernel  = layer->kernel;
+    UINT                outSide = Side - kernel + 1;
+    UINT                outputs = Policy->outputs[Layer];
+    BOOL                last    = Layer == Policy->layerCount - 1;
+    int                 sums[8];
+    UINT                x, y, row, o;
+
+    //Bytes past the taps stay zero, like the weights facing them
+    memset(rowBuffer, 0, Policy->rowBytes[Layer]);
+
+    for (y = 0; y < outSide; y++)
+    {
+        for (x = 0; x < outSide; x++)
+        {
+            for (row = 0; row < kernel; row++)
+                memcpy(rowBuffer + row * kernel * stride, Input + ((size_t) (y + row) * Side + x) * stride, kernel * stride);
+
+            for (o = 0; o < outputs; o += 8)
+            {
+                DotRows8(rowBuffer, Policy->weights[Layer] + (size_t) o * Policy->rowBytes[Layer], Policy->rowBytes[Layer], sums);
+
+                if (last)
+                {
+                    Scores[y * outSide + x] = (float) (sums[0] + Policy->biases[Layer][0]) * Policy->scales[Layer][0];
+                    break;
+                }
+
+                Activate8(sums, Policy->biases[Layer] + o, Policy->scales[Layer] + o, Output + (y * outSide + x) * outputs + o);
+            }
+        }
+    }
+}
+
+
+//*****************************************************************************
+//
+//                              POLICY FUNCTIONS
+//
+//*****************************************************************************
+
+BOOL LoadPolicy(POLICY* Policy, const char* File)
+{
+    POLICY_HEADER header;
+    POLICY_LAYER* layer;
+    signed char   weights[MAX_ROW_BYTES];
+    FILE*         file;
+    BOOL          read;
+    UINT          l, o, tap, taps;
+
+    memset(Policy, 0, sizeof(POLICY));
+
+    file = fopen(File, "rb");
+    if (file == NULL) return FALSE;
+
+    read = fread(&header, sizeof(header), 1, file) == 1 && header.magic == POLICY_MAGIC &&
+           header.version == POLICY_VERSION && header.layerCount > 0 && header.layerCount <= POLICY_MAX_LAYERS;
+
+    for (l = 0; read && l < header.layerCount; l++)
+    {
+        layer = Policy->layers + l;
+        read  = fread(layer, sizeof(POLICY_LAYER), 1, file) == 1 && AllocateLayer(Policy, l);
+        taps  = layer->kernel * layer->kernel;
+
+        Policy->layerCount = l + 1;
+
+        //The weights of an output are spread over its padded row tap by tap
+        for (o = 0; read && o < layer->outChannels; o++)
+        {
+            read = fread(weights, layer->inChannels, taps, file) == taps;
+
+            for (tap = 0; read && tap < taps; tap++)
+                memcpy(PaddedWeight(Policy, l, o, tap, 0), weights + tap * layer->inChannels, layer->inChannels);
+        }
+
+        read = read && fread(Policy->biases[l], sizeof(int),   layer->outChannels, file) == layer->outChannels &&
+                       fread(Policy->scales[l], sizeof(float), layer->outChannels, file) == layer->outChannels;
+    }
+
+    fclose(file);
+
+    if (!read || Policy->layers[Policy->layerCount - 1].outChannels != 1)
+    {
+        DestroyPolicy(Policy);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL CreateRandomPolicy(POLICY* Policy, UINT Layers, UINT Channels, UINT64 Seed)
+{
+    POLICY_LAYER* layer;
+    UINT64        random = Seed;
+    float         scale;
+    UINT          l, o, tap, c;
+
+    memset(Policy, 0, sizeof(POLICY));
+
+    if (Layers == 0 || Layers > POLICY_MAX_LAYERS) return FALSE;
+
+    for (l = 0; l < Layers; l++)
+    {
+        layer = Policy->layers + l;
+
+        layer->kernel      = l + 1 < Layers ? 3 : 1;
+        layer->inChannels  = l == 0 ? PLANE_COUNT : Channels;
+        layer->outChannels = l + 1 < Layers ? Channels : 1;
+        layer->flags       = l + 1 < Layers ? POLICY_RELU : 0;
+
+        Policy->layerCount = l + 1;
+
+        if (!AllocateLayer(Policy, l))
+        {
+            DestroyPolicy(Policy);
+            return FALSE;
+        }
+    }
+
+    //Scaled so that the typical activation stays well inside 0..127: one
+    //input of the first layer is set per block, later ones average about 40
+    for (l = 0; l < Layers; l++)
+    {
+        layer = Policy->layers + l;
+        scale = l == 0 ? 48.0f / (73.0f * layer->kernel)
+                       : 48.0f / (73.0f * 40.0f * sqrtf(layer->kernel * layer->kernel * layer->inChannels / 2.0f));
+
+        for (o = 0; o < layer->outChannels; o++)
+        {
+            for (tap = 0; tap < layer->kernel * layer->kernel; tap++)
+                for (c = 0; c < layer->inChannels; c++)
+                    *PaddedWeight(Policy, l, o, tap, c) = (signed char) ((int) (SplitMix64(&random) % 255) - 127);
+
+            Policy->biases[l][o] = (int) (SplitMix64(&random) % 2001) - 1000;
+            Policy->scales[l][o] = scale;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL SavePolicy(const POLICY* Policy, const char* File)
+{
+    POLICY_HEADER       header;
+    const POLICY_LAYER* layer;
+    FILE*               file;
+    BOOL                written;
+    UINT                l, o, tap, c;
+
+    memset(&header, 0, sizeof(header));
+
+    header.magic      = POLICY_MAGIC;
+    header.version    = POLICY_VERSION;
+    header.layerCount = Policy->layerCount;
+
+    file = fopen(File, "wb");
+    if (file == NULL) return FALSE;
+
+    written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (l = 0; l < Policy->layerCount && written; l++)
+    {
+        layer   = Policy->layers + l;
+        written = fwrite(layer, sizeof(POLICY_LAYER), 1, file) == 1;
+
+        for (o = 0; o < layer->outChannels && written; o++)
+            for (tap = 0; tap < layer->kernel * layer->kernel && written; tap++)
+                for (c = 0; c < layer->inChannels && written; c++)
+                    written = fputc((BYTE) *PaddedWeight(Policy, l, o, tap, c), file) != EOF;
+
+        written = written && fwrite(Policy->biases[l], sizeof(int),   layer->outChannels, file) == layer->outChannels &&
+                             fwrite(Policy->scales[l], sizeof(float), layer->outChannels, file) == layer->outChannels;
+    }
+
+    return fclose(file) == 0 && written;
+}
+
+void DestroyPolicy(POLICY* Policy)
+{
+    UINT l;
+
+    for (l = 0; l < POLICY_MAX_LAYERS; l++)
+    {
+        FreeAligned(Policy->weights[l]);
+        FreeAligned(Policy->biases[l]);
+        FreeAligned(Policy->scales[l]);
+
+        Policy->weights[l] = NULL;
+        Policy->biases[l]  = NULL;
+        Policy->scales[l]  = NULL;
+    }
+
+    Policy->layerCount = 0;
+}
+
+void PolicyScores(const POLICY* Policy, SNAKE_GAME* Game, float* Scores)
+{
+    BYTE  windows[2][MAX_WINDOW * MAX_WINDOW * POLICY_MAX_CHANNELS] __attribute__((aligned(32)));
+    float map[9];
+    UINT  side = 2 * Policy->radius + 1;
+    UINT  l, d;
+
+    FillWindow(Policy, Game, windows[0]);
+
+    for (l = 0; l < Policy->layerCount; l++)
+    {
+        RunLayer(Policy, l, windows[l % 2], side, windows[(l + 1) % 2], map);
+        side -= Policy->layers[l].kernel - 1;
+    }
+
+    for (d = RIGHT; d <= DOWN; d++) Scores[d] = map[neighbourScores[d]];
+}
+
+const char* PolicyKernel(void)
+{
+    return POLICY_KERNEL;
+}
+
+SNAKE_DIRECTION PolicyDirection(const POLICY* Policy, SNAKE_GAME* Game)
+{
+    SNAKE_DIRECTION best     = Game->previousDirection;
+    float           bestScore = 0.0f;
+    BOOL            bestSafe  = FALSE, found = FALSE, safe;
+    float           scores[4];
+    WORD            position;
+    UINT            d;
+
+    PolicyScores(Policy, Game, scores);
+
+    //Moves that run into something only win when every move does
+    for (d = RIGHT; d <= DOWN; d++)
+    {
+        if (d == OPPOSITE_DIRECTION(Game->previousDirection)) continue;
+
+        position = NewPosition(Game, Game->headPosition, 1, (SNAKE_DIRECTION) d);
+        safe     = IsInsideField(Game, position) && IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position));
+
+        if (!found || (safe && !bestSafe) || (safe == bestSafe && scores[d] > bestScore))
+        {
+            best      = (SNAKE_DIRECTION) d;
+            bestScore = scores[d];
+            bestSafe  = safe;
+            found     = TRUE;
+        }
+    }
+
+    return best;
+}
+
+void PolicyBatch(const POLICY* Policy, SNAKE_GAME* Games, UINT Count, BYTE* Directions)
+{
+    UINT i;
+
+    for (i = 0; i < Count; i++) Directions[i] = (BYTE) PolicyDirection(Policy, Games + i);
+}
@@ -0,0 +1,118 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "snake.h"
+#include "encoder.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define POLICY_MAGIC                0x4C504E53 //"SNPL" in the first bytes of a weights file
+#define POLICY_VERSION              1
+#define POLICY_MAX_LAYERS           8
+#define POLICY_MAX_CHANNELS         64
+#define POLICY_MAX_ACTIVATION       127   //Activations are clamped to it, see POLICY_LAYER
+
+//Flags of a layer
+#define POLICY_RELU                 0x01  //Every layer but the last one
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Start of a weights file, followed by layerCount layers. All the integers of
+//the file are little endian and the structures have no padding.
+typedef struct _POLICY_HEADER
+{
+    UINT magic;
+    UINT version;
+    UINT layerCount;
+    UINT reserved;
+} POLICY_HEADER;
+
+//A convolution of kernel x kernel blocks, 1 or 3, followed in the file by
+//outChannels * kernel * kernel * inChannels signed byte weights, ordered
+//[out][row][column][in], outChannels signed 32-bit biases and outChannels
+//float scales. Output o is (bias[o] + sum of weight * input) * scale[o]: the
+//input of the next layer after rounding to the nearest integer and clamping
+//to 0..POLICY_MAX_ACTIVATION with POLICY_RELU, a score otherwise. The first
+//layer reads the PLANE_COUNT one-hot planes of the field as 0 or 1, and the
+//last has a single output.
+typedef struct _POLICY_LAYER
+{
+    UINT outChannels;
+    UINT inChannels;
+    UINT kernel;
+    UINT flags;
+} POLICY_LAYER;
+
+//A convolutional net scoring every block of the field, the snake moving to
+//the neighbour of its head with the highest score. Beyond the walls blocks
+//have every plane at zero, and every layer sees them like any other block,
+//so a score only depends on the blocks within the radius of the net, and the
+//net is evaluated on that window around the head alone, whatever the size of
+//the field. It can thus be trained on head-centered crops of that radius,
+//like EncodeCrop writes them but unrotated.
+//
+//Weights are kept padded for the kernels: every row to a whole number of 32
+//byte vectors and the outputs to multiples of 8, padding all zero. With AVX2
+//the products go through vpmaddubsw, or vpdpbusd with AVX512-VNNI, and the
+//scalar code rounds the same way, so every build picks the same moves.
+typedef struct _POLICY
+{
+    UINT         layerCount;
+    UINT         radius;                        //Blocks around the head the scores depend on, the head's neighbours included
+    POLICY_LAYER layers[POLICY_MAX_LAYERS];
+    UINT         rowBytes[POLICY_MAX_LAYERS];   //Weights of an output, padded
+    UINT         outputs[POLICY_MAX_LAYERS];    //Padded output channels
+    signed char* weights[POLICY_MAX_LAYERS];
+    int*         biases[POLICY_MAX_LAYERS];
+    float*       scales[POLICY_MAX_LAYERS];
+} POLICY;
+
+
+//*****************************************************************************
+//
+//                              POLICY FUNCTIONS
+//
+//*****************************************************************************
+
+//LoadPolicy reads a weights file, and CreateRandomPolicy makes a net of
+//Layers layers of Channels channels, 3x3 but for a 1x1 last layer, with
+//weights drawn from Seed, for testing and timing without a trained net. Both
+//return FALSE on a file or shape they can't take, or out of memory.
+BOOL            LoadPolicy         (POLICY* Policy, const char* File);
+BOOL            CreateRandomPolicy (POLICY* Policy, UINT Layers, UINT Channels, UINT64 Seed);
+BOOL            SavePolicy         (const POLICY* Policy, const char* File);
+void            DestroyPolicy      (POLICY* Policy);
+
+//Instructions the kernels were built for: "AVX512-VNNI", "AVX-VNNI", "AVX2"
+//or "scalar"
+const char*     PolicyKernel       (void);
+
+//Scores of the blocks right, up, left and down of the head, indexed by
+//SNAKE_DIRECTION. The policy can be used by any number of threads at once.
+void            PolicyScores       (const POLICY* Policy, SNAKE_GAME* Game, float* Scores);
+
+//The direction with the best score, never the one back into the snake and
+//one running into something only when every move does
+SNAKE_DIRECTION PolicyDirection    (const POLICY* Policy, SNAKE_GAME* Game);
+
+//The directions of every game of a batch, the games needing no common field
+void            PolicyBatch        (const POLICY* Policy, SNAKE_GAME* Games, UINT Count, BYTE* Directions);
+
+#endif
@@ -0,0 +1,462 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+#include "common.h"
+#include "shared.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define REPLAY_MAGIC                0x50524E53 //"SNRP"
+#define REPLAY_FIELD_BYTES          4040       //Largest packed field, rounded up to whole words
+#define MAX_MISSES                  1024       //Draws a sampling call may lose to transitions being written
+
+#define RECORD_AT(r, s)             ((r)->pRecords + (size_t) (s) * (r)->pHeader->recordBytes)
+#define TREE_LEAF(r, s)             ((r)->leaves - 1 + (s))
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static UINT RecordBytes(UINT Width, UINT Height)
+{
+    return sizeof(REPLAY_RECORD) + ROUND_TO_WORDS((Width * Height + 3) / 4);
+}
+
+static BOOL HeaderMatches(const REPLAY_HEADER* Header, UINT64 Capacity, UINT Width, UINT Height)
+{
+    return Header->magic == REPLAY_MAGIC && Header->version == REPLAY_VERSION && Header->capacity == Capacity &&
+           Header->fieldWidth == Width && Header->fieldHeight == Height &&
+           Header->recordBytes == RecordBytes(Width, Height);
+}
+
+//In [0, 1)
+static double RandomUnit(REPLAY* Replay)
+{
+    return (SplitMix64(&Replay->randomState) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//Copies the record in Slot and its field, unless it's being written or was
+//overwritten while it was read
+static BOOL ReadTransition(REPLAY* Replay, UINT64 Slot, REPLAY_RECORD* Record, BYTE* Field)
+{
+    const BYTE* pRecord    = RECORD_AT(Replay, Slot);
+    UINT        fieldBytes = Replay->pHeader->recordBytes - sizeof(REPLAY_RECORD);
+    UINT64      sequence   = LOAD_ACQUIRE((const UINT64*) pRecord);
+
+    if (sequence == 0) return FALSE;
+
+    ReadShared((BYTE*) Record + sizeof(UINT64), pRecord + sizeof(UINT64), sizeof(REPLAY_RECORD) - sizeof(UINT64));
+    ReadShared(Field, pRecord + sizeof(REPLAY_RECORD), fieldBytes);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (LOAD((const UINT64*) pRecord) != sequence) return FALSE;
+
+    Record->sequence = sequence;
+    return Record->changeCount <= REPLAY_MAX_CHANGES;
+}
+
+//Encodes the state, then applies the changes to the field and encodes the
+//next state
+static void WriteSample(REPLAY* Replay, REPLAY_BATCH* Batch, UINT Sample, const REPLAY_RECORD* Record, BYTE* Field)
+{
+    UINT   width      = Replay->pHeader->fieldWidth;
+    UINT   height     = Replay->pHeader->fieldHeight;
+    UINT   blocks     = width * height;
+    size_t planeBytes = (size_t) PLANE_COUNT * blocks * (Batch->type == PLANE_FLOAT ? sizeof(float) : 1);
+    UINT   x, y, block, i;
+
+    EncodePacked(Field, blocks, (BYTE*) Batch->states + Sample * planeBytes, Batch->type);
+
+    for (i = 0; i < Record->changeCount; i++)
+    {
+        x = (BYTE) BLOCK_X(Record->changes[i].blockPosition);
+        y = (BYTE) BLOCK_Y(Record->changes[i].blockPosition);
+
+        if (x >= width || y >= height) continue;
+
+        block            = y * width + x;
+        Field[block / 4] = (BYTE) ((Field[block / 4] & ~(0x03 << 2 * (block % 4))) |
+                                   (Record->changes[i].newState & 0x03) << 2 * (block % 4));
+    }
+
+    EncodePacked(Field, blocks, (BYTE*) Batch->nextStates + Sample * planeBytes, Batch->type);
+
+    Batch->actions[Sample]   = Record->action;
+    Batch->rewards[Sample]   = Record->reward;
+    Batch->terminals[Sample] = (BYTE) ((Record->flags & REPLAY_TERMINAL) != 0);
+
+    if (Batch->indices != NULL) Batch->indices[Sample] = Record->sequence - 1;
+}
+
+//Sets a leaf of the sum tree and the sums above it
+static void SetLeaf(REPLAY* Replay, UINT64 Slot, double Value)
+{
+    double* pTree = Replay->pTree;
+    UINT64  node  = TREE_LEAF(Replay, Slot);
+
+    pTree[node] = Value;
+
+    while (node > 0)
+    {
+        node        = (node - 1) / 2;
+        pTree[node] = pTree[2 * node + 1] + pTree[2 * node + 2];
+    }
+}
+
+//Gives the transitions appended since the last call the largest priority,
+//stopping at the first one still being written
+static void SyncPriorities(REPLAY* Replay)
+{
+    UINT64 claimed  = LOAD_ACQUIRE(&Replay->pHeader->claimed);
+    UINT64 capacity = Replay->pHeader->capacity;
+    double priority = pow(Replay->maxPriority, Replay->alpha);
+
+    if (claimed - Replay->synced > capacity) Replay->synced = claimed - capacity;
+
+    for (; Replay->synced < claimed; Replay->synced++)
+    {
+        if (LOAD_ACQUIRE((const UINT64*) RECORD_AT(Replay, Replay->synced % capacity)) == 0) break;
+
+        SetLeaf(Replay, Replay->synced % capacity, priority);
+    }
+}
+
+
+//*****************************************************************************
+//
+//                              REPLAY FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT OpenReplay(REPLAY* Replay, const char* File, UINT64 Capacity, UINT Width, UINT Height,
+                        BOOL PassThroughWalls)
+{
+    REPLAY_HEADER  header;
+    REPLAY_HEADER* pHeader;
+    UINT           recordBytes = RecordBytes(Width, Height);
+    size_t         bytes;
+    BOOL           carryOn;
+#ifdef _WIN32
+    DWORD          read;
+#else
+    int            file;
+#endif
+
+    memset(Replay, 0, sizeof(REPLAY));
+
+    if (Capacity == 0) Capacity = REPLAY_CAPACITY;
+
+    if (Width == 0 || Height == 0 || Width > 127 || Height > 127) return SR_BAD_FIELD_SIZE;
+    if (Capacity > (SIZE_MAX - REPLAY_HEADER_BYTES) / recordBytes) return SR_MEMORY_ERROR;
+
+    bytes = REPLAY_HEADER_BYTES + (size_t) Capacity * recordBytes;
+    memset(&header, 0, sizeof(header));
+
+#ifdef _WIN32
+    Replay->hFile = CreateFileA(File, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (Replay->hFile == INVALID_HANDLE_VALUE) return SR_MEMORY_ERROR;
+
+    carryOn = ReadFile(Replay->hFile, &header, sizeof(header), &read, NULL) && read == sizeof(header) &&
+              HeaderMatches(&header, Capacity, Width, Height);
+
+    //Records of another layout must not be taken for transitions
+    if (!carryOn)
+    {
+        SetFilePointer(Replay->hFile, 0, NULL, FILE_BEGIN);
+        SetEndOfFile(Replay->hFile);
+    }
+
+    Replay->hMapping = CreateFileMappingA(Replay->hFile, NULL, PAGE_READWRITE, (DWORD) ((UINT64) bytes >> 32),
+                                          (DWORD) bytes, NULL);
+    pHeader          = Replay->hMapping ? (REPLAY_HEADER*) MapViewOfFile(Replay->hMapping, FILE_MAP_WRITE, 0, 0, bytes) :
+                                          NULL;
+
+    if (pHeader == NULL)
+    {
+        if (Replay->hMapping) CloseHandle(Replay->hMapping);
+        CloseHandle(Replay->hFile);
+        return SR_MEMORY_ERROR;
+    }
+#else
+    if ((file = open(File, O_RDWR | O_CREAT, 0644)) < 0) return SR_MEMORY_ERROR;
+
+    carryOn = pread(file, &header, sizeof(header), 0) == sizeof(header) &&
+              HeaderMatches(&header, Capacity, Width, Height);
+
+    //Records of another layout must not be taken for transitions. The file is
+    //sparse, so blocks never appended to take no room on disk.
+    if ((!carryOn && ftruncate(file, 0) != 0) || ftruncate(file, (off_t) bytes) != 0)
+    {
+        close(file);
+        return SR_MEMORY_ERROR;
+    }
+
+    pHeader = (REPLAY_HEADER*) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+
+    if (pHeader == (REPLAY_HEADER*) MAP_FAILED) return SR_MEMORY_ERROR;
+#endif
+
+    if (!carryOn)
+    {
+        pHeader->version          = REPLAY_VERSION;
+        pHeader->fieldWidth       = Width;
+        pHeader->fieldHeight      = Height;
+        pHeader->recordBytes      = recordBytes;
+        pHeader->passThroughWalls = PassThroughWalls != FALSE;
+        pHeader->capacity         = Capacity;
+        pHeader->claimed          = 0;
+        STORE_RELEASE(&pHeader->magic, REPLAY_MAGIC);
+    }
+
+    Replay->pHeader     = pHeader;
+    Replay->pRecords    = (BYTE*) pHeader + REPLAY_HEADER_BYTES;
+    Replay->mappedBytes = bytes;
+
+    return SR_OK;
+}
+
+void CloseReplay(REPLAY* Replay)
+{
+    if (Replay->pHeader == NULL) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(Replay->pHeader);
+    CloseHandle(Replay->hMapping);
+    CloseHandle(Replay->hFile);
+#else
+    munmap(Replay->pHeader, Replay->mappedBytes);
+#endif
+
+    free(Replay->pTree);
+    memset(Replay, 0, sizeof(REPLAY));
+}
+
+SNAKE_RESULT RecordMove(REPLAY* Replay, SNAKE_GAME* Game)
+{
+    REPLAY_HEADER* pHeader = Replay->pHeader;
+    CELL_EVENTS    events;
+    CELL_EVENTS*   pEvents = Game->pEvents;
+    REPLAY_RECORD  record;
+    BYTE           field[REPLAY_FIELD_BYTES];
+    BYTE*          pRecord;
+    UINT64         index;
+    UINT           bytes   = FIELD_BUFFER_SIZE(Game);
+    UINT           size    = Game->snakeSize;
+    SNAKE_RESULT   result;
+
+    if (pHeader == NULL || Game->fieldWidth != pHeader->fieldWidth || Game->fieldHeight != pHeader->fieldHeight)
+        return SR_BAD_FIELD_SIZE;
+
+    //Finished games are left untouched, like StepBatch does
+    if (Game->hFieldBuffer == NULL || Game->snakeState != RUNNING) return SR_OK;
+
+    memset(field, 0, ROUND_TO_WORDS(bytes));
+    memcpy(field, GlobalLock(Game->hFieldBuffer), bytes);
+    GlobalUnlock(Game->hFieldBuffer);
+
+    //The events of the move are the difference to the next state
+    if (pEvents == NULL) Game->pEvents = &events;
+
+    result = MoveSnake(Game);
+
+    events         = *Game->pEvents;
+    Game->pEvents  = pEvents;
+
+    if (result != SR_OK) return result;
+
+    memset(&record, 0, sizeof(record));
+    record.action      = (BYTE) Game->previousDirection;
+    record.reward      = (Game->snakeSize > size ? REPLAY_REWARD_FOOD : 0.0f) +
+                         (Game->snakeState == LOST ? REPLAY_REWARD_LOSS : 0.0f);
+    record.flags       = Game->snakeState != RUNNING ? REPLAY_TERMINAL : 0;
+    record.changeCount = (BYTE) events.count;
+
+    memcpy(record.changes, events.events, events.count * sizeof(CELL_EVENT));
+
+    //A move never fills the list, but a next state that isn't known is
+    //better kept as the end of the game than as a wrong one
+    if (events.overflow)
+    {
+        record.flags      |= REPLAY_TERMINAL;
+        record.changeCount = 0;
+    }
+
+    index   = __atomic_fetch_add(&pHeader->claimed, 1, __ATOMIC_RELAXED);
+    pRecord = RECORD_AT(Replay, index % pHeader->capacity);
+
+    STORE((UINT64*) pRecord, 0);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    WriteShared(pRecord + sizeof(UINT64), (const BYTE*) &record + sizeof(UINT64), sizeof(record) - sizeof(UINT64));
+    WriteShared(pRecord + sizeof(record), field, pHeader->recordBytes - sizeof(record));
+
+    STORE_RELEASE((UINT64*) pRecord, index + 1);
+
+    return SR_OK;
+}
+
+UINT64 ReplaySize(const REPLAY* Replay)
+{
+    UINT64 claimed;
+
+    if (Replay->pHeader == NULL) return 0;
+
+    claimed = LOAD_ACQUIRE(&Replay->pHeader->claimed);
+
+    return claimed < Replay->pHeader->capacity ? claimed : Replay->pHeader->capacity;
+}
+
+UINT SampleReplay(REPLAY* Replay, REPLAY_BATCH* Batch, UINT Count)
+{
+    REPLAY_RECORD record;
+    BYTE          field[REPLAY_FIELD_BYTES];
+    UINT64        size = ReplaySize(Replay);
+    UINT          sample, misses;
+
+    for (sample = 0, misses = 0; sample < Count && size > 0 && misses < MAX_MISSES;)
+    {
+        if (!ReadTransition(Replay, (UINT64) (RandomUnit(Replay) * size), &record, field))
+        {
+            misses++;
+            continue;
+        }
+
+        if (Batch->weights != NULL) Batch->weights[sample] = 1.0f;
+
+        WriteSample(Replay, Batch, sample++, &record, field);
+    }
+
+    return sample;
+}
+
+UINT SamplePrioritized(REPLAY* Replay, REPLAY_BATCH* Batch, UINT Count, double Beta)
+{
+    REPLAY_RECORD record;
+    BYTE          field[REPLAY_FIELD_BYTES];
+    UINT64        size, node;
+    double        total, target, weight, maxWeight = 0.0;
+    UINT          sample, misses, i;
+
+    if (Replay->pTree == NULL) return SampleReplay(Replay, Batch, Count);
+
+    SyncPriorities(Replay);
+
+    size  = ReplaySize(Replay);
+    total = Replay->pTree[0];
+
+    for (sample = 0, misses = 0; sample < Count && total > 0.0 && misses < MAX_MISSES;)
+    {
+        //One draw from each of Count equal slices of the total, the way
+        //prioritized replay spreads a batch, and anywhere after a miss
+        target = misses == 0 ? (sample + RandomUnit(Replay)) * total / Count : RandomUnit(Replay) * total;
+
+        for (node = 0; node < Replay->leaves - 1;)
+        {
+            if (target < Replay->pTree[2 * node + 1]) node = 2 * node + 1;
+            else
+            {
+                target -= Replay->pTree[2 * node + 1];
+                node    = 2 * node + 2;
+            }
+        }
+
+        if (Replay->pTree[node] <= 0.0 || node - (Replay->leaves - 1) >= Replay->pHeader->capacity ||
+            !ReadTransition(Replay, node - (Replay->leaves - 1), &record, field))
+        {
+            misses++;
+            continue;
+        }
+
+        weight    = pow(size * Replay->pTree[node] / total, -Beta);
+        maxWeight = weight > maxWeight ? weight : maxWeight;
+
+        if (Batch->weights != NULL) Batch->weights[sample] = (float) weight;
+
+        WriteSample(Replay, Batch, sample++, &record, field);
+    }
+
+    if (Batch->weights != NULL)
+        for (i = 0; i < sample; i++) Batch->weights[i] = (float) (Batch->weights[i] / maxWeight);
+
+    return sample;
+}
+
+SNAKE_RESULT EnablePriorities(REPLAY* Replay, double Alpha)
+{
+    UINT64 leaves = 1;
+
+    if (Replay->pHeader == NULL) return SR_MEMORY_ERROR;
+
+    while (leaves < Replay->pHeader->capacity) leaves *= 2;
+
+    free(Replay->pTree);
+
+    Replay->pTree = (double*) calloc(2 * leaves - 1, sizeof(double));
+    if (Replay->pTree == NULL) return SR_MEMORY_ERROR;
+
+    Replay->leaves      = leaves;
+    Replay->synced      = 0;
+    Replay->alpha       = Alpha;
+    Replay->maxPriority = 1.0;
+
+    SyncPriorities(Replay);
+
+    return SR_OK;
+}
+
+void SetPriorities(REPLAY* Replay, const UINT64* Indices, const float* Priorities, UINT Count)
+{
+    UINT64 capacity;
+    double priority;
+    UINT   i;
+
+    if (Replay->pTree == NULL) return;
+
+    capacity = Replay->pHeader->capacity;
+
+    for (i = 0; i < Count; i++)
+    {
+        //Transitions overwritten since they were sampled keep the priority of
+        //the one in their place
+        if (Indices[i] >= Replay->synced || Replay->synced - Indices[i] > capacity) continue;
+
+        priority = Priorities[i] > 0.0f ? Priorities[i] : 0.0;
+
+        if (priority > Replay->maxPriority) Replay->maxPriority = priority;
+
+        SetLeaf(Replay, Indices[i] % capacity, pow(priority, Replay->alpha));
+    }
+}
+
+void SeedReplay(REPLAY* Replay, UINT64 Seed)
+{
+    Replay->randomState = Seed;
+}
@@ -0,0 +1,148 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "snake.h"
+#include "encoder.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define REPLAY_VERSION              1
+#define REPLAY_CAPACITY             (1 << 20)  //Default transitions kept
+#define REPLAY_HEADER_BYTES         4096       //Records start on the second page of the file
+#define REPLAY_MAX_CHANGES          CELL_EVENT_CAPACITY
+
+//Rewards written by RecordMove, which training code is free to shape again
+#define REPLAY_REWARD_FOOD          1.0f
+#define REPLAY_REWARD_LOSS          -1.0f
+
+//Flags of a record
+#define REPLAY_TERMINAL             0x01  //The move ended the game
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Start of the file. Transition i is kept in record i % capacity until
+//capacity more are appended.
+typedef struct _REPLAY_HEADER
+{
+    UINT   magic;
+    UINT   version;
+    UINT   fieldWidth;
+    UINT   fieldHeight;
+    UINT   recordBytes;             //Of a record and its field, a multiple of 8
+    UINT   passThroughWalls;
+    UINT64 capacity;
+    UINT64 claimed;                 //Transitions appended or being appended
+} REPLAY_HEADER;
+
+//A state, the move taken from it and what followed. The state is the packed
+//field before the move, right after the record and padded to whole words, and
+//the next state is that field with the changes applied in order, the blocks
+//the move changed as its cell events listed them.
+typedef struct _REPLAY_RECORD
+{
+    UINT64     sequence;            //Transition number plus one, zero while it's written
+    float      reward;
+    BYTE       action;              //SNAKE_DIRECTION the snake moved in
+    BYTE       flags;
+    BYTE       changeCount;
+    BYTE       reserved;
+    CELL_EVENT changes[REPLAY_MAX_CHANGES];
+} REPLAY_RECORD;
+
+//Where sampled transitions go, every array holding a sample per entry. The
+//states and next states are one-hot planes like EncodePlanes writes them,
+//shaped [count][PLANE_COUNT][fieldHeight][fieldWidth].
+typedef struct _REPLAY_BATCH
+{
+    PLANE_TYPE type;
+    void*      states;
+    void*      nextStates;
+    BYTE*      actions;
+    float*     rewards;
+    BYTE*      terminals;
+    UINT64*    indices;             //Transition numbers, for SetPriorities, or NULL
+    float*     weights;             //Importance weights of prioritized samples, or NULL
+} REPLAY_BATCH;
+
+//A file of transitions mapped into memory, which any number of threads, or
+//processes mapping the same file, append to without locks. Transitions are
+//claimed with an atomic increment and published through their sequence, so
+//samplers skip the ones being written or overwritten as they read them. The
+//priorities are kept by the one thread sampling, in a sum tree of memory of
+//its own, and transitions it hasn't seen yet join with the largest priority.
+typedef struct _REPLAY
+{
+    REPLAY_HEADER* pHeader;
+    BYTE*          pRecords;
+    size_t         mappedBytes;
+    UINT64         randomState;     //Of the sampler
+
+    //Prioritized sampling, once EnablePriorities was called
+    double*        pTree;           //Sums of the priorities below every node, leaves at leaves - 1
+    UINT64         leaves;          //A power of two
+    UINT64         synced;          //Transitions added to the tree
+    double         alpha;
+    double         maxPriority;
+#ifdef _WIN32
+    HANDLE         hFile;
+    HANDLE         hMapping;
+#endif
+} REPLAY;
+
+
+//*****************************************************************************
+//
+//                              REPLAY FUNCTIONS
+//
+//*****************************************************************************
+
+//Maps File, creating it as a sparse file of Capacity transitions for fields
+//of Width x Height blocks, zero taking REPLAY_CAPACITY. A file written with
+//the same field and capacity is carried on from where it stopped, anything
+//else is emptied.
+SNAKE_RESULT    OpenReplay         (REPLAY* Replay, const char* File, UINT64 Capacity, UINT Width, UINT Height,
+                                    BOOL PassThroughWalls);
+void            CloseReplay        (REPLAY* Replay);
+
+//Moves the game like MoveSnake, commands given through ReceiveCommand
+//beforehand, and appends the transition. The game must be running and have
+//the field of the replay. Any thread may call it on a game it owns.
+SNAKE_RESULT    RecordMove         (REPLAY* Replay, SNAKE_GAME* Game);
+
+//Transitions that can be sampled: those appended, up to the capacity
+UINT64          ReplaySize         (const REPLAY* Replay);
+
+//Fill the batch with Count transitions drawn uniformly, or by priority with
+//importance weights raised to Beta and scaled so the largest of the batch is
+//1. They return the transitions sampled, fewer than Count only when the
+//replay is empty or every draw hit a transition being written.
+UINT            SampleReplay       (REPLAY* Replay, REPLAY_BATCH* Batch, UINT Count);
+UINT            SamplePrioritized  (REPLAY* Replay, REPLAY_BATCH* Batch, UINT Count, double Beta);
+
+//Starts keeping priorities, raised to Alpha, for every transition appended so
+//far and from now on. Priorities and the sampling functions must be used from
+//a single thread.
+SNAKE_RESULT    EnablePriorities   (REPLAY* Replay, double Alpha);
+void            SetPriorities      (REPLAY* Replay, const UINT64* Indices, const float* Priorities, UINT Count);
+
+//Sampling draws from a generator of its own, seeded with zero on opening
+void            SeedReplay         (REPLAY* Replay, UINT64 Seed);
+
+#endif
@@ -0,0 +1,610 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "results.h"
+#include "common.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define RESULTS_MAGIC               0x524B4E53 //"SNKR"
+#define BLOCK_MAGIC                 0x4B4C4252 //"RBLK"
+#define RESULTS_VERSION             1
+
+#define ZIGZAG(v)                   (((UINT64) (v) << 1) ^ (UINT64) ((long long) (v) >> 63))
+#define UNZIGZAG(v)                 (((v) >> 1) ^ (UINT64) -(long long) ((v) & 1))
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef struct _RESULTS_FILE_HEADER
+{
+    UINT magic;
+    UINT version;
+} RESULTS_FILE_HEADER;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static BOOL GrowBlock(RESULTS_BLOCK* Block, UINT FoodTotal)
+{
+    UINT  capacity = Block->foodCapacity ? Block->foodCapacity : 4096;
+    UINT* foodTicks;
+
+    if (FoodTotal <= Block->foodCapacity) return TRUE;
+
+    while (capacity < FoodTotal) capacity *= 2;
+
+    foodTicks = (UINT*) realloc(Block->foodTicks, capacity * sizeof(UINT));
+    if (foodTicks == NULL) return FALSE;
+
+    Block->foodTicks    = foodTicks;
+    Block->foodCapacity = capacity;
+
+    return TRUE;
+}
+
+static BOOL AllocateBlock(RESULTS_BLOCK* Block)
+{
+    memset(Block, 0, sizeof(RESULTS_BLOCK));
+
+    Block->seeds      = (UINT64*) malloc(RESULTS_BLOCK_GAMES * sizeof(UINT64));
+    Block->configs    = (UINT*)   malloc(RESULTS_BLOCK_GAMES * sizeof(UINT));
+    Block->sizes      = (UINT*)   malloc(RESULTS_BLOCK_GAMES * sizeof(UINT));
+    Block->ticks      = (UINT*)   malloc(RESULTS_BLOCK_GAMES * sizeof(UINT));
+    Block->outcomes   = (BYTE*)   malloc(RESULTS_BLOCK_GAMES * sizeof(BYTE));
+    Block->foodCounts = (UINT*)   malloc(RESULTS_BLOCK_GAMES * sizeof(UINT));
+
+    return Block->seeds && Block->configs && Block->sizes && Block->ticks && Block->outcomes &&
+           Block->foodCounts && GrowBlock(Block, 1);
+}
+
+static void FreeBlock(RESULTS_BLOCK* Block)
+{
+    free(Block->seeds);
+    free(Block->configs);
+    free(Block->sizes);
+    free(Block->ticks);
+    free(Block->outcomes);
+    free(Block->foodCounts);
+    free(Block->foodTicks);
+
+    memset(Block, 0, sizeof(RESULTS_BLOCK));
+}
+
+//Writes runs of equal values as value and length pairs
+static void PutRuns(BYTE_BUFFER* Buffer, const UINT* Values, const BYTE* Bytes, UINT Count)
+{
+    UINT i, start, value;
+
+    for (start = 0; start < Count; start = i)
+    {
+        value = Values ? Values[start] : Bytes[start];
+
+        for (i = start + 1; i < Count && (Values ? Values[i] : Bytes[i]) == value; i++);
+
+        PutVarint(Buffer, value);
+        PutVarint(Buffer, i - start);
+    }
+}
+
+static BOOL GetRuns(const BYTE* Bytes, const BYTE* End, UINT* Values, BYTE* Outcomes, UINT Count)
+{
+    UINT64 value, length;
+    UINT   i = 0;
+
+    while (i < Count)
+    {
+        if (!GetVarint(&Bytes, End, &value) || !GetVarint(&Bytes, End, &length) ||
+            length == 0 || length > Count - i) return FALSE;
+
+        for (; length > 0; length--, i++)
+        {
+            if (Values) Values[i]   = (UINT) value;
+            else        Outcomes[i] = (BYTE) value;
+        }
+    }
+
+    return Bytes == End;
+}
+
+//Encodes the columns of a block one after the other, filling the sizes and
+//aggregates of its header
+static BOOL EncodeBlock(RESULTS_BLOCK* Block, RESULTS_BLOCK_HEADER* Header, BYTE_BUFFER* Buffer)
+{
+    UINT   i, j, food, previous;
+    UINT64 previousSeed = 0;
+    size_t start;
+
+    memset(Header, 0, sizeof(RESULTS_BLOCK_HEADER));
+
+    Header->magic     = BLOCK_MAGIC;
+    Header->games     = Block->count;
+    Header->foodTotal = Block->foodTotal;
+
+    for (i = 0; i < Block->count; i++)
+    {
+        Header->won     += Block->outcomes[i] == WON;
+        Header->lost    += Block->outcomes[i] == LOST;
+        Header->sizeSum += Block->sizes[i];
+        Header->tickSum += Block->ticks[i];
+
+        if (Block->sizes[i] > Header->maxSize)  Header->maxSize  = Block->sizes[i];
+        if (Block->ticks[i] > Header->maxTicks) Header->maxTicks = Block->ticks[i];
+    }
+
+    //Worst case of every column at once
+    Buffer->size = 0;
+    if (!ReserveBytes(Buffer, (size_t) MAX_VARINT * (8 * Block->count + Block->foodTotal))) return FALSE;
+
+    start = Buffer->size;
+    for (i = 0; i < Block->count; i++)
+    {
+        PutVarint(Buffer, ZIGZAG(Block->seeds[i] - previousSeed));
+        previousSeed = Block->seeds[i];
+    }
+    Header->columnBytes[RC_SEED] = (UINT) (Buffer->size - start);
+
+    start = Buffer->size;
+    PutRuns(Buffer, Block->configs, NULL, Block->count);
+    Header->columnBytes[RC_CONFIG] = (UINT) (Buffer->size - start);
+
+    start = Buffer->size;
+    for (i = 0; i < Block->count; i++) PutVarint(Buffer, Block->sizes[i]);
+    Header->columnBytes[RC_SIZE] = (UINT) (Buffer->size - start);
+
+    start = Buffer->size;
+    for (i = 0; i < Block->count; i++) PutVarint(Buffer, Block->ticks[i]);
+    Header->columnBytes[RC_TICKS] = (UINT) (Buffer->size - start);
+
+    start = Buffer->size;
+    PutRuns(Buffer, NULL, Block->outcomes, Block->count);
+    Header->columnBytes[RC_OUTCOME] = (UINT) (Buffer->size - start);
+
+    start = Buffer->size;
+    for (i = 0; i < Block->count; i++) PutVarint(Buffer, Block->foodCounts[i]);
+    Header->columnBytes[RC_FOOD_COUNT] = (UINT) (Buffer->size - start);
+
+    //Pickups are far apart in ticks but close to each other
+    start = Buffer->size;
+    for (i = 0, food = 0; i < Block->count; i++)
+        for (j = 0, previous = 0; j < Block->foodCounts[i]; j++, food++)
+        {
+            PutVarint(Buffer, Block->foodTicks[food] - previous);
+            previous = Block->foodTicks[food];
+        }
+    Header->columnBytes[RC_FOOD_TICKS] = (UINT) (Buffer->size - start);
+
+    return TRUE;
+}
+
+static BOOL DecodeColumn(RESULTS_READER* Reader, RESULT_COLUMN Column, const BYTE* Bytes, const BYTE* End)
+{
+    RESULTS_BLOCK* block = &Reader->block;
+    UINT64         value, previous;
+    UINT           i, j, food, count = Reader->header.games;
+
+    switch (Column)
+    {
+        case RC_CONFIG:  return GetRuns(Bytes, End, block->configs, NULL, count);
+        case RC_OUTCOME: return GetRuns(Bytes, End, NULL, block->outcomes, count);
+
+        case RC_SEED:
+            for (i = 0, previous = 0; i < count; i++)
+            {
+                if (!GetVarint(&Bytes, End, &value)) return FALSE;
+                block->seeds[i] = previous += UNZIGZAG(value);
+            }
+            break;
+
+        case RC_SIZE:
+        case RC_TICKS:
+        case RC_FOOD_COUNT:
+            for (i = 0; i < count; i++)
+            {
+                if (!GetVarint(&Bytes, End, &value)) return FALSE;
+
+                if      (Column == RC_SIZE)  block->sizes[i]      = (UINT) value;
+                else if (Column == RC_TICKS) block->ticks[i]      = (UINT) value;
+                else                         block->foodCounts[i] = (UINT) value;
+            }
+            break;
+
+        //Needs the food counts, which come first
+        case RC_FOOD_TICKS:
+            for (i = 0, food = 0; i < count; i++)
+                for (j = 0, previous = 0; j < block->foodCounts[i]; j++, food++)
+                {
+                    if (food >= Reader->header.foodTotal || !GetVarint(&Bytes, End, &value)) return FALSE;
+                    block->foodTicks[food] = (UINT) (previous += value);
+                }
+            break;
+
+        default:
+            return FALSE;
+    }
+
+    return Bytes == End;
+}
+
+static void* ResultsWriterThread(void* Argument)
+{
+    RESULTS_WRITER*      writer = (RESULTS_WRITER*) Argument;
+    RESULTS_BLOCK_HEADER header;
+    BYTE_BUFFER          buffer = { NULL, 0, 0 };
+    RESULTS_BLOCK*       block;
+    UINT                 index;
+    BOOL                 written;
+
+    pthread_mutex_lock(&writer->lock);
+
+    for (;;)
+    {
+        while (writer->queueLength == 0 && !writer->quit) pthread_cond_wait(&writer->blockFull, &writer->lock);
+
+        if (writer->queueLength == 0) break;
+
+        index = writer->queue[writer->queueStart];
+        block = writer->blocks + index;
+
+        //The block belongs to this thread until it's marked free again
+        pthread_mutex_unlock(&writer->lock);
+
+        written = !writer->failed && EncodeBlock(block, &header, &buffer) &&
+                  fwrite(&header, sizeof(header), 1, writer->file) == 1 &&
+                  fwrite(buffer.bytes, 1, buffer.size, writer->file) == buffer.size;
+
+        pthread_mutex_lock(&writer->lock);
+
+        if (written)
+        {
+            writer->rawBytes     += (UINT64) block->count * (sizeof(UINT64) + 4 * sizeof(UINT) + 1) +
+                                    (UINT64) block->foodTotal * sizeof(UINT);
+            writer->writtenBytes += sizeof(header) + buffer.size;
+        }
+        else writer->failed = TRUE;
+
+        block->count     = 0;
+        block->foodTotal = 0;
+
+        writer->queued[index] = FALSE;
+        writer->queueStart    = (writer->queueStart + 1) % RESULTS_BUFFERS;
+        writer->queueLength--;
+
+        pthread_cond_broadcast(&writer->blockFree);
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+
+    free(buffer.bytes);
+    return NULL;
+}
+
+//Queues the block being filled. The lock must be held.
+static void QueueFilling(RESULTS_WRITER* Writer)
+{
+    Writer->queue[(Writer->queueStart + Writer->queueLength) % RESULTS_BUFFERS] = Writer->filling;
+    Writer->queueLength++;
+
+    Writer->queued[Writer->filling] = TRUE;
+    Writer->filling                 = -1;
+
+    pthread_cond_signal(&Writer->blockFull);
+}
+
+
+//*****************************************************************************
+//
+//                              RESULTS FUNCTIONS
+//
+//*****************************************************************************
+
+BOOL ReserveBytes(BYTE_BUFFER* Buffer, size_t Bytes)
+{
+    size_t capacity = Buffer->capacity ? Buffer->capacity : 4096;
+    BYTE*  bytes;
+
+    if (Buffer->size + Bytes <= Buffer->capacity) return TRUE;
+
+    while (capacity < Buffer->size + Bytes) capacity *= 2;
+
+    bytes = (BYTE*) realloc(Buffer->bytes, capacity);
+    if (bytes == NULL) return FALSE;
+
+    Buffer->bytes    = bytes;
+    Buffer->capacity = capacity;
+
+    return TRUE;
+}
+
+void PutVarint(BYTE_BUFFER* Buffer, UINT64 Value)
+{
+    while (Value >= 0x80)
+    {
+        Buffer->bytes[Buffer->size++] = (BYTE) (Value | 0x80);
+        Value >>= 7;
+    }
+
+    Buffer->bytes[Buffer->size++] = (BYTE) Value;
+}
+
+BOOL GetVarint(const BYTE** Bytes, const BYTE* End, UINT64* Value)
+{
+    const BYTE* bytes = *Bytes;
+    UINT64      value = 0;
+    UINT        shift;
+
+    for (shift = 0; bytes < End && shift < 64; shift += 7)
+    {
+        value |= (UINT64) (*bytes & 0x7F) << shift;
+
+        if (!(*bytes++ & 0x80))
+        {
+            *Bytes = bytes;
+            *Value = value;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+SNAKE_RESULT OpenResultsWriter(RESULTS_WRITER* Writer, const char* File, BOOL Append)
+{
+    RESULTS_FILE_HEADER header = { RESULTS_MAGIC, RESULTS_VERSION };
+    UINT                i;
+
+    memset(Writer, 0, sizeof(RESULTS_WRITER));
+
+    //Games are added to the first block to begin with
+    for (i = 0; i < RESULTS_BUFFERS; i++)
+    {
+        if (!AllocateBlock(Writer->blocks + i))
+        {
+            for (i = 0; i < RESULTS_BUFFERS; i++) FreeBlock(Writer->blocks + i);
+            return SR_MEMORY_ERROR;
+        }
+    }
+
+    Writer->file = fopen(File, Append ? "ab" : "wb");
+
+    //Appended files already start with the header, new ones need it
+    if (Writer->file && (fseek(Writer->file, 0, SEEK_END) != 0 ||
+        (ftell(Writer->file) == 0 && fwrite(&header, sizeof(header), 1, Writer->file) != 1)))
+    {
+        fclose(Writer->file);
+        Writer->file = NULL;
+    }
+
+    pthread_mutex_init(&Writer->lock, NULL);
+    pthread_cond_init (&Writer->blockFull, NULL);
+    pthread_cond_init (&Writer->blockFree, NULL);
+
+    if (Writer->file == NULL || pthread_create(&Writer->thread, NULL, ResultsWriterThread, Writer) != 0)
+    {
+        if (Writer->file) fclose(Writer->file);
+
+        for (i = 0; i < RESULTS_BUFFERS; i++) FreeBlock(Writer->blocks + i);
+
+        pthread_mutex_destroy(&Writer->lock);
+        pthread_cond_destroy (&Writer->blockFull);
+        pthread_cond_destroy (&Writer->blockFree);
+
+        return SR_MEMORY_ERROR;
+    }
+
+    return SR_OK;
+}
+
+SNAKE_RESULT AddResult(RESULTS_WRITER* Writer, const GAME_RESULT* Result)
+{
+    RESULTS_BLOCK* block;
+    double         start;
+    UINT           i;
+
+    pthread_mutex_lock(&Writer->lock);
+
+    if (Writer->filling < 0)
+    {
+        start = Now();
+
+        for (;;)
+        {
+            for (i = 0; i < RESULTS_BUFFERS && Writer->queued[i]; i++);
+            if (i < RESULTS_BUFFERS) break;
+
+            pthread_cond_wait(&Writer->blockFree, &Writer->lock);
+        }
+
+        Writer->filling      = i;
+        Writer->blockedTime += Now() - start;
+    }
+
+    block = Writer->blocks + Writer->filling;
+
+    if (!GrowBlock(block, block->foodTotal + Result->foodCount))
+    {
+        pthread_mutex_unlock(&Writer->lock);
+        return SR_MEMORY_ERROR;
+    }
+
+    block->seeds[block->count]      = Result->seed;
+    block->configs[block->count]    = Result->config;
+    block->sizes[block->count]      = Result->snakeSize;
+    block->ticks[block->count]      = Result->ticks;
+    block->outcomes[block->count]   = Result->outcome;
+    block->foodCounts[block->count] = Result->foodCount;
+
+    if (Result->foodCount)
+        memcpy(block->foodTicks + block->foodTotal, Result->foodTicks, Result->foodCount * sizeof(UINT));
+
+    block->foodTotal += Result->foodCount;
+    Writer->games++;
+
+    if (++block->count == RESULTS_BLOCK_GAMES) QueueFilling(Writer);
+
+    pthread_mutex_unlock(&Writer->lock);
+
+    return SR_OK;
+}
+
+BOOL CloseResultsWriter(RESULTS_WRITER* Writer)
+{
+    BOOL written;
+    UINT i;
+
+    pthread_mutex_lock(&Writer->lock);
+
+    if (Writer->filling >= 0 && Writer->blocks[Writer->filling].count > 0) QueueFilling(Writer);
+
+    Writer->quit = TRUE;
+    pthread_cond_signal(&Writer->blockFull);
+    pthread_mutex_unlock(&Writer->lock);
+
+    pthread_join(Writer->thread, NULL);
+
+    written = !Writer->failed;
+    if (fclose(Writer->file) != 0) written = FALSE;
+
+    for (i = 0; i < RESULTS_BUFFERS; i++) FreeBlock(Writer->blocks + i);
+
+    pthread_mutex_destroy(&Writer->lock);
+    pthread_cond_destroy (&Writer->blockFull);
+    pthread_cond_destroy (&Writer->blockFree);
+
+    Writer->file = NULL;
+
+    return written;
+}
+
+BOOL OpenResultsReader(RESULTS_READER* Reader, const char* File)
+{
+    RESULTS_FILE_HEADER header;
+
+    memset(Reader, 0, sizeof(RESULTS_READER));
+
+    if (AllocateBlock(&Reader->block)) Reader->file = fopen(File, "rb");
+
+    if (Reader->file == NULL || fread(&header, sizeof(header), 1, Reader->file) != 1 ||
+        header.magic != RESULTS_MAGIC || header.version != RESULTS_VERSION)
+    {
+        CloseResultsReader(Reader);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void CloseResultsReader(RESULTS_READER* Reader)
+{
+    if (Reader->file) fclose(Reader->file);
+
+    FreeBlock(&Reader->block);
+    free(Reader->buffer);
+
+    Reader->file   = NULL;
+    Reader->buffer = NULL;
+}
+
+BOOL ReadResultsBlock(RESULTS_READER* Reader, UINT Columns)
+{
+    RESULTS_BLOCK_HEADER* header = &Reader->header;
+    UINT                  column;
+
+    //Food ticks are split between games by the food counts
+    if (Columns & COLUMN_MASK(RC_FOOD_TICKS)) Columns |= COLUMN_MASK(RC_FOOD_COUNT);
+
+    if (fread(header, sizeof(RESULTS_BLOCK_HEADER), 1, Reader->file) != 1)
+    {
+        header->games = 0;
+        return FALSE;
+    }
+
+    if (header->magic != BLOCK_MAGIC || header->games == 0 || header->games > RESULTS_BLOCK_GAMES ||
+        !GrowBlock(&Reader->block, header->foodTotal))
+    {
+        header->games = 1;
+        return FALSE;
+    }
+
+    Reader->block.count     = header->games;
+    Reader->block.foodTotal = header->foodTotal;
+
+    for (column = 0; column < RC_COUNT; column++)
+    {
+        if (!(Columns & COLUMN_MASK(column)))
+        {
+            if (fseek(Reader->file, header->columnBytes[column], SEEK_CUR) != 0) return FALSE;
+            continue;
+        }
+
+        if (header->columnBytes[column] > Reader->bufferSize)
+        {
+            free(Reader->buffer);
+
+            Reader->bufferSize = header->columnBytes[column];
+            Reader->buffer     = (BYTE*) malloc(Reader->bufferSize);
+
+            if (Reader->buffer == NULL)
+            {
+                Reader->bufferSize = 0;
+                return FALSE;
+            }
+        }
+
+        if (fread(Reader->buffer, 1, header->columnBytes[column], Reader->file) != header->columnBytes[column] ||
+            !DecodeColumn(Reader, (RESULT_COLUMN) column, Reader->buffer, Reader->buffer + header->columnBytes[column]))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL SummarizeResults(const char* File, RESULTS_SUMMARY* Summary)
+{
+    RESULTS_READER reader;
+    BOOL           ended;
+
+    memset(Summary, 0, sizeof(RESULTS_SUMMARY));
+
+    if (!OpenResultsReader(&reader, File)) return FALSE;
+
+    while (ReadResultsBlock(&reader, 0))
+    {
+        Summary->games     += reader.header.games;
+        Summary->won       += reader.header.won;
+        Summary->lost      += reader.header.lost;
+        Summary->sizeSum   += reader.header.sizeSum;
+        Summary->tickSum   += reader.header.tickSum;
+        Summary->foodTotal += reader.header.foodTotal;
+        Summary->blocks++;
+
+        if (reader.header.maxSize  > Summary->maxSize)  Summary->maxSize  = reader.header.maxSize;
+        if (reader.header.maxTicks > Summary->maxTicks) Summary->maxTicks = reader.header.maxTicks;
+    }
+
+    ended = reader.header.games == 0;
+    CloseResultsReader(&reader);
+
+    return ended;
+}
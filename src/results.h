@@ -0,0 +1,193 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define RESULTS_BLOCK_GAMES         65536 //Games per block of the file
+#define RESULTS_BUFFERS             4     //Blocks being filled or waiting for the writer
+#define MAX_VARINT                  10    //Bytes of the longest varint, that of a UINT64
+
+//Field width and height, walls and speed of a game in a single column value
+#define RESULT_CONFIG(g)            ((UINT) (g)->fieldWidth | (UINT) (g)->fieldHeight << 8 | \
+                                     ((g)->passThroughWalls ? 1u : 0u) << 16 | (UINT) (g)->snakeSpeed << 17)
+#define CONFIG_WIDTH(c)             ((c) & 0xFF)
+#define CONFIG_HEIGHT(c)            (((c) >> 8) & 0xFF)
+#define CONFIG_WALLS(c)             (!(((c) >> 16) & 1))
+#define CONFIG_SPEED(c)             ((c) >> 17)
+
+#define COLUMN_MASK(c)              (1u << (c))
+#define ALL_COLUMNS                 (COLUMN_MASK(RC_COUNT) - 1)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _RESULT_COLUMN
+{
+    RC_SEED,                    //Delta from the previous seed, zigzag varint
+    RC_CONFIG,                  //Runs of equal values
+    RC_SIZE,                    //Final snakeSize, varint
+    RC_TICKS,                   //Varint
+    RC_OUTCOME,                 //Final snakeState, runs of equal values
+    RC_FOOD_COUNT,              //Food eaten in each game, varint
+    RC_FOOD_TICKS,              //Ticks between pickups of every game in turn, varint
+    RC_COUNT
+} RESULT_COLUMN;
+
+//Bytes being encoded, grown as needed
+typedef struct _BYTE_BUFFER
+{
+    BYTE*  bytes;
+    size_t size;
+    size_t capacity;
+} BYTE_BUFFER;
+
+typedef struct _GAME_RESULT
+{
+    UINT64      seed;
+    UINT        config;         //RESULT_CONFIG
+    UINT        snakeSize;
+    UINT        ticks;
+    BYTE        outcome;        //SNAKE_STATE, RUNNING for games that were stopped
+    UINT        foodCount;
+    const UINT* foodTicks;      //Tick at which each food was eaten
+} GAME_RESULT;
+
+//A block of games stored column by column. Food ticks of every game follow
+//each other in a single array.
+typedef struct _RESULTS_BLOCK
+{
+    UINT        count;
+    UINT64*     seeds;
+    UINT*       configs;
+    UINT*       sizes;
+    UINT*       ticks;
+    BYTE*       outcomes;
+    UINT*       foodCounts;
+    UINT*       foodTicks;
+    UINT        foodTotal;
+    UINT        foodCapacity;
+} RESULTS_BLOCK;
+
+//Written before the columns of every block, so common aggregates are read
+//without decoding anything
+typedef struct _RESULTS_BLOCK_HEADER
+{
+    UINT        magic;
+    UINT        games;
+    UINT        foodTotal;
+    UINT        columnBytes[RC_COUNT];
+    UINT        won;
+    UINT        lost;
+    UINT        maxSize;
+    UINT        maxTicks;
+    UINT64      sizeSum;
+    UINT64      tickSum;
+} RESULTS_BLOCK_HEADER;
+
+typedef struct _RESULTS_SUMMARY
+{
+    UINT64      games;
+    UINT64      won;
+    UINT64      lost;
+    UINT64      sizeSum;
+    UINT64      tickSum;
+    UINT64      foodTotal;
+    UINT        maxSize;
+    UINT        maxTicks;
+    UINT        blocks;
+} RESULTS_SUMMARY;
+
+//Appends games to a results file. Any thread may add games: they are copied
+//into the block being filled, and full blocks are encoded and written by a
+//background thread. Adding only waits when RESULTS_BUFFERS blocks are already
+//queued, that is when the disk can't keep up at all.
+typedef struct _RESULTS_WRITER
+{
+    FILE*           file;
+    RESULTS_BLOCK   blocks[RESULTS_BUFFERS];
+    BOOL            queued[RESULTS_BUFFERS];
+    UINT            queue[RESULTS_BUFFERS]; //Full blocks in the order they were filled
+    UINT            queueStart;
+    UINT            queueLength;
+    int             filling;                //Block games are added to, -1 when all are queued
+
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  blockFull;
+    pthread_cond_t  blockFree;
+    BOOL            quit;
+    BOOL            failed;
+
+    //Statistics
+    UINT64          games;
+    UINT64          rawBytes;               //Size of the columns before encoding
+    UINT64          writtenBytes;
+    double          blockedTime;            //Spent by adding threads waiting for a free block
+} RESULTS_WRITER;
+
+typedef struct _RESULTS_READER
+{
+    FILE*                file;
+    RESULTS_BLOCK_HEADER header;            //Of the last block read
+    RESULTS_BLOCK        block;             //Its decoded columns
+    BYTE*                buffer;
+    size_t               bufferSize;
+} RESULTS_READER;
+
+
+//*****************************************************************************
+//
+//                              RESULTS FUNCTIONS
+//
+//*****************************************************************************
+
+//Makes room for Bytes more bytes, returning FALSE when out of memory
+BOOL            ReserveBytes        (BYTE_BUFFER* Buffer, size_t Bytes);
+
+//LEB128: seven bits per byte, the high bit set on every byte but the last.
+//Space for it must have been reserved. GetVarint returns FALSE when the
+//value runs past End.
+void            PutVarint           (BYTE_BUFFER* Buffer, UINT64 Value);
+BOOL            GetVarint           (const BYTE** Bytes, const BYTE* End, UINT64* Value);
+
+//Creates the file, or appends to it when Append is TRUE
+SNAKE_RESULT    OpenResultsWriter   (RESULTS_WRITER* Writer, const char* File, BOOL Append);
+SNAKE_RESULT    AddResult           (RESULTS_WRITER* Writer, const GAME_RESULT* Result);
+
+//Writes the last partial block and waits for the writer thread. Returns FALSE
+//when anything failed to be written.
+BOOL            CloseResultsWriter  (RESULTS_WRITER* Writer);
+
+//Returns FALSE when the file can't be opened or isn't a results file
+BOOL            OpenResultsReader   (RESULTS_READER* Reader, const char* File);
+void            CloseResultsReader  (RESULTS_READER* Reader);
+
+//Reads the next block, decoding only the columns in the Columns mask and
+//seeking over the others. Returns FALSE at the end of the file or when it's
+//damaged; Reader->header then has zero games for a clean end.
+BOOL            ReadResultsBlock    (RESULTS_READER* Reader, UINT Columns);
+
+//Adds up the block headers of a file, without decoding any column
+BOOL            SummarizeResults    (const char* File, RESULTS_SUMMARY* Summary);
+
+#endif
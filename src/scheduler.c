@@ -0,0 +1,350 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <string.h>
+#include "scheduler.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+//First tick starting at or after a deadline
+#define DEADLINE_TICK(d)            (((d) + SCHEDULER_TICK_US - 1) / SCHEDULER_TICK_US)
+
+//Level 0 of pLevels is the second of the wheel, each slot a turn of the root
+#define LEVEL_SHIFT(l)              (WHEEL_ROOT_BITS + (l) * WHEEL_LEVEL_BITS)
+#define LEVEL_INDEX(t, l)           ((UINT) ((t) >> LEVEL_SHIFT(l)) & (WHEEL_LEVEL_SLOTS - 1))
+#define WHEEL_SPAN                  ((UINT64) 1 << LEVEL_SHIFT(WHEEL_LEVELS - 1))
+
+#define TICK_PERIOD(g)              (1000000 / (g)->snakeSpeed)
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static void LinkTask(TASK** Slot, TASK* Task)
+{
+    Task->pNext      = *Slot;
+    Task->ppPrevious = Slot;
+
+    if (*Slot != NULL) (*Slot)->ppPrevious = &Task->pNext;
+
+    *Slot = Task;
+}
+
+static void UnlinkTask(TASK* Task)
+{
+    *Task->ppPrevious = Task->pNext;
+
+    if (Task->pNext != NULL) Task->pNext->ppPrevious = Task->ppPrevious;
+}
+
+static void QueueTask(SCHEDULER* Scheduler, TASK* Task)
+{
+    Task->state      = TASK_READY;
+    Task->pNext      = NULL;
+    Task->ppPrevious = Scheduler->ppReadyEnd;
+
+    *Scheduler->ppReadyEnd = Task;
+    Scheduler->ppReadyEnd  = &Task->pNext;
+}
+
+//Puts a sleeping task in the slot of the lowest level whose turn covers its
+//deadline. Deadlines farther than the wheel goes wait in the last slot it
+//reaches and are placed again from there.
+static void PlaceTask(SCHEDULER* Scheduler, TASK* Task)
+{
+    UINT64 expires = DEADLINE_TICK(Task->deadline);
+    UINT64 ahead;
+    UINT   level;
+
+    if (expires < Scheduler->tick) expires = Scheduler->tick;
+
+    ahead = expires - Scheduler->tick;
+
+    if (ahead < WHEEL_ROOT_SLOTS)
+    {
+        LinkTask(&Scheduler->pRoot[expires & (WHEEL_ROOT_SLOTS - 1)], Task);
+        return;
+    }
+
+    if (ahead >= WHEEL_SPAN) expires = Scheduler->tick + WHEEL_SPAN - 1;
+
+    for (level = 0; level < WHEEL_LEVELS - 2 && ahead >= (UINT64) 1 << LEVEL_SHIFT(level + 1); level++);
+
+    LinkTask(&Scheduler->pLevels[level][LEVEL_INDEX(expires, level)], Task);
+}
+
+//Places the tasks of a slot again, now that its turn came
+static void CascadeSlot(SCHEDULER* Scheduler, TASK** Slot)
+{
+    TASK* task = *Slot;
+    TASK* next;
+
+    *Slot = NULL;
+
+    for (; task != NULL; task = next)
+    {
+        next = task->pNext;
+        PlaceTask(Scheduler, task);
+        Scheduler->cascaded++;
+    }
+}
+
+//Wakes the tasks of the next tick, first bringing down the slots of every
+//level turning over with it
+static void ExpireTick(SCHEDULER* Scheduler)
+{
+    UINT64 tick = Scheduler->tick;
+    UINT   turn = (UINT) tick & (WHEEL_ROOT_SLOTS - 1);
+    TASK*  task;
+    TASK*  next;
+    UINT   level;
+
+    for (level = 0; turn == 0 && level < WHEEL_LEVELS - 1; level++)
+    {
+        turn = LEVEL_INDEX(tick, level);
+        CascadeSlot(Scheduler, &Scheduler->pLevels[level][turn]);
+    }
+
+    task = Scheduler->pRoot[tick & (WHEEL_ROOT_SLOTS - 1)];
+    Scheduler->pRoot[tick & (WHEEL_ROOT_SLOTS - 1)] = NULL;
+
+    for (; task != NULL; task = next)
+    {
+        next = task->pNext;
+
+        //Only a deadline beyond the reach of the wheel lands here early
+        if (DEADLINE_TICK(task->deadline) > tick)
+        {
+            PlaceTask(Scheduler, task);
+            continue;
+        }
+
+        Scheduler->sleeping--;
+        Scheduler->expired++;
+        QueueTask(Scheduler, task);
+    }
+
+    Scheduler->tick++;
+}
+
+static void RunReady(SCHEDULER* Scheduler)
+{
+    TASK* task;
+
+    while ((task = Scheduler->pReady) != NULL)
+    {
+        Scheduler->pReady = task->pNext;
+
+        if (Scheduler->pReady != NULL) Scheduler->pReady->ppPrevious = &Scheduler->pReady;
+        else Scheduler->ppReadyEnd = &Scheduler->pReady;
+
+        task->state = TASK_RUNNING;
+        Scheduler->resumes++;
+        task->function(Scheduler, task);
+    }
+}
+
+
+//*****************************************************************************
+//
+//                            SCHEDULER FUNCTIONS
+//
+//*****************************************************************************
+
+void InitializeScheduler(SCHEDULER* Scheduler, UINT64 Now)
+{
+    memset(Scheduler, 0, sizeof(SCHEDULER));
+
+    Scheduler->now        = Now;
+    Scheduler->tick       = Now / SCHEDULER_TICK_US + 1;
+    Scheduler->ppReadyEnd = &Scheduler->pReady;
+}
+
+void StartTask(SCHEDULER* Scheduler, TASK* Task, TASK_FUNCTION Function)
+{
+    Task->function     = Function;
+    Task->resumePoint  = 0;
+    Task->commandCount = 0;
+    Task->deadline     = Scheduler->now;
+
+    QueueTask(Scheduler, Task);
+}
+
+void WaitTask(SCHEDULER* Scheduler, TASK* Task, UINT64 Deadline)
+{
+    Task->deadline = Deadline;
+
+    if (Task->commandCount > 0)
+    {
+        Scheduler->commanded++;
+        QueueTask(Scheduler, Task);
+    }
+    else if (Deadline <= Scheduler->now)
+    {
+        Scheduler->expired++;
+        QueueTask(Scheduler, Task);
+    }
+    else if (Deadline == TASK_FOREVER) Task->state = TASK_WAITING;
+    else
+    {
+        Task->state = TASK_SLEEPING;
+        Scheduler->sleeping++;
+        PlaceTask(Scheduler, Task);
+    }
+}
+
+BOOL PostCommand(SCHEDULER* Scheduler, TASK* Task, BYTE Command)
+{
+    if (Task->state == TASK_DONE || Task->commandCount == TASK_MAILBOX) return FALSE;
+
+    Task->commands[Task->commandCount++] = Command;
+
+    if (Task->state == TASK_SLEEPING)
+    {
+        UnlinkTask(Task);
+        Scheduler->sleeping--;
+    }
+    else if (Task->state != TASK_WAITING) return TRUE;
+
+    Scheduler->commanded++;
+    QueueTask(Scheduler, Task);
+
+    return TRUE;
+}
+
+BOOL TakeCommand(TASK* Task, BYTE* Command)
+{
+    UINT i;
+
+    if (Task->commandCount == 0) return FALSE;
+
+    *Command = Task->commands[0];
+    Task->commandCount--;
+
+    for (i = 0; i < Task->commandCount; i++) Task->commands[i] = Task->commands[i + 1];
+
+    return TRUE;
+}
+
+UINT64 AdvanceScheduler(SCHEDULER* Scheduler, UINT64 Now)
+{
+    UINT64 last    = Now / SCHEDULER_TICK_US;
+    UINT64 resumes = Scheduler->resumes;
+
+    //Commands posted since the last call go first, at the time they came
+    RunReady(Scheduler);
+
+    //With nothing asleep no tick has anything to do
+    if (Scheduler->sleeping == 0 && Scheduler->tick <= last) Scheduler->tick = last + 1;
+
+    while (Scheduler->tick <= last)
+    {
+        if (Scheduler->now < Scheduler->tick * SCHEDULER_TICK_US) Scheduler->now = Scheduler->tick * SCHEDULER_TICK_US;
+
+        ExpireTick(Scheduler);
+        RunReady(Scheduler);
+
+        if (Scheduler->sleeping == 0 && Scheduler->tick <= last) Scheduler->tick = last + 1;
+    }
+
+    if (Scheduler->now < Now) Scheduler->now = Now;
+
+    RunReady(Scheduler);
+
+    return Scheduler->resumes - resumes;
+}
+
+UINT64 NextWakeUp(const SCHEDULER* Scheduler)
+{
+    UINT64 tick;
+
+    if (Scheduler->pReady != NULL) return Scheduler->now;
+    if (Scheduler->sleeping == 0)  return TASK_FOREVER;
+
+    //The root only holds ticks of its current turn, the next turn may bring more down
+    for (tick = Scheduler->tick; ; tick++)
+        if ((tick & (WHEEL_ROOT_SLOTS - 1)) == 0 || Scheduler->pRoot[tick & (WHEEL_ROOT_SLOTS - 1)] != NULL) break;
+
+    return tick * SCHEDULER_TICK_US;
+}
+
+void CancelTask(SCHEDULER* Scheduler, TASK* Task)
+{
+    if (Task->state == TASK_SLEEPING)
+    {
+        UnlinkTask(Task);
+        Scheduler->sleeping--;
+    }
+    else if (Task->state == TASK_READY)
+    {
+        if (Task->pNext == NULL) Scheduler->ppReadyEnd = Task->ppPrevious;
+
+        UnlinkTask(Task);
+    }
+
+    Task->state = TASK_DONE;
+}
+
+void StartGameTask(SCHEDULER* Scheduler, GAME_TASK* GameTask)
+{
+    GameTask->ticks  = 0;
+    GameTask->played = 0;
+    GameTask->result = SR_OK;
+
+    StartTask(Scheduler, &GameTask->task, PlayGameTask);
+}
+
+void PlayGameTask(SCHEDULER* Scheduler, TASK* Task)
+{
+    GAME_TASK*  gameTask = (GAME_TASK*) Task;
+    SNAKE_GAME* game     = &gameTask->game;
+    BYTE        command;
+
+    TASK_BEGIN(Task);
+
+    while (gameTask->result == SR_OK)
+    {
+        //Nothing happens until the player gives a command, which starts a game
+        TASK_AWAIT(Scheduler, Task, TASK_FOREVER);
+
+        if (!TakeCommand(Task, &command)) continue;
+        if ((gameTask->result = ResetGame(game)) != SR_OK) break;
+        if ((gameTask->result = ReceiveCommand(game, (SNAKE_DIRECTION) command)) != SR_OK) break;
+
+        gameTask->played++;
+        gameTask->nextMove = Scheduler->now + TICK_PERIOD(game);
+
+        while (game->snakeState == RUNNING)
+        {
+            TASK_AWAIT(Scheduler, Task, gameTask->nextMove);
+
+            while (gameTask->result == SR_OK && TakeCommand(Task, &command))
+                gameTask->result = ReceiveCommand(game, (SNAKE_DIRECTION) command);
+
+            if (gameTask->result != SR_OK) break;
+            if (Scheduler->now < gameTask->nextMove) continue;
+
+            if ((gameTask->result = MoveSnake(game)) != SR_OK) break;
+
+            gameTask->ticks++;
+
+            //Ticks missed while the scheduler was late are skipped, not caught up
+            gameTask->nextMove += TICK_PERIOD(game);
+            if (gameTask->nextMove <= Scheduler->now) gameTask->nextMove = Scheduler->now + TICK_PERIOD(game);
+        }
+    }
+
+    TASK_END(Task);
+}
@@ -0,0 +1,163 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define SCHEDULER_TICK_US           1000       //Resolution of the timer wheel, in microseconds
+#define WHEEL_ROOT_BITS             8          //The first level has a slot per tick for 256 ticks
+#define WHEEL_LEVEL_BITS            6          //Each level after it a slot per 64 slots of the one before
+#define WHEEL_LEVELS                4          //Deadlines up to 2^26 ticks ahead, farther ones wait in steps
+#define WHEEL_ROOT_SLOTS            (1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_SLOTS           (1 << WHEEL_LEVEL_BITS)
+#define TASK_MAILBOX                4          //Commands a task holds before PostCommand turns them down
+#define TASK_FOREVER                ((UINT64) -1)
+
+//Tasks are coroutines: functions that return whenever they wait and are
+//called again by the scheduler once their deadline passes or a command is
+//posted to them, carrying on after the wait through a switch on its line.
+//Their locals don't survive a wait, so whatever they need afterwards lives in
+//the structure the task is part of, and a switch of their own must not span
+//a wait. A task that reaches TASK_END is done and never resumed.
+#define TASK_BEGIN(Task)            switch ((Task)->resumePoint) { case 0:
+#define TASK_END(Task)              } (Task)->state = TASK_DONE; return
+
+//Waits until Deadline, in microseconds of the scheduler clock, or until a
+//command is posted, whichever comes first. TASK_FOREVER only waits for a
+//command, and a command already posted wakes the task right away.
+#define TASK_AWAIT(Scheduler, Task, Deadline)                                           \
+    do                                                                                  \
+    {                                                                                   \
+        (Task)->resumePoint = __LINE__;                                                 \
+        WaitTask((Scheduler), (Task), (Deadline));                                      \
+        return;                                                                         \
+        case __LINE__:;                                                                 \
+    } while (0)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _TASK_STATE
+{
+    TASK_READY = 0,             //Queued to run
+    TASK_RUNNING,
+    TASK_SLEEPING,              //In the timer wheel until its deadline or a command
+    TASK_WAITING,               //Until a command, with no deadline
+    TASK_DONE
+} TASK_STATE;
+
+struct _SCHEDULER;
+struct _TASK;
+
+typedef void (*TASK_FUNCTION)(struct _SCHEDULER* Scheduler, struct _TASK* Task);
+
+//The part of a coroutine the scheduler knows about, meant to be the first
+//member of a structure holding the rest of its state. A task only lives in
+//the ready queue or a slot of the wheel, so one link serves both.
+typedef struct _TASK
+{
+    TASK_FUNCTION  function;
+    struct _TASK*  pNext;
+    struct _TASK** ppPrevious;  //Link pointing to the task in its slot, to leave it in O(1)
+    UINT64         deadline;
+    UINT           resumePoint;
+    BYTE           state;       //TASK_STATE
+    BYTE           commandCount;
+    BYTE           commands[TASK_MAILBOX];
+} TASK;
+
+//Runs any number of tasks on the thread calling it. Sleeping tasks are kept
+//in a hierarchical timer wheel: the first level has a slot per tick and each
+//further level a slot per turn of the level before, whose tasks are spread
+//over that level as its turn comes up. Waiting and waking are O(1) whatever
+//the number of tasks, and a tick costs a look at one slot.
+typedef struct _SCHEDULER
+{
+    UINT64 now;                 //Microseconds, as last given to AdvanceScheduler
+    UINT64 tick;                //Next tick of the wheel to expire
+    TASK*  pReady;              //First of the tasks queued to run
+    TASK** ppReadyEnd;          //Link the next one queued goes to
+    TASK*  pRoot[WHEEL_ROOT_SLOTS];
+    TASK*  pLevels[WHEEL_LEVELS - 1][WHEEL_LEVEL_SLOTS];
+
+    //Statistics
+    UINT64 sleeping;            //Tasks in the wheel now
+    UINT64 resumes;
+    UINT64 expired;             //Tasks woken by their deadline
+    UINT64 commanded;           //Tasks woken by a command
+    UINT64 cascaded;            //Tasks moved down a level of the wheel
+} SCHEDULER;
+
+//An interactive game played as a coroutine. It waits for a command, starts a
+//game with it and moves the snake once every tick at the speed of the game,
+//the first move a whole tick after the start, until the game is over, then
+//waits for the next command to start another. Commands posted in between
+//reach the game through ReceiveCommand as they come, ticks missed because the
+//scheduler ran late are skipped like in the window.
+typedef struct _GAME_TASK
+{
+    TASK         task;
+    SNAKE_GAME   game;          //Parameters set by the caller before StartGameTask
+    UINT64       nextMove;      //Deadline of the next tick
+    UINT64       ticks;
+    UINT         played;        //Games started
+    SNAKE_RESULT result;        //Of the core functions, the task is done when it isn't SR_OK
+} GAME_TASK;
+
+
+//*****************************************************************************
+//
+//                            SCHEDULER FUNCTIONS
+//
+//*****************************************************************************
+
+//The clock starts at Now microseconds, of any clock the caller likes as long
+//as it never goes back
+void            InitializeScheduler(SCHEDULER* Scheduler, UINT64 Now);
+
+//Queues the task to run from the top of Function on the next AdvanceScheduler
+void            StartTask          (SCHEDULER* Scheduler, TASK* Task, TASK_FUNCTION Function);
+
+//Used by TASK_AWAIT
+void            WaitTask           (SCHEDULER* Scheduler, TASK* Task, UINT64 Deadline);
+
+//Gives the task a command and wakes it if it waits. Returns FALSE when its
+//mailbox is full or it is done. TakeCommand hands the task the oldest one.
+BOOL            PostCommand        (SCHEDULER* Scheduler, TASK* Task, BYTE Command);
+BOOL            TakeCommand        (TASK* Task, BYTE* Command);
+
+//Moves the clock to Now, running every task whose deadline passed on the way,
+//tick by tick and in the order they were woken within a tick, and every task
+//woken by a command. Returns the tasks resumed.
+UINT64          AdvanceScheduler   (SCHEDULER* Scheduler, UINT64 Now);
+
+//When AdvanceScheduler may next have a task to run, for a caller sleeping
+//in between: the next tick with a deadline, or earlier when a level of the
+//wheel turns, Now when tasks are ready and TASK_FOREVER when none sleeps
+UINT64          NextWakeUp         (const SCHEDULER* Scheduler);
+
+//Takes a task out of the scheduler, wherever it is, so it can be freed
+void            CancelTask         (SCHEDULER* Scheduler, TASK* Task);
+
+//Starts a game task waiting for its first command
+void            StartGameTask      (SCHEDULER* Scheduler, GAME_TASK* GameTask);
+void            PlayGameTask       (SCHEDULER* Scheduler, TASK* Task);
+
+#endif
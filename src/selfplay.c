@@ -0,0 +1,955 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "selfplay.h"
+#include "common.h"
+#include "hamilton.h"
+#include "results.h"
+
+//Sockets and processes are POSIX only, the window game has no use for them
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define MAX_WORKERS                 256
+#define NO_SHARD                    0xFFFFFFFF
+#define CONNECT_SECONDS             5.0   //A worker retries that long for the coordinator to listen
+#define CONNECT_RETRY_NS            50000000
+#define POLL_MS                     100
+#define GAME_BYTES(f)               (16 + 5 * (f)) //Largest encoding of a game eating f food
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL                0
+#endif
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _SHARD_STATE
+{
+    SS_PENDING = 0,
+    SS_ASSIGNED,
+    SS_DONE,                    //Reported, waiting for the shards before it
+    SS_WRITTEN
+} SHARD_STATE;
+
+typedef struct _SHARD
+{
+    SHARD_STATE state;
+    double      progressed;     //When it was handed out, or its worker last finished a game of it
+    UINT        played;         //Games its worker reported finished
+    BYTE*       payload;        //Games reported, kept until written in order
+    UINT        bytes;
+} SHARD;
+
+//A connected worker, as seen by the coordinator
+typedef struct _WORKER_LINK
+{
+    int    socket;              //-1 for a free link
+    BOOL   greeted;
+    UINT   threads;
+    UINT   shard;               //Being played, or NO_SHARD
+    BYTE*  input;               //Read but not parsed yet
+    size_t inputSize;
+    size_t inputCapacity;
+} WORKER_LINK;
+
+//Games of a shard the threads of a worker finished, for the heartbeats
+typedef struct _SHARD_PROGRESS
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  finished;   //Signaled when a thread is done with the shard
+    UINT            played;
+    UINT            running;    //Threads still playing
+} SHARD_PROGRESS;
+
+//Games first, first + step and so on of a shard, played on one thread of a
+//worker and encoded one after the other
+typedef struct _PLAY_THREAD
+{
+    const SHARD_ORDER* order;
+    SHARD_PROGRESS*    progress;
+    UINT               first;
+    UINT               step;
+    BYTE_BUFFER        output;
+    UINT*              lengths;     //Bytes of every game encoded
+    UINT*              foodTicks;
+    SNAKE_RESULT       result;
+} PLAY_THREAD;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+//Decodes the next game of a report, food ticks into FoodTicks
+static BOOL DecodeGame(const BYTE** Data, const BYTE* End, GAME_RESULT* Result, UINT* FoodTicks, UINT MaxFood)
+{
+    UINT64 size, ticks, count, delta;
+    UINT   tick = 0, i;
+
+    if (!GetVarint(Data, End, &size) || !GetVarint(Data, End, &ticks) || *Data >= End) return FALSE;
+
+    Result->snakeSize = (UINT) size;
+    Result->ticks     = (UINT) ticks;
+    Result->outcome   = *(*Data)++;
+
+    if (!GetVarint(Data, End, &count) || count > MaxFood) return FALSE;
+
+    Result->foodCount = (UINT) count;
+
+    for (i = 0; i < Result->foodCount; i++)
+    {
+        if (!GetVarint(Data, End, &delta)) return FALSE;
+
+        FoodTicks[i] = tick += (UINT) delta;
+    }
+
+    Result->foodTicks = FoodTicks;
+    return TRUE;
+}
+
+static BOOL SendAll(int Socket, const void* Data, size_t Size)
+{
+    const BYTE* bytes = (const BYTE*) Data;
+    ssize_t     sent;
+
+    while (Size > 0)
+    {
+        sent = send(Socket, bytes, Size, MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return FALSE;
+
+        bytes += sent;
+        Size  -= sent;
+    }
+
+    return TRUE;
+}
+
+static BOOL ReceiveAll(int Socket, void* Data, size_t Size)
+{
+    BYTE*   bytes = (BYTE*) Data;
+    ssize_t count;
+
+    while (Size > 0)
+    {
+        count = recv(Socket, bytes, Size, 0);
+
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return FALSE;
+
+        bytes += count;
+        Size  -= count;
+    }
+
+    return TRUE;
+}
+
+//"unix:path" or "host:port", where the host is an IPv4 address or localhost
+static BOOL ParseAddress(const char* Address, struct sockaddr_storage* Storage, socklen_t* Length)
+{
+    struct sockaddr_un* local  = (struct sockaddr_un*) Storage;
+    struct sockaddr_in* remote = (struct sockaddr_in*) Storage;
+    const char*         colon  = strrchr(Address, ':');
+    char                host[64];
+
+    memset(Storage, 0, sizeof(*Storage));
+
+    if (!strncmp(Address, "unix:", 5))
+    {
+        if (strlen(Address + 5) == 0 || strlen(Address + 5) >= sizeof(local->sun_path)) return FALSE;
+
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, Address + 5);
+
+        *Length = sizeof(struct sockaddr_un);
+        return TRUE;
+    }
+
+    if (colon == NULL || (size_t) (colon - Address) >= sizeof(host)) return FALSE;
+
+    memcpy(host, Address, colon - Address);
+    host[colon - Address] = 0;
+
+    remote->sin_family = AF_INET;
+    remote->sin_port   = htons((unsigned short) atoi(colon + 1));
+
+    if (host[0] == 0 || !strcmp(host, "localhost")) strcpy(host, "127.0.0.1");
+    if (inet_pton(AF_INET, host, &remote->sin_addr) != 1) return FALSE;
+
+    *Length = sizeof(struct sockaddr_in);
+    return TRUE;
+}
+
+//Takes a free link for a worker that just connected
+static void AddWorker(SELFPLAY* SelfPlay, WORKER_LINK* Links, int Socket)
+{
+    int one = 1;
+    UINT i;
+
+    for (i = 0; i < MAX_WORKERS && Links[i].socket >= 0; i++);
+
+    if (i == MAX_WORKERS)
+    {
+        close(Socket);
+        return;
+    }
+
+    fcntl(Socket, F_SETFL, fcntl(Socket, F_GETFL) | O_NONBLOCK);
+    setsockopt(Socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Links[i].socket    = Socket;
+    Links[i].greeted   = FALSE;
+    Links[i].shard     = NO_SHARD;
+    Links[i].inputSize = 0;
+
+    SelfPlay->workers++;
+}
+
+//Closes the link, handing its shard out again
+static void DropWorker(SELFPLAY* SelfPlay, WORKER_LINK* Link, SHARD* Shards)
+{
+    if (Link->shard != NO_SHARD)
+    {
+        Shards[Link->shard].state = SS_PENDING;
+        SelfPlay->reassigned++;
+    }
+
+    close(Link->socket);
+
+    Link->socket = -1;
+    Link->shard  = NO_SHARD;
+    SelfPlay->workersLost++;
+}
+
+//Checks the games of a report and keeps them in the shard
+static BOOL TakeReport(SELFPLAY* SelfPlay, WORKER_LINK* Link, SHARD* Shards, const SHARD_REPORT* Report,
+                       const BYTE* Payload, UINT* FoodTicks, UINT MaxFood)
+{
+    SHARD*       shard = Shards + Link->shard;
+    GAME_RESULT  result;
+    const BYTE*  data  = Payload;
+    UINT         first = Link->shard * SelfPlay->shardGames;
+    UINT         count = SelfPlay->games - first < SelfPlay->shardGames ? SelfPlay->games - first : SelfPlay->shardGames;
+    UINT         i;
+
+    if (Report->shard != Link->shard || Report->gameCount != count) return FALSE;
+
+    for (i = 0; i < count; i++) if (!DecodeGame(&data, Payload + Report->bytes, &result, FoodTicks, MaxFood)) return FALSE;
+
+    if (data != Payload + Report->bytes) return FALSE;
+
+    shard->payload = (BYTE*) malloc(Report->bytes ? Report->bytes : 1);
+    if (shard->payload == NULL) return FALSE;
+
+    memcpy(shard->payload, Payload, Report->bytes);
+
+    shard->bytes  = Report->bytes;
+    shard->state  = SS_DONE;
+    Link->shard   = NO_SHARD;
+
+    SelfPlay->bytesReceived += sizeof(SHARD_REPORT) + Report->bytes;
+    return TRUE;
+}
+
+//Reads what the worker sent and handles every whole message in it. Returns
+//FALSE when the worker left or broke the protocol.
+static BOOL ReceiveFromWorker(SELFPLAY* SelfPlay, WORKER_LINK* Link, SHARD* Shards, UINT* FoodTicks, UINT MaxFood)
+{
+    WORKER_HELLO hello;
+    SHARD_REPORT report;
+    BYTE*        input;
+    ssize_t      count;
+    size_t       used;
+
+    if (Link->inputCapacity - Link->inputSize < 65536)
+    {
+        input = (BYTE*) realloc(Link->input, Link->inputCapacity + 65536);
+        if (input == NULL) return FALSE;
+
+        Link->input          = input;
+        Link->inputCapacity += 65536;
+    }
+
+    count = recv(Link->socket, Link->input + Link->inputSize, Link->inputCapacity - Link->inputSize, 0);
+
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return TRUE;
+    if (count <= 0) return FALSE;
+
+    Link->inputSize += count;
+
+    while (TRUE)
+    {
+        if (!Link->greeted)
+        {
+            if (Link->inputSize < sizeof(hello)) return TRUE;
+
+            memcpy(&hello, Link->input, sizeof(hello));
+
+            if (hello.magic != SELFPLAY_MAGIC || hello.version != SELFPLAY_VERSION) return FALSE;
+
+            Link->greeted = TRUE;
+            Link->threads = hello.threads;
+            used          = sizeof(hello);
+        }
+        else
+        {
+            if (Link->inputSize < sizeof(report)) return TRUE;
+
+            memcpy(&report, Link->input, sizeof(report));
+
+            //Nothing is reported but the shard the worker was given
+            if (report.magic != SELFPLAY_MAGIC || Link->shard == NO_SHARD ||
+                report.bytes > (UINT64) SelfPlay->shardGames * GAME_BYTES(MaxFood))
+                return FALSE;
+
+            if (Link->inputSize < sizeof(report) + report.bytes) return TRUE;
+
+            //A heartbeat, which only keeps the worker when it finished more games
+            if (report.bytes == 0)
+            {
+                if (report.shard != Link->shard) return FALSE;
+
+                if (report.gameCount > Shards[Link->shard].played)
+                {
+                    Shards[Link->shard].played     = report.gameCount;
+                    Shards[Link->shard].progressed = Now();
+                }
+
+                SelfPlay->bytesReceived += sizeof(report);
+            }
+            else if (!TakeReport(SelfPlay, Link, Shards, &report, Link->input + sizeof(report), FoodTicks, MaxFood))
+                return FALSE;
+
+            used = sizeof(report) + report.bytes;
+        }
+
+        memmove(Link->input, Link->input + used, Link->inputSize - used);
+        Link->inputSize -= used;
+    }
+}
+
+//Hands the first pending shards to the idle workers
+static void AssignShards(SELFPLAY* SelfPlay, WORKER_LINK* Links, SHARD* Shards, UINT ShardCount)
+{
+    SHARD_ORDER order;
+    UINT        shard = 0, i;
+
+    for (i = 0; i < MAX_WORKERS; i++)
+    {
+        if (Links[i].socket < 0 || !Links[i].greeted || Links[i].shard != NO_SHARD) continue;
+
+        while (shard < ShardCount && Shards[shard].state != SS_PENDING) shard++;
+
+        if (shard == ShardCount) return;
+
+        memset(&order, 0, sizeof(order));
+        order.magic     = SELFPLAY_MAGIC;
+        order.shard     = shard;
+        order.seed      = SelfPlay->seed;
+        order.firstGame = shard * SelfPlay->shardGames;
+        order.gameCount = SelfPlay->games - order.firstGame < SelfPlay->shardGames ?
+                          SelfPlay->games - order.firstGame : SelfPlay->shardGames;
+        order.config    = RESULT_CONFIG(&SelfPlay->game);
+        order.maxTicks  = SelfPlay->maxTicks;
+        order.player    = SelfPlay->player;
+
+        if (!SendAll(Links[i].socket, &order, sizeof(order)))
+        {
+            DropWorker(SelfPlay, Links + i, Shards);
+            continue;
+        }
+
+        Links[i].shard           = shard;
+        Shards[shard].state      = SS_ASSIGNED;
+        Shards[shard].progressed = Now();
+        Shards[shard].played     = 0;
+    }
+}
+
+//Takes the finished shards that follow the ones already taken, in game order
+static void WriteShards(SELFPLAY* SelfPlay, RESULTS_WRITER* Writer, SHARD* Shards, UINT ShardCount, UINT* NextShard,
+                        UINT* FoodTicks, UINT MaxFood)
+{
+    GAME_RESULT result;
+    const BYTE* data;
+    SHARD*      shard;
+    UINT        game, i;
+
+    for (; *NextShard < ShardCount && Shards[*NextShard].state == SS_DONE; (*NextShard)++)
+    {
+        shard = Shards + *NextShard;
+        data  = shard->payload;
+        game  = *NextShard * SelfPlay->shardGames;
+
+        for (; data < shard->payload + shard->bytes; game++)
+        {
+            DecodeGame(&data, shard->payload + shard->bytes, &result, FoodTicks, MaxFood);
+
+            result.seed   = SelfPlay->seed << 32 | game;
+            result.config = RESULT_CONFIG(&SelfPlay->game);
+
+            if (SelfPlay->results != NULL && AddResult(Writer, &result) != SR_OK) SelfPlay->failure = "can't write results";
+
+            SelfPlay->ticks    += result.ticks;
+            SelfPlay->won      += result.outcome == WON;
+            SelfPlay->lost     += result.outcome == LOST;
+
+            //Every value is mixed in as the splitmix64 of the checksum so far and the value
+            SelfPlay->checksum ^= result.snakeSize;
+            SelfPlay->checksum  = SplitMix64(&SelfPlay->checksum);
+            SelfPlay->checksum ^= (UINT64) result.ticks << 8 | result.outcome;
+            SelfPlay->checksum  = SplitMix64(&SelfPlay->checksum);
+
+            for (i = 0; i < result.foodCount; i++)
+            {
+                SelfPlay->checksum ^= result.foodTicks[i];
+                SelfPlay->checksum  = SplitMix64(&SelfPlay->checksum);
+            }
+        }
+
+        free(shard->payload);
+
+        shard->payload = NULL;
+        shard->state   = SS_WRITTEN;
+    }
+}
+
+//Random move that doesn't run into anything, when there is any
+static void TurnRandomly(SNAKE_GAME* Game)
+{
+    SNAKE_DIRECTION directions[3];
+    WORD            position;
+    UINT            turn, count;
+
+    for (turn = 0, count = 0; turn < 3; turn++)
+    {
+        directions[count] = (SNAKE_DIRECTION) ((Game->previousDirection + 1 - turn) & 3);
+        position          = NewPosition(Game, Game->headPosition, 1, directions[count]);
+
+        if (IsInsideField(Game, position) && IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position))) count++;
+    }
+
+    if (count > 0) ReceiveCommand(Game, directions[RandomBelow(Game, count)]);
+}
+
+static SNAKE_RESULT PlayGame(SNAKE_GAME* Game, const SHARD_ORDER* Order, UINT Index, UINT* FoodTicks, UINT* Ticks,
+                             UINT* Food)
+{
+    HAMILTON_SOLVER solver;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+    UINT            size;
+
+    SeedGame(Game, Order->seed, Order->firstGame + Index);
+
+    if ((result = ResetGame(Game)) != SR_OK) return result;
+    if (Order->player == SP_HAMILTON && (result = CreateHamiltonSolver(&solver, Game, TRUE)) != SR_OK) return result;
+
+    for (*Ticks = 0, *Food = 0; Game->snakeState == RUNNING && *Ticks < Order->maxTicks; (*Ticks)++)
+    {
+        if (Order->player == SP_HAMILTON)
+        {
+            direction = HamiltonDirection(&solver, Game);
+
+            if (direction != Game->previousDirection) ReceiveCommand(Game, direction);
+        }
+        else TurnRandomly(Game);
+
+        size = Game->snakeSize;
+
+        if ((result = MoveSnake(Game)) != SR_OK) break;
+
+        if (Game->snakeSize > size) FoodTicks[(*Food)++] = *Ticks + 1;
+    }
+
+    if (Order->player == SP_HAMILTON) DestroyHamiltonSolver(&solver);
+
+    return result;
+}
+
+static void* PlayThread(void* Parameter)
+{
+    PLAY_THREAD*       thread = (PLAY_THREAD*) Parameter;
+    const SHARD_ORDER* order  = thread->order;
+    SNAKE_GAME         game;
+    UINT               ticks, food, start, i, j, k;
+
+    memset(&game, 0, sizeof(game));
+    game.fieldWidth       = CONFIG_WIDTH(order->config);
+    game.fieldHeight      = CONFIG_HEIGHT(order->config);
+    game.passThroughWalls = !CONFIG_WALLS(order->config);
+    game.snakeSpeed       = CONFIG_SPEED(order->config);
+
+    thread->output.size = 0;
+    thread->result      = SR_OK;
+
+    for (i = thread->first, j = 0; i < order->gameCount && thread->result == SR_OK; i += thread->step, j++)
+    {
+        if ((thread->result = PlayGame(&game, order, i, thread->foodTicks, &ticks, &food)) != SR_OK) break;
+
+        if (!ReserveBytes(&thread->output, GAME_BYTES(food)))
+        {
+            thread->result = SR_MEMORY_ERROR;
+            break;
+        }
+
+        start = (UINT) thread->output.size;
+
+        PutVarint(&thread->output, game.snakeSize);
+        PutVarint(&thread->output, ticks);
+        thread->output.bytes[thread->output.size++] = (BYTE) game.snakeState;
+        PutVarint(&thread->output, food);
+
+        for (k = 0; k < food; k++) PutVarint(&thread->output, thread->foodTicks[k] - (k ? thread->foodTicks[k - 1] : 0));
+
+        thread->lengths[j] = (UINT) thread->output.size - start;
+
+        pthread_mutex_lock(&thread->progress->lock);
+        thread->progress->played++;
+        pthread_mutex_unlock(&thread->progress->lock);
+    }
+
+    EndingCleanUp(&game);
+
+    pthread_mutex_lock(&thread->progress->lock);
+    thread->progress->running--;
+    pthread_cond_signal(&thread->progress->finished);
+    pthread_mutex_unlock(&thread->progress->lock);
+
+    return NULL;
+}
+
+//Waits for the threads playing a shard, telling the coordinator how many
+//games they finished every SELFPLAY_HEARTBEAT seconds
+static void WaitForShard(SHARD_PROGRESS* Progress, int Connection, UINT Shard)
+{
+    SHARD_REPORT    heartbeat = { SELFPLAY_MAGIC, Shard, 0, 0 };
+    struct timespec deadline;
+    BOOL            connected = TRUE;
+
+    pthread_mutex_lock(&Progress->lock);
+
+    while (Progress->running > 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += SELFPLAY_HEARTBEAT;
+
+        if (pthread_cond_timedwait(&Progress->finished, &Progress->lock, &deadline) != ETIMEDOUT || !connected)
+            continue;
+
+        heartbeat.gameCount = Progress->played;
+
+        //A broken connection shows when the shard is sent
+        pthread_mutex_unlock(&Progress->lock);
+        connected = SendAll(Connection, &heartbeat, sizeof(heartbeat));
+        pthread_mutex_lock(&Progress->lock);
+    }
+
+    pthread_mutex_unlock(&Progress->lock);
+}
+
+//Plays the shard on the threads and writes the report, games in shard order,
+//sending heartbeats over Connection meanwhile
+static SNAKE_RESULT PlayShard(const SHARD_ORDER* Order, PLAY_THREAD* Threads, UINT ThreadCount, BYTE_BUFFER* Report,
+                              int Connection)
+{
+    pthread_t      handles[MAX_THREADS];
+    BOOL           started[MAX_THREADS];
+    size_t         offsets[MAX_THREADS];
+    SHARD_PROGRESS progress;
+    SHARD_REPORT   report;
+    UINT         blocks = CONFIG_WIDTH(Order->config) * CONFIG_HEIGHT(Order->config);
+    UINT         length, i, t;
+    UINT*        lengths;
+    UINT*        foodTicks;
+
+    for (t = 0; t < ThreadCount; t++)
+    {
+        lengths   = (UINT*) realloc(Threads[t].lengths, (Order->gameCount / ThreadCount + 1) * sizeof(UINT));
+        foodTicks = lengths ? (UINT*) realloc(Threads[t].foodTicks, blocks * sizeof(UINT)) : NULL;
+
+        if (lengths)   Threads[t].lengths   = lengths;
+        if (foodTicks) Threads[t].foodTicks = foodTicks;
+        if (foodTicks == NULL) return SR_MEMORY_ERROR;
+
+        Threads[t].order    = Order;
+        Threads[t].progress = &progress;
+        Threads[t].first    = t;
+        Threads[t].step     = ThreadCount;
+    }
+
+    pthread_mutex_init(&progress.lock, NULL);
+    pthread_cond_init(&progress.finished, NULL);
+
+    progress.played  = 0;
+    progress.running = ThreadCount;
+
+    //The calling thread sends the heartbeats, and plays the share of any
+    //thread that couldn't start
+    for (t = 0; t < ThreadCount; t++)
+        started[t] = pthread_create(handles + t, NULL, PlayThread, Threads + t) == 0;
+
+    for (t = 0; t < ThreadCount; t++) if (!started[t]) PlayThread(Threads + t);
+
+    WaitForShard(&progress, Connection, Order->shard);
+
+    for (t = 0; t < ThreadCount; t++) if (started[t]) pthread_join(handles[t], NULL);
+
+    pthread_mutex_destroy(&progress.lock);
+    pthread_cond_destroy(&progress.finished);
+
+    report.magic     = SELFPLAY_MAGIC;
+    report.shard     = Order->shard;
+    report.gameCount = Order->gameCount;
+    report.bytes     = 0;
+
+    for (t = 0; t < ThreadCount; t++)
+    {
+        if (Threads[t].result != SR_OK) return Threads[t].result;
+
+        report.bytes += (UINT) Threads[t].output.size;
+        offsets[t]    = 0;
+    }
+
+    Report->size = 0;
+
+    if (!ReserveBytes(Report, sizeof(report) + report.bytes)) return SR_MEMORY_ERROR;
+
+    memcpy(Report->bytes, &report, sizeof(report));
+    Report->size = sizeof(report);
+
+    //Interleaves the games of the threads back into shard order
+    for (i = 0; i < Order->gameCount; i++)
+    {
+        t      = i % ThreadCount;
+        length = Threads[t].lengths[i / ThreadCount];
+
+        memcpy(Report->bytes + Report->size, Threads[t].output.bytes + offsets[t], length);
+
+        Report->size += length;
+        offsets[t]   += length;
+    }
+
+    return SR_OK;
+}
+
+
+//*****************************************************************************
+//
+//                            SELF-PLAY FUNCTIONS
+//
+//*****************************************************************************
+
+int ListenSelfPlay(const char* Address, char* Bound, size_t BoundSize)
+{
+    struct sockaddr_storage storage;
+    struct sockaddr_in*     remote = (struct sockaddr_in*) &storage;
+    socklen_t               length;
+    char                    host[INET_ADDRSTRLEN];
+    int                     listener, one = 1;
+
+    if (!ParseAddress(Address, &storage, &length)) return -1;
+
+    if ((listener = socket(storage.ss_family, SOCK_STREAM, 0)) < 0) return -1;
+
+    if (storage.ss_family == AF_UNIX) unlink(((struct sockaddr_un*) &storage)->sun_path);
+    else setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(listener, (struct sockaddr*) &storage, length) != 0 || listen(listener, MAX_WORKERS) != 0 ||
+        getsockname(listener, (struct sockaddr*) &storage, &length) != 0)
+    {
+        close(listener);
+        return -1;
+    }
+
+    if (storage.ss_family == AF_UNIX) snprintf(Bound, BoundSize, "%s", Address);
+    else snprintf(Bound, BoundSize, "%s:%u", inet_ntop(AF_INET, &remote->sin_addr, host, sizeof(host)),
+                  (unsigned) ntohs(remote->sin_port));
+
+    return listener;
+}
+
+BOOL RunCoordinator(SELFPLAY* SelfPlay, int Listener)
+{
+    static WORKER_LINK links[MAX_WORKERS];
+
+    struct pollfd   polls[MAX_WORKERS + 1];
+    UINT            pollLinks[MAX_WORKERS + 1];
+    RESULTS_WRITER  writer;
+    HAMILTON_SOLVER solver;
+    SNAKE_GAME      game  = SelfPlay->game;
+    SHARD*          shards;
+    UINT*           foodTicks;
+    SHARD_ORDER     stop;
+    UINT            maxFood = SelfPlay->game.fieldWidth * SelfPlay->game.fieldHeight;
+    UINT            shardCount, nextShard = 0, pollCount, connected, i;
+    double          start = Now(), now, lastWorker = start;
+    int             socket;
+    BOOL            writing = FALSE;
+
+    SelfPlay->ticks         = 0;
+    SelfPlay->won           = 0;
+    SelfPlay->lost          = 0;
+    SelfPlay->checksum      = 0;
+    SelfPlay->workers       = 0;
+    SelfPlay->workersLost   = 0;
+    SelfPlay->reassigned    = 0;
+    SelfPlay->bytesReceived = 0;
+    SelfPlay->failure       = NULL;
+
+    if (SelfPlay->shardGames == 0) SelfPlay->shardGames = SELFPLAY_SHARD_GAMES;
+    if (SelfPlay->timeout <= 0.0)  SelfPlay->timeout    = SELFPLAY_TIMEOUT;
+
+    //A shard no worker can play would be handed out forever
+    game.hFieldBuffer = NULL;
+    game.pHeatmap     = NULL;
+    game.pEvents      = NULL;
+
+    if (SelfPlay->player >= SELFPLAY_PLAYERS || SelfPlay->games == 0 || Initialize(&game, FALSE) != SR_OK)
+        SelfPlay->failure = "bad parameters";
+    else if (SelfPlay->player == SP_HAMILTON)
+    {
+        if (CreateHamiltonSolver(&solver, &game, TRUE) != SR_OK) SelfPlay->failure = "the field has no Hamiltonian cycle";
+        else DestroyHamiltonSolver(&solver);
+    }
+
+    EndingCleanUp(&game);
+
+    if (SelfPlay->failure != NULL) return FALSE;
+
+    shardCount = (SelfPlay->games + SelfPlay->shardGames - 1) / SelfPlay->shardGames;
+    shards     = (SHARD*) calloc(shardCount, sizeof(SHARD));
+    foodTicks  = (UINT*) malloc(maxFood * sizeof(UINT));
+
+    if (shards == NULL || foodTicks == NULL) SelfPlay->failure = "out of memory";
+    else if (SelfPlay->results != NULL)
+    {
+        if (OpenResultsWriter(&writer, SelfPlay->results, TRUE) == SR_OK) writing = TRUE;
+        else SelfPlay->failure = "can't write results";
+    }
+
+    for (i = 0; i < MAX_WORKERS; i++) links[i].socket = -1;
+
+    fcntl(Listener, F_SETFL, fcntl(Listener, F_GETFL) | O_NONBLOCK);
+
+    while (SelfPlay->failure == NULL && nextShard < shardCount)
+    {
+        AssignShards(SelfPlay, links, shards, shardCount);
+
+        polls[0].fd     = Listener;
+        polls[0].events = POLLIN;
+        pollCount       = 1;
+
+        for (i = 0; i < MAX_WORKERS; i++)
+        {
+            if (links[i].socket < 0) continue;
+
+            polls[pollCount].fd      = links[i].socket;
+            polls[pollCount].events  = POLLIN;
+            pollLinks[pollCount++]   = i;
+        }
+
+        if (poll(polls, pollCount, POLL_MS) < 0 && errno != EINTR)
+        {
+            SelfPlay->failure = "can't wait for the workers";
+            break;
+        }
+
+        if (polls[0].revents & POLLIN)
+            while ((socket = accept(Listener, NULL, NULL)) >= 0) AddWorker(SelfPlay, links, socket);
+
+        for (i = 1; i < pollCount; i++)
+        {
+            if (polls[i].revents == 0 || links[pollLinks[i]].socket < 0) continue;
+
+            if (!ReceiveFromWorker(SelfPlay, links + pollLinks[i], shards, foodTicks, maxFood))
+                DropWorker(SelfPlay, links + pollLinks[i], shards);
+        }
+
+        //A worker that stopped finishing games is dropped like one that crashed
+        now = Now();
+
+        for (i = 0, connected = 0; i < MAX_WORKERS; i++)
+        {
+            if (links[i].socket < 0) continue;
+
+            if (links[i].shard != NO_SHARD && now - shards[links[i].shard].progressed > SelfPlay->timeout)
+                DropWorker(SelfPlay, links + i, shards);
+            else connected++;
+        }
+
+        if (connected > 0) lastWorker = now;
+        else if (now - lastWorker > SelfPlay->timeout) SelfPlay->failure = "no worker left";
+
+        WriteShards(SelfPlay, &writer, shards, shardCount, &nextShard, foodTicks, maxFood);
+    }
+
+    //Workers still connected are told to leave
+    memset(&stop, 0, sizeof(stop));
+    stop.magic = SELFPLAY_MAGIC;
+    stop.shard = SHARD_STOP;
+
+    for (i = 0; i < MAX_WORKERS; i++)
+    {
+        if (links[i].socket < 0) continue;
+
+        SendAll(links[i].socket, &stop, sizeof(stop));
+        close(links[i].socket);
+        free(links[i].input);
+
+        links[i].socket        = -1;
+        links[i].input         = NULL;
+        links[i].inputCapacity = 0;
+    }
+
+    if (writing && !CloseResultsWriter(&writer) && SelfPlay->failure == NULL) SelfPlay->failure = "can't write results";
+
+    for (i = 0; shards && i < shardCount; i++) free(shards[i].payload);
+
+    free(shards);
+    free(foodTicks);
+
+    SelfPlay->elapsed = Now() - start;
+    return SelfPlay->failure == NULL;
+}
+
+BOOL RunSelfPlayWorker(const char* Address, UINT Threads, UINT CrashAfter)
+{
+    static PLAY_THREAD threads[MAX_THREADS];
+
+    struct sockaddr_storage storage;
+    struct timespec         retry = { 0, CONNECT_RETRY_NS };
+    socklen_t               length;
+    WORKER_HELLO            hello;
+    SHARD_ORDER             order;
+    BYTE_BUFFER             report = { NULL, 0, 0 };
+    UINT                    done   = 0, t;
+    double                  start  = Now();
+    int                     connection = -1, one = 1;
+    BOOL                    ok     = FALSE;
+
+    if (Threads == 0)           Threads = ProcessorCount();
+    if (Threads > MAX_THREADS)  Threads = MAX_THREADS;
+
+    if (!ParseAddress(Address, &storage, &length)) return FALSE;
+
+    //The coordinator may not be listening yet
+    while (connection < 0 && Now() - start < CONNECT_SECONDS)
+    {
+        if ((connection = socket(storage.ss_family, SOCK_STREAM, 0)) < 0) return FALSE;
+
+        if (connect(connection, (struct sockaddr*) &storage, length) != 0)
+        {
+            close(connection);
+            connection = -1;
+            nanosleep(&retry, NULL);
+        }
+    }
+
+    if (connection < 0) return FALSE;
+
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    hello.magic   = SELFPLAY_MAGIC;
+    hello.version = SELFPLAY_VERSION;
+    hello.threads = Threads;
+    hello.process = (UINT) getpid();
+
+    if (SendAll(connection, &hello, sizeof(hello)))
+    {
+        while (ReceiveAll(connection, &order, sizeof(order)) && order.magic == SELFPLAY_MAGIC)
+        {
+            if (order.shard == SHARD_STOP)
+            {
+                ok = TRUE;
+                break;
+            }
+
+            //Leaves without a word, the way a crashed worker would
+            if (CrashAfter != 0 && done == CrashAfter) break;
+
+            if (order.gameCount == 0 || order.player >= SELFPLAY_PLAYERS ||
+                PlayShard(&order, threads, Threads, &report, connection) != SR_OK ||
+                !SendAll(connection, report.bytes, report.size))
+                break;
+
+            done++;
+        }
+    }
+
+    close(connection);
+
+    for (t = 0; t < MAX_THREADS; t++)
+    {
+        free(threads[t].output.bytes);
+        free(threads[t].lengths);
+        free(threads[t].foodTicks);
+    }
+
+    memset(threads, 0, sizeof(threads));
+    free(report.bytes);
+
+    return ok;
+}
+
+#else
+
+int ListenSelfPlay(const char* Address, char* Bound, size_t BoundSize)
+{
+    return -1;
+}
+
+BOOL RunCoordinator(SELFPLAY* SelfPlay, int Listener)
+{
+    SelfPlay->failure = "not supported on Windows";
+    return FALSE;
+}
+
+BOOL RunSelfPlayWorker(const char* Address, UINT Threads, UINT CrashAfter)
+{
+    return FALSE;
+}
+
+#endif
+
+const char* PlayerName(SELFPLAY_PLAYER Player)
+{
+    switch (Player)
+    {
+        case SP_RANDOM:   return "random";
+        case SP_HAMILTON: return "hamilton";
+        default:          return "unknown";
+    }
+}
@@ -0,0 +1,134 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define SELFPLAY_MAGIC              0x50534E53 //"SNSP" in the first bytes of every message
+#define SELFPLAY_VERSION            2
+#define SELFPLAY_SHARD_GAMES        64         //Default games per shard
+#define SELFPLAY_TIMEOUT            60.0       //Default seconds a worker may go without finishing a game
+#define SELFPLAY_HEARTBEAT          1          //Seconds between progress reports of a worker playing a shard
+#define SHARD_STOP                  0xFFFFFFFF //Shard of the order telling a worker to leave
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _SELFPLAY_PLAYER
+{
+    SP_RANDOM = 0,              //Random moves that don't run into anything, drawn from the game's generator
+    SP_HAMILTON,                //Along a Hamiltonian cycle, with shortcuts
+    SELFPLAY_PLAYERS
+} SELFPLAY_PLAYER;
+
+//Sent by a worker once connected. All the integers of the protocol are
+//little endian and the structures have no padding.
+typedef struct _WORKER_HELLO
+{
+    UINT magic;
+    UINT version;
+    UINT threads;
+    UINT process;
+} WORKER_HELLO;
+
+//Games firstGame to firstGame + gameCount - 1 of a run, game i seeded with
+//stream i of seed, so a shard plays the same wherever it runs
+typedef struct _SHARD_ORDER
+{
+    UINT   magic;
+    UINT   shard;               //SHARD_STOP once there is nothing left
+    UINT64 seed;
+    UINT   firstGame;
+    UINT   gameCount;
+    UINT   config;              //RESULT_CONFIG
+    UINT   maxTicks;
+    UINT   player;              //SELFPLAY_PLAYER
+    UINT   reserved;
+} SHARD_ORDER;
+
+//Answer to an order, followed by bytes of games in the order of the shard:
+//the final size, the ticks, the outcome byte, the food eaten and the ticks
+//between pickups, every number but the outcome as a varint. While it plays,
+//a worker sends one with no bytes every SELFPLAY_HEARTBEAT seconds, gameCount
+//then being the games of the shard it finished so far.
+typedef struct _SHARD_REPORT
+{
+    UINT magic;
+    UINT shard;
+    UINT gameCount;
+    UINT bytes;
+} SHARD_REPORT;
+
+//A run split into shards of shardGames games, handed out to whichever worker
+//is free. Shards of a worker that disconnects or finishes no game of its
+//shard for timeout seconds are handed to another, and finished shards are
+//taken in game order, so the results file and the checksum only depend on
+//the parameters.
+typedef struct _SELFPLAY
+{
+    //Parameters, set by the caller before RunCoordinator
+    SNAKE_GAME      game;       //Field and speed of every game
+    SELFPLAY_PLAYER player;
+    UINT            games;
+    UINT            shardGames;
+    UINT            maxTicks;   //A game still running after them is stopped
+    UINT64          seed;
+    double          timeout;
+    const char*     results;    //File the games are appended to, or NULL
+
+    //Statistics
+    UINT64          ticks;
+    UINT            won;
+    UINT            lost;
+    UINT64          checksum;   //Of every result in game order
+    UINT            workers;    //Connected over the run
+    UINT            workersLost;
+    UINT            reassigned; //Shards handed out again
+    UINT64          bytesReceived;
+    double          elapsed;
+    const char*     failure;    //Why the run stopped early, NULL when every game was played
+} SELFPLAY;
+
+
+//*****************************************************************************
+//
+//                            SELF-PLAY FUNCTIONS
+//
+//*****************************************************************************
+
+//Addresses are "unix:path" for a Unix socket or "host:port" for TCP. Listen
+//returns the listening socket, or -1, and writes the address workers must
+//connect to into Bound, with the port the system picked for port 0.
+int             ListenSelfPlay     (const char* Address, char* Bound, size_t BoundSize);
+
+//Hands out every shard to the workers connecting to Listener and waits for
+//all of them, then tells the workers to leave. Returns FALSE when it stopped
+//early, such as when no worker was left for a whole timeout.
+BOOL            RunCoordinator     (SELFPLAY* SelfPlay, int Listener);
+
+//Plays the shards ordered by the coordinator at Address on Threads threads,
+//zero using every processor, until told to leave. For testing, a worker
+//with CrashAfter shards done drops the connection in the middle of the next
+//one. Returns FALSE when the connection failed or broke.
+BOOL            RunSelfPlayWorker  (const char* Address, UINT Threads, UINT CrashAfter);
+
+const char*     PlayerName         (SELFPLAY_PLAYER Player);
+
+#endif
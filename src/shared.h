@@ -0,0 +1,65 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SHARED_H
+#define SHARED_H
+
+#include <string.h>
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define LOAD(p)                     __atomic_load_n(p, __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p)             __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE(p, v)                 __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v)         __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#define ROUND_TO_WORDS(n)           (((n) + 7) & ~7)
+
+
+//*****************************************************************************
+//
+//                              SHARED FUNCTIONS
+//
+//*****************************************************************************
+
+//Memory shared with other threads or processes is only ever touched a whole
+//word at a time with atomic operations, so a reader racing the writer sees
+//torn records, never undefined behavior, and throws them away by their
+//sequences. Bytes is a multiple of 8.
+static inline void WriteShared(void* Shared, const void* Data, size_t Bytes)
+{
+    UINT64* pShared = (UINT64*) Shared;
+    UINT64  word;
+    size_t  i;
+
+    for (i = 0; i < Bytes / 8; i++)
+    {
+        memcpy(&word, (const BYTE*) Data + i * 8, 8);
+        STORE(pShared + i, word);
+    }
+}
+
+static inline void ReadShared(void* Data, const void* Shared, size_t Bytes)
+{
+    const UINT64* pShared = (const UINT64*) Shared;
+    UINT64        word;
+    size_t        i;
+
+    for (i = 0; i < Bytes / 8; i++)
+    {
+        word = LOAD(pShared + i);
+        memcpy((BYTE*) Data + i * 8, &word, 8);
+    }
+}
+
+#endif
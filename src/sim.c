@@ -0,0 +1,2713 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#include <pthread.h>
+#include "snake.h"
+#include "common.h"
+#include "heatmap.h"
+#include "hamilton.h"
+#include "planner.h"
+#include "evolve.h"
+#include "results.h"
+#include "table.h"
+#include "symmetry.h"
+#include "broadcast.h"
+#include "solver.h"
+#include "bot.h"
+#include "selfplay.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "policy.h"
+#include "outcome.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define DEFAULT_GAMES               3
+#define DEFAULT_SEED                1
+#define GAME_SEED(s, i)             ((UINT64) (s) << 32 | (i))  //Seed and stream of game i, as results files keep it
+#define DEFAULT_MAX_TICKS           2000
+#define DEFAULT_POPULATION          256
+#define DEFAULT_GENERATIONS         100
+#define MAX_FOOD                    (127 * 127) //No game eats more food than there are blocks
+#define DEFAULT_WATCH_SECONDS       5
+#define DEFAULT_SUSPENDED           10000
+#define DEFAULT_SOLVER_MB           256
+#define WATCH_POLL_NS               10000000  //Spectators look for new ticks every 10 ms
+#define DEFAULT_HEATMAP_GAMES       3000
+#define DEFAULT_DRAWS               100000000
+#define BIASED_BOUND                0x60000000 //Three quarters of 2^31, where a modulo of rand is worst
+#define DEFAULT_BOT_GAMES           10
+#define DEFAULT_SEARCH_DEPTH        12
+#define DEFAULT_SEARCH_LENGTH       100
+#define DEFAULT_SELFPLAY_GAMES      4096
+#define DEFAULT_REPLAY_GAMES        2000
+#define DEFAULT_REPLAY_BATCH        256
+#define REPLAY_BATCHES              200   //Sampled each way by the replay command
+#define DEFAULT_LOCAL_WORKERS       2
+#define MAX_LOCAL_WORKERS           64
+#define DEFAULT_SESSIONS            100000
+#define DEFAULT_SESSION_SECONDS     10
+#define DEFAULT_SESSION_COMMANDS    2.0   //Per session and second
+#define DEFAULT_POLICY_LAYERS       4
+#define DEFAULT_POLICY_CHANNELS     32
+#define DEFAULT_POLICY_BATCH        256
+#define POLICY_BATCHES              100   //Timed by the policy command
+#define DEFAULT_OUTCOME_GAMES       1000
+#define DEFAULT_OUTCOME_MAX_TICKS   1000000
+
+//How the events command keeps its copy of the field
+#define FOLLOW_NONE                 0
+#define FOLLOW_EVENTS               1     //Applies the cell events of every move
+#define FOLLOW_RESCAN               2     //Reads every block after every move
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Games first, first + step and so on of a heatmap run, played on one thread
+//into a heatmap of its own
+typedef struct _HEATMAP_WORKER
+{
+    HEATMAP      heatmap;
+    SNAKE_GAME   game;
+    UINT         first;
+    UINT         step;
+    UINT         games;
+    UINT         seed;
+    UINT         maxTicks;
+    BOOL         counting;
+    UINT64       ticks;
+    SNAKE_RESULT result;
+} HEATMAP_WORKER;
+
+//Games first, first + step and so on of a replay run, played on one thread
+//and recorded into the shared replay
+typedef struct _REPLAY_WORKER
+{
+    REPLAY*      replay;
+    SNAKE_GAME   game;
+    UINT         first;
+    UINT         step;
+    UINT         games;
+    UINT         seed;
+    UINT         maxTicks;
+    UINT64       ticks;
+    SNAKE_RESULT result;
+} REPLAY_WORKER;
+
+//A session doing nothing but waking up every tick, to time the scheduler alone
+typedef struct _TICK_TASK
+{
+    TASK   task;
+    UINT64 nextTick;
+    UINT64 period;
+    UINT64 ticks;
+} TICK_TASK;
+
+
+//*****************************************************************************
+//
+//                              GLOBAL VARIABLES
+//
+//*****************************************************************************
+
+//Fields ending in "w" pass through walls
+static const char* hamiltonSizes[] =
+{
+    "8x8", "16x16", "21x16", "21x15w", "32x32", "64x64", "127x126", "127x127w", NULL
+};
+
+//Snake lengths the suspend command measures at, as far as the field allows
+static const UINT suspendLengths[] =
+{
+    5, 16, 64, 256, 1024, 4096, 16129, 0
+};
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+//Bytes of heap in use, or zero where the C runtime doesn't tell
+static size_t HeapInUse(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    struct mallinfo2 info = mallinfo2();
+
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+static int CompareDoubles(const void* A, const void* B)
+{
+    double a = *(const double*) A;
+    double b = *(const double*) B;
+
+    return (a > b) - (a < b);
+}
+
+//Reads "WxH", or "WxHw" for a field without walls
+static BOOL ParseField(const char* Text, SNAKE_GAME* Game)
+{
+    unsigned width, height;
+    char     walls = 0;
+
+    if (sscanf(Text, "%ux%u%c", &width, &height, &walls) < 2) return FALSE;
+    if (walls != 0 && walls != 'w') return FALSE;
+
+    memset(Game, 0, sizeof(SNAKE_GAME));
+
+    Game->fieldWidth       = width;
+    Game->fieldHeight      = height;
+    Game->snakeSpeed       = SNAKE_SPEED;
+    Game->passThroughWalls = walls == 'w';
+
+    return TRUE;
+}
+
+//Starts the results file given with -o, if any. Ticks holds the tick of every
+//food eaten in the game being played.
+static BOOL OpenResults(RESULTS_WRITER* Writer, const char* File, UINT** Ticks)
+{
+    *Ticks = NULL;
+
+    if (File == NULL) return TRUE;
+
+    *Ticks = (UINT*) malloc(MAX_FOOD * sizeof(UINT));
+
+    if (*Ticks == NULL || OpenResultsWriter(Writer, File, TRUE) != SR_OK)
+    {
+        fprintf(stderr, "Can't write \"%s\"\n", File);
+        free(*Ticks);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void AddGame(RESULTS_WRITER* Writer, SNAKE_GAME* Game, UINT64 Seed, UINT64 Ticks, const UINT* FoodTicks, UINT FoodCount)
+{
+    GAME_RESULT result;
+
+    if (FoodTicks == NULL) return;
+
+    result.seed      = Seed;
+    result.config    = RESULT_CONFIG(Game);
+    result.snakeSize = Game->snakeSize;
+    result.ticks     = (UINT) Ticks;
+    result.outcome   = (BYTE) Game->snakeState;
+    result.foodCount = FoodCount;
+    result.foodTicks = FoodTicks;
+
+    AddResult(Writer, &result);
+}
+
+static void CloseResults(RESULTS_WRITER* Writer, const char* File, UINT* Ticks)
+{
+    if (Ticks == NULL) return;
+
+    if (!CloseResultsWriter(Writer)) fprintf(stderr, "Can't write \"%s\"\n", File);
+
+    free(Ticks);
+}
+
+//Turns at random where it doesn't run into anything, when anywhere
+static void TurnRandomly(SNAKE_GAME* Game)
+{
+    SNAKE_DIRECTION directions[PLANNER_ACTIONS];
+    WORD            position;
+    UINT            action, count;
+
+    for (action = 0, count = 0; action < PLANNER_ACTIONS; action++)
+    {
+        directions[count] = (SNAKE_DIRECTION) ((Game->previousDirection + 1 - action) & 3);
+        position          = NewPosition(Game, Game->headPosition, 1, directions[count]);
+
+        if (IsInsideField(Game, position) && IS_BLOCK_AVAILABLE(GetFieldBlock(Game, position))) count++;
+    }
+
+    if (count > 0) ReceiveCommand(Game, directions[RandomBelow(Game, count)]);
+}
+
+//Random move that doesn't run into anything, when there is any
+static SNAKE_RESULT MoveRandomly(SNAKE_GAME* Game)
+{
+    TurnRandomly(Game);
+
+    return MoveSnake(Game);
+}
+
+static void* HeatmapWorker(void* Parameter)
+{
+    HEATMAP_WORKER* worker = (HEATMAP_WORKER*) Parameter;
+    SNAKE_GAME*     game   = &worker->game;
+    UINT            tick, i;
+
+    game->pHeatmap = worker->counting ? &worker->heatmap : NULL;
+    worker->ticks  = 0;
+
+    for (i = worker->first; i < worker->games && worker->result == SR_OK; i += worker->step)
+    {
+        SeedGame(game, worker->seed, i);
+
+        //Initialized by the first game and reset in place afterwards
+        if ((worker->result = ResetGame(game)) != SR_OK) break;
+
+        for (tick = 0; game->snakeState == RUNNING && tick < worker->maxTicks && worker->result == SR_OK; tick++)
+            worker->result = MoveRandomly(game);
+
+        worker->ticks += tick;
+    }
+
+    return NULL;
+}
+
+static void* ReplayWorker(void* Parameter)
+{
+    REPLAY_WORKER* worker = (REPLAY_WORKER*) Parameter;
+    SNAKE_GAME*    game   = &worker->game;
+    UINT           tick, i;
+
+    worker->ticks = 0;
+
+    for (i = worker->first; i < worker->games && worker->result == SR_OK; i += worker->step)
+    {
+        SeedGame(game, worker->seed, i);
+
+        if ((worker->result = ResetGame(game)) != SR_OK) break;
+
+        for (tick = 0; game->snakeState == RUNNING && tick < worker->maxTicks && worker->result == SR_OK; tick++)
+        {
+            TurnRandomly(game);
+            worker->result = RecordMove(worker->replay, game);
+        }
+
+        worker->ticks += tick;
+    }
+
+    return NULL;
+}
+
+static void TickTask(SCHEDULER* Scheduler, TASK* Task)
+{
+    TICK_TASK* tickTask = (TICK_TASK*) Task;
+    BYTE       command;
+
+    TASK_BEGIN(Task);
+
+    while (TRUE)
+    {
+        TASK_AWAIT(Scheduler, Task, tickTask->nextTick);
+
+        while (TakeCommand(Task, &command));
+
+        if (Scheduler->now < tickTask->nextTick) continue;
+
+        tickTask->ticks++;
+        tickTask->nextTick += tickTask->period;
+    }
+
+    TASK_END(Task);
+}
+
+//Plays the players of Count sessions, Stride bytes apart from Tasks on: the
+//clock moves a millisecond at a time for Seconds, and every millisecond takes
+//its share of Rate commands per session and second, a random direction to a
+//random session. Returns the seconds taken.
+static double DriveSessions(SCHEDULER* Scheduler, BYTE* Tasks, size_t Stride, UINT Count, double Rate, UINT Seconds,
+                            SNAKE_GAME* Dice, UINT64* Posted)
+{
+    double start = Now();
+    double due   = 0;
+    UINT64 ms;
+
+    for (ms = 1; ms <= Seconds * 1000ULL; ms++)
+    {
+        for (due += Count * Rate / 1000; due >= 1; due--)
+            *Posted += PostCommand(Scheduler, (TASK*) (Tasks + Stride * RandomBelow(Dice, Count)), (BYTE) RandomBelow(Dice, 4));
+
+        AdvanceScheduler(Scheduler, ms * 1000);
+    }
+
+    return Now() - start;
+}
+
+static void PrintUsage(void)
+{
+    fprintf(stderr,
+            "Usage: snakesim <command> [options]\n"
+            "\n"
+            "Commands taking -o results append every game they play to that\n"
+            "results file.\n"
+            "\n"
+            "  hamilton [-g games] [-s seed] [-n] [-o results] [WxH[w] ...]\n"
+            "      Plays to the end along a Hamiltonian cycle and reports the ticks\n"
+            "      needed to win. -n disables shortcuts, a trailing w removes walls.\n"
+            "\n"
+            "  mcts [-g games] [-s seed] [-t threads] [-b budget ms] [-m max ticks]\n"
+            "       [-o results] [-w broadcast] [WxH[w]]\n"
+            "      Plays with the tree search planner and reports scores and playouts\n"
+            "      per second. The budget defaults to most of a tick at SNAKE_SPEED.\n"
+            "      -w publishes every tick to a broadcast under that name.\n"
+            "\n"
+            "  hash [-g games] [-s seed] [-b table bits] [-m max ticks] [WxH[w]]\n"
+            "      Plays random games checking the incremental game hash against one\n"
+            "      computed from scratch on every tick, and counts the states seen\n"
+            "      before through a transposition table.\n"
+            "\n"
+            "  heatmap [-g games] [-s seed] [-t threads] [-m max ticks] [-o prefix]\n"
+            "          [WxH[w]]\n"
+            "      Plays random games on every processor counting head visits, deaths\n"
+            "      and food per block, and reports the cost of counting per tick. -o\n"
+            "      writes prefix-visits.bmp, prefix-deaths.bmp and prefix-food.bmp.\n"
+            "\n"
+            "  symmetry [-g games] [-s seed] [-b table bits] [-m max ticks] [WxH[w]]\n"
+            "      Plays random games and counts the distinct states with and without\n"
+            "      merging the rotations and mirrors of each other.\n"
+            "\n"
+            "  suspend [-g games] [-s seed] [WxH[w]]\n"
+            "      Grows a snake along a Hamiltonian cycle and, at several lengths,\n"
+            "      holds that many copies of the game as they are and suspended,\n"
+            "      reporting the bytes per game of each and the conversion times.\n"
+            "\n"
+            "  sessions [-g sessions] [-e seconds] [-c commands] [-s seed] [WxH[w]]\n"
+            "      Runs interactive games as coroutines on one thread, each moving on\n"
+            "      its own ticks and starting a game on a command after the last one\n"
+            "      ended, for -e seconds of a simulated clock with -c commands per\n"
+            "      session and second. Reports the memory per session and the cost\n"
+            "      per tick of the scheduler alone and with the games.\n"
+            "\n"
+            "  events [-g games] [-s seed] [-m max ticks] [WxH[w]]\n"
+            "      Plays random games keeping a copy of the field from the cell events\n"
+            "      of every move and again reading every block after every move, checks\n"
+            "      the copies and reports the cost of each per tick.\n"
+            "\n"
+            "  undo [-d depth] [-l length] [-s seed] [WxH[w]]\n"
+            "      Grows a snake along a Hamiltonian cycle to the length, then searches\n"
+            "      every line of moves to the depth, once copying the game at every\n"
+            "      node and once moving one game down and back up with DoMove and\n"
+            "      UndoMove, and compares the nodes per second of each.\n"
+            "\n"
+            "  replay [-g games] [-s seed] [-t threads] [-m max ticks] [-c capacity]\n"
+            "         [-b batch] [-o file] [WxH[w]]\n"
+            "      Records the moves of random games from every processor into a\n"
+            "      replay file, a temporary one unless -o names it, and reports the\n"
+            "      transitions appended and sampled per second, uniformly and by\n"
+            "      priority, as float planes in batches of -b.\n"
+            "\n"
+            "  random [-n draws] [-s seed]\n"
+            "      Times drawing food positions from the generator of a game against\n"
+            "      rand() %% n, reports how often each lands in the lower half of a\n"
+            "      range where the modulo is biased, and checks skipping ahead.\n"
+            "\n"
+            "  solve [-t threads] [-m memory MB] [-d spill file] [WxH[w] ...]\n"
+            "      Finds the exact probability of winning on small fields under optimal\n"
+            "      play, over every placement of the food, and the states solved per\n"
+            "      second. The memo table spills to disk once it outgrows the memory.\n"
+            "\n"
+            "  watch [-q] [-e seconds] [broadcast]\n"
+            "      Follows a broadcast, the window game by default, printing the field\n"
+            "      on every tick. -q prints only the totals, and it stops once nothing\n"
+            "      is published for -e seconds.\n"
+            "\n"
+            "  policy [-l weights] [-o weights] [-n layers] [-c channels] [-g games]\n"
+            "         [-b batch] [-m max ticks] [-s seed] [WxH[w]]\n"
+            "      Plays with the int8 convolutional policy loaded from -l, or a\n"
+            "      random one of -n layers of -c channels, and reports the latency of\n"
+            "      every decision against a tick and the time per batch of -b games.\n"
+            "      -o writes the weights.\n"
+            "\n"
+            "  outcome [-g games] [-s seed] [-p random|hamilton] [-k interval]\n"
+            "          [-r region] [-n min snake] [-m max ticks] [WxH[w]]\n"
+            "      Plays games to the end asking the outcome detector whether they are\n"
+            "      already lost or won, -k ticks and a tick per block of snake apart,\n"
+            "      checks every answer against the end of the game, and reports the\n"
+            "      time stopping at the first answer saves, net of the checks. -r\n"
+            "      leaves regions of that many blocks undecided, and -n snakes shorter\n"
+            "      than that.\n"
+            "\n"
+            "  bot [-g games] [-n slots] [-k ticks] [-m max ticks] [-s seed] [-x]\n"
+            "      [WxH[w]]\n"
+            "      Plays games for a bot on the other end of stdin and stdout, writing\n"
+            "      the blocks that changed and reading a direction byte per tick. -n\n"
+            "      games are played at once and -k ticks answered per frame, -x speaks\n"
+            "      text instead. Reports the time the bot took per tick to stderr.\n"
+            "\n"
+#ifndef _WIN32
+            "  selfplay [-g games] [-s seed] [-p random|hamilton] [-m max ticks]\n"
+            "           [-k shard games] [-w workers] [-t threads] [-x crash after]\n"
+            "           [-e timeout] [-a address] [-o results] [WxH[w]]\n"
+            "      Coordinates self-play over sockets, handing shards of -k games to\n"
+            "      the workers that connect to -a, \"unix:path\" or \"host:port\", and\n"
+            "      to -w local worker processes of -t threads each. The first local\n"
+            "      worker leaves in the middle of a shard after -x shards, and a worker\n"
+            "      that finishes no game for -e seconds is dropped. Prints a checksum\n"
+            "      of the results, which only depends on the games, seed and player.\n"
+            "\n"
+            "  worker [-t threads] address\n"
+            "      Plays the shards of the coordinator at the address until told to\n"
+            "      leave.\n"
+            "\n"
+#endif
+            "  results <file>\n"
+            "      Reports aggregates of the games in a results file.\n"
+            "\n"
+            "  evolve [-p population] [-n generations] [-g games] [-s seed] [-t threads]\n"
+            "         [-c checkpoint] [-r] [WxH[w]]\n"
+            "      Evolves neural network controllers and prints the best and mean\n"
+            "      fitness of every generation. -r resumes from the checkpoint, which is\n"
+            "      written after every generation.\n");
+}
+
+
+//*****************************************************************************
+//
+//                              COMMANDS
+//
+//*****************************************************************************
+
+static int RunHamilton(int argc, char** argv)
+{
+    const char**    sizes     = hamiltonSizes;
+    UINT            games     = DEFAULT_GAMES;
+    UINT            seed      = DEFAULT_SEED;
+    BOOL            shortcuts = TRUE;
+    const char*     output    = NULL;
+    SNAKE_GAME      game;
+    HAMILTON_SOLVER solver;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+    RESULTS_WRITER  writer;
+    UINT*           foodTicks;
+    UINT64          ticks, totalTicks, minTicks, maxTicks;
+    UINT            won, food, size, i;
+    double          start, elapsed;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-n"))                   shortcuts = FALSE;
+        else if (!strcmp(argv[arg], "-g") && arg + 1 < argc) games     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed      = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) output    = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    //argv is terminated by a NULL pointer, just like the default list
+    if (arg < argc) sizes = (const char**) argv + arg;
+
+    if (!OpenResults(&writer, output, &foodTicks)) return 1;
+
+    printf("%-10s %6s %6s %12s %12s %12s %10s %10s\n",
+           "field", "games", "won", "mean ticks", "min ticks", "max ticks", "per block", "Mticks/s");
+
+    for (; *sizes; sizes++)
+    {
+        if (!ParseField(*sizes, &game))
+        {
+            fprintf(stderr, "Bad field \"%s\"\n", *sizes);
+            return 1;
+        }
+
+        totalTicks = 0;
+        minTicks   = (UINT64) -1;
+        maxTicks   = 0;
+        won        = 0;
+        start      = Now();
+
+        for (i = 0; i < games; i++)
+        {
+            SeedGame(&game, seed, i);
+
+            if ((result = Initialize(&game, FALSE)) != SR_OK ||
+                (result = CreateHamiltonSolver(&solver, &game, shortcuts)) != SR_OK)
+            {
+                printf("%-10s %s\n", *sizes, ResultToString(result));
+                EndingCleanUp(&game);
+                break;
+            }
+
+            for (ticks = 0, food = 0; game.snakeState == RUNNING; ticks++)
+            {
+                direction = HamiltonDirection(&solver, &game);
+
+                if (direction != game.previousDirection) ReceiveCommand(&game, direction);
+
+                size = game.snakeSize;
+                if (MoveSnake(&game) != SR_OK) break;
+
+                if (foodTicks && game.snakeSize > size) foodTicks[food++] = (UINT) ticks + 1;
+            }
+
+            if (game.snakeState == WON) won++;
+
+            AddGame(&writer, &game, GAME_SEED(seed, i), ticks, foodTicks, food);
+
+            totalTicks += ticks;
+            if (ticks < minTicks) minTicks = ticks;
+            if (ticks > maxTicks) maxTicks = ticks;
+
+            DestroyHamiltonSolver(&solver);
+            EndingCleanUp(&game);
+        }
+
+        if (i < games) continue;
+
+        elapsed = Now() - start;
+
+        printf("%-10s %6u %6u %12.0f %12llu %12llu %10.2f %10.2f\n", *sizes, games, won,
+               (double) totalTicks / games, (unsigned long long) minTicks, (unsigned long long) maxTicks,
+               (double) totalTicks / games / (game.fieldWidth * game.fieldHeight),
+               elapsed > 0.0 ? totalTicks / elapsed * 1e-6 : 0.0);
+
+        fflush(stdout);
+    }
+
+    CloseResults(&writer, output, foodTicks);
+    return 0;
+}
+
+
+static int RunPlanner(int argc, char** argv)
+{
+    const char*     field    = "21x15";
+    UINT            games    = DEFAULT_GAMES;
+    UINT            seed     = DEFAULT_SEED;
+    UINT            threads  = 0;
+    UINT            maxTicks = DEFAULT_MAX_TICKS;
+    double          budget   = 0.0;
+    const char*     output   = NULL;
+    const char*     name     = NULL;
+    SNAKE_GAME      game;
+    SNAKE_PLANNER   planner;
+    BROADCAST       broadcast;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+    RESULTS_WRITER  writer;
+    UINT*           foodTicks;
+    UINT64          ticks, totalTicks = 0, totalSize = 0;
+    UINT            won = 0, lost = 0, food, size, i;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads  = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-b") && arg + 1 < argc) budget   = atof(argv[++arg]) / 1000.0;
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) output   = argv[++arg];
+        else if (!strcmp(argv[arg], "-w") && arg + 1 < argc) name     = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    memset(&broadcast, 0, sizeof(BROADCAST));
+
+    if (name != NULL && (result = OpenBroadcast(&broadcast, name, 0, 0)) != SR_OK)
+    {
+        fprintf(stderr, "Can't broadcast to \"%s\"\n", name);
+        return 1;
+    }
+
+    if ((result = CreatePlanner(&planner, threads, 0)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        CloseBroadcast(&broadcast);
+        return 1;
+    }
+
+    if (!OpenResults(&writer, output, &foodTicks))
+    {
+        DestroyPlanner(&planner);
+        CloseBroadcast(&broadcast);
+        return 1;
+    }
+
+    printf("field %s, %u threads, %.1f ms per move\n", field, planner.threadCount,
+           (budget > 0.0 ? budget : PLANNER_BUDGET_SHARE / game.snakeSpeed) * 1000.0);
+
+    for (i = 0; i < games; i++)
+    {
+        SeedGame(&game, seed, i);
+
+        if ((result = Initialize(&game, FALSE)) != SR_OK)
+        {
+            fprintf(stderr, "%s\n", ResultToString(result));
+            break;
+        }
+
+        PublishGame(&broadcast, &game);
+
+        for (ticks = 0, food = 0; game.snakeState == RUNNING && ticks < maxTicks; ticks++)
+        {
+            if ((result = PlanMove(&planner, &game, budget, &direction)) != SR_OK) break;
+
+            if (direction != game.previousDirection) ReceiveCommand(&game, direction);
+
+            size = game.snakeSize;
+            if (MoveSnake(&game) != SR_OK) break;
+
+            PublishGame(&broadcast, &game);
+
+            if (foodTicks && game.snakeSize > size) foodTicks[food++] = (UINT) ticks + 1;
+        }
+
+        if (result != SR_OK)
+        {
+            fprintf(stderr, "%s\n", ResultToString(result));
+            EndingCleanUp(&game);
+            break;
+        }
+
+        AddGame(&writer, &game, GAME_SEED(seed, i), ticks, foodTicks, food);
+
+        printf("game %3u: %-7s size %5u after %6llu ticks\n", i + 1,
+               game.snakeState == WON ? "won" : game.snakeState == LOST ? "lost" : "stopped",
+               game.snakeSize, (unsigned long long) ticks);
+        fflush(stdout);
+
+        won        += game.snakeState == WON;
+        lost       += game.snakeState == LOST;
+        totalTicks += ticks;
+        totalSize  += game.snakeSize;
+
+        EndingCleanUp(&game);
+    }
+
+    if (i > 0)
+    {
+        printf("won %u, lost %u, mean size %.1f, mean ticks %.0f\n", won, lost,
+               (double) totalSize / i, (double) totalTicks / i);
+        printf("%.0f playouts/s, %.0f playouts per move, %.1f%% valued as a certain loss\n",
+               PlayoutRate(&planner), totalTicks ? (double) planner.totalPlayouts / totalTicks : 0.0,
+               planner.totalPlayouts ? 100.0 * planner.totalSettled / planner.totalPlayouts : 0.0);
+    }
+
+    CloseResults(&writer, output, foodTicks);
+    DestroyPlanner(&planner);
+    CloseBroadcast(&broadcast);
+    return 0;
+}
+
+
+static int RunHash(int argc, char** argv)
+{
+    const char*         field    = "21x15";
+    UINT                games    = DEFAULT_GAMES * 100;
+    UINT                seed     = DEFAULT_SEED;
+    UINT                bits     = 0;
+    UINT                maxTicks = DEFAULT_MAX_TICKS;
+    SNAKE_GAME          game;
+    TRANSPOSITION_TABLE table;
+    TABLE_DATA          data;
+    SNAKE_RESULT        result;
+    UINT64              hash, ticks = 0, mismatches = 0, repeated = 0;
+    UINT                tick, i;
+    int                 arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-b") && arg + 1 < argc) bits     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if ((result = CreateTable(&table, bits)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    for (i = 0; i < games; i++)
+    {
+        SeedGame(&game, seed, i);
+
+        if ((result = Initialize(&game, FALSE)) != SR_OK)
+        {
+            fprintf(stderr, "%s\n", ResultToString(result));
+            break;
+        }
+
+        for (tick = 0; game.snakeState == RUNNING && tick < maxTicks; tick++)
+        {
+            if (MoveRandomly(&game) != SR_OK) break;
+
+            hash        = GameHash(&game);
+            mismatches += hash != ComputeGameHash(&game);
+
+            if (ProbeTable(&table, hash, &data)) repeated++;
+            else StoreTable(&table, hash, 0.0f, 0, (BYTE) game.previousDirection);
+
+            ticks++;
+        }
+
+        EndingCleanUp(&game);
+    }
+
+    printf("%u games, %llu ticks: %llu mismatches, %llu states seen before (%.2f%%)\n", i,
+           (unsigned long long) ticks, (unsigned long long) mismatches, (unsigned long long) repeated,
+           ticks ? 100.0 * repeated / ticks : 0.0);
+
+    DestroyTable(&table);
+    return mismatches != 0;
+}
+
+
+static int RunHeatmap(int argc, char** argv)
+{
+    static const char* kindNames[HEATMAP_KINDS] = { "visits", "deaths", "food" };
+
+    const char*     field    = "21x15";
+    const char*     prefix   = NULL;
+    UINT            games    = DEFAULT_HEATMAP_GAMES;
+    UINT            seed     = DEFAULT_SEED;
+    UINT            threads  = 0;
+    UINT            maxTicks = DEFAULT_MAX_TICKS;
+    HEATMAP_WORKER* workers;
+    HEATMAP         total;
+    SNAKE_GAME      game;
+    SNAKE_RESULT    result = SR_OK;
+    pthread_t       handles[MAX_THREADS];
+    BOOL            started[MAX_THREADS];
+    double          best[2] = { 0.0, 0.0 }, start, elapsed, mergeTime;
+    UINT64          ticks[2] = { 0, 0 };
+    char            file[260];
+    UINT            pass, kind, i;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads  = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) prefix   = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || games == 0)
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if (threads == 0)           threads = ProcessorCount();
+    if (threads > MAX_THREADS)  threads = MAX_THREADS;
+
+    workers = (HEATMAP_WORKER*) calloc(threads, sizeof(HEATMAP_WORKER));
+
+    if (workers == NULL || CreateHeatmap(&total, game.fieldWidth, game.fieldHeight) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(SR_MEMORY_ERROR));
+        free(workers);
+        return 1;
+    }
+
+    for (i = 0; i < threads && result == SR_OK; i++)
+    {
+        workers[i].game     = game;
+        workers[i].first    = i;
+        workers[i].step     = threads;
+        workers[i].games    = games;
+        workers[i].seed     = seed;
+        workers[i].maxTicks = maxTicks;
+
+        result = CreateHeatmap(&workers[i].heatmap, game.fieldWidth, game.fieldHeight);
+    }
+
+    //The same games are played without counting and with it, twice each so
+    //that neither runs only cold, keeping the faster time of each
+    for (pass = 0; pass < 4 && result == SR_OK; pass++)
+    {
+        for (i = 0; i < threads; i++)
+        {
+            workers[i].counting = pass & 1;
+            ClearHeatmap(&workers[i].heatmap);
+        }
+
+        start = Now();
+
+        //The calling thread is the first worker
+        for (i = 1; i < threads; i++)
+            started[i] = pthread_create(handles + i, NULL, HeatmapWorker, workers + i) == 0;
+
+        HeatmapWorker(workers);
+
+        for (i = 1; i < threads; i++)
+        {
+            if (started[i]) pthread_join(handles[i], NULL);
+            else HeatmapWorker(workers + i);
+        }
+
+        elapsed = Now() - start;
+
+        for (i = 0, ticks[pass & 1] = 0; i < threads; i++)
+        {
+            ticks[pass & 1] += workers[i].ticks;
+            if (workers[i].result != SR_OK) result = workers[i].result;
+        }
+
+        if (pass < 2 || elapsed < best[pass & 1]) best[pass & 1] = elapsed;
+    }
+
+    if (result != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+    }
+    else
+    {
+        start = Now();
+        for (i = 0; i < threads; i++) MergeHeatmap(&total, &workers[i].heatmap);
+        mergeTime = Now() - start;
+
+        printf("%u games of %s, %llu ticks on %u threads\n", games, field, (unsigned long long) ticks[1], threads);
+        printf("%.1f ns per tick without counting, %.1f ns with, %+.1f%%; merged in %.1f us\n",
+               best[0] * 1e9 / ticks[0], best[1] * 1e9 / ticks[1], 100.0 * (best[1] / best[0] - 1.0), mergeTime * 1e6);
+
+        for (kind = 0; kind < HEATMAP_KINDS; kind++)
+        {
+            printf("%-8s %12llu", kindNames[kind], (unsigned long long) HeatmapTotal(&total, (HEATMAP_KIND) kind));
+
+            if (prefix != NULL)
+            {
+                snprintf(file, sizeof(file), "%s-%s.bmp", prefix, kindNames[kind]);
+                printf("  %s", WriteHeatmapImage(&total, (HEATMAP_KIND) kind, file) ? file : "can't be written");
+            }
+
+            printf("\n");
+        }
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        EndingCleanUp(&workers[i].game);
+        DestroyHeatmap(&workers[i].heatmap);
+    }
+
+    DestroyHeatmap(&total);
+    free(workers);
+
+    return result != SR_OK;
+}
+
+static int RunSymmetry(int argc, char** argv)
+{
+    const char*         field    = "12x12";
+    UINT                games    = DEFAULT_GAMES * 100;
+    UINT                seed     = DEFAULT_SEED;
+    UINT                bits     = 0;
+    UINT                maxTicks = DEFAULT_MAX_TICKS;
+    SNAKE_GAME          game;
+    CANONICAL_STATE     state;
+    TRANSPOSITION_TABLE tables[2];      //Raw and canonical states
+    TABLE_DATA          data;
+    SNAKE_RESULT        result;
+    UINT64              ticks = 0, distinct[2] = { 0, 0 };
+    double              start, elapsed = 0.0;
+    UINT                tick, i;
+    int                 arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-b") && arg + 1 < argc) bits     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if ((result = CreateTable(tables, bits)) != SR_OK || (result = CreateTable(tables + 1, bits)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        DestroyTable(tables);
+        return 1;
+    }
+
+    for (i = 0; i < games; i++)
+    {
+        SeedGame(&game, seed, i);
+
+        if ((result = Initialize(&game, FALSE)) != SR_OK)
+        {
+            fprintf(stderr, "%s\n", ResultToString(result));
+            break;
+        }
+
+        for (tick = 0; game.snakeState == RUNNING && tick < maxTicks; tick++)
+        {
+            if (MoveRandomly(&game) != SR_OK) break;
+
+            start = Now();
+            CanonicalizeGame(&game, &state);
+            elapsed += Now() - start;
+
+            if (!ProbeTable(tables, GameHash(&game), &data))
+            {
+                StoreTable(tables, GameHash(&game), 0.0f, 0, (BYTE) game.previousDirection);
+                distinct[0]++;
+            }
+
+            if (!ProbeTable(tables + 1, state.hash, &data))
+            {
+                StoreTable(tables + 1, state.hash, 0.0f, 0, (BYTE) state.symmetry);
+                distinct[1]++;
+            }
+
+            ticks++;
+        }
+
+        EndingCleanUp(&game);
+    }
+
+    printf("%u games, %llu ticks: %llu distinct states, %llu distinct up to symmetry (%.2fx fewer)\n"
+           "%.0f ns per canonical state\n", i, (unsigned long long) ticks,
+           (unsigned long long) distinct[0], (unsigned long long) distinct[1],
+           distinct[1] ? (double) distinct[0] / distinct[1] : 0.0, ticks ? elapsed * 1e9 / ticks : 0.0);
+
+    DestroyTable(tables);
+    DestroyTable(tables + 1);
+    return 0;
+}
+
+
+//Holds Count copies of the game, first as they are and then suspended, and
+//prints what each form takes per game and how long converting between them took
+static BOOL MeasureSuspended(SNAKE_GAME* Game, UINT Count)
+{
+    SNAKE_GAME*   games;
+    GLOBALHANDLE* suspended = NULL;
+    SNAKE_RESULT  result    = SR_OK;
+    UINT64        hash      = GameHash(Game);
+    size_t        heap      = HeapInUse(), gameBytes, suspendedBytes;
+    double        start, suspendTime, restoreTime;
+    UINT          mismatches = 0, i;
+
+    games = (SNAKE_GAME*) calloc(Count, sizeof(SNAKE_GAME));
+
+    for (i = 0; i < Count && games && result == SR_OK; i++) result = CopyGame(games + i, Game);
+
+    gameBytes = HeapInUse() - heap;
+    suspended = games ? (GLOBALHANDLE*) calloc(Count, sizeof(GLOBALHANDLE)) : NULL;
+    start     = Now();
+
+    for (i = 0; i < Count && suspended && result == SR_OK; i++) result = SuspendGame(games + i, suspended + i);
+
+    suspendTime = Now() - start;
+
+    //Games that weren't suspended are dropped with the array
+    for (i = 0; i < Count && games; i++) EndingCleanUp(games + i);
+
+    free(games);
+    suspendedBytes = HeapInUse() - heap;
+    games          = suspended ? (SNAKE_GAME*) calloc(Count, sizeof(SNAKE_GAME)) : NULL;
+    start          = Now();
+
+    for (i = 0; i < Count && games && result == SR_OK; i++)
+        if ((result = RestoreGame(games + i, suspended[i])) == SR_OK) suspended[i] = NULL;
+
+    restoreTime = Now() - start;
+
+    for (i = 0; i < Count && suspended; i++)
+    {
+        if (suspended[i] != NULL) GlobalFree(suspended[i]);
+        else if (games != NULL)
+        {
+            mismatches += GameHash(games + i) != hash || ComputeGameHash(games + i) != hash;
+            EndingCleanUp(games + i);
+        }
+    }
+
+    if (games == NULL) result = SR_MEMORY_ERROR;
+
+    free(games);
+    free(suspended);
+
+    if (result != SR_OK || mismatches)
+    {
+        fprintf(stderr, "%s\n", result != SR_OK ? ResultToString(result) : "Restored games differ");
+        return FALSE;
+    }
+
+    //Without the allocator's own figure, count the bytes asked for
+    if (heap == 0)
+    {
+        gameBytes      = Count * (sizeof(SNAKE_GAME) + FIELD_BUFFER_SIZE(Game) + Game->snakeSize * sizeof(SNAKE_ELEMENT));
+        suspendedBytes = Count * (sizeof(GLOBALHANDLE) + SuspendedSize(Game));
+    }
+
+    printf("%8u %12.1f %12.1f %8.1f %12.0f %12.0f\n", Game->snakeSize,
+           (double) gameBytes / Count, (double) suspendedBytes / Count, (double) gameBytes / suspendedBytes,
+           suspendTime * 1e9 / Count, restoreTime * 1e9 / Count);
+
+    return TRUE;
+}
+
+static int RunSuspend(int argc, char** argv)
+{
+    const char*     field = "32x32";
+    UINT            count = DEFAULT_SUSPENDED;
+    UINT            seed  = DEFAULT_SEED;
+    SNAKE_GAME      game;
+    HAMILTON_SOLVER solver;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+    const UINT*     length = suspendLengths;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) count = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed  = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || count == 0)
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    SeedGame(&game, seed, 0);
+
+    if ((result = Initialize(&game, FALSE)) != SR_OK || (result = CreateHamiltonSolver(&solver, &game, TRUE)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        EndingCleanUp(&game);
+        return 1;
+    }
+
+    printf("%8s %12s %12s %8s %12s %12s\n", "length", "bytes", "suspended", "ratio", "suspend ns", "restore ns");
+
+    //Grows the snake along the cycle, measuring as it reaches each length
+    while (*length && *length <= game.fieldWidth * game.fieldHeight)
+    {
+        if (game.snakeSize >= *length || game.snakeState != RUNNING)
+        {
+            if (!MeasureSuspended(&game, count)) break;
+
+            length++;
+            continue;
+        }
+
+        direction = HamiltonDirection(&solver, &game);
+
+        if (direction != game.previousDirection) ReceiveCommand(&game, direction);
+        if (MoveSnake(&game) != SR_OK) break;
+    }
+
+    DestroyHamiltonSolver(&solver);
+    EndingCleanUp(&game);
+    return *length && *length <= game.fieldWidth * game.fieldHeight;
+}
+
+
+static int RunSessions(int argc, char** argv)
+{
+    const char*    field   = "20x15";
+    UINT           count   = DEFAULT_SESSIONS;
+    UINT           seconds = DEFAULT_SESSION_SECONDS;
+    UINT           seed    = DEFAULT_SEED;
+    double         rate    = DEFAULT_SESSION_COMMANDS;
+    SNAKE_GAME     game, dice;
+    SCHEDULER      scheduler;
+    TICK_TASK*     tickTasks;
+    GAME_TASK*     gameTasks = NULL;
+    SNAKE_RESULT   result    = SR_OK;
+    pthread_attr_t attributes;
+    size_t         stack     = 0, heap, bytes;
+    double         alone, played;
+    UINT64         aloneTicks = 0, ticks = 0, posted = 0, games = 0, sizes = 0;
+    UINT           running = 0, i;
+    int            arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) count   = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-e") && arg + 1 < argc) seconds = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) rate    = atof(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed    = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || count == 0)
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    memset(&dice, 0, sizeof(SNAKE_GAME));
+    SeedGame(&dice, seed, count);
+
+    //The scheduler alone, every session ticking from a phase of its own
+    tickTasks = (TICK_TASK*) calloc(count, sizeof(TICK_TASK));
+
+    if (tickTasks == NULL)
+    {
+        fprintf(stderr, "%s\n", ResultToString(SR_MEMORY_ERROR));
+        return 1;
+    }
+
+    InitializeScheduler(&scheduler, 0);
+
+    for (i = 0; i < count; i++)
+    {
+        tickTasks[i].period   = 1000000 / game.snakeSpeed;
+        tickTasks[i].nextTick = tickTasks[i].period * i / count + 1;
+        StartTask(&scheduler, &tickTasks[i].task, TickTask);
+    }
+
+    alone = DriveSessions(&scheduler, (BYTE*) tickTasks, sizeof(TICK_TASK), count, rate, seconds, &dice, &posted);
+
+    for (i = 0; i < count; i++) aloneTicks += tickTasks[i].ticks;
+
+    free(tickTasks);
+
+    //The same with games, idle until a player gives them a command
+    SeedGame(&dice, seed, count);
+    InitializeScheduler(&scheduler, 0);
+
+    heap      = HeapInUse();
+    gameTasks = (GAME_TASK*) calloc(count, sizeof(GAME_TASK));
+
+    for (i = 0; i < count && gameTasks; i++)
+    {
+        gameTasks[i].game = game;
+        SeedGame(&gameTasks[i].game, seed, i);
+        StartGameTask(&scheduler, gameTasks + i);
+    }
+
+    posted = 0;
+    played = gameTasks ? DriveSessions(&scheduler, (BYTE*) gameTasks, sizeof(GAME_TASK), count, rate, seconds, &dice, &posted) : 0;
+    bytes  = HeapInUse() - heap;
+
+    for (i = 0; i < count && gameTasks; i++)
+    {
+        if (gameTasks[i].result != SR_OK) result = gameTasks[i].result;
+
+        ticks   += gameTasks[i].ticks;
+        games   += gameTasks[i].played;
+        running += gameTasks[i].game.snakeState == RUNNING;
+        sizes   += gameTasks[i].game.snakeSize;
+    }
+
+    //Without the allocator's own figure, count the bytes asked for
+    if (heap == 0)
+        bytes = count * (sizeof(GAME_TASK) + FIELD_BUFFER_SIZE(&game)) + sizes * sizeof(SNAKE_ELEMENT);
+
+    for (i = 0; i < count && gameTasks; i++)
+    {
+        CancelTask(&scheduler, &gameTasks[i].task);
+        EndingCleanUp(&gameTasks[i].game);
+    }
+
+    free(gameTasks);
+
+    if (gameTasks == NULL) result = SR_MEMORY_ERROR;
+
+    if (result != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    if (pthread_attr_init(&attributes) == 0)
+    {
+        pthread_attr_getstacksize(&attributes, &stack);
+        pthread_attr_destroy(&attributes);
+    }
+
+    printf("%u sessions on %s for %u s, %.1f commands per session and second, %llu posted\n",
+           count, field, seconds, rate, (unsigned long long) posted);
+    printf("%-16s %12s %12s %12s\n", "", "ticks", "ticks/s", "ns/tick");
+    printf("%-16s %12llu %12.0f %12.1f\n", "scheduler alone", (unsigned long long) aloneTicks,
+           aloneTicks / alone, aloneTicks ? alone * 1e9 / aloneTicks : 0);
+    printf("%-16s %12llu %12.0f %12.1f\n", "with games", (unsigned long long) ticks,
+           ticks / played, ticks ? played * 1e9 / ticks : 0);
+    printf("%llu games started, %u running at the end, %llu tasks moved down the wheel\n",
+           (unsigned long long) games, running, (unsigned long long) scheduler.cascaded);
+    printf("%.1f bytes per session, %u of them the task and its game, where a thread per game reserves %llu bytes of stack\n",
+           (double) bytes / count, (UINT) sizeof(GAME_TASK), (unsigned long long) stack);
+
+    return 0;
+}
+
+
+//Searches every line of Depth moves from the game, taking each move back once
+//its line is searched, and adds up the hashes of every node
+static UINT64 SearchUndoing(SNAKE_GAME* Game, UINT Depth, UINT64* Nodes)
+{
+    MOVE_DELTA delta;
+    UINT64     sum = GameHash(Game);
+    UINT       direction;
+
+    (*Nodes)++;
+
+    if (Depth == 0 || Game->snakeState != RUNNING) return sum;
+
+    for (direction = RIGHT; direction <= DOWN; direction++)
+    {
+        if (direction == OPPOSITE_DIRECTION(Game->previousDirection)) continue;
+        if (DoMove(Game, (SNAKE_DIRECTION) direction, &delta) != SR_OK) break;
+
+        sum += SearchUndoing(Game, Depth - 1, Nodes);
+        UndoMove(Game, &delta);
+    }
+
+    return sum;
+}
+
+//The same search moving a copy of the node for every child, Games[1] onwards
+//holding the copies of each depth
+static UINT64 SearchCopying(SNAKE_GAME* Games, UINT Depth, UINT64* Nodes)
+{
+    UINT64 sum = GameHash(Games);
+    UINT   direction;
+
+    (*Nodes)++;
+
+    if (Depth == 0 || Games->snakeState != RUNNING) return sum;
+
+    for (direction = RIGHT; direction <= DOWN; direction++)
+    {
+        if (direction == OPPOSITE_DIRECTION(Games->previousDirection)) continue;
+        if (CopyGame(Games + 1, Games) != SR_OK) break;
+
+        if (direction != Games->previousDirection) ReceiveCommand(Games + 1, (SNAKE_DIRECTION) direction);
+        if (MoveSnake(Games + 1) != SR_OK) break;
+
+        sum += SearchCopying(Games + 1, Depth - 1, Nodes);
+    }
+
+    return sum;
+}
+
+//Plays the same random games whatever the mode, keeping Plane, a byte per
+//block, in step with the field as the mode says, and returns the seconds taken
+static double FollowGames(SNAKE_GAME* Game, UINT Mode, UINT Games, UINT Seed, UINT MaxTicks, BYTE* Plane,
+                          UINT64* Ticks, UINT64* Events, UINT64* Mismatches)
+{
+    static BYTE check[127 * 127];
+
+    CELL_EVENTS events;
+    double      start = Now();
+    UINT        tick, i, x, y, e;
+
+    memset(&events, 0, sizeof(CELL_EVENTS));
+
+    Game->pEvents = Mode == FOLLOW_EVENTS ? &events : NULL;
+
+    for (i = 0; i < Games; i++)
+    {
+        SeedGame(Game, Seed, i);
+
+        if (Initialize(Game, FALSE) != SR_OK) break;
+
+        WriteObservation(Game, Plane);
+
+        for (tick = 0; Game->snakeState == RUNNING && tick < MaxTicks; tick++)
+        {
+            if (MoveRandomly(Game) != SR_OK) break;
+
+            if (Mode == FOLLOW_EVENTS)
+            {
+                if (events.overflow) WriteObservation(Game, Plane);
+                else for (e = 0; e < events.count; e++)
+                    Plane[BLOCK_BUFFER_POSITION(Game, events.events[e].blockPosition)] = events.events[e].newState;
+
+                *Events += events.count;
+            }
+            else if (Mode == FOLLOW_RESCAN)
+            {
+                for (y = 0; y < Game->fieldHeight; y++)
+                    for (x = 0; x < Game->fieldWidth; x++)
+                        Plane[y * Game->fieldWidth + x] = (BYTE) GetFieldBlock(Game, BLOCK_POSITION(x, y));
+            }
+        }
+
+        if (Mode != FOLLOW_NONE)
+        {
+            WriteObservation(Game, check);
+            *Mismatches += memcmp(check, Plane, Game->fieldWidth * Game->fieldHeight) != 0;
+        }
+
+        *Ticks += tick;
+        EndingCleanUp(Game);
+    }
+
+    Game->pEvents = NULL;
+    return Now() - start;
+}
+
+static int RunEvents(int argc, char** argv)
+{
+    static const char* modeNames[] = { "none", "events", "rescan" };
+
+    const char* field    = "21x15";
+    UINT        games    = DEFAULT_GAMES * 1000;
+    UINT        seed     = DEFAULT_SEED;
+    UINT        maxTicks = DEFAULT_MAX_TICKS;
+    SNAKE_GAME  game;
+    BYTE        plane[127 * 127];
+    UINT64      ticks = 0, events = 0, mismatches = 0;
+    double      seconds, baseline = 0.0;
+    UINT        mode;
+    int         arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    //Warms the caches and the allocator up before the first measured mode
+    FollowGames(&game, FOLLOW_NONE, games, seed, maxTicks, plane, &ticks, &events, &mismatches);
+
+    printf("%-8s %12s %10s %10s %14s\n", "follow", "ticks", "ns/tick", "extra ns", "events/tick");
+
+    for (mode = FOLLOW_NONE; mode <= FOLLOW_RESCAN; mode++)
+    {
+        ticks   = 0;
+        events  = 0;
+        seconds = FollowGames(&game, mode, games, seed, maxTicks, plane, &ticks, &events, &mismatches);
+
+        if (mode == FOLLOW_NONE) baseline = seconds;
+
+        printf("%-8s %12llu %10.1f %10.1f %14.2f\n", modeNames[mode], (unsigned long long) ticks,
+               ticks ? seconds * 1e9 / ticks : 0.0, ticks ? (seconds - baseline) * 1e9 / ticks : 0.0,
+               ticks ? (double) events / ticks : 0.0);
+    }
+
+    if (mismatches) fprintf(stderr, "%llu games ended with a copy unlike the field\n", (unsigned long long) mismatches);
+
+    return mismatches != 0;
+}
+
+static int RunUndo(int argc, char** argv)
+{
+    const char*     field  = "32x32";
+    UINT            depth  = DEFAULT_SEARCH_DEPTH;
+    UINT            length = DEFAULT_SEARCH_LENGTH;
+    UINT            seed   = DEFAULT_SEED;
+    SNAKE_GAME*     games;
+    HAMILTON_SOLVER solver;
+    SNAKE_DIRECTION direction;
+    SNAKE_RESULT    result;
+    UINT64          copyNodes = 0, undoNodes = 0, copySum, undoSum, hash;
+    double          start, copyTime, undoTime;
+    UINT            i;
+    BOOL            same;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-d") && arg + 1 < argc) depth  = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-l") && arg + 1 < argc) length = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed   = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    games = (SNAKE_GAME*) calloc(depth + 1, sizeof(SNAKE_GAME));
+
+    if (games == NULL || !ParseField(field, games))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        free(games);
+        return 1;
+    }
+
+    SeedGame(games, seed, 0);
+
+    if ((result = Initialize(games, FALSE)) != SR_OK || (result = CreateHamiltonSolver(&solver, games, TRUE)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        EndingCleanUp(games);
+        free(games);
+        return 1;
+    }
+
+    while (games->snakeSize < length && games->snakeState == RUNNING && result == SR_OK)
+    {
+        direction = HamiltonDirection(&solver, games);
+
+        if (direction != games->previousDirection) ReceiveCommand(games, direction);
+
+        result = MoveSnake(games);
+    }
+
+    DestroyHamiltonSolver(&solver);
+
+    games->snakeState = RUNNING;
+    hash              = GameHash(games);
+
+    start    = Now();
+    copySum  = SearchCopying(games, depth, &copyNodes);
+    copyTime = Now() - start;
+
+    start    = Now();
+    undoSum  = SearchUndoing(games, depth, &undoNodes);
+    undoTime = Now() - start;
+
+    printf("Snake of %u blocks, %u moves deep\n", games->snakeSize, depth);
+    printf("%-8s %12s %14s %10s\n", "search", "nodes", "nodes/s", "seconds");
+    printf("%-8s %12llu %14.0f %10.3f\n", "copy", (unsigned long long) copyNodes, copyNodes / copyTime, copyTime);
+    printf("%-8s %12llu %14.0f %10.3f\n", "undo", (unsigned long long) undoNodes, undoNodes / undoTime, undoTime);
+    printf("Undoing is %.1fx as fast\n", (undoNodes / undoTime) / (copyNodes / copyTime));
+
+    //Both searches must see the same nodes and leave the game as it started
+    same = copySum == undoSum && copyNodes == undoNodes && GameHash(games) == hash &&
+           GameHash(games) == ComputeGameHash(games);
+
+    if (!same) fprintf(stderr, "The searches differ\n");
+
+    for (i = 0; i <= depth; i++) EndingCleanUp(games + i);
+
+    free(games);
+    return !same;
+}
+
+
+static int RunReplay(int argc, char** argv)
+{
+    const char*    field    = "21x15";
+    const char*    file     = NULL;
+    UINT           games    = DEFAULT_REPLAY_GAMES;
+    UINT           seed     = DEFAULT_SEED;
+    UINT           threads  = 0;
+    UINT           maxTicks = DEFAULT_MAX_TICKS;
+    UINT           count    = DEFAULT_REPLAY_BATCH;
+    UINT64         capacity = REPLAY_CAPACITY;
+    UINT64         ticks    = 0, sampled;
+    REPLAY_WORKER* workers;
+    REPLAY_BATCH   batch;
+    REPLAY         replay;
+    SNAKE_GAME     game;
+    SNAKE_RESULT   result;
+    pthread_t      handles[MAX_THREADS];
+    BOOL           started[MAX_THREADS];
+    float*         priorities;
+    size_t         planeFloats;
+    double         start, appending, uniform, prioritized;
+    UINT           blocks, n, i;
+    int            arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads  = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) capacity = (UINT64) atoll(argv[++arg]);
+        else if (!strcmp(argv[arg], "-b") && arg + 1 < argc) count    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) file     = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || count == 0)
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if (threads == 0)           threads = ProcessorCount();
+    if (threads > MAX_THREADS)  threads = MAX_THREADS;
+
+    if ((result = OpenReplay(&replay, file ? file : "snakesim-replay.tmp", capacity, game.fieldWidth,
+                             game.fieldHeight, game.passThroughWalls)) != SR_OK)
+    {
+        fprintf(stderr, "Can't open \"%s\": %s\n", file ? file : "snakesim-replay.tmp", ResultToString(result));
+        return 1;
+    }
+
+    blocks      = game.fieldWidth * game.fieldHeight;
+    planeFloats = (size_t) count * PLANE_COUNT * blocks;
+    workers     = (REPLAY_WORKER*) calloc(threads, sizeof(REPLAY_WORKER));
+    priorities  = (float*) malloc(count * sizeof(float));
+
+    memset(&batch, 0, sizeof(batch));
+    batch.type       = PLANE_FLOAT;
+    batch.states     = malloc(planeFloats * sizeof(float));
+    batch.nextStates = malloc(planeFloats * sizeof(float));
+    batch.actions    = (BYTE*) malloc(count);
+    batch.rewards    = (float*) malloc(count * sizeof(float));
+    batch.terminals  = (BYTE*) malloc(count);
+    batch.indices    = (UINT64*) malloc(count * sizeof(UINT64));
+    batch.weights    = (float*) malloc(count * sizeof(float));
+
+    result = workers && priorities && batch.states && batch.nextStates && batch.actions && batch.rewards &&
+             batch.terminals && batch.indices && batch.weights ? SR_OK : SR_MEMORY_ERROR;
+
+    for (i = 0; i < threads && result == SR_OK; i++)
+    {
+        workers[i].replay   = &replay;
+        workers[i].game     = game;
+        workers[i].first    = i;
+        workers[i].step     = threads;
+        workers[i].games    = games;
+        workers[i].seed     = seed;
+        workers[i].maxTicks = maxTicks;
+    }
+
+    if (result == SR_OK)
+    {
+        start = Now();
+
+        //The calling thread is the first worker, every one appending to the
+        //same replay
+        for (i = 1; i < threads; i++)
+            started[i] = pthread_create(handles + i, NULL, ReplayWorker, workers + i) == 0;
+
+        ReplayWorker(workers);
+
+        for (i = 1; i < threads; i++)
+        {
+            if (started[i]) pthread_join(handles[i], NULL);
+            else ReplayWorker(workers + i);
+        }
+
+        appending = Now() - start;
+
+        for (i = 0; i < threads; i++)
+        {
+            ticks += workers[i].ticks;
+            if (workers[i].result != SR_OK) result = workers[i].result;
+        }
+    }
+
+    if (result == SR_OK)
+    {
+        SeedReplay(&replay, seed);
+
+        start = Now();
+        for (i = 0, sampled = 0; i < REPLAY_BATCHES; i++) sampled += SampleReplay(&replay, &batch, count);
+        uniform = Now() - start;
+
+        //Rewards stand in for the errors a learner would set the priorities from
+        result = EnablePriorities(&replay, 0.6);
+        start  = Now();
+
+        for (i = 0; i < REPLAY_BATCHES && result == SR_OK; i++)
+        {
+            n = SamplePrioritized(&replay, &batch, count, 0.4);
+
+            for (sampled += n; n > 0; n--) priorities[n - 1] = 0.1f + (batch.rewards[n - 1] < 0.0f ? 1.0f : batch.rewards[n - 1]);
+
+            SetPriorities(&replay, batch.indices, priorities, count);
+        }
+
+        prioritized = Now() - start;
+    }
+
+    if (result != SR_OK) fprintf(stderr, "%s\n", ResultToString(result));
+    else
+    {
+        printf("%u games of %s on %u threads: %llu transitions appended, %.2f M per second\n", games, field, threads,
+               (unsigned long long) ticks, ticks / appending / 1e6);
+        printf("%llu kept of %llu, %u bytes each against %u as float planes\n",
+               (unsigned long long) ReplaySize(&replay), (unsigned long long) replay.pHeader->capacity,
+               replay.pHeader->recordBytes, (UINT) (2 * PLANE_COUNT * blocks * sizeof(float) + 6));
+        printf("%.2f M samples per second uniformly, %.2f M by priority, batches of %u\n",
+               count * (double) REPLAY_BATCHES / uniform / 1e6, count * (double) REPLAY_BATCHES / prioritized / 1e6,
+               count);
+    }
+
+    CloseReplay(&replay);
+
+    if (file == NULL) remove("snakesim-replay.tmp");
+
+    for (i = 0; workers && i < threads; i++) EndingCleanUp(&workers[i].game);
+
+    free(workers);
+    free(priorities);
+    free(batch.states);
+    free(batch.nextStates);
+    free(batch.actions);
+    free(batch.rewards);
+    free(batch.terminals);
+    free(batch.indices);
+    free(batch.weights);
+
+    return result != SR_OK;
+}
+
+static int RunRandom(int argc, char** argv)
+{
+    UINT64     draws = DEFAULT_DRAWS;
+    UINT       seed  = DEFAULT_SEED;
+    SNAKE_GAME game, stepped;
+    UINT64     low, sum, i;
+    double     start, elapsed;
+    int        arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-n") && arg + 1 < argc) draws = (UINT64) atof(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed  = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (draws == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    memset(&game, 0, sizeof(game));
+    printf("%-14s %10s %10s\n", "generator", "ns/draw", "low half");
+
+    //The sums keep the draws from being optimized away
+    srand(seed);
+    start = Now();
+    for (i = 0, low = 0, sum = 0; i < draws; i++) sum += (UINT) rand() % ((i & 0xFF) | 0x100);
+    elapsed = Now() - start;
+    for (i = 0; i < draws; i++) low += (UINT) rand() % BIASED_BOUND < BIASED_BOUND / 2;
+
+    printf("%-14s %10.2f %10.4f\n", "rand() % n", elapsed * 1e9 / draws, (double) low / draws);
+
+    SeedGame(&game, seed, 0);
+    start = Now();
+    for (i = 0, low = 0; i < draws; i++) sum += RandomBelow(&game, (UINT) ((i & 0xFF) | 0x100));
+    elapsed = Now() - start;
+    for (i = 0; i < draws; i++) low += RandomBelow(&game, BIASED_BOUND) < BIASED_BOUND / 2;
+
+    printf("%-14s %10.2f %10.4f\n", "RandomBelow", elapsed * 1e9 / draws, (double) low / draws);
+
+    //Draws below a power of two never draw again, so each is one step
+    SeedGame(&game, seed, 1);
+    stepped = game;
+
+    start = Now();
+    SkipRandom(&game, draws);
+    elapsed = Now() - start;
+
+    for (i = 0; i < draws; i++) sum += RandomBelow(&stepped, 1U << 31);
+
+    printf("skipping %llu draws took %.2f us and %s stepping (%llu)\n", (unsigned long long) draws, elapsed * 1e6,
+           game.randomState == stepped.randomState ? "matches" : "DOES NOT MATCH", (unsigned long long) (sum & 0xFF));
+
+    return game.randomState != stepped.randomState;
+}
+
+static int RunSolver(int argc, char** argv)
+{
+    static const char* defaultSizes[] = { "5x2", "5x3", "5x3w", "6x3", "5x4", NULL };
+
+    const char**    sizes   = defaultSizes;
+    const char*     spill   = NULL;
+    UINT            threads = 0;
+    UINT64          memory  = DEFAULT_SOLVER_MB;
+    SNAKE_GAME      game;
+    SNAKE_SOLVER    solver;
+    SNAKE_RESULT    result;
+    double          value, start;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) memory  = (UINT64) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-d") && arg + 1 < argc) spill   = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) sizes = (const char**) argv + arg;
+
+    printf("%-8s %12s %14s %12s %12s %10s\n", "field", "win", "states", "states/s", "spilled", "seconds");
+
+    for (; *sizes; sizes++)
+    {
+        if (!ParseField(*sizes, &game))
+        {
+            fprintf(stderr, "Bad field \"%s\"\n", *sizes);
+            return 1;
+        }
+
+        if ((result = CreateSolver(&solver, game.fieldWidth, game.fieldHeight, game.passThroughWalls,
+                                   threads, memory << 20, spill)) != SR_OK ||
+            (result = Initialize(&game, FALSE)) != SR_OK)
+        {
+            printf("%-8s %s\n", *sizes, ResultToString(result));
+            DestroySolver(&solver);
+            continue;
+        }
+
+        //From the start of a game, before the first food is placed
+        start  = Now();
+        result = SolveGame(&solver, &game, TRUE, &value);
+
+        if (result != SR_OK) printf("%-8s %s\n", *sizes, ResultToString(result));
+        else printf("%-8s %12.9f %14llu %12.0f %12llu %10.2f\n", *sizes, value,
+                    (unsigned long long) solver.statesSolved, SolverRate(&solver),
+                    (unsigned long long) solver.spilledStates, Now() - start);
+
+        fflush(stdout);
+        EndingCleanUp(&game);
+        DestroySolver(&solver);
+    }
+
+    return 0;
+}
+
+
+static int RunWatch(int argc, char** argv)
+{
+    static const char blockChars[] = ".*@o"; //EMPTY, FOOD, SNAKE_HEAD, SNAKE_BODY
+
+    const char*     name    = BROADCAST_NAME;
+    double          timeout = DEFAULT_WATCH_SECONDS;
+    BOOL            quiet   = FALSE;
+    SPECTATOR       spectator;
+    struct timespec poll    = { 0, WATCH_POLL_NS };
+    UINT64          followed = 0, skipped = 0, lastTick = 0;
+    double          lastChange;
+    UINT            count, x, y;
+    int             arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-q"))                   quiet   = TRUE;
+        else if (!strcmp(argv[arg], "-e") && arg + 1 < argc) timeout = atof(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) name = argv[arg];
+
+    //The broadcast may not have started yet
+    for (lastChange = Now(); !AttachSpectator(&spectator, name); nanosleep(&poll, NULL))
+    {
+        if (Now() - lastChange > timeout)
+        {
+            fprintf(stderr, "No broadcast \"%s\"\n", name);
+            return 1;
+        }
+    }
+
+    for (lastChange = Now(); Now() - lastChange <= timeout; nanosleep(&poll, NULL))
+    {
+        if ((count = FollowBroadcast(&spectator)) == 0) continue;
+
+        //Ticks the spectator jumped over by taking a snapshot
+        if (lastTick != 0 && spectator.counters.tick > lastTick + count)
+            skipped += spectator.counters.tick - lastTick - count;
+
+        followed   += count;
+        lastTick    = spectator.counters.tick;
+        lastChange  = Now();
+
+        if (quiet) continue;
+
+        printf("tick %llu: size %u, %s\n", (unsigned long long) spectator.counters.tick, spectator.counters.snakeSize,
+               spectator.counters.snakeState == WON ? "won" : spectator.counters.snakeState == LOST ? "lost" : "playing");
+
+        for (y = spectator.counters.fieldHeight; y-- > 0; putchar('\n'))
+            for (x = 0; x < spectator.counters.fieldWidth; x++) putchar(blockChars[SpectatorBlock(&spectator, x, y)]);
+
+        fflush(stdout);
+    }
+
+    printf("%llu ticks followed, %llu skipped, %llu snapshots taken\n", (unsigned long long) followed,
+           (unsigned long long) skipped, (unsigned long long) spectator.resyncs);
+
+    DetachSpectator(&spectator);
+    return 0;
+}
+
+
+static int RunPolicy(int argc, char** argv)
+{
+    const char*  field    = "127x127";
+    const char*  load     = NULL;
+    const char*  save     = NULL;
+    UINT         layers   = DEFAULT_POLICY_LAYERS;
+    UINT         channels = DEFAULT_POLICY_CHANNELS;
+    UINT         count    = DEFAULT_GAMES;
+    UINT         size     = DEFAULT_POLICY_BATCH;
+    UINT         maxTicks = DEFAULT_MAX_TICKS;
+    UINT         seed     = DEFAULT_SEED;
+    POLICY       policy;
+    SNAKE_GAME   game;
+    SNAKE_GAME*  batch      = NULL;
+    BYTE*        directions = NULL;
+    double*      latencies  = NULL;
+    SNAKE_RESULT result     = SR_OK;
+    double       start, total = 0.0, batchTime = 0.0, budget;
+    UINT64       macs = 0;
+    UINT         decisions = 0, side, g, i, l;
+    int          arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-l") && arg + 1 < argc) load     = argv[++arg];
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) save     = argv[++arg];
+        else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) layers   = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) channels = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-g") && arg + 1 < argc) count    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-b") && arg + 1 < argc) size     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || size == 0)
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if (load != NULL && !LoadPolicy(&policy, load))
+    {
+        fprintf(stderr, "Can't load \"%s\"\n", load);
+        return 1;
+    }
+
+    if (load == NULL && !CreateRandomPolicy(&policy, layers, channels, seed))
+    {
+        fprintf(stderr, "Bad net of %u layers of %u channels\n", layers, channels);
+        return 1;
+    }
+
+    if (save != NULL && !SavePolicy(&policy, save)) fprintf(stderr, "Can't write \"%s\"\n", save);
+
+    //Products of a decision, over the window each layer is evaluated on
+    for (l = 0, side = 2 * policy.radius + 1; l < policy.layerCount; l++)
+    {
+        side -= policy.layers[l].kernel - 1;
+        macs += (UINT64) side * side * policy.layers[l].outChannels * policy.layers[l].kernel * policy.layers[l].kernel *
+                policy.layers[l].inChannels;
+    }
+
+    printf("%u layers, radius %u, %llu multiply-adds per decision, %s kernels\n", policy.layerCount, policy.radius,
+           (unsigned long long) macs, PolicyKernel());
+
+    //One game at a time, timing every decision
+    latencies = (double*) malloc((size_t) count * maxTicks * sizeof(double));
+
+    for (g = 0; g < count && latencies && result == SR_OK; g++)
+    {
+        SeedGame(&game, seed, g);
+
+        if ((result = Initialize(&game, FALSE)) != SR_OK) break;
+
+        for (i = 0; game.snakeState == RUNNING && i < maxTicks && result == SR_OK; i++)
+        {
+            SNAKE_DIRECTION direction;
+
+            start                    = Now();
+            direction                = PolicyDirection(&policy, &game);
+            latencies[decisions]     = Now() - start;
+            total                   += latencies[decisions++];
+
+            if (direction != game.previousDirection) ReceiveCommand(&game, direction);
+
+            result = MoveSnake(&game);
+        }
+
+        EndingCleanUp(&game);
+    }
+
+    //Then a batch of games side by side, a game over starting again
+    batch      = (SNAKE_GAME*) calloc(size, sizeof(SNAKE_GAME));
+    directions = (BYTE*) malloc(size);
+
+    for (g = 0; g < size && batch && directions && result == SR_OK; g++)
+    {
+        batch[g] = game;
+        SeedGame(batch + g, seed, count + g);
+        result = Initialize(batch + g, FALSE);
+    }
+
+    for (i = 0; i < POLICY_BATCHES && batch && directions && result == SR_OK; i++)
+    {
+        start = Now();
+        PolicyBatch(&policy, batch, size, directions);
+        batchTime += Now() - start;
+
+        for (g = 0; g < size && result == SR_OK; g++)
+        {
+            if (directions[g] != batch[g].previousDirection) ReceiveCommand(batch + g, (SNAKE_DIRECTION) directions[g]);
+            if ((result = MoveSnake(batch + g)) == SR_OK && batch[g].snakeState != RUNNING) result = ResetGame(batch + g);
+        }
+    }
+
+    for (g = 0; g < size && batch; g++) EndingCleanUp(batch + g);
+
+    if (latencies == NULL || batch == NULL || directions == NULL) result = SR_MEMORY_ERROR;
+
+    free(batch);
+    free(directions);
+    DestroyPolicy(&policy);
+
+    if (result != SR_OK)
+    {
+        free(latencies);
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    qsort(latencies, decisions, sizeof(double), CompareDoubles);
+
+    budget = 1.0 / game.snakeSpeed;
+
+    if (decisions > 0)
+        printf("%u decisions on %s: %.1f us mean, %.1f us median, %.1f us p99, %.1f us max, %.3f%% of a %.1f ms tick\n",
+               decisions, field, total / decisions * 1e6, latencies[decisions / 2] * 1e6,
+               latencies[(UINT) (decisions * 0.99)] * 1e6, latencies[decisions - 1] * 1e6,
+               latencies[decisions - 1] / budget * 100, budget * 1e3);
+
+    printf("%u batches of %u: %.3f ms per batch, %.1f us per game\n", POLICY_BATCHES, size,
+           batchTime / POLICY_BATCHES * 1e3, batchTime / POLICY_BATCHES / size * 1e6);
+
+    free(latencies);
+    return 0;
+}
+
+
+//Moves along the cycle of Solver, or randomly without one
+static SNAKE_RESULT MoveOutcomePlayer(SNAKE_GAME* Game, HAMILTON_SOLVER* Solver)
+{
+    SNAKE_DIRECTION direction;
+
+    if (Solver == NULL) return MoveRandomly(Game);
+
+    direction = HamiltonDirection(Solver, Game);
+
+    if (direction != Game->previousDirection) ReceiveCommand(Game, direction);
+
+    return MoveSnake(Game);
+}
+
+//Plays the games again, to the end or, given a detector, until its first
+//answer, and returns the time taken
+static double TimeOutcomes(SNAKE_GAME* Game, UINT Games, UINT Seed, BOOL Hamilton, OUTCOME_DETECTOR* Detector,
+                           UINT Interval, UINT64 MaxTicks, SNAKE_RESULT* Result)
+{
+    HAMILTON_SOLVER solver;
+    UINT64          ticks, nextCheck;
+    double          start = Now();
+    UINT            i;
+
+    for (i = 0; i < Games && *Result == SR_OK; i++)
+    {
+        SeedGame(Game, Seed, i);
+
+        if ((*Result = Initialize(Game, FALSE)) != SR_OK) break;
+
+        if (Hamilton && (*Result = CreateHamiltonSolver(&solver, Game, TRUE)) != SR_OK)
+        {
+            EndingCleanUp(Game);
+            break;
+        }
+
+        if (Detector != NULL) Detector->pCycle = Hamilton ? &solver : NULL;
+
+        for (ticks = 0, nextCheck = 0; Game->snakeState == RUNNING && ticks < MaxTicks && *Result == SR_OK; ticks++)
+        {
+            if (Detector != NULL && ticks == nextCheck)
+            {
+                if (PredictOutcome(Detector, Game) != RUNNING) break;
+
+                nextCheck = ticks + OutcomeInterval(Game, Interval);
+            }
+
+            *Result = MoveOutcomePlayer(Game, Hamilton ? &solver : NULL);
+        }
+
+        if (Hamilton) DestroyHamiltonSolver(&solver);
+
+        EndingCleanUp(Game);
+    }
+
+    return Now() - start;
+}
+
+//Plays games to the end, as a rollout would without the detector, and checks
+//that every game it called ended that way. Then times them played out in
+//full against stopped at the first answer.
+static int RunOutcome(int argc, char** argv)
+{
+    const char*      field    = "20x20";
+    UINT             games    = DEFAULT_OUTCOME_GAMES;
+    UINT             seed     = DEFAULT_SEED;
+    UINT             interval = OUTCOME_INTERVAL;
+    UINT             region   = 0;
+    UINT             minSnake = OUTCOME_MIN_SNAKE;
+    UINT64           maxTicks = DEFAULT_OUTCOME_MAX_TICKS;
+    BOOL             hamilton = FALSE;
+    SNAKE_GAME       game;
+    HAMILTON_SOLVER  solver;
+    OUTCOME_DETECTOR detector;
+    SNAKE_STATE      answer, firstAnswer;
+    SNAKE_RESULT     result = SR_OK;
+    UINT64           ticks, nextCheck, answered, lossAnswers, winAnswers;
+    UINT64           totalTicks = 0, savedTicks = 0, wrong = 0, checks;
+    UINT             lost = 0, won = 0, stopped = 0, lossesCalled = 0, winsCalled = 0, i;
+    double           checkStart, checkTime = 0.0, fullTime, stoppedTime;
+    int              arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) games    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-k") && arg + 1 < argc) interval = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-r") && arg + 1 < argc) region   = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) minSnake = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) maxTicks = (UINT64) atoll(argv[++arg]);
+        else if (!strcmp(argv[arg], "-p") && arg + 1 < argc)
+        {
+            hamilton = !strcmp(argv[++arg], "hamilton");
+
+            if (!hamilton && strcmp(argv[arg], "random"))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (interval == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!ParseField(field, &game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if ((result = CreateOutcomeDetector(&detector, &game, region)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    detector.minSnake = minSnake;
+
+    printf("%s player, field %s, checks %u ticks and a tick per block of snake apart\n",
+           hamilton ? "hamilton" : "random", field, interval);
+
+    for (i = 0; i < games && result == SR_OK; i++)
+    {
+        SeedGame(&game, seed, i);
+
+        if ((result = Initialize(&game, FALSE)) != SR_OK) break;
+
+        if (hamilton && (result = CreateHamiltonSolver(&solver, &game, TRUE)) != SR_OK)
+        {
+            EndingCleanUp(&game);
+            break;
+        }
+
+        //Only a player following the cycle can count on winning along it
+        detector.pCycle = hamilton ? &solver : NULL;
+        firstAnswer     = RUNNING;
+        answered        = 0;
+        lossAnswers     = 0;
+        winAnswers      = 0;
+        nextCheck       = 0;
+
+        for (ticks = 0; game.snakeState == RUNNING && ticks < maxTicks && result == SR_OK; ticks++)
+        {
+            if (ticks == nextCheck)
+            {
+                checkStart = Now();
+                answer     = PredictOutcome(&detector, &game);
+                checkTime += Now() - checkStart;
+                nextCheck  = ticks + OutcomeInterval(&game, interval);
+
+                if (answer != RUNNING && firstAnswer == RUNNING)
+                {
+                    firstAnswer = answer;
+                    answered    = ticks;
+                }
+
+                lossAnswers += answer == LOST;
+                winAnswers  += answer == WON;
+            }
+
+            result = MoveOutcomePlayer(&game, hamilton ? &solver : NULL);
+        }
+
+        totalTicks += ticks;
+
+        //Games stopped before the end can't tell whether their answers were right
+        if (game.snakeState == RUNNING) stopped++;
+        else
+        {
+            lost += game.snakeState == LOST;
+            won  += game.snakeState == WON;
+
+            //An answer is wrong when the game ended any other way
+            if (game.snakeState != LOST) wrong += lossAnswers;
+            if (game.snakeState != WON)  wrong += winAnswers;
+
+            if (firstAnswer == game.snakeState)
+            {
+                lossesCalled += firstAnswer == LOST;
+                winsCalled   += firstAnswer == WON;
+                savedTicks   += ticks - answered;
+            }
+        }
+
+        if (hamilton) DestroyHamiltonSolver(&solver);
+
+        EndingCleanUp(&game);
+    }
+
+    checks = detector.checks;
+
+    //Games replay the same from their seeds
+    fullTime    = TimeOutcomes(&game, games, seed, hamilton, NULL, interval, maxTicks, &result);
+    stoppedTime = TimeOutcomes(&game, games, seed, hamilton, &detector, interval, maxTicks, &result);
+
+    DestroyOutcomeDetector(&detector);
+
+    if (result != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    printf("%u games: lost %u, won %u, stopped %u\n", games, lost, won, stopped);
+    printf("called %u of the losses (%.1f%%) and %u of the wins (%.1f%%), %llu wrong answers\n",
+           lossesCalled, lost ? 100.0 * lossesCalled / lost : 0.0, winsCalled, won ? 100.0 * winsCalled / won : 0.0,
+           (unsigned long long) wrong);
+    printf("%llu ticks played, %llu after the first answer: stopping there saves %.1f%%\n",
+           (unsigned long long) totalTicks, (unsigned long long) savedTicks,
+           totalTicks ? 100.0 * savedTicks / totalTicks : 0.0);
+    printf("%llu checks, %.0f ns each\n", (unsigned long long) checks, checks ? checkTime / checks * 1e9 : 0.0);
+    printf("played out in %.3f s, stopped at the first answer in %.3f s: a net saving of %.1f%%\n", fullTime,
+           stoppedTime, fullTime > 0.0 ? 100.0 * (1.0 - stoppedTime / fullTime) : 0.0);
+
+    if (wrong) fprintf(stderr, "%llu answers were wrong\n", (unsigned long long) wrong);
+
+    return wrong != 0;
+}
+
+
+static int RunBot(int argc, char** argv)
+{
+    const char* field = "21x15";
+    BOT_SESSION session;
+    int         arg;
+
+    memset(&session, 0, sizeof(session));
+    session.slots         = 1;
+    session.ticksPerRound = 1;
+    session.games         = DEFAULT_BOT_GAMES;
+    session.maxTicks      = DEFAULT_MAX_TICKS;
+    session.seed          = DEFAULT_SEED;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) session.games         = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) session.slots         = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-k") && arg + 1 < argc) session.ticksPerRound = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) session.maxTicks      = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) session.seed          = (UINT64) atoll(argv[++arg]);
+        else if (!strcmp(argv[arg], "-x"))                   session.text          = TRUE;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &session.game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    //A bot that exits early must not take the simulator with it
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    PlayBotSession(&session, 0, 1);
+
+    fprintf(stderr, "%u games won, %u lost, %llu ticks in %u rounds, %.3f s\n", session.won, session.lost,
+            (unsigned long long) session.ticks, session.rounds, session.elapsed);
+
+    if (session.ticks > 0)
+        fprintf(stderr, "%.2f us round trip per tick, %.2f us simulating, %.3f frames per tick, "
+                "%.1f bytes written and %.1f read per tick\n", session.waiting * 1e6 / session.ticks,
+                (session.elapsed - session.waiting) * 1e6 / session.ticks, (double) session.rounds / session.ticks,
+                (double) session.bytesWritten / session.ticks, (double) session.bytesRead / session.ticks);
+
+    if (session.failure) fprintf(stderr, "Stopped early: %s\n", session.failure);
+
+    return session.failure != NULL;
+}
+
+#ifndef _WIN32
+static int RunSelfPlay(int argc, char** argv)
+{
+    const char* field   = "20x15";
+    const char* address = NULL;
+    char        path[64];
+    char        bound[128];
+    pid_t       workers[MAX_LOCAL_WORKERS];
+    SELFPLAY    selfPlay;
+    UINT        workerCount = DEFAULT_LOCAL_WORKERS, threads = 0, crashAfter = 0, started, i;
+    int         listener, status, arg;
+
+    memset(&selfPlay, 0, sizeof(selfPlay));
+    selfPlay.games      = DEFAULT_SELFPLAY_GAMES;
+    selfPlay.shardGames = SELFPLAY_SHARD_GAMES;
+    selfPlay.maxTicks   = DEFAULT_MAX_TICKS;
+    selfPlay.seed       = DEFAULT_SEED;
+    selfPlay.timeout    = SELFPLAY_TIMEOUT;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-g") && arg + 1 < argc) selfPlay.games      = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) selfPlay.seed       = (UINT64) atoll(argv[++arg]);
+        else if (!strcmp(argv[arg], "-m") && arg + 1 < argc) selfPlay.maxTicks   = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-k") && arg + 1 < argc) selfPlay.shardGames = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-e") && arg + 1 < argc) selfPlay.timeout    = atof(argv[++arg]);
+        else if (!strcmp(argv[arg], "-o") && arg + 1 < argc) selfPlay.results    = argv[++arg];
+        else if (!strcmp(argv[arg], "-a") && arg + 1 < argc) address             = argv[++arg];
+        else if (!strcmp(argv[arg], "-w") && arg + 1 < argc) workerCount         = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads             = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-x") && arg + 1 < argc) crashAfter          = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-p") && arg + 1 < argc)
+        {
+            arg++;
+
+            for (selfPlay.player = SP_RANDOM; selfPlay.player < SELFPLAY_PLAYERS; selfPlay.player++)
+                if (!strcmp(argv[arg], PlayerName(selfPlay.player))) break;
+
+            if (selfPlay.player == SELFPLAY_PLAYERS)
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &selfPlay.game))
+    {
+        fprintf(stderr, "Bad field \"%s\"\n", field);
+        return 1;
+    }
+
+    if (workerCount > MAX_LOCAL_WORKERS) workerCount = MAX_LOCAL_WORKERS;
+
+    //Local workers share the processors
+    if (threads == 0 && workerCount > 0) threads = (ProcessorCount() + workerCount - 1) / workerCount;
+
+    if (address == NULL)
+    {
+        snprintf(path, sizeof(path), "unix:/tmp/snakesim-%d.sock", (int) getpid());
+        address = path;
+    }
+
+    if ((listener = ListenSelfPlay(address, bound, sizeof(bound))) < 0)
+    {
+        fprintf(stderr, "Can't listen on \"%s\"\n", address);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "Listening on %s\n", bound);
+
+    //Buffered output would be written again by every child
+    fflush(NULL);
+
+    for (started = 0; started < workerCount; started++)
+    {
+        if ((workers[started] = fork()) < 0) break;
+
+        if (workers[started] == 0)
+        {
+            close(listener);
+            _exit(RunSelfPlayWorker(bound, threads, started == 0 ? crashAfter : 0) ? 0 : 1);
+        }
+    }
+
+    RunCoordinator(&selfPlay, listener);
+    close(listener);
+
+    for (i = 0; i < started; i++) waitpid(workers[i], &status, 0);
+
+    if (!strncmp(bound, "unix:", 5)) unlink(bound + 5);
+
+    printf("%u games of %s on %s: won %u, lost %u, %llu ticks, %.0f ticks/s\n", selfPlay.games,
+           PlayerName(selfPlay.player), field, selfPlay.won, selfPlay.lost, (unsigned long long) selfPlay.ticks,
+           selfPlay.elapsed > 0 ? selfPlay.ticks / selfPlay.elapsed : 0.0);
+    printf("%u workers, %u lost, %u shards reassigned, %.2f bytes per game, %.3f s\n", selfPlay.workers,
+           selfPlay.workersLost, selfPlay.reassigned,
+           selfPlay.games ? (double) selfPlay.bytesReceived / selfPlay.games : 0.0, selfPlay.elapsed);
+    printf("checksum %016llx\n", (unsigned long long) selfPlay.checksum);
+
+    if (selfPlay.failure) fprintf(stderr, "Stopped early: %s\n", selfPlay.failure);
+
+    return selfPlay.failure != NULL;
+}
+
+static int RunWorker(int argc, char** argv)
+{
+    UINT threads = 0;
+    int  arg;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (!strcmp(argv[arg], "-t") && arg + 1 < argc) threads = (UINT) atoi(argv[++arg]);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg + 1 != argc)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!RunSelfPlayWorker(argv[arg], threads, 0))
+    {
+        fprintf(stderr, "Lost the coordinator at %s\n", argv[arg]);
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+
+static int RunResults(int argc, char** argv)
+{
+    RESULTS_SUMMARY summary;
+    RESULTS_READER  reader;
+    UINT64          foodGames = 0, firstFood = 0;
+    UINT            i, food;
+    double          start = Now();
+
+    if (argc != 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    //The headers alone give most aggregates
+    if (!SummarizeResults(argv[0], &summary))
+    {
+        fprintf(stderr, "Can't read \"%s\"\n", argv[0]);
+        return 1;
+    }
+
+    printf("%llu games in %u blocks: won %.2f%%, lost %.2f%%\n", (unsigned long long) summary.games, summary.blocks,
+           summary.games ? 100.0 * summary.won / summary.games : 0.0,
+           summary.games ? 100.0 * summary.lost / summary.games : 0.0);
+    printf("mean size %.2f, max %u\n", summary.games ? (double) summary.sizeSum / summary.games : 0.0, summary.maxSize);
+    printf("mean ticks %.1f, max %u\n", summary.games ? (double) summary.tickSum / summary.games : 0.0, summary.maxTicks);
+
+    //The others decode just the columns they need
+    if (!OpenResultsReader(&reader, argv[0])) return 1;
+
+    while (ReadResultsBlock(&reader, COLUMN_MASK(RC_FOOD_TICKS)))
+    {
+        for (i = 0, food = 0; i < reader.block.count; food += reader.block.foodCounts[i++])
+        {
+            if (reader.block.foodCounts[i] == 0) continue;
+
+            firstFood += reader.block.foodTicks[food];
+            foodGames++;
+        }
+    }
+
+    if (reader.header.games != 0) fprintf(stderr, "\"%s\" is damaged\n", argv[0]);
+
+    CloseResultsReader(&reader);
+
+    printf("mean ticks to the first food %.1f, %.2f food per game\n",
+           foodGames ? (double) firstFood / foodGames : 0.0,
+           summary.games ? (double) summary.foodTotal / summary.games : 0.0);
+    printf("scanned in %.3f s\n", Now() - start);
+
+    return 0;
+}
+
+
+static int RunEvolution(int argc, char** argv)
+{
+    const char*  field       = "21x15";
+    const char*  checkpoint  = NULL;
+    UINT         generations = DEFAULT_GENERATIONS;
+    UINT         seed        = DEFAULT_SEED;
+    BOOL         resume      = FALSE;
+    SNAKE_GAME   game;
+    EVOLUTION    evolution;
+    SNAKE_RESULT result;
+    UINT         i;
+    int          arg;
+
+    memset(&evolution, 0, sizeof(evolution));
+
+    evolution.population     = DEFAULT_POPULATION;
+    evolution.gamesPerGenome = DEFAULT_GAMES;
+    evolution.mutationRate   = 0.1f;
+    evolution.mutationScale  = 0.2f;
+    evolution.eliteShare     = 0.05f;
+
+    for (arg = 0; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if      (!strcmp(argv[arg], "-r"))                   resume                   = TRUE;
+        else if (!strcmp(argv[arg], "-p") && arg + 1 < argc) evolution.population     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-n") && arg + 1 < argc) generations              = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-g") && arg + 1 < argc) evolution.gamesPerGenome = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) seed                     = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) evolution.threadCount    = (UINT) atoi(argv[++arg]);
+        else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) checkpoint               = argv[++arg];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (arg < argc) field = argv[arg];
+
+    if (!ParseField(field, &game) || (resume && checkpoint == NULL))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    evolution.fieldWidth       = game.fieldWidth;
+    evolution.fieldHeight      = game.fieldHeight;
+    evolution.passThroughWalls = game.passThroughWalls;
+
+    if (resume)
+    {
+        if (!LoadEvolution(&evolution, checkpoint))
+        {
+            fprintf(stderr, "Can't load \"%s\"\n", checkpoint);
+            return 1;
+        }
+    }
+    else if ((result = CreateEvolution(&evolution, seed)) != SR_OK)
+    {
+        fprintf(stderr, "%s\n", ResultToString(result));
+        return 1;
+    }
+
+    printf("%6s %10s %10s %12s\n", "gen", "best", "mean", "gens/hour");
+
+    for (i = 0; i < generations; i++)
+    {
+        if ((result = RunGeneration(&evolution)) != SR_OK)
+        {
+            fprintf(stderr, "%s\n", ResultToString(result));
+            break;
+        }
+
+        printf("%6u %10.3f %10.3f %12.0f\n", evolution.generation, evolution.bestFitness,
+               evolution.meanFitness, GenerationsPerHour(&evolution));
+        fflush(stdout);
+
+        if (checkpoint && !SaveEvolution(&evolution, checkpoint))
+        {
+            fprintf(stderr, "Can't save \"%s\"\n", checkpoint);
+            break;
+        }
+    }
+
+    DestroyEvolution(&evolution);
+    return i < generations;
+}
+
+
+//*****************************************************************************
+//
+//                              MAIN FUNCTION
+//
+//*****************************************************************************
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "hamilton")) return RunHamilton(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "mcts"))     return RunPlanner (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "evolve"))   return RunEvolution(argc - 2, argv + 2);
+    if (!strcmp(argv[1], "hash"))     return RunHash     (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "symmetry")) return RunSymmetry (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "heatmap"))  return RunHeatmap  (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "random"))   return RunRandom   (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "replay"))   return RunReplay   (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "solve"))    return RunSolver   (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "suspend"))  return RunSuspend  (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "sessions")) return RunSessions (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "undo"))     return RunUndo     (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "events"))   return RunEvents   (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "watch"))    return RunWatch    (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "policy"))   return RunPolicy   (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "outcome"))  return RunOutcome  (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "bot"))      return RunBot      (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "results"))  return RunResults  (argc - 2, argv + 2);
+#ifndef _WIN32
+    if (!strcmp(argv[1], "selfplay")) return RunSelfPlay (argc - 2, argv + 2);
+    if (!strcmp(argv[1], "worker"))   return RunWorker   (argc - 2, argv + 2);
+#endif
+
+    PrintUsage();
+    return 1;
+}
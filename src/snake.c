@@ -0,0 +1,1380 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake.h"
+#include "encoder.h"
+#include "heatmap.h"
+#include "trace.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+//Kinds of Zobrist keys, the first ones being the block states
+#define KEY_DIRECTION               4
+#define KEY_TAIL                    5
+
+//Flags of a suspended game
+#define SG_PASS_THROUGH_WALLS       0x01
+#define SG_FIELD                    0x02  //The game has a field
+#define SG_FOOD                     0x04  //The field has food on foodPosition
+#define SG_STALLED                  0x08  //The head ran into a wall and stayed where it was
+
+#define SUSPENDED_CHAIN(s)          ((BYTE*) ((SUSPENDED_GAME*) (s) + 1))
+
+#define PCG_MULTIPLIER              6364136223846793005ULL
+
+//Tells the subscriber of a game, if any, to read its whole field again. Set
+//before the field is rebuilt, so none of the blocks rebuilt is listed.
+#define RESCAN_EVENTS(g)                                                                \
+    do                                                                                  \
+    {                                                                                   \
+        if ((g)->pEvents != NULL)                                                       \
+        {                                                                               \
+            (g)->pEvents->count    = 0;                                                 \
+            (g)->pEvents->overflow = TRUE;                                              \
+        }                                                                               \
+    } while (0)
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Everything a suspended game keeps besides its chain, which follows it in the
+//same allocation: the direction from every element of the snake to the next
+//one towards the tail, head first, then the pending commands, 2 bits each and
+//packed like the field. The field is rebuilt from the snake and the food.
+typedef struct _SUSPENDED_GAME
+{
+    UINT64 randomState;
+    UINT64 randomIncrement;
+    UINT   snakeSpeed;
+    UINT   snakeSize;
+    UINT   commandCount;
+    WORD   headPosition;
+    WORD   foodPosition;
+    BYTE   fieldWidth;
+    BYTE   fieldHeight;
+    BYTE   snakeState;
+    BYTE   previousDirection;
+    BYTE   flags;
+} SUSPENDED_GAME;
+
+
+//*****************************************************************************
+//
+//                             SNAKE CORE FUNCTIONS
+//
+//*****************************************************************************
+
+//Zobrist keys are the splitmix64 finalizer of their kind and block, so they
+//need no table and are the same in every process. Empty blocks have no key.
+UINT64 ZobristKey(UINT Kind, WORD Position)
+{
+    UINT64 key = ((UINT64) Kind << 16 | Position) + 0x9E3779B97F4A7C15ULL;
+
+    if (Kind == EMPTY) return 0;
+
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+
+    return key ^ (key >> 31);
+}
+
+GLOBALHANDLE CreateSnakeBlock(WORD BlockPosition, GLOBALHANDLE NextElement)
+{
+    GLOBALHANDLE   hNewSnakeBlock;
+    SNAKE_ELEMENT* pNewSnakeBlock;
+
+    hNewSnakeBlock = GlobalAlloc(GMEM_MOVEABLE, sizeof(SNAKE_ELEMENT));
+
+    if (hNewSnakeBlock)
+    {
+        pNewSnakeBlock = (SNAKE_ELEMENT*) GlobalLock(hNewSnakeBlock);
+
+        pNewSnakeBlock->blockPosition = BlockPosition;
+        pNewSnakeBlock->hNextElement  = NextElement;
+
+        GlobalUnlock(hNewSnakeBlock);
+    }
+
+    return hNewSnakeBlock;
+}
+
+//Like CreateSnakeBlock, but reusing a spare element of the game when there is one
+GLOBALHANDLE TakeSnakeBlock(SNAKE_GAME* Game, WORD BlockPosition, GLOBALHANDLE NextElement)
+{
+    GLOBALHANDLE   hSnakeBlock = Game->hSpareElements;
+    SNAKE_ELEMENT* pSnakeBlock;
+
+    if (hSnakeBlock == NULL) return CreateSnakeBlock(BlockPosition, NextElement);
+
+    pSnakeBlock                   = (SNAKE_ELEMENT*) GlobalLock(hSnakeBlock);
+    Game->hSpareElements          = pSnakeBlock->hNextElement;
+    pSnakeBlock->blockPosition    = BlockPosition;
+    pSnakeBlock->hNextElement     = NextElement;
+
+    GlobalUnlock(hSnakeBlock);
+    return hSnakeBlock;
+}
+
+void DestroySnakeStack(GLOBALHANDLE SnakeStack)
+{
+    GLOBALHANDLE   hNextElement = SnakeStack;
+    GLOBALHANDLE   hCurrentElement;
+    SNAKE_ELEMENT* pCurrentElement;
+
+    while (hNextElement)
+    {
+        hCurrentElement = hNextElement;
+        pCurrentElement = (SNAKE_ELEMENT*) GlobalLock(hCurrentElement);
+        hNextElement    = pCurrentElement->hNextElement;
+
+        GlobalUnlock(hCurrentElement);
+        GlobalFree  (hCurrentElement);
+    }
+}
+
+WORD NewPosition(SNAKE_GAME* Game, WORD Position, char Steps, SNAKE_DIRECTION Direction)
+{
+    char x, y;
+
+    x = BLOCK_X(Position);
+    y = BLOCK_Y(Position);
+
+    if (Game->passThroughWalls) switch (Direction)
+    {
+        case RIGHT: x = (x                     + Steps) % Game->fieldWidth;  break;
+        case LEFT:  x = (x + Game->fieldWidth  - Steps) % Game->fieldWidth;  break;
+        case UP:    y = (y                     + Steps) % Game->fieldHeight; break;
+        case DOWN:  y = (y + Game->fieldHeight - Steps) % Game->fieldHeight; break;
+    }
+    else switch (Direction)
+    {
+        case RIGHT: x += Steps; break;
+        case LEFT:  x -= Steps; break;
+        case UP:    y += Steps; break;
+        case DOWN:  y -= Steps; break;
+    }
+
+    return BLOCK_POSITION(x, y);
+}
+
+BOOL IsInsideField(SNAKE_GAME* Game, WORD Position)
+{
+    BYTE x, y;
+
+    x = BLOCK_X(Position);
+    y = BLOCK_Y(Position);
+
+    return x < Game->fieldWidth && y < Game->fieldHeight;
+}
+
+static void RecordCellEvent(CELL_EVENTS* Events, WORD Position, BLOCK_STATE OldState, BLOCK_STATE NewState)
+{
+    CELL_EVENT* pEvent;
+
+    if (OldState == NewState) return;
+
+    //Once the list is incomplete nothing more is listed until the next move
+    if (Events->overflow || Events->count >= CELL_EVENT_CAPACITY)
+    {
+        Events->overflow = TRUE;
+        return;
+    }
+
+    pEvent                = Events->events + Events->count++;
+    pEvent->blockPosition = Position;
+    pEvent->oldState      = (BYTE) OldState;
+    pEvent->newState      = (BYTE) NewState;
+}
+
+BLOCK_STATE GetFieldBlock(SNAKE_GAME* Game, WORD Position)
+{
+    BYTE*       pFieldBuffer;
+    BLOCK_STATE state;
+    BYTE*       pBlockByte;
+    int         shift;
+    int         bufferPosition = BLOCK_BUFFER_POSITION(Game, Position);
+
+    pFieldBuffer = (BYTE *) GlobalLock(Game->hFieldBuffer);
+    pBlockByte   = pFieldBuffer + bufferPosition / 4;
+    shift        = 2 * (bufferPosition % 4);
+    state        = (BLOCK_STATE) ((*pBlockByte >> shift) & 0x03);
+
+    GlobalUnlock(Game->hFieldBuffer);
+    return state;
+}
+
+void SetFieldBlock(SNAKE_GAME* Game, WORD Position, BLOCK_STATE NewState)
+{
+    BYTE*       pFieldBuffer;
+    BLOCK_STATE previousState;
+    BYTE*       pBlockByte;
+    BYTE        mask;
+    int         shift;
+    int         bufferPosition = BLOCK_BUFFER_POSITION(Game, Position);
+
+    pFieldBuffer = (BYTE *) GlobalLock(Game->hFieldBuffer);
+    pBlockByte   = pFieldBuffer + bufferPosition / 4;
+
+    shift         = 2 * (bufferPosition % 4);
+    mask          = 0x03 << shift;
+    previousState = (BLOCK_STATE) ((*pBlockByte & mask) >> shift);
+
+    *pBlockByte &= ~mask;
+    *pBlockByte |= (NewState << shift) & mask;
+
+    GlobalUnlock(Game->hFieldBuffer);
+
+    if (previousState == EMPTY) Game->emptyBlocks--;
+    if (NewState      == EMPTY) Game->emptyBlocks++;
+
+    if (Game->pEvents != NULL) RecordCellEvent(Game->pEvents, Position, previousState, NewState);
+
+    Game->fieldHash ^= ZobristKey(previousState, Position) ^ ZobristKey(NewState, Position);
+}
+
+SNAKE_RESULT BuildSnakeStack(SNAKE_GAME* Game)
+{
+    WORD            tailPosition;
+    WORD            headPosition;
+    SNAKE_DIRECTION tailDirection = OPPOSITE_DIRECTION(INITIAL_DIRECTION);
+    WORD            currentPosition;
+    GLOBALHANDLE    hHeadBlock;
+    GLOBALHANDLE    hPreviousBlock;
+    GLOBALHANDLE    hCurrentBlock;
+    int             i;
+
+    // Check if the snake has an appropriate size
+    if (INITIAL_SNAKE_SIZE == 0) return SR_BAD_SNAKE_SIZE;
+
+    // Calculate head position
+    headPosition = BLOCK_POSITION(INITIAL_SNAKE_SIZE + (Game->fieldWidth - INITIAL_SNAKE_SIZE) / 3 - 1, (Game->fieldHeight - 1) / 2);
+
+    // Check if the snake's both head and tail are inside the field
+    if (!IsInsideField(Game, headPosition)) return SR_BAD_INITIAL_POSITION;
+
+    tailPosition = NewPosition(Game, headPosition, INITIAL_SNAKE_SIZE - 1, tailDirection);
+
+    if (!IsInsideField(Game, tailPosition)) return SR_BAD_INITIAL_POSITION;
+
+    //Create the head of the snake
+    hCurrentBlock   = TakeSnakeBlock(Game, headPosition, NULL);
+    currentPosition = headPosition;
+
+    if (!hCurrentBlock) return SR_MEMORY_ERROR;
+
+    hHeadBlock = hCurrentBlock;
+
+    SetFieldBlock(Game, headPosition, SNAKE_HEAD);
+
+    //Create the remaining body elements
+    for (i = 1; i < INITIAL_SNAKE_SIZE; i++)
+    {
+        hPreviousBlock  = hCurrentBlock;
+        currentPosition = NewPosition(Game, currentPosition, 1, tailDirection);
+        hCurrentBlock   = TakeSnakeBlock(Game, currentPosition, hPreviousBlock);
+
+        if (!hCurrentBlock)
+        {
+            DestroySnakeStack(hPreviousBlock);
+            return SR_MEMORY_ERROR;
+        }
+
+        SetFieldBlock(Game, currentPosition, SNAKE_BODY);
+    }
+
+    Game->hSnakeStack  = hCurrentBlock;
+    Game->hSnakeHead   = hHeadBlock;
+    Game->headPosition = headPosition;
+    Game->snakeSize    = INITIAL_SNAKE_SIZE;
+    return SR_OK;
+}
+
+//PCG32 with the XSH RR output: the top bits of the state, xorshifted and
+//rotated by its top five bits
+UINT DrawRandom(SNAKE_GAME* Game)
+{
+    UINT64 state = Game->randomState;
+    UINT   shifted, rotation;
+
+    Game->randomState = state * PCG_MULTIPLIER + Game->randomIncrement;
+    shifted           = (UINT) (((state >> 18) ^ state) >> 27);
+    rotation          = (UINT) (state >> 59);
+
+    return shifted >> rotation | shifted << (-rotation & 31);
+}
+
+void SeedGame(SNAKE_GAME* Game, UINT64 Seed, UINT64 Stream)
+{
+    Game->randomState     = 0;
+    Game->randomIncrement = Stream << 1 | 1;
+
+    DrawRandom(Game);
+    Game->randomState += Seed;
+    DrawRandom(Game);
+}
+
+//The steps of the generator compose into a single multiply and add, squared
+//once per bit of Draws
+void SkipRandom(SNAKE_GAME* Game, UINT64 Draws)
+{
+    UINT64 multiplier = PCG_MULTIPLIER, increment = Game->randomIncrement;
+    UINT64 totalMultiplier = 1, totalIncrement = 0;
+
+    for (; Draws; Draws >>= 1)
+    {
+        if (Draws & 1)
+        {
+            totalMultiplier *= multiplier;
+            totalIncrement   = totalIncrement * multiplier + increment;
+        }
+
+        increment   = (multiplier + 1) * increment;
+        multiplier *= multiplier;
+    }
+
+    Game->randomState = Game->randomState * totalMultiplier + totalIncrement;
+}
+
+//Lemire's multiply and shift, drawing again only for the few low products
+//that would favour some results
+UINT RandomBelow(SNAKE_GAME* Game, UINT Bound)
+{
+    UINT64 product;
+    UINT   threshold;
+
+    if (Game->randomIncrement == 0) SeedGame(Game, (UINT64) rand() << 31 ^ (UINT64) rand(), (UINT64) rand());
+
+    product = (UINT64) DrawRandom(Game) * Bound;
+
+    if ((UINT) product < Bound)
+    {
+        threshold = -Bound % Bound;
+
+        while ((UINT) product < threshold) product = (UINT64) DrawRandom(Game) * Bound;
+    }
+
+    return (UINT) (product >> 32);
+}
+
+void CreateNewFood(SNAKE_GAME* Game)
+{
+    BLOCK_STATE state;
+    BYTE*       pFieldBuffer;
+    BYTE*       pBlockByte;
+    BYTE        mask;
+    UINT64      word;
+    int         fieldBytes   = FIELD_BUFFER_SIZE(Game);
+    int         foodIndex    = (int) RandomBelow(Game, Game->emptyBlocks);
+    int         currentIndex = 0;
+    int         emptyCount;
+    int         i, j;
+
+    pFieldBuffer = (BYTE*) GlobalLock(Game->hFieldBuffer);
+
+    //Skip whole words before the food. An empty block is a pair of zero bits,
+    //so the even bits of ~(word | word >> 1) flag the empty blocks of a word.
+    for (i = 0; i + 8 <= fieldBytes; i += 8)
+    {
+        memcpy(&word, pFieldBuffer + i, sizeof(word));
+        emptyCount = __builtin_popcountll(~(word | word >> 1) & 0x5555555555555555ULL);
+
+        if (currentIndex + emptyCount > foodIndex) break;
+
+        currentIndex += emptyCount;
+    }
+
+    pBlockByte = pFieldBuffer + i;
+
+    //Sweep the remaining bytes of the field buffer
+    for (; i < fieldBytes; i++)
+    {
+        //Sweep all the bit pairs of each byte
+        for (j = 0; j < 4; j++)
+        {
+            mask  = 0x03 << 2 * j;
+            state = (BLOCK_STATE) ((*pBlockByte & mask) >> 2 * j);
+
+            if (state != EMPTY) continue;
+
+            if (currentIndex == foodIndex)
+            {
+                *pBlockByte &= ~mask;
+                *pBlockByte |= (FOOD << 2 * j) & mask;
+                Game->emptyBlocks--;
+                Game->foodPosition = BLOCK_POSITION((i * 4 + j) % Game->fieldWidth, (i * 4 + j) / Game->fieldWidth);
+                Game->fieldHash   ^= ZobristKey(FOOD, Game->foodPosition);
+
+                if (Game->pHeatmap != NULL) HEATMAP_COUNT(Game->pHeatmap, HM_FOOD, Game->foodPosition);
+                if (Game->pEvents  != NULL) RecordCellEvent(Game->pEvents, Game->foodPosition, EMPTY, FOOD);
+
+                i = fieldBytes; // Forces break of outer loop
+                break;
+            }
+
+            currentIndex++;
+        }
+
+        pBlockByte++;
+    }
+
+    GlobalUnlock(Game->hFieldBuffer);
+}
+
+UINT CountCommands(SNAKE_GAME* Game)
+{
+    GLOBALHANDLE       hNextCommand = Game->hCommandsBeginning;
+    DIRECTION_COMMAND* pCurrentCommand;
+    UINT               count = 0;
+
+    while (hNextCommand)
+    {
+        pCurrentCommand = (DIRECTION_COMMAND*) GlobalLock(hNextCommand);
+        GlobalUnlock(hNextCommand);
+
+        hNextCommand = pCurrentCommand->hNextCommand;
+        count++;
+    }
+
+    return count;
+}
+
+SNAKE_RESULT ReceiveCommand(SNAKE_GAME* Game, SNAKE_DIRECTION Direction)
+{
+    GLOBALHANDLE       hNewCommand = NULL;
+    DIRECTION_COMMAND* pNewCommand;
+    DIRECTION_COMMAND* pPreviousCommand = NULL;
+    SNAKE_DIRECTION    lastDirection;
+    UINT               traceId;
+
+    if (Game->snakeState != RUNNING) return SR_OK;
+
+    traceId = TRACE_NEW_ID();
+    TRACE_COMMAND(TS_RECEIVED, traceId, Direction, CountCommands(Game));
+
+    if (Game->hCommandsEnding == NULL) lastDirection = Game->previousDirection;
+    else
+    {
+        pPreviousCommand = (DIRECTION_COMMAND*) GlobalLock(Game->hCommandsEnding);
+        lastDirection    = pPreviousCommand->direction;
+    }
+
+    if (IS_PERPENDICULAR(Direction, lastDirection))
+    {
+        hNewCommand = GlobalAlloc(GMEM_MOVEABLE, sizeof(DIRECTION_COMMAND));
+
+        if (hNewCommand == NULL)
+        {
+            if (Game->hCommandsEnding != NULL) GlobalUnlock(Game->hCommandsEnding);
+
+            return SR_MEMORY_ERROR;
+        }
+
+        pNewCommand               = (DIRECTION_COMMAND*) GlobalLock(hNewCommand);
+        pNewCommand->hNextCommand = NULL;
+        pNewCommand->direction    = Direction;
+        pNewCommand->traceId      = traceId;
+
+        GlobalUnlock(hNewCommand);
+    }
+    else TRACE_COMMAND(TS_DROPPED, traceId, Direction, 0);
+
+    if (pPreviousCommand == NULL)
+    {
+        if (hNewCommand != NULL)
+        {
+            Game->hCommandsBeginning = hNewCommand;
+            Game->hCommandsEnding    = hNewCommand;
+        }
+    }
+    else
+    {
+        if (hNewCommand != NULL)
+        {
+            pPreviousCommand->hNextCommand = hNewCommand;
+            Game->hCommandsEnding          = hNewCommand;
+        }
+
+        GlobalUnlock(Game->hCommandsEnding);
+    }
+
+    return SR_OK;
+}
+
+SNAKE_DIRECTION PickDirection(SNAKE_GAME* Game, UINT* TraceId)
+{
+    DIRECTION_COMMAND* pFirstCommand;
+    GLOBALHANDLE       hSecondCommand;
+    SNAKE_DIRECTION    ret;
+
+    *TraceId = 0;
+
+    if (Game->hCommandsBeginning == NULL) return Game->previousDirection;
+
+    pFirstCommand  = (DIRECTION_COMMAND*) GlobalLock(Game->hCommandsBeginning);
+    ret            = pFirstCommand->direction;
+    hSecondCommand = pFirstCommand->hNextCommand;
+    *TraceId       = pFirstCommand->traceId;
+
+    GlobalUnlock(Game->hCommandsBeginning);
+    GlobalFree  (Game->hCommandsBeginning);
+
+    if (hSecondCommand == NULL)
+    {
+        Game->hCommandsBeginning = NULL;
+        Game->hCommandsEnding    = NULL;
+    }
+    else Game->hCommandsBeginning = hSecondCommand;
+
+    TRACE_COMMAND(TS_DEQUEUED, *TraceId, ret, CountCommands(Game));
+    return ret;
+}
+
+void DestroyCommandsList(GLOBALHANDLE CommandsList)
+{
+    GLOBALHANDLE       hNextCommand = CommandsList;
+    GLOBALHANDLE       hCurrentCommand;
+    DIRECTION_COMMAND* pCurrentCommand;
+
+    while (hNextCommand)
+    {
+        hCurrentCommand = hNextCommand;
+        pCurrentCommand = (DIRECTION_COMMAND*) GlobalLock(hCurrentCommand);
+        hNextCommand    = pCurrentCommand->hNextCommand;
+
+        GlobalUnlock(hCurrentCommand);
+        GlobalFree  (hCurrentCommand);
+    }
+}
+
+//Body of MoveSnake, recording what it changes into Delta when there is one
+static SNAKE_RESULT StepSnake(SNAKE_GAME* Game, MOVE_DELTA* Delta)
+{
+    GLOBALHANDLE   hTailElement = Game->hSnakeStack;
+    GLOBALHANDLE   hHeadElement = Game->hSnakeHead;
+    SNAKE_ELEMENT* pTailElement;
+    SNAKE_ELEMENT* pHeadElement;
+    WORD           nextPosition;
+    WORD           tailPreviousPosition;
+    BLOCK_STATE    nextState;
+    BOOL           isInside;
+    BOOL           isAvailable = TRUE;
+    BOOL           gotFood     = FALSE;
+    UINT           traceId;
+
+    TRACE_TICK();
+
+    if (Game->pEvents != NULL)
+    {
+        Game->pEvents->count    = 0;
+        Game->pEvents->overflow = FALSE;
+    }
+
+    pTailElement         = (SNAKE_ELEMENT*) GlobalLock(hTailElement);
+    pHeadElement         = (SNAKE_ELEMENT*) GlobalLock(hHeadElement);
+    tailPreviousPosition = pTailElement->blockPosition;
+
+    Game->previousDirection = PickDirection(Game, &traceId);
+    nextPosition            = NewPosition(Game, pHeadElement->blockPosition, 1, Game->previousDirection);
+    isInside                = IsInsideField(Game, nextPosition);
+
+    if (Delta != NULL)
+    {
+        Delta->tailPosition = tailPreviousPosition;
+        Delta->blocks       = (BYTE) (GetFieldBlock(Game, tailPreviousPosition) |
+                                      GetFieldBlock(Game, pHeadElement->blockPosition) << 2);
+    }
+
+    SetFieldBlock(Game, tailPreviousPosition, EMPTY);
+
+    if (hTailElement != hHeadElement) SetFieldBlock(Game, pHeadElement->blockPosition, SNAKE_BODY);
+
+    if (isInside)
+    {
+        nextState   = GetFieldBlock(Game, nextPosition);
+        isAvailable = IS_BLOCK_AVAILABLE(nextState);
+        gotFood     = nextState == FOOD;
+
+        if (Delta != NULL) Delta->blocks |= nextState << 4;
+    }
+    else nextPosition = pHeadElement->blockPosition;
+
+    //Every element takes the position of the one ahead of it, which is the
+    //same as the tail element becoming the new head
+    if (hTailElement != hHeadElement)
+    {
+        Game->hSnakeStack          = pTailElement->hNextElement;
+        pTailElement->hNextElement = NULL;
+        pHeadElement->hNextElement = hTailElement;
+        Game->hSnakeHead           = hTailElement;
+    }
+
+    pTailElement->blockPosition = nextPosition;
+
+    GlobalUnlock(hHeadElement);
+    GlobalUnlock(hTailElement);
+
+    if (isInside)
+    {
+        Game->headPosition = nextPosition;
+        SetFieldBlock(Game, nextPosition, SNAKE_HEAD);
+
+        if (traceId) TRACE_COMMAND(TS_APPLIED, traceId, Game->previousDirection, 0);
+
+        if (gotFood)
+        {
+            Game->hSnakeStack = TakeSnakeBlock(Game, tailPreviousPosition, Game->hSnakeStack);
+
+            if (Game->hSnakeStack == NULL) return SR_MEMORY_ERROR;
+
+            SetFieldBlock(Game, tailPreviousPosition, SNAKE_BODY);
+            Game->snakeSize++;
+
+            if (Game->emptyBlocks) CreateNewFood(Game);
+            else Game->snakeState = WON;
+        }
+    }
+
+    if (Delta != NULL)
+    {
+        if (isInside) Delta->flags |= MD_INSIDE;
+        if (gotFood)  Delta->flags |= Game->snakeState == WON ? MD_GREW : MD_GREW | MD_FOOD;
+    }
+
+    if (!isInside || !isAvailable) Game->snakeState = LOST;
+
+    if (Game->pHeatmap != NULL)
+    {
+        if (isInside)                 HEATMAP_COUNT(Game->pHeatmap, HM_VISITS, nextPosition);
+        if (!isInside || !isAvailable) HEATMAP_COUNT(Game->pHeatmap, HM_DEATHS, Game->headPosition);
+    }
+
+    VERIFY_HASH(Game);
+
+    return SR_OK;
+}
+
+SNAKE_RESULT MoveSnake(SNAKE_GAME* Game)
+{
+    return StepSnake(Game, NULL);
+}
+
+SNAKE_RESULT DoMove(SNAKE_GAME* Game, SNAKE_DIRECTION Direction, MOVE_DELTA* Delta)
+{
+    Delta->randomState  = Game->randomState;
+    Delta->hHeadElement = Game->hSnakeHead;
+    Delta->headPosition = Game->headPosition;
+    Delta->foodPosition = Game->foodPosition;
+    Delta->flags        = (BYTE) (Game->previousDirection | Game->snakeState << 2);
+
+    if (IS_PERPENDICULAR(Direction, Game->previousDirection)) Game->previousDirection = Direction;
+
+    return StepSnake(Game, Delta);
+}
+
+//Takes back the blocks in the opposite order MoveSnake set them, so every
+//SetFieldBlock restores its share of emptyBlocks and of the hash
+void UndoMove(SNAKE_GAME* Game, const MOVE_DELTA* Delta)
+{
+    GLOBALHANDLE   hTailElement;
+    GLOBALHANDLE   hHeadElement = Game->hSnakeHead;
+    SNAKE_ELEMENT* pTailElement;
+    SNAKE_ELEMENT* pHeadElement;
+
+    if (Game->pEvents != NULL)
+    {
+        Game->pEvents->count    = 0;
+        Game->pEvents->overflow = FALSE;
+    }
+
+    if (Delta->flags & MD_FOOD) SetFieldBlock(Game, Game->foodPosition, EMPTY);
+
+    //The element taken at the tail goes back to the spares
+    if (Delta->flags & MD_GREW)
+    {
+        hTailElement                = Game->hSnakeStack;
+        pTailElement                = (SNAKE_ELEMENT*) GlobalLock(hTailElement);
+        Game->hSnakeStack           = pTailElement->hNextElement;
+        pTailElement->hNextElement  = Game->hSpareElements;
+        Game->hSpareElements        = hTailElement;
+
+        GlobalUnlock(hTailElement);
+        SetFieldBlock(Game, Delta->tailPosition, EMPTY);
+        Game->snakeSize--;
+    }
+
+    if (Delta->flags & MD_INSIDE) SetFieldBlock(Game, Game->headPosition, (BLOCK_STATE) (Delta->blocks >> 4 & 0x03));
+
+    //The head element becomes the tail again, behind the rest of the snake
+    pHeadElement = (SNAKE_ELEMENT*) GlobalLock(hHeadElement);
+
+    if (hHeadElement != Delta->hHeadElement)
+    {
+        pTailElement               = (SNAKE_ELEMENT*) GlobalLock(Delta->hHeadElement);
+        pTailElement->hNextElement = NULL;
+        pHeadElement->hNextElement = Game->hSnakeStack;
+        Game->hSnakeStack          = hHeadElement;
+        Game->hSnakeHead           = Delta->hHeadElement;
+
+        SetFieldBlock(Game, pTailElement->blockPosition, (BLOCK_STATE) (Delta->blocks >> 2 & 0x03));
+        GlobalUnlock(Delta->hHeadElement);
+    }
+
+    pHeadElement->blockPosition = Delta->tailPosition;
+
+    GlobalUnlock(hHeadElement);
+    SetFieldBlock(Game, Delta->tailPosition, (BLOCK_STATE) (Delta->blocks & 0x03));
+
+    Game->headPosition      = Delta->headPosition;
+    Game->foodPosition      = Delta->foodPosition;
+    Game->previousDirection = (SNAKE_DIRECTION) (Delta->flags & 0x03);
+    Game->snakeState        = (SNAKE_STATE) (Delta->flags >> 2 & 0x07);
+    Game->randomState       = Delta->randomState;
+}
+
+SNAKE_RESULT Initialize(SNAKE_GAME* Game, BOOL EmptyField)
+{
+    SNAKE_RESULT result;
+
+    RESCAN_EVENTS(Game);
+
+    //Create field
+    if (Game->fieldWidth <= 0 || Game->fieldWidth > 127 || Game->fieldHeight <= 0 || Game->fieldHeight > 127)
+        return SR_BAD_FIELD_SIZE;
+
+    if (Game->snakeSpeed <= 0) return SR_BAD_SNAKE_SPEED;
+
+    Game->hFieldBuffer = GlobalAlloc(GHND, FIELD_BUFFER_SIZE(Game));
+
+    if (!Game->hFieldBuffer) return SR_MEMORY_ERROR;
+
+    Game->emptyBlocks    = Game->fieldWidth * Game->fieldHeight;
+    Game->fieldHash      = 0;
+    Game->hSpareElements = NULL;
+
+    //Initialize direction commands list
+    Game->hCommandsBeginning = NULL;
+    Game->hCommandsEnding    = NULL;
+    Game->previousDirection  = INITIAL_DIRECTION;
+
+    if (EmptyField)
+    {
+        Game->hSnakeStack = NULL;
+        Game->hSnakeHead  = NULL;
+        Game->snakeState  = IDLE;
+        Game->snakeSize   = 0;
+
+        return SR_OK;
+    }
+
+    result = BuildSnakeStack(Game);
+
+    if (result)
+    {
+        GlobalFree(Game->hFieldBuffer);
+        Game->hFieldBuffer = NULL;
+        return result;
+    }
+
+    //Create first food block
+    if (Game->emptyBlocks) CreateNewFood(Game);
+    else
+    {
+        DestroySnakeStack(Game->hSnakeStack);
+        Game->hSnakeStack = NULL;
+        GlobalFree(Game->hFieldBuffer);
+        Game->hFieldBuffer = NULL;
+
+        return SR_NO_SPACE_FOR_FOOD;
+    }
+
+    Game->snakeState = RUNNING;
+
+    return SR_OK;
+}
+
+SNAKE_RESULT ResetGame(SNAKE_GAME* Game)
+{
+    GLOBALHANDLE   hElement;
+    GLOBALHANDLE   hNextElement;
+    SNAKE_ELEMENT* pElement;
+    BYTE*          pFieldBuffer;
+    SNAKE_RESULT   result;
+    UINT           blocks  = Game->fieldWidth * Game->fieldHeight;
+    UINT           cleared = 0;
+    int            bufferPosition;
+
+    if (Game->hFieldBuffer == NULL) return Initialize(Game, FALSE);
+
+    RESCAN_EVENTS(Game);
+
+    pFieldBuffer = (BYTE*) GlobalLock(Game->hFieldBuffer);
+
+    //Clear the blocks of the old snake, whose elements all become spares
+    for (hElement = Game->hSnakeStack; hElement; hElement = hNextElement)
+    {
+        pElement       = (SNAKE_ELEMENT*) GlobalLock(hElement);
+        hNextElement   = pElement->hNextElement;
+        bufferPosition = BLOCK_BUFFER_POSITION(Game, pElement->blockPosition);
+
+        pFieldBuffer[bufferPosition / 4] &= ~(0x03 << 2 * (bufferPosition % 4));
+        cleared++;
+
+        if (hNextElement == NULL)
+        {
+            pElement->hNextElement = Game->hSpareElements;
+            Game->hSpareElements   = Game->hSnakeStack;
+        }
+
+        GlobalUnlock(hElement);
+    }
+
+    GlobalUnlock(Game->hFieldBuffer);
+
+    if (GetFieldBlock(Game, Game->foodPosition) == FOOD) SetFieldBlock(Game, Game->foodPosition, EMPTY);
+
+    //Blocks set by the caller on an empty field are only found by clearing it all
+    if (cleared != blocks - Game->emptyBlocks)
+    {
+        memset(GlobalLock(Game->hFieldBuffer), 0, FIELD_BUFFER_SIZE(Game));
+        GlobalUnlock(Game->hFieldBuffer);
+    }
+
+    Game->emptyBlocks = blocks;
+    Game->fieldHash   = 0;
+
+    DestroyCommandsList(Game->hCommandsBeginning);
+
+    Game->hSnakeStack        = NULL;
+    Game->hSnakeHead         = NULL;
+    Game->hCommandsBeginning = NULL;
+    Game->hCommandsEnding    = NULL;
+    Game->previousDirection  = INITIAL_DIRECTION;
+    Game->snakeSize          = 0;
+
+    result = BuildSnakeStack(Game);
+
+    if (result == SR_OK && Game->emptyBlocks == 0) result = SR_NO_SPACE_FOR_FOOD;
+
+    if (result != SR_OK)
+    {
+        EndingCleanUp(Game);
+        return result;
+    }
+
+    CreateNewFood(Game);
+    Game->snakeState = RUNNING;
+
+    return SR_OK;
+}
+
+void EndingCleanUp(SNAKE_GAME* Game)
+{
+    if (Game->hSnakeStack != NULL)
+    {
+        DestroySnakeStack(Game->hSnakeStack);
+        Game->hSnakeStack = NULL;
+        Game->hSnakeHead  = NULL;
+    }
+
+    if (Game->hSpareElements != NULL)
+    {
+        DestroySnakeStack(Game->hSpareElements);
+        Game->hSpareElements = NULL;
+    }
+
+    if (Game->hFieldBuffer != NULL)
+    {
+        GlobalFree(Game->hFieldBuffer);
+        Game->hFieldBuffer = NULL;
+    }
+
+    if (Game->hCommandsBeginning != NULL)
+    {
+        DestroyCommandsList(Game->hCommandsBeginning);
+        Game->hCommandsBeginning = NULL;
+        Game->hCommandsEnding    = NULL;
+    }
+}
+
+SNAKE_RESULT CopyGame(SNAKE_GAME* Copy, SNAKE_GAME* Game)
+{
+    GLOBALHANDLE       hSourceElement;
+    GLOBALHANDLE       hNextSource;
+    GLOBALHANDLE       hCopyElement;
+    SNAKE_ELEMENT*     pElement;
+    GLOBALHANDLE       hSourceCommand;
+    GLOBALHANDLE       hCopyCommand;
+    DIRECTION_COMMAND* pCommand;
+    WORD               position;
+    SNAKE_DIRECTION    direction;
+    UINT               traceId;
+
+    RESCAN_EVENTS(Copy);
+
+    //Field, reallocated only when its size changes
+    if (Copy->hFieldBuffer != NULL && (Game->hFieldBuffer == NULL || FIELD_BUFFER_SIZE(Copy) != FIELD_BUFFER_SIZE(Game)))
+    {
+        GlobalFree(Copy->hFieldBuffer);
+        Copy->hFieldBuffer = NULL;
+    }
+
+    Copy->fieldWidth        = Game->fieldWidth;
+    Copy->fieldHeight       = Game->fieldHeight;
+    Copy->snakeSpeed        = Game->snakeSpeed;
+    Copy->passThroughWalls  = Game->passThroughWalls;
+    Copy->headPosition      = Game->headPosition;
+    Copy->foodPosition      = Game->foodPosition;
+    Copy->previousDirection = Game->previousDirection;
+    Copy->snakeState        = Game->snakeState;
+    Copy->emptyBlocks       = Game->emptyBlocks;
+    Copy->snakeSize         = Game->snakeSize;
+    Copy->fieldHash         = Game->fieldHash;
+    Copy->randomState       = Game->randomState;
+    Copy->randomIncrement   = Game->randomIncrement;
+
+    if (Game->hFieldBuffer != NULL)
+    {
+        if (Copy->hFieldBuffer == NULL) Copy->hFieldBuffer = GlobalAlloc(GMEM_MOVEABLE, FIELD_BUFFER_SIZE(Game));
+        if (Copy->hFieldBuffer == NULL) return SR_MEMORY_ERROR;
+
+        memcpy(GlobalLock(Copy->hFieldBuffer), GlobalLock(Game->hFieldBuffer), FIELD_BUFFER_SIZE(Game));
+
+        GlobalUnlock(Game->hFieldBuffer);
+        GlobalUnlock(Copy->hFieldBuffer);
+    }
+
+    //Snake, made of the elements the copy already has, spares included
+    if (Copy->hSnakeStack != NULL)
+    {
+        pElement               = (SNAKE_ELEMENT*) GlobalLock(Copy->hSnakeHead);
+        pElement->hNextElement = Copy->hSpareElements;
+        GlobalUnlock(Copy->hSnakeHead);
+
+        Copy->hSpareElements = Copy->hSnakeStack;
+    }
+
+    Copy->hSnakeStack = NULL;
+    Copy->hSnakeHead  = NULL;
+
+    for (hSourceElement = Game->hSnakeStack; hSourceElement; hSourceElement = hNextSource)
+    {
+        pElement    = (SNAKE_ELEMENT*) GlobalLock(hSourceElement);
+        position    = pElement->blockPosition;
+        hNextSource = pElement->hNextElement;
+        GlobalUnlock(hSourceElement);
+
+        hCopyElement = TakeSnakeBlock(Copy, position, NULL);
+
+        if (!hCopyElement)
+        {
+            DestroySnakeStack(Copy->hSnakeStack);
+            Copy->hSnakeStack = NULL;
+            Copy->hSnakeHead  = NULL;
+            return SR_MEMORY_ERROR;
+        }
+
+        if (Copy->hSnakeHead == NULL) Copy->hSnakeStack = hCopyElement;
+        else
+        {
+            pElement               = (SNAKE_ELEMENT*) GlobalLock(Copy->hSnakeHead);
+            pElement->hNextElement = hCopyElement;
+            GlobalUnlock(Copy->hSnakeHead);
+        }
+
+        Copy->hSnakeHead = hCopyElement;
+    }
+
+    //Pending commands, usually none
+    DestroyCommandsList(Copy->hCommandsBeginning);
+    Copy->hCommandsBeginning = NULL;
+    Copy->hCommandsEnding    = NULL;
+
+    for (hSourceCommand = Game->hCommandsBeginning; hSourceCommand; hSourceCommand = hNextSource)
+    {
+        pCommand    = (DIRECTION_COMMAND*) GlobalLock(hSourceCommand);
+        direction   = pCommand->direction;
+        traceId     = pCommand->traceId;
+        hNextSource = pCommand->hNextCommand;
+        GlobalUnlock(hSourceCommand);
+
+        hCopyCommand = GlobalAlloc(GMEM_MOVEABLE, sizeof(DIRECTION_COMMAND));
+        if (hCopyCommand == NULL) return SR_MEMORY_ERROR;
+
+        pCommand               = (DIRECTION_COMMAND*) GlobalLock(hCopyCommand);
+        pCommand->direction    = direction;
+        pCommand->traceId      = traceId;
+        pCommand->hNextCommand = NULL;
+        GlobalUnlock(hCopyCommand);
+
+        if (Copy->hCommandsEnding == NULL) Copy->hCommandsBeginning = hCopyCommand;
+        else
+        {
+            pCommand               = (DIRECTION_COMMAND*) GlobalLock(Copy->hCommandsEnding);
+            pCommand->hNextCommand = hCopyCommand;
+            GlobalUnlock(Copy->hCommandsEnding);
+        }
+
+        Copy->hCommandsEnding = hCopyCommand;
+    }
+
+    return SR_OK;
+}
+
+UINT64 GameHash(SNAKE_GAME* Game)
+{
+    SNAKE_ELEMENT* pTailElement;
+    UINT64         hash = Game->fieldHash ^ ZobristKey(KEY_DIRECTION, (WORD) Game->previousDirection);
+
+    if (Game->hSnakeStack != NULL)
+    {
+        pTailElement = (SNAKE_ELEMENT*) GlobalLock(Game->hSnakeStack);
+        hash        ^= ZobristKey(KEY_TAIL, pTailElement->blockPosition);
+        GlobalUnlock(Game->hSnakeStack);
+    }
+
+    return hash;
+}
+
+UINT64 ComputeGameHash(SNAKE_GAME* Game)
+{
+    SNAKE_ELEMENT* pTailElement;
+    UINT64         hash = ZobristKey(KEY_DIRECTION, (WORD) Game->previousDirection);
+    WORD           position;
+    UINT           x, y;
+
+    if (Game->hFieldBuffer != NULL)
+    {
+        for (y = 0; y < Game->fieldHeight; y++)
+            for (x = 0; x < Game->fieldWidth; x++)
+            {
+                position = BLOCK_POSITION(x, y);
+                hash    ^= ZobristKey(GetFieldBlock(Game, position), position);
+            }
+    }
+
+    if (Game->hSnakeStack != NULL)
+    {
+        pTailElement = (SNAKE_ELEMENT*) GlobalLock(Game->hSnakeStack);
+        hash        ^= ZobristKey(KEY_TAIL, pTailElement->blockPosition);
+        GlobalUnlock(Game->hSnakeStack);
+    }
+
+    return hash;
+}
+
+LPCTSTR ResultToString(SNAKE_RESULT Result)
+{
+    switch (Result)
+    {
+        case SR_OK:                      return TEXT("No error.");
+        case SR_MEMORY_ERROR:            return TEXT("An error occurred while allocating memory.");
+        case SR_BAD_FIELD_SIZE:          return TEXT("Field width and height must be between 1 and 127.");
+        case SR_BAD_SNAKE_SIZE:          return TEXT("Snake size must be greater than zero.");
+        case SR_BAD_INITIAL_POSITION:    return TEXT("Snake doesn't fit into the field.");
+        case SR_BAD_SNAKE_SPEED:         return TEXT("The speed of the snake must be a positive integer.");
+        case SR_NO_SPACE_FOR_FOOD:       return TEXT("There is no empty space for the food.");
+        case SR_NO_CYCLE:                return TEXT("The field has no Hamiltonian cycle.");
+        default:                         return TEXT("");
+    }
+}
+
+
+//*****************************************************************************
+//
+//                          SUSPENDED GAME FUNCTIONS
+//
+//*****************************************************************************
+
+//Direction of the step from one block to a neighbour, RIGHT when the two are
+//the same block
+SNAKE_DIRECTION StepDirection(SNAKE_GAME* Game, WORD From, WORD To)
+{
+    SNAKE_DIRECTION direction;
+
+    for (direction = RIGHT; direction <= DOWN; direction++)
+        if (NewPosition(Game, From, 1, direction) == To) return direction;
+
+    return RIGHT;
+}
+
+UINT SuspendedSize(SNAKE_GAME* Game)
+{
+    UINT links = Game->snakeSize ? Game->snakeSize - 1 : 0;
+
+    return sizeof(SUSPENDED_GAME) + (links + CountCommands(Game) + 3) / 4;
+}
+
+SNAKE_RESULT SuspendGame(SNAKE_GAME* Game, GLOBALHANDLE* Suspended)
+{
+    GLOBALHANDLE       hSuspended;
+    SUSPENDED_GAME*    pSuspended;
+    BYTE*              pChain;
+    GLOBALHANDLE       hElement;
+    GLOBALHANDLE       hNextElement;
+    SNAKE_ELEMENT*     pElement;
+    GLOBALHANDLE       hCommand;
+    DIRECTION_COMMAND* pCommand;
+    WORD               position;
+    WORD               tailwardPosition = 0;
+    UINT               link;
+
+    hSuspended = GlobalAlloc(GHND, SuspendedSize(Game));
+
+    if (hSuspended == NULL) return SR_MEMORY_ERROR;
+
+    pSuspended = (SUSPENDED_GAME*) GlobalLock(hSuspended);
+    pChain     = SUSPENDED_CHAIN(pSuspended);
+
+    pSuspended->randomState       = Game->randomState;
+    pSuspended->randomIncrement   = Game->randomIncrement;
+    pSuspended->snakeSpeed        = Game->snakeSpeed;
+    pSuspended->snakeSize         = Game->snakeSize;
+    pSuspended->commandCount      = CountCommands(Game);
+    pSuspended->headPosition      = Game->headPosition;
+    pSuspended->foodPosition      = Game->foodPosition;
+    pSuspended->fieldWidth        = (BYTE) Game->fieldWidth;
+    pSuspended->fieldHeight       = (BYTE) Game->fieldHeight;
+    pSuspended->snakeState        = (BYTE) Game->snakeState;
+    pSuspended->previousDirection = (BYTE) Game->previousDirection;
+    pSuspended->flags             = Game->passThroughWalls ? SG_PASS_THROUGH_WALLS : 0;
+
+    if (Game->hFieldBuffer != NULL)
+    {
+        pSuspended->flags |= SG_FIELD;
+
+        if (GetFieldBlock(Game, Game->foodPosition) == FOOD) pSuspended->flags |= SG_FOOD;
+
+        //Running into a wall leaves the head on the block of the element
+        //behind it, or off the field when the snake is a single block
+        if (Game->snakeSize && GetFieldBlock(Game, Game->headPosition) != SNAKE_HEAD) pSuspended->flags |= SG_STALLED;
+    }
+
+    //The stack starts at the tail, whose element has the last link
+    link = Game->snakeSize;
+
+    for (hElement = Game->hSnakeStack; hElement; hElement = hNextElement)
+    {
+        pElement     = (SNAKE_ELEMENT*) GlobalLock(hElement);
+        position     = pElement->blockPosition;
+        hNextElement = pElement->hNextElement;
+        GlobalUnlock(hElement);
+
+        if (link-- < Game->snakeSize)
+            pChain[link / 4] |= StepDirection(Game, position, tailwardPosition) << 2 * (link % 4);
+
+        tailwardPosition = position;
+    }
+
+    //Pending commands follow the links
+    link = Game->snakeSize ? Game->snakeSize - 1 : 0;
+
+    for (hCommand = Game->hCommandsBeginning; hCommand; hCommand = pCommand->hNextCommand, link++)
+    {
+        pCommand = (DIRECTION_COMMAND*) GlobalLock(hCommand);
+        GlobalUnlock(hCommand);
+
+        pChain[link / 4] |= pCommand->direction << 2 * (link % 4);
+    }
+
+    GlobalUnlock(hSuspended);
+
+    EndingCleanUp(Game);
+    *Suspended = hSuspended;
+    return SR_OK;
+}
+
+//Rebuilds the game from the chain of a suspended game, leaving whatever was
+//built so far in the game when running out of memory
+SNAKE_RESULT UnpackSuspended(SNAKE_GAME* Game, SUSPENDED_GAME* Suspended)
+{
+    BYTE*              pChain = SUSPENDED_CHAIN(Suspended);
+    GLOBALHANDLE       hElement;
+    GLOBALHANDLE       hCommand;
+    DIRECTION_COMMAND* pCommand;
+    SNAKE_DIRECTION    direction;
+    WORD               position = Suspended->headPosition;
+    BOOL               hasField = Suspended->flags & SG_FIELD;
+    UINT               link, i;
+
+    if (hasField)
+    {
+        Game->hFieldBuffer = GlobalAlloc(GHND, FIELD_BUFFER_SIZE(Game));
+
+        if (Game->hFieldBuffer == NULL) return SR_MEMORY_ERROR;
+    }
+
+    //From the head to the tail, each element linking to the one before it
+    for (i = 0; i < Suspended->snakeSize; i++)
+    {
+        if (i > 0)
+        {
+            link      = i - 1;
+            direction = (SNAKE_DIRECTION) (pChain[link / 4] >> 2 * (link % 4) & 0x03);
+
+            if (i > 1 || !(Suspended->flags & SG_STALLED)) position = NewPosition(Game, position, 1, direction);
+
+            if (hasField) SetFieldBlock(Game, position, SNAKE_BODY);
+        }
+
+        hElement = CreateSnakeBlock(position, Game->hSnakeStack);
+
+        if (hElement == NULL) return SR_MEMORY_ERROR;
+
+        if (i == 0) Game->hSnakeHead = hElement;
+
+        Game->hSnakeStack = hElement;
+    }
+
+    //The head goes last, as it may lie on the block of the body it ran into
+    if (hasField && Suspended->snakeSize && !(Suspended->flags & SG_STALLED))
+        SetFieldBlock(Game, Suspended->headPosition, SNAKE_HEAD);
+
+    if (Suspended->flags & SG_FOOD) SetFieldBlock(Game, Suspended->foodPosition, FOOD);
+
+    link = Suspended->snakeSize ? Suspended->snakeSize - 1 : 0;
+
+    for (i = 0; i < Suspended->commandCount; i++, link++)
+    {
+        hCommand = GlobalAlloc(GMEM_MOVEABLE, sizeof(DIRECTION_COMMAND));
+
+        if (hCommand == NULL) return SR_MEMORY_ERROR;
+
+        pCommand               = (DIRECTION_COMMAND*) GlobalLock(hCommand);
+        pCommand->direction    = (SNAKE_DIRECTION) (pChain[link / 4] >> 2 * (link % 4) & 0x03);
+        pCommand->traceId      = 0;
+        pCommand->hNextCommand = NULL;
+        GlobalUnlock(hCommand);
+
+        if (Game->hCommandsEnding == NULL) Game->hCommandsBeginning = hCommand;
+        else
+        {
+            pCommand               = (DIRECTION_COMMAND*) GlobalLock(Game->hCommandsEnding);
+            pCommand->hNextCommand = hCommand;
+            GlobalUnlock(Game->hCommandsEnding);
+        }
+
+        Game->hCommandsEnding = hCommand;
+    }
+
+    return SR_OK;
+}
+
+SNAKE_RESULT RestoreGame(SNAKE_GAME* Game, GLOBALHANDLE Suspended)
+{
+    SUSPENDED_GAME* pSuspended = (SUSPENDED_GAME*) GlobalLock(Suspended);
+    SNAKE_RESULT    result;
+
+    RESCAN_EVENTS(Game);
+
+    Game->fieldWidth         = pSuspended->fieldWidth;
+    Game->fieldHeight        = pSuspended->fieldHeight;
+    Game->snakeSpeed         = pSuspended->snakeSpeed;
+    Game->passThroughWalls   = (pSuspended->flags & SG_PASS_THROUGH_WALLS) != 0;
+    Game->hFieldBuffer       = NULL;
+    Game->hSnakeStack        = NULL;
+    Game->hSnakeHead         = NULL;
+    Game->hSpareElements     = NULL;
+    Game->hCommandsBeginning = NULL;
+    Game->hCommandsEnding    = NULL;
+    Game->headPosition       = pSuspended->headPosition;
+    Game->foodPosition       = pSuspended->foodPosition;
+    Game->previousDirection  = (SNAKE_DIRECTION) pSuspended->previousDirection;
+    Game->snakeState         = (SNAKE_STATE) pSuspended->snakeState;
+    Game->emptyBlocks        = Game->fieldWidth * Game->fieldHeight;
+    Game->snakeSize          = pSuspended->snakeSize;
+    Game->fieldHash          = 0;
+    Game->randomState        = pSuspended->randomState;
+    Game->randomIncrement    = pSuspended->randomIncrement;
+
+    result = UnpackSuspended(Game, pSuspended);
+
+    GlobalUnlock(Suspended);
+
+    if (result != SR_OK)
+    {
+        EndingCleanUp(Game);
+        return result;
+    }
+
+    GlobalFree(Suspended);
+
+    return SR_OK;
+}
+
+
+//*****************************************************************************
+//
+//                          OBSERVATION & BATCH FUNCTIONS
+//
+//*****************************************************************************
+
+void WriteObservation(SNAKE_GAME* Game, BYTE* Plane)
+{
+    UINT blocks = Game->fieldWidth * Game->fieldHeight;
+    UINT i;
+
+    if (Game->hFieldBuffer == NULL)
+    {
+        for (i = 0; i < blocks; i++) Plane[i] = EMPTY;
+        return;
+    }
+
+    UnpackField(Game, Plane);
+}
+
+void WriteStatus(SNAKE_GAME* Game, SNAKE_STATUS* Status)
+{
+    Status->snakeState        = Game->snakeState;
+    Status->snakeSize         = Game->snakeSize;
+    Status->emptyBlocks       = Game->emptyBlocks;
+    Status->previousDirection = Game->previousDirection;
+}
+
+SNAKE_RESULT StepBatch(SNAKE_GAME* Games, UINT Count, const BYTE* Directions,
+                       BYTE* Planes, SNAKE_STATUS* Statuses)
+{
+    SNAKE_GAME*  pGame;
+    SNAKE_RESULT result;
+    UINT         i;
+
+    for (i = 0; i < Count; i++)
+    {
+        pGame = Games + i;
+
+        //Finished games are left untouched until the caller resets them
+        if (pGame->snakeState == RUNNING)
+        {
+            if (Directions != NULL && Directions[i] != NO_COMMAND)
+            {
+                result = ReceiveCommand(pGame, (SNAKE_DIRECTION) (Directions[i] & 3));
+                if (result != SR_OK) return result;
+            }
+
+            result = MoveSnake(pGame);
+            if (result != SR_OK) return result;
+        }
+
+        if (Planes != NULL) WriteObservation(pGame, Planes);
+        if (Statuses != NULL) WriteStatus(pGame, Statuses + i);
+
+        if (Planes != NULL) Planes += pGame->fieldWidth * pGame->fieldHeight;
+    }
+
+    return SR_OK;
+}
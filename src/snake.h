@@ -0,0 +1,300 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SNAKE_H
+#define SNAKE_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdlib.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              PLATFORM
+//
+//*****************************************************************************
+
+#ifndef _WIN32
+//The core only needs a handful of Win32 types and the global memory API, so
+//outside of Windows they are mapped onto the C runtime. Handles are plain
+//pointers there and locking a handle just returns it.
+typedef unsigned char      BYTE;
+typedef unsigned short     WORD;
+typedef unsigned int       UINT;
+typedef unsigned long long UINT64;
+typedef int                BOOL;
+typedef void*              GLOBALHANDLE;
+typedef const char*        LPCTSTR;
+
+#define TRUE                        1
+#define FALSE                       0
+#define TEXT(s)                     s
+
+#define GMEM_MOVEABLE               0x0002
+#define GMEM_ZEROINIT               0x0040
+#define GHND                        (GMEM_MOVEABLE | GMEM_ZEROINIT)
+
+#define GlobalAlloc(f, n)           ((GLOBALHANDLE) (((f) & GMEM_ZEROINIT) ? calloc(1, (n)) : malloc(n)))
+#define GlobalLock(h)               ((void*) (h))
+#define GlobalUnlock(h)             ((void) (h))
+#define GlobalFree(h)               free(h)
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define SNAKE_API_VERSION           9     //Bumped whenever the structures below change
+
+#define FIELD_WIDTH                 21    //Max: 127
+#define FIELD_HEIGHT                15    //Max: 127
+#define SNAKE_SPEED                 15    //Blocks per second
+#define INITIAL_DIRECTION           RIGHT
+#define INITIAL_SNAKE_SIZE          5
+#define PASS_THROUGH_WALLS          FALSE
+
+#define BLOCK_X(p)                  ((char) (p & 0x00FF))
+#define BLOCK_Y(p)                  ((char) ((p >> 8) & 0x00FF))
+#define BLOCK_POSITION(x, y)        ((WORD) (((x) & 0x00FF) | ((y) << 8 & 0xFF00)))
+#define BLOCK_BUFFER_POSITION(g, p) ((int) BLOCK_Y(p) * (g)->fieldWidth + (int) BLOCK_X(p))
+#define FIELD_BUFFER_SIZE(g)        (((g)->fieldWidth * (g)->fieldHeight + 3) / 4)
+#define OPPOSITE_DIRECTION(d)       ((SNAKE_DIRECTION) (((int) d + 2) & 3))
+#define IS_PERPENDICULAR(d1, d2)    ((BOOL) ((d1 ^ d2) & 0x01))
+#define IS_BLOCK_AVAILABLE(s)       ((BOOL) (~s & 0x02))
+#define CELL_EVENT_CAPACITY         8     //MoveSnake changes five blocks at most
+
+//Verification mode: MoveSnake recomputes the hash of the game from scratch
+//after every move and asserts it matches the incremental one
+#ifdef SNAKE_VERIFY_HASH
+#define VERIFY_HASH(g)              assert(GameHash(g) == ComputeGameHash(g))
+#else
+#define VERIFY_HASH(g)              ((void) 0)
+#endif
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _BLOCK_STATE
+{
+    EMPTY       = 0,
+    FOOD        = 1,
+    SNAKE_HEAD  = 2,
+    SNAKE_BODY  = 3
+} BLOCK_STATE;
+
+typedef enum _SNAKE_DIRECTION
+{
+    RIGHT   = 0,
+    UP      = 1,
+    LEFT    = 2,
+    DOWN    = 3
+} SNAKE_DIRECTION;
+
+typedef enum _SNAKE_RESULT
+{
+    SR_OK = 0,                  //No error.
+    SR_MEMORY_ERROR,            //An error occurred while allocating memory.
+    SR_BAD_FIELD_SIZE,          //Field width and height must be between 0 and 127.
+    SR_BAD_SNAKE_SIZE,          //Snake size must be greater than zero.
+    SR_BAD_INITIAL_POSITION,    //Snake doesn't fit into the field. Change the initial position or the initial direction.
+    SR_BAD_SNAKE_SPEED,         //The speed of the snake must be a positive integer.
+    SR_NO_SPACE_FOR_FOOD,       //There is no empty space for the food.
+    SR_NO_CYCLE                 //The field has no Hamiltonian cycle.
+} SNAKE_RESULT;
+
+typedef enum _SNAKE_STATE
+{
+    IDLE,
+    RUNNING,
+    PAUSED,
+    LOST,
+    WON
+} SNAKE_STATE;
+
+typedef struct _SNAKE_ELEMENT
+{
+    WORD         blockPosition;
+    GLOBALHANDLE hNextElement;
+} SNAKE_ELEMENT;
+
+typedef struct _DIRECTION_COMMAND
+{
+    SNAKE_DIRECTION direction;
+    UINT            traceId;
+    GLOBALHANDLE    hNextCommand;
+} DIRECTION_COMMAND;
+
+//A block that changed state
+typedef struct _CELL_EVENT
+{
+    WORD blockPosition;
+    BYTE oldState;              //BLOCK_STATE
+    BYTE newState;
+} CELL_EVENT;
+
+//The blocks a game changed since its last move, in the order they changed, so
+//a block may be listed more than once. A game with SNAKE_GAME::pEvents set
+//starts the list over on every MoveSnake, DoMove and UndoMove, which never
+//fill it, and appends to it on SetFieldBlock. Initialize, ResetGame, CopyGame
+//and RestoreGame rebuild the field without listing it and set overflow
+//instead, as does running out of room: the list is then incomplete and the
+//whole field must be read again. Without pEvents nothing is recorded.
+typedef struct _CELL_EVENTS
+{
+    UINT       count;
+    BOOL       overflow;
+    CELL_EVENT events[CELL_EVENT_CAPACITY];
+} CELL_EVENTS;
+
+//Everything a single game needs. The parameters are set by the caller before
+//Initialize, the remaining members are owned by the core functions.
+typedef struct _SNAKE_GAME
+{
+    //Parameters
+    UINT            fieldWidth;
+    UINT            fieldHeight;
+    UINT            snakeSpeed;
+    BOOL            passThroughWalls;
+    struct _HEATMAP* pHeatmap;          //Counts visits, deaths and food when set, see heatmap.h
+    CELL_EVENTS*    pEvents;            //Lists the blocks changed by every move when set
+
+    //State
+    GLOBALHANDLE    hFieldBuffer;
+    GLOBALHANDLE    hSnakeStack;        //Tail element, each one links to the next towards the head
+    GLOBALHANDLE    hSnakeHead;         //Last element of the stack
+    GLOBALHANDLE    hSpareElements;     //Elements of earlier games, taken before allocating new ones
+    GLOBALHANDLE    hCommandsBeginning;
+    GLOBALHANDLE    hCommandsEnding;
+    WORD            headPosition;
+    WORD            foodPosition;
+    SNAKE_DIRECTION previousDirection;
+    SNAKE_STATE     snakeState;
+    UINT            emptyBlocks;
+    UINT            snakeSize;
+    UINT64          fieldHash;          //Zobrist hash of the blocks, kept by SetFieldBlock
+    UINT64          randomState;        //PCG32 generator placing the food
+    UINT64          randomIncrement;    //Odd, selects the stream; zero until the game is seeded
+} SNAKE_GAME;
+
+//Fixed layout summary of a game, written by StepBatch so that a whole batch
+//can be read as one contiguous array of unsigned integers.
+typedef struct _SNAKE_STATUS
+{
+    UINT snakeState;
+    UINT snakeSize;
+    UINT emptyBlocks;
+    UINT previousDirection;
+} SNAKE_STATUS;
+
+#define NO_COMMAND                  0xFF  //Direction byte that leaves the snake going straight
+
+//Flags of a move delta, above the previous direction and state
+#define MD_GREW                     0x20  //The snake ate, taking an element at the tail
+#define MD_INSIDE                   0x40  //The head entered the block ahead, which didn't lie past a wall
+#define MD_FOOD                     0x80  //New food was placed
+
+//What DoMove changed in a game, enough for UndoMove to take it back. The
+//blocks hold the states the tail, the head and the block entered had before
+//the move, 2 bits each, and the flags the previous direction in bits 0-1 and
+//the state in bits 2-4.
+typedef struct _MOVE_DELTA
+{
+    UINT64       randomState;
+    GLOBALHANDLE hHeadElement;
+    WORD         headPosition;
+    WORD         tailPosition;
+    WORD         foodPosition;
+    BYTE         blocks;
+    BYTE         flags;
+} MOVE_DELTA;
+
+
+//*****************************************************************************
+//
+//                             SNAKE CORE FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT    Initialize       (SNAKE_GAME* Game, BOOL EmptyField);
+
+//ResetGame starts a new game in place of a finished one of the same field
+//size, without touching the heap: only the blocks of the old snake and food
+//are cleared, and the snake elements are reused. Games without a field are
+//initialized instead.
+SNAKE_RESULT    ResetGame        (SNAKE_GAME* Game);
+SNAKE_RESULT    ReceiveCommand   (SNAKE_GAME* Game, SNAKE_DIRECTION Direction);
+SNAKE_RESULT    MoveSnake        (SNAKE_GAME* Game);
+void            EndingCleanUp    (SNAKE_GAME* Game);
+WORD            NewPosition      (SNAKE_GAME* Game, WORD Position, char Steps, SNAKE_DIRECTION Direction);
+BOOL            IsInsideField    (SNAKE_GAME* Game, WORD Position);
+BLOCK_STATE     GetFieldBlock    (SNAKE_GAME* Game, WORD Position);
+void            SetFieldBlock    (SNAKE_GAME* Game, WORD Position, BLOCK_STATE NewState);
+LPCTSTR         ResultToString   (SNAKE_RESULT Result);
+
+//DoMove steps the game like MoveSnake, heading for Direction when it is
+//perpendicular to previousDirection and straight on otherwise, and records
+//what it changed into Delta. UndoMove takes back the last move done, exactly
+//and in constant time, so a depth-first search can walk a single game down
+//and up the tree instead of copying it. The game must have no commands
+//queued and only the deltas of its own moves may be undone, the latest
+//first. The element taken when the snake eats is kept as a spare, so going
+//back down a line allocates nothing. Heatmap counts are not taken back.
+SNAKE_RESULT    DoMove           (SNAKE_GAME* Game, SNAKE_DIRECTION Direction, MOVE_DELTA* Delta);
+void            UndoMove         (SNAKE_GAME* Game, const MOVE_DELTA* Delta);
+
+//CopyGame makes Copy an independent duplicate of Game. Copy must be zeroed or
+//hold a game, whose field and snake elements are then reused, so copying the
+//same game over and over allocates nothing once the copy's snake is as long.
+SNAKE_RESULT    CopyGame         (SNAKE_GAME* Copy, SNAKE_GAME* Game);
+
+//A suspended game is a single allocation holding the head position and the
+//rest of the snake as a chain of 2-bit directions, so it takes a few dozen
+//bytes plus one byte per four blocks of snake instead of an element per block
+//and a field. SuspendGame frees the game on success. RestoreGame rebuilds the
+//field and the snake, overwriting Game without freeing it, and frees the
+//suspended game on success. Only the snake and the food are kept, so blocks
+//set by the caller on an empty field are lost, and so are trace ids.
+UINT            SuspendedSize    (SNAKE_GAME* Game);
+SNAKE_RESULT    SuspendGame      (SNAKE_GAME* Game, GLOBALHANDLE* Suspended);
+SNAKE_RESULT    RestoreGame      (SNAKE_GAME* Game, GLOBALHANDLE Suspended);
+
+//Every game places its food from a PCG32 generator of its own, so games on
+//different threads share nothing and replay the same way whatever the order
+//they run in. SeedGame picks one of 2^63 independent streams of Seed, so a
+//single seed covers any number of games. A game never seeded takes its seed
+//from rand when it first places food. SkipRandom jumps Draws numbers ahead in
+//O(log Draws) steps, and RandomBelow draws without the bias of a modulo.
+void            SeedGame         (SNAKE_GAME* Game, UINT64 Seed, UINT64 Stream);
+void            SkipRandom       (SNAKE_GAME* Game, UINT64 Draws);
+UINT            RandomBelow      (SNAKE_GAME* Game, UINT Bound);
+
+//64-bit Zobrist hash of a game: a key for the state of every block that isn't
+//empty, the food included, one for previousDirection and one for the tail
+//position. GameHash is O(1), ComputeGameHash sweeps the field and must give
+//the same value. Snakes lying on the same blocks with the same head and tail
+//but with their middle in a different order share a hash.
+UINT64          GameHash         (SNAKE_GAME* Game);
+UINT64          ComputeGameHash  (SNAKE_GAME* Game);
+
+//Observation and batch functions. An observation plane has one byte per block
+//holding its BLOCK_STATE, stored row by row (index y * fieldWidth + x).
+void            WriteObservation (SNAKE_GAME* Game, BYTE* Plane);
+void            WriteStatus      (SNAKE_GAME* Game, SNAKE_STATUS* Status);
+SNAKE_RESULT    StepBatch        (SNAKE_GAME* Games, UINT Count, const BYTE* Directions,
+                                  BYTE* Planes, SNAKE_STATUS* Statuses);
+
+#endif
@@ -0,0 +1,1133 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "solver.h"
+#include "common.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define MIN_ENTRIES                 (1 << 16)
+#define NO_BLOCK                    0xFF
+#define NO_FOOD                     0x3F  //Food of a state whose food isn't placed yet
+#define NO_NODE                     0xFFFFFFFF
+#define BLOOM_BITS                  10    //Per spilled state
+#define BLOOM_PROBES                7
+
+//Flags of the tag of a memo entry
+#define TAG_KEYED                   (1ULL << 62)
+#define TAG_SOLVED                  (1ULL << 63)
+#define TAG_KEY                     (TAG_KEYED - 1)
+
+#define EVEN_BITS                   0x5555555555555555ULL
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _MOVE_OUTCOME
+{
+    MO_LOST,
+    MO_MOVED,
+    MO_ATE,                     //The next state has no food yet
+    MO_WON
+} MOVE_OUTCOME;
+
+typedef enum _MEMO_STATE
+{
+    MEMO_ABSENT,
+    MEMO_BUSY,                  //A thread is solving it
+    MEMO_SOLVED
+} MEMO_STATE;
+
+//A game reduced to what decides its future. Links are the directions from
+//every element of the snake to the next one towards the tail, head first, 2
+//bits each. Blocks are buffer positions.
+typedef struct _SOLVER_STATE
+{
+    UINT64 links[2];
+    UINT64 occupied;
+    BYTE   head;
+    BYTE   tail;
+    BYTE   length;
+    BYTE   food;
+    BYTE   direction;
+} SOLVER_STATE;
+
+//State whose strongly connected component is being searched
+typedef struct _SOLVER_NODE
+{
+    UINT64 key[2];
+    double best;                //Of the moves leaving the component so far
+    UINT   lowlink;             //Lowest node reached that is still on the stack
+} SOLVER_NODE;
+
+typedef struct _SOLVER_FRAME
+{
+    SOLVER_STATE state;
+    UINT64       pending;       //Food blocks left to solve in this pass
+    UINT64       deferred;      //Food blocks another thread was busy with
+    double       sum;
+    UINT         node;
+    BYTE         chance;        //Mean over the food blocks instead of best move
+    BYTE         step;          //Actions tried
+    BYTE         pass;
+    BYTE         count;
+} SOLVER_FRAME;
+
+typedef struct _SOLVER_WORKER
+{
+    SNAKE_SOLVER* solver;
+    UINT          index;
+    SOLVER_STATE  root;
+    double        value;
+    BOOL          done;         //Solved the root, rather than being stopped
+    SNAKE_RESULT  result;
+    UINT64        solved;
+
+    //Explicit stacks, since components may hold millions of states
+    SOLVER_FRAME* frames;
+    UINT          frameCount;
+    UINT          frameCapacity;
+    SOLVER_NODE*  nodes;
+    UINT          nodeCount;
+    UINT          nodeCapacity;
+    UINT*         map;          //Node + 1 of the keys on the node stack
+    UINT          mapMask;
+    UINT          mapCount;
+} SOLVER_WORKER;
+
+//Memo entry as written to the spill file
+typedef struct _SOLVER_RECORD
+{
+    UINT64 high;
+    UINT64 low;
+    double value;
+} SOLVER_RECORD;
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static UINT64 MixKey(const UINT64* Key)
+{
+    UINT64 state = Key[0] ^ (Key[1] * 0x9E3779B97F4A7C15ULL);
+
+    return SplitMix64(&state);
+}
+
+static int CompareKeys(UINT64 High1, UINT64 Low1, UINT64 High2, UINT64 Low2)
+{
+    if (High1 != High2) return High1 < High2 ? -1 : 1;
+    if (Low1  != Low2)  return Low1  < Low2  ? -1 : 1;
+
+    return 0;
+}
+
+static int CompareRecords(const void* Record1, const void* Record2)
+{
+    const SOLVER_RECORD* record1 = (const SOLVER_RECORD*) Record1;
+    const SOLVER_RECORD* record2 = (const SOLVER_RECORD*) Record2;
+
+    return CompareKeys(record1->high, record1->low, record2->high, record2->low);
+}
+
+static BOOL ReadAt(FILE* File, void* Buffer, UINT Size, UINT64 Offset)
+{
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    DWORD      read;
+
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset     = (DWORD) Offset;
+    overlapped.OffsetHigh = (DWORD) (Offset >> 32);
+
+    return ReadFile((HANDLE) _get_osfhandle(_fileno(File)), Buffer, Size, &read, &overlapped) && read == Size;
+#else
+    return pread(fileno(File), Buffer, Size, (off_t) Offset) == (ssize_t) Size;
+#endif
+}
+
+
+//*****************************************************************************
+//
+//                              STATE FUNCTIONS
+//
+//*****************************************************************************
+
+static MOVE_OUTCOME StepState(SNAKE_SOLVER* Solver, const SOLVER_STATE* State, SNAKE_DIRECTION Direction, SOLVER_STATE* Next)
+{
+    BYTE   head = Solver->neighbours[State->head][Direction];
+    UINT   links, link;
+    UINT64 lastLink;
+
+    if (head == NO_BLOCK) return MO_LOST;
+
+    //The tail leaves its block before the head moves, as in MoveSnake
+    if (head != State->food && head != State->tail && (State->occupied >> head & 1)) return MO_LOST;
+
+    //Two blocks across a field that wraps are neighbours both ways, and the
+    //link is the lowest direction, as GameToState finds it
+    link = OPPOSITE_DIRECTION(Direction);
+    if (Solver->neighbours[head][link & 1] == State->head) link &= 1;
+
+    Next->links[1]  = State->links[1] << 2 | State->links[0] >> 62;
+    Next->links[0]  = State->links[0] << 2 | link;
+    Next->head      = head;
+    Next->direction = (BYTE) Direction;
+
+    if (head == State->food)
+    {
+        Next->occupied = State->occupied | 1ULL << head;
+        Next->tail     = State->tail;
+        Next->length   = State->length + 1;
+        Next->food     = NO_FOOD;
+
+        return Next->length == Solver->blocks ? MO_WON : MO_ATE;
+    }
+
+    //The link to the tail is dropped, and the tail goes back along it
+    links    = State->length - 1;
+    lastLink = links ? (State->links[(links - 1) / 32] >> 2 * ((links - 1) % 32) & 3) : 0;
+
+    Next->tail     = links ? Solver->neighbours[State->tail][OPPOSITE_DIRECTION(lastLink)] : head;
+    Next->occupied = (State->occupied & ~(1ULL << State->tail)) | 1ULL << head;
+    Next->length   = State->length;
+    Next->food     = State->food;
+
+    if (links < 32) Next->links[0] &= (1ULL << 2 * links) - 1;
+    Next->links[1] &= links > 32 ? (1ULL << 2 * (links - 32)) - 1 : 0;
+
+    return MO_MOVED;
+}
+
+//Links mirrored in x flip the horizontal directions, those with the low bit
+//clear; mirrored in y, the vertical ones; transposed, every low bit
+static UINT64 TransformLinks(UINT64 Links, UINT64 Valid, UINT Symmetry)
+{
+    if (Symmetry & SYM_FLIP_X)    Links ^= (~Links & EVEN_BITS & Valid) << 1;
+    if (Symmetry & SYM_FLIP_Y)    Links ^= (Links & EVEN_BITS & Valid) << 1;
+    if (Symmetry & SYM_TRANSPOSE) Links ^= EVEN_BITS & Valid;
+
+    return Links;
+}
+
+//Smallest key of the state over the symmetries of the field. The high word
+//holds the links past the 32nd, then head, food, length and direction.
+static void CanonicalKey(SNAKE_SOLVER* Solver, const SOLVER_STATE* State, UINT64* Key)
+{
+    UINT   links     = State->length - 1;
+    UINT64 validLow  = links < 32 ? (1ULL << 2 * links) - 1 : ~0ULL;
+    UINT64 validHigh = links > 32 ? (1ULL << 2 * (links - 32)) - 1 : 0;
+    UINT64 high, low;
+    UINT   symmetry;
+    BYTE   food;
+
+    for (symmetry = 0; symmetry < Solver->symmetries; symmetry++)
+    {
+        food = State->food == NO_FOOD ? NO_FOOD : Solver->positions[symmetry][State->food];
+        low  = TransformLinks(State->links[0], validLow, symmetry);
+        high = TransformLinks(State->links[1], validHigh, symmetry)
+             | (UINT64) Solver->positions[symmetry][State->head] << 32
+             | (UINT64) food << 38
+             | (UINT64) State->length << 44
+             | (UINT64) Solver->directions[symmetry][State->direction] << 50;
+
+        if (symmetry == 0 || CompareKeys(high, low, Key[1], Key[0]) < 0)
+        {
+            Key[0] = low;
+            Key[1] = high;
+        }
+    }
+}
+
+static SNAKE_RESULT GameToState(SNAKE_SOLVER* Solver, SNAKE_GAME* Game, SOLVER_STATE* State)
+{
+    GLOBALHANDLE   hElement;
+    GLOBALHANDLE   hNextElement;
+    SNAKE_ELEMENT* pElement;
+    BYTE           positions[SOLVER_MAX_BLOCKS];
+    UINT           count = 0, link, direction;
+
+    if (Game->fieldWidth != Solver->fieldWidth || Game->fieldHeight != Solver->fieldHeight ||
+        Game->passThroughWalls != Solver->passThroughWalls || Game->snakeSize > Solver->blocks)
+        return SR_BAD_FIELD_SIZE;
+
+    if (Game->snakeSize == 0) return SR_BAD_SNAKE_SIZE;
+
+    memset(State, 0, sizeof(SOLVER_STATE));
+
+    //The stack starts at the tail
+    for (hElement = Game->hSnakeStack; hElement && count < Game->snakeSize; hElement = hNextElement, count++)
+    {
+        pElement         = (SNAKE_ELEMENT*) GlobalLock(hElement);
+        positions[count] = (BYTE) BLOCK_BUFFER_POSITION(Game, pElement->blockPosition);
+        hNextElement     = pElement->hNextElement;
+        GlobalUnlock(hElement);
+
+        State->occupied |= 1ULL << positions[count];
+    }
+
+    State->tail      = positions[0];
+    State->head      = positions[count - 1];
+    State->length    = (BYTE) count;
+    State->direction = (BYTE) Game->previousDirection;
+    State->food      = GetFieldBlock(Game, Game->foodPosition) == FOOD ? (BYTE) BLOCK_BUFFER_POSITION(Game, Game->foodPosition) : NO_FOOD;
+
+    for (link = 0; link + 1 < count; link++)
+    {
+        for (direction = 0; direction < 4; direction++)
+            if (Solver->neighbours[positions[count - 1 - link]][direction] == positions[count - 2 - link]) break;
+
+        State->links[link / 32] |= (UINT64) (direction & 3) << 2 * (link % 32);
+    }
+
+    return SR_OK;
+}
+
+
+//*****************************************************************************
+//
+//                              MEMO FUNCTIONS
+//
+//*****************************************************************************
+
+//Finds the entry of a key, taking an empty one for it when Claim is set. Only
+//returns NULL for keys that aren't there, when not claiming or when full.
+static SOLVER_ENTRY* FindEntry(SNAKE_SOLVER* Solver, const UINT64* Key, BOOL Claim)
+{
+    SOLVER_ENTRY* entry;
+    UINT64        index = MixKey(Key) & Solver->mask;
+    UINT64        tag;
+
+    for (;; index = (index + 1) & Solver->mask)
+    {
+        entry = Solver->entries + index;
+        tag   = __atomic_load_n(&entry->tag, __ATOMIC_ACQUIRE);
+
+        if (tag == 0)
+        {
+            if (!Claim || __atomic_load_n(&Solver->used, __ATOMIC_RELAXED) >= Solver->limit) return NULL;
+
+            if (__atomic_compare_exchange_n(&entry->tag, &tag, Key[1], FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                __atomic_add_fetch(&Solver->used, 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&entry->low, Key[0], __ATOMIC_RELAXED);
+                __atomic_store_n(&entry->tag, Key[1] | TAG_KEYED, __ATOMIC_RELEASE);
+                return entry;
+            }
+        }
+
+        //Another thread took the entry and is about to write its low word
+        while (!(tag & TAG_KEYED)) tag = __atomic_load_n(&entry->tag, __ATOMIC_ACQUIRE);
+
+        if ((tag & TAG_KEY) == Key[1] && __atomic_load_n(&entry->low, __ATOMIC_RELAXED) == Key[0]) return entry;
+    }
+}
+
+static BOOL BloomTest(const SOLVER_RUN* Run, UINT64 Hash, BOOL Set)
+{
+    UINT64 step = Hash >> 32 | 1;
+    UINT64 bit;
+    UINT   probe;
+
+    for (probe = 0; probe < BLOOM_PROBES; probe++, Hash += step)
+    {
+        bit = Hash & Run->bloomMask;
+
+        if (Set) Run->bloom[bit / 64] |= 1ULL << bit % 64;
+        else if (!(Run->bloom[bit / 64] >> bit % 64 & 1)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+//Looks a key up in the spilled runs, newest first
+static BOOL ProbeRuns(SNAKE_SOLVER* Solver, const UINT64* Key, double* Value)
+{
+    SOLVER_RECORD page[SOLVER_PAGE_ENTRIES];
+    SOLVER_RUN*   run;
+    UINT64        hash = MixKey(Key);
+    UINT64        pages, first, last, middle, count;
+    UINT          i;
+    int           order;
+
+    for (i = Solver->runCount; i-- > 0;)
+    {
+        run = Solver->runs + i;
+
+        if (!BloomTest(run, hash, FALSE)) continue;
+
+        //Last page starting at or before the key
+        pages = (run->count + SOLVER_PAGE_ENTRIES - 1) / SOLVER_PAGE_ENTRIES;
+
+        for (first = 0, last = pages; last - first > 1;)
+        {
+            middle = (first + last) / 2;
+
+            if (CompareKeys(run->pageKeys[2 * middle], run->pageKeys[2 * middle + 1], Key[1], Key[0]) <= 0) first = middle;
+            else last = middle;
+        }
+
+        count = run->count - first * SOLVER_PAGE_ENTRIES;
+        if (count > SOLVER_PAGE_ENTRIES) count = SOLVER_PAGE_ENTRIES;
+
+        __atomic_add_fetch(&Solver->diskReads, 1, __ATOMIC_RELAXED);
+
+        if (!ReadAt(Solver->spillFile, page, (UINT) (count * sizeof(SOLVER_RECORD)),
+                    run->offset + first * SOLVER_PAGE_ENTRIES * sizeof(SOLVER_RECORD)))
+            continue;
+
+        for (first = 0, last = count; first < last;)
+        {
+            middle = (first + last) / 2;
+            order  = CompareKeys(page[middle].high, page[middle].low, Key[1], Key[0]);
+
+            if (order == 0)
+            {
+                *Value = page[middle].value;
+                return TRUE;
+            }
+
+            if (order < 0) first = middle + 1;
+            else last = middle;
+        }
+    }
+
+    return FALSE;
+}
+
+static MEMO_STATE ProbeMemo(SNAKE_SOLVER* Solver, const UINT64* Key, double* Value)
+{
+    SOLVER_ENTRY* entry = FindEntry(Solver, Key, FALSE);
+
+    if (entry == NULL) return ProbeRuns(Solver, Key, Value) ? MEMO_SOLVED : MEMO_ABSENT;
+
+    if (!(__atomic_load_n(&entry->tag, __ATOMIC_ACQUIRE) & TAG_SOLVED)) return MEMO_BUSY;
+
+    __atomic_load(&entry->value, Value, __ATOMIC_RELAXED);
+    return MEMO_SOLVED;
+}
+
+//Writes the memo table to a new run of the spill file and empties it. Runs
+//with every worker stopped.
+static void SpillTable(SNAKE_SOLVER* Solver)
+{
+    SOLVER_RECORD* records = (SOLVER_RECORD*) Solver->entries; //Compacted in place, entries being as large
+    SOLVER_RUN*    runs;
+    SOLVER_RUN*    run;
+    UINT64         key[2];
+    UINT64         count = 0, bits, i;
+
+    for (i = 0; i <= Solver->mask; i++)
+    {
+        //Entries some thread was only busy with are dropped
+        if (!(Solver->entries[i].tag & TAG_SOLVED)) continue;
+
+        records[count].high  = Solver->entries[i].tag & TAG_KEY;
+        records[count].low   = Solver->entries[i].low;
+        records[count].value = Solver->entries[i].value;
+        count++;
+    }
+
+    qsort(records, count, sizeof(SOLVER_RECORD), CompareRecords);
+
+    runs = (SOLVER_RUN*) realloc(Solver->runs, (Solver->runCount + 1) * sizeof(SOLVER_RUN));
+
+    if (runs != NULL && count > 0)
+    {
+        Solver->runs = runs;
+        run          = runs + Solver->runCount;
+
+        for (bits = 64; bits < count * BLOOM_BITS; bits *= 2);
+
+        run->offset    = Solver->spillSize;
+        run->count     = count;
+        run->bloomMask = bits - 1;
+        run->bloom     = (UINT64*) calloc(bits / 64, sizeof(UINT64));
+        run->pageKeys  = (UINT64*) malloc((count + SOLVER_PAGE_ENTRIES - 1) / SOLVER_PAGE_ENTRIES * 2 * sizeof(UINT64));
+
+        fseek(Solver->spillFile, 0, SEEK_END);
+
+        if (run->bloom && run->pageKeys && fwrite(records, sizeof(SOLVER_RECORD), count, Solver->spillFile) == count &&
+            fflush(Solver->spillFile) == 0)
+        {
+            for (i = 0; i < count; i++)
+            {
+                key[0] = records[i].low;
+                key[1] = records[i].high;
+                BloomTest(run, MixKey(key), TRUE);
+
+                if (i % SOLVER_PAGE_ENTRIES) continue;
+
+                run->pageKeys[i / SOLVER_PAGE_ENTRIES * 2]     = records[i].high;
+                run->pageKeys[i / SOLVER_PAGE_ENTRIES * 2 + 1] = records[i].low;
+            }
+
+            Solver->runCount++;
+            Solver->spillSize     += count * sizeof(SOLVER_RECORD);
+            Solver->spilledStates += count;
+        }
+        else
+        {
+            free(run->bloom);
+            free(run->pageKeys);
+        }
+    }
+    else if (runs != NULL) Solver->runs = runs;
+
+    //States that couldn't be written are just solved again
+    memset(Solver->entries, 0, (Solver->mask + 1) * sizeof(SOLVER_ENTRY));
+    Solver->used = 0;
+}
+
+
+//*****************************************************************************
+//
+//                              WORKER FUNCTIONS
+//
+//*****************************************************************************
+
+//Called with the lock held by the last worker to stop
+static void SpillAndResume(SNAKE_SOLVER* Solver)
+{
+    SpillTable(Solver);
+
+    Solver->parked = 0;
+    Solver->spills++;
+    __atomic_store_n(&Solver->spillPending, 0, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&Solver->resumed);
+}
+
+static void ParkWorker(SNAKE_SOLVER* Solver)
+{
+    UINT64 spills;
+
+    pthread_mutex_lock(&Solver->lock);
+
+    spills = Solver->spills;
+
+    if (Solver->spillPending)
+    {
+        if (++Solver->parked == Solver->active) SpillAndResume(Solver);
+        else while (Solver->spills == spills) pthread_cond_wait(&Solver->resumed, &Solver->lock);
+    }
+
+    pthread_mutex_unlock(&Solver->lock);
+}
+
+static void LeaveWorkers(SNAKE_SOLVER* Solver)
+{
+    pthread_mutex_lock(&Solver->lock);
+
+    Solver->active--;
+    if (Solver->spillPending && Solver->parked == Solver->active) SpillAndResume(Solver);
+
+    pthread_mutex_unlock(&Solver->lock);
+}
+
+static void StoreMemo(SNAKE_SOLVER* Solver, const UINT64* Key, double Value)
+{
+    SOLVER_ENTRY* entry;
+
+    while ((entry = FindEntry(Solver, Key, TRUE)) == NULL)
+    {
+        __atomic_store_n(&Solver->spillPending, 1, __ATOMIC_RELEASE);
+        ParkWorker(Solver);
+    }
+
+    __atomic_store(&entry->value, &Value, __ATOMIC_RELAXED);
+    __atomic_fetch_or(&entry->tag, TAG_SOLVED, __ATOMIC_RELEASE);
+}
+
+static BOOL Reserve(void** Array, UINT* Capacity, UINT Count, size_t Size)
+{
+    void* array;
+    UINT  capacity = *Capacity ? *Capacity : 1024;
+
+    if (Count < *Capacity) return TRUE;
+
+    while (capacity <= Count) capacity *= 2;
+
+    if ((array = realloc(*Array, capacity * Size)) == NULL) return FALSE;
+
+    *Array    = array;
+    *Capacity = capacity;
+    return TRUE;
+}
+
+static UINT FindNode(SOLVER_WORKER* Worker, const UINT64* Key)
+{
+    UINT index, node;
+
+    for (index = (UINT) MixKey(Key) & Worker->mapMask; Worker->map[index]; index = (index + 1) & Worker->mapMask)
+    {
+        node = Worker->map[index] - 1;
+
+        if (Worker->nodes[node].key[0] == Key[0] && Worker->nodes[node].key[1] == Key[1]) return node;
+    }
+
+    return NO_NODE;
+}
+
+static BOOL InsertNode(SOLVER_WORKER* Worker, UINT Node)
+{
+    UINT* map;
+    UINT  size = Worker->mapMask + 1;
+    UINT  index, i;
+
+    //Kept at most half full
+    if (2 * (Worker->mapCount + 1) > size)
+    {
+        if ((map = (UINT*) calloc(2 * size, sizeof(UINT))) == NULL) return FALSE;
+
+        for (i = 0; i < size; i++)
+        {
+            if (Worker->map[i] == 0) continue;
+
+            for (index = (UINT) MixKey(Worker->nodes[Worker->map[i] - 1].key) & (2 * size - 1); map[index];
+                 index = (index + 1) & (2 * size - 1));
+
+            map[index] = Worker->map[i];
+        }
+
+        free(Worker->map);
+        Worker->map     = map;
+        Worker->mapMask = 2 * size - 1;
+    }
+
+    for (index = (UINT) MixKey(Worker->nodes[Node].key) & Worker->mapMask; Worker->map[index];
+         index = (index + 1) & Worker->mapMask);
+
+    Worker->map[index] = Node + 1;
+    Worker->mapCount++;
+    return TRUE;
+}
+
+//Backward shift deletion, so that probes never need tombstones
+static void RemoveNode(SOLVER_WORKER* Worker, UINT Node)
+{
+    UINT hole, index, home;
+
+    for (hole = (UINT) MixKey(Worker->nodes[Node].key) & Worker->mapMask; Worker->map[hole] != Node + 1;
+         hole = (hole + 1) & Worker->mapMask);
+
+    for (index = (hole + 1) & Worker->mapMask; Worker->map[index]; index = (index + 1) & Worker->mapMask)
+    {
+        home = (UINT) MixKey(Worker->nodes[Worker->map[index] - 1].key) & Worker->mapMask;
+
+        //Entries whose home lies cyclically in (hole, index] stay where they are
+        if (((index - home) & Worker->mapMask) < ((index - hole) & Worker->mapMask)) continue;
+
+        Worker->map[hole] = Worker->map[index];
+        hole              = index;
+    }
+
+    Worker->map[hole] = 0;
+    Worker->mapCount--;
+}
+
+static BOOL PushState(SOLVER_WORKER* Worker, const SOLVER_STATE* State, const UINT64* Key)
+{
+    SOLVER_FRAME* frame;
+    SOLVER_NODE*  node;
+
+    if (!Reserve((void**) &Worker->frames, &Worker->frameCapacity, Worker->frameCount, sizeof(SOLVER_FRAME)) ||
+        !Reserve((void**) &Worker->nodes, &Worker->nodeCapacity, Worker->nodeCount, sizeof(SOLVER_NODE)))
+        return FALSE;
+
+    node          = Worker->nodes + Worker->nodeCount;
+    node->key[0]  = Key[0];
+    node->key[1]  = Key[1];
+    node->best    = 0.0;
+    node->lowlink = Worker->nodeCount;
+
+    if (!InsertNode(Worker, Worker->nodeCount)) return FALSE;
+
+    frame         = Worker->frames + Worker->frameCount++;
+    frame->state  = *State;
+    frame->node   = Worker->nodeCount++;
+    frame->chance = FALSE;
+    frame->step   = 0;
+
+    return TRUE;
+}
+
+static BOOL PushChance(SOLVER_WORKER* Worker, const SOLVER_STATE* State)
+{
+    SNAKE_SOLVER* solver = Worker->solver;
+    SOLVER_FRAME* frame;
+    UINT64        all    = solver->blocks == 64 ? ~0ULL : (1ULL << solver->blocks) - 1;
+
+    if (!Reserve((void**) &Worker->frames, &Worker->frameCapacity, Worker->frameCount, sizeof(SOLVER_FRAME)))
+        return FALSE;
+
+    frame           = Worker->frames + Worker->frameCount++;
+    frame->state    = *State;
+    frame->pending  = all & ~State->occupied;
+    frame->deferred = 0;
+    frame->sum      = 0.0;
+    frame->chance   = TRUE;
+    frame->pass     = 0;
+    frame->count    = (BYTE) __builtin_popcountll(frame->pending);
+
+    return TRUE;
+}
+
+//Next food placement of a chance frame left to solve, adding up those already
+//solved. Placements another thread is busy with are put off to a second pass.
+static BOOL NextFood(SOLVER_WORKER* Worker, SOLVER_FRAME* Frame, SOLVER_STATE* Next, UINT64* Key)
+{
+    SNAKE_SOLVER* solver = Worker->solver;
+    UINT64        rotated;
+    double        value;
+    UINT          block;
+    UINT          start = Worker->index * 7 % solver->blocks;
+
+    for (;;)
+    {
+        if (Frame->pending == 0)
+        {
+            if (Frame->pass > 0 || Frame->deferred == 0) return FALSE;
+
+            Frame->pending  = Frame->deferred;
+            Frame->deferred = 0;
+            Frame->pass     = 1;
+        }
+
+        //Threads start at different blocks
+        rotated = Frame->pending >> start;
+        block   = rotated ? start + (UINT) __builtin_ctzll(rotated) : (UINT) __builtin_ctzll(Frame->pending);
+
+        Frame->pending &= ~(1ULL << block);
+        *Next           = Frame->state;
+        Next->food      = (BYTE) block;
+
+        CanonicalKey(solver, Next, Key);
+
+        switch (ProbeMemo(solver, Key, &value))
+        {
+            case MEMO_SOLVED:
+                Frame->sum += value;
+                break;
+
+            case MEMO_BUSY:
+                if (Frame->pass == 0)
+                {
+                    Frame->deferred |= 1ULL << block;
+                    break;
+                }
+
+                return TRUE;
+
+            case MEMO_ABSENT:
+                FindEntry(solver, Key, TRUE);
+                return TRUE;
+        }
+    }
+}
+
+//Gives every state of a finished component the best value found in it
+static double SolveComponent(SOLVER_WORKER* Worker, UINT Root)
+{
+    double best = 0.0;
+    UINT   node;
+
+    for (node = Root; node < Worker->nodeCount; node++)
+        if (Worker->nodes[node].best > best) best = Worker->nodes[node].best;
+
+    for (node = Root; node < Worker->nodeCount; node++)
+    {
+        StoreMemo(Worker->solver, Worker->nodes[node].key, best);
+        RemoveNode(Worker, node);
+    }
+
+    Worker->solved   += Worker->nodeCount - Root;
+    Worker->nodeCount = Root;
+
+    return best;
+}
+
+//Tarjan's algorithm over the states of each length, nested through the food,
+//with explicit stacks. A frame that returns passes its value up when its
+//component was finished, and its lowlink otherwise.
+static void* SolverWorker(void* Parameter)
+{
+    SOLVER_WORKER* worker   = (SOLVER_WORKER*) Parameter;
+    SNAKE_SOLVER*  solver   = worker->solver;
+    SOLVER_FRAME*  frame;
+    SOLVER_NODE*   node;
+    SOLVER_STATE   next;
+    MOVE_OUTCOME   outcome;
+    UINT64         key[2];
+    double         value    = 0.0;
+    UINT           lowlink  = 0;
+    UINT           found;
+    BOOL           returned = FALSE;
+    BOOL           finished = FALSE;
+    BOOL           pushed   = FALSE;
+
+    worker->frameCount = 0;
+    worker->nodeCount  = 0;
+    worker->mapCount   = 0;
+    worker->solved     = 0;
+    worker->done       = FALSE;
+    worker->result     = SR_OK;
+
+    if (worker->map == NULL)
+    {
+        worker->map     = (UINT*) calloc(1024, sizeof(UINT));
+        worker->mapMask = 1023;
+    }
+    else memset(worker->map, 0, (worker->mapMask + 1) * sizeof(UINT));
+
+    if (worker->map == NULL) worker->result = SR_MEMORY_ERROR;
+    else if (worker->root.food == NO_FOOD) pushed = PushChance(worker, &worker->root);
+    else
+    {
+        CanonicalKey(solver, &worker->root, key);
+        pushed = PushState(worker, &worker->root, key);
+    }
+
+    if (worker->result == SR_OK && !pushed) worker->result = SR_MEMORY_ERROR;
+
+    while (worker->frameCount > 0 && worker->result == SR_OK)
+    {
+        if (__atomic_load_n(&solver->spillPending, __ATOMIC_ACQUIRE)) ParkWorker(solver);
+        if (__atomic_load_n(&solver->stop, __ATOMIC_RELAXED)) break;
+
+        frame = worker->frames + worker->frameCount - 1;
+
+        if (frame->chance)
+        {
+            if (returned) frame->sum += value;
+
+            returned = FALSE;
+
+            if (NextFood(worker, frame, &next, key))
+            {
+                if (!PushState(worker, &next, key)) worker->result = SR_MEMORY_ERROR;
+                continue;
+            }
+
+            value    = frame->sum / frame->count;
+            finished = TRUE;
+            returned = TRUE;
+            worker->frameCount--;
+            continue;
+        }
+
+        node = worker->nodes + frame->node;
+
+        if (returned && finished && value > node->best) node->best = value;
+        if (returned && !finished && lowlink < node->lowlink) node->lowlink = lowlink;
+
+        returned = FALSE;
+        pushed   = FALSE;
+
+        while (frame->step < 3 && !pushed)
+        {
+            outcome = StepState(solver, &frame->state, TURN(frame->state.direction, (frame->step++ + worker->index) % 3), &next);
+
+            if (outcome == MO_WON) node->best = 1.0;
+            else if (outcome == MO_ATE)
+            {
+                if (!PushChance(worker, &next)) worker->result = SR_MEMORY_ERROR;
+                pushed = TRUE;
+            }
+            else if (outcome == MO_MOVED)
+            {
+                CanonicalKey(solver, &next, key);
+
+                if (ProbeMemo(solver, key, &value) == MEMO_SOLVED)
+                {
+                    if (value > node->best) node->best = value;
+                }
+                else if ((found = FindNode(worker, key)) != NO_NODE)
+                {
+                    if (found < node->lowlink) node->lowlink = found;
+                }
+                else
+                {
+                    if (!PushState(worker, &next, key)) worker->result = SR_MEMORY_ERROR;
+                    pushed = TRUE;
+                }
+            }
+        }
+
+        if (pushed) continue;
+
+        //Every move was tried
+        finished = node->lowlink == frame->node;
+        lowlink  = node->lowlink;
+        returned = TRUE;
+
+        if (finished) value = SolveComponent(worker, frame->node);
+
+        worker->frameCount--;
+    }
+
+    //The first worker done with the root stops the others
+    if (worker->result == SR_OK && worker->frameCount == 0)
+    {
+        worker->value = value;
+        worker->done  = TRUE;
+        __atomic_store_n(&solver->stop, 1, __ATOMIC_RELAXED);
+    }
+
+    LeaveWorkers(solver);
+    return NULL;
+}
+
+//Solves a state, or the mean over its food placements when it has no food
+static SNAKE_RESULT SolveState(SNAKE_SOLVER* Solver, const SOLVER_STATE* Root, double* Value)
+{
+    pthread_t threads[MAX_THREADS];
+    BOOL      started[MAX_THREADS];
+    UINT64    key[2];
+    UINT64    solved = 0;
+    double    start  = Now();
+    BOOL      done   = FALSE;
+    UINT      i;
+
+    if (Root->food != NO_FOOD)
+    {
+        CanonicalKey(Solver, Root, key);
+        if (ProbeMemo(Solver, key, Value) == MEMO_SOLVED) return SR_OK;
+    }
+
+    Solver->stop   = 0;
+    Solver->active = Solver->threadCount;
+
+    for (i = 0; i < Solver->threadCount; i++) Solver->workers[i].root = *Root;
+
+    //The calling thread is the first worker
+    for (i = 1; i < Solver->threadCount; i++)
+        started[i] = pthread_create(threads + i, NULL, SolverWorker, Solver->workers + i) == 0;
+
+    //Workers that didn't start don't take part in spills
+    for (i = 1; i < Solver->threadCount; i++) if (!started[i]) LeaveWorkers(Solver);
+
+    SolverWorker(Solver->workers);
+
+    for (i = 1; i < Solver->threadCount; i++) if (started[i]) pthread_join(threads[i], NULL);
+
+    *Value = 0.0;
+
+    for (i = 0; i < Solver->threadCount; i++)
+    {
+        if (i > 0 && !started[i]) continue;
+
+        solved += Solver->workers[i].solved;
+
+        if (Solver->workers[i].done) *Value = Solver->workers[i].value;
+        if (Solver->workers[i].done) done = TRUE;
+    }
+
+    Solver->statesSolved += solved;
+    Solver->elapsed      += Now() - start;
+
+    return done ? SR_OK : SR_MEMORY_ERROR;
+}
+
+
+//*****************************************************************************
+//
+//                              SOLVER FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateSolver(SNAKE_SOLVER* Solver, UINT Width, UINT Height, BOOL PassThroughWalls,
+                          UINT Threads, UINT64 Memory, const char* SpillFile)
+{
+    SNAKE_GAME field;
+    UINT64     entries = MIN_ENTRIES;
+    WORD       position;
+    UINT       symmetry, block, direction;
+
+    memset(Solver, 0, sizeof(SNAKE_SOLVER));
+    pthread_mutex_init(&Solver->lock, NULL);
+    pthread_cond_init(&Solver->resumed, NULL);
+
+    if (Width == 0 || Height == 0 || Width * Height > SOLVER_MAX_BLOCKS) return SR_BAD_FIELD_SIZE;
+
+    if (Threads == 0) Threads = ProcessorCount();
+    if (Threads > MAX_THREADS) Threads = MAX_THREADS;
+    if (Memory == 0) Memory = SOLVER_MEMORY;
+
+    while (2 * entries * sizeof(SOLVER_ENTRY) <= Memory) entries *= 2;
+
+    Solver->fieldWidth       = Width;
+    Solver->fieldHeight      = Height;
+    Solver->passThroughWalls = PassThroughWalls;
+    Solver->blocks           = Width * Height;
+    Solver->symmetries       = Width == Height ? SYMMETRY_COUNT : SYM_TRANSPOSE;
+    Solver->threadCount      = Threads;
+    Solver->mask             = entries - 1;
+    Solver->limit            = entries / 4 * 3;
+
+    //Moves as NewPosition makes them
+    memset(&field, 0, sizeof(SNAKE_GAME));
+    field.fieldWidth       = Width;
+    field.fieldHeight      = Height;
+    field.passThroughWalls = PassThroughWalls;
+
+    for (block = 0; block < Solver->blocks; block++)
+    {
+        for (direction = 0; direction < 4; direction++)
+        {
+            position = NewPosition(&field, BLOCK_POSITION(block % Width, block / Width), 1, (SNAKE_DIRECTION) direction);
+
+            Solver->neighbours[block][direction] = IsInsideField(&field, position) ? (BYTE) BLOCK_BUFFER_POSITION(&field, position) : NO_BLOCK;
+        }
+
+        for (symmetry = 0; symmetry < Solver->symmetries; symmetry++)
+        {
+            position = TransformPosition(symmetry, Width, Height, BLOCK_POSITION(block % Width, block / Width));
+
+            Solver->positions[symmetry][block] = (BYTE) (BLOCK_Y(position) * Width + BLOCK_X(position));
+        }
+    }
+
+    for (symmetry = 0; symmetry < Solver->symmetries; symmetry++)
+        for (direction = 0; direction < 4; direction++)
+            Solver->directions[symmetry][direction] = (BYTE) TransformDirection(symmetry, (SNAKE_DIRECTION) direction);
+
+    Solver->entries = (SOLVER_ENTRY*) calloc(entries, sizeof(SOLVER_ENTRY));
+    Solver->workers = (SOLVER_WORKER*) calloc(Threads, sizeof(SOLVER_WORKER));
+
+    if (SpillFile != NULL)
+    {
+        strncpy(Solver->spillPath, SpillFile, sizeof(Solver->spillPath) - 1);
+        Solver->spillFile = fopen(SpillFile, "w+b");
+    }
+    else Solver->spillFile = tmpfile();
+
+    if (!Solver->entries || !Solver->workers || !Solver->spillFile)
+    {
+        DestroySolver(Solver);
+        return SR_MEMORY_ERROR;
+    }
+
+    for (block = 0; block < Threads; block++)
+    {
+        Solver->workers[block].solver = Solver;
+        Solver->workers[block].index  = block;
+    }
+
+    return SR_OK;
+}
+
+void DestroySolver(SNAKE_SOLVER* Solver)
+{
+    UINT i;
+
+    for (i = 0; Solver->workers && i < Solver->threadCount; i++)
+    {
+        free(Solver->workers[i].frames);
+        free(Solver->workers[i].nodes);
+        free(Solver->workers[i].map);
+    }
+
+    for (i = 0; i < Solver->runCount; i++)
+    {
+        free(Solver->runs[i].pageKeys);
+        free(Solver->runs[i].bloom);
+    }
+
+    if (Solver->spillFile != NULL)
+    {
+        fclose(Solver->spillFile);
+
+        if (Solver->spillPath[0]) remove(Solver->spillPath);
+    }
+
+    pthread_mutex_destroy(&Solver->lock);
+    pthread_cond_destroy(&Solver->resumed);
+
+    free(Solver->entries);
+    free(Solver->workers);
+    free(Solver->runs);
+
+    memset(Solver, 0, sizeof(SNAKE_SOLVER));
+}
+
+SNAKE_RESULT SolveGame(SNAKE_SOLVER* Solver, SNAKE_GAME* Game, BOOL NewFood, double* Value)
+{
+    SOLVER_STATE state;
+    SNAKE_RESULT result;
+
+    *Value = Game->snakeState == WON ? 1.0 : 0.0;
+
+    if (Game->snakeState == WON || Game->snakeState == LOST) return SR_OK;
+
+    if ((result = GameToState(Solver, Game, &state)) != SR_OK) return result;
+
+    if (NewFood) state.food = NO_FOOD;
+
+    return SolveState(Solver, &state, Value);
+}
+
+SNAKE_RESULT SolveMoves(SNAKE_SOLVER* Solver, SNAKE_GAME* Game, double Values[4])
+{
+    SOLVER_STATE    state, next;
+    SNAKE_RESULT    result;
+    SNAKE_DIRECTION direction;
+    UINT            action;
+
+    for (action = 0; action < 4; action++) Values[action] = 0.0;
+
+    if (Game->snakeState == WON || Game->snakeState == LOST) return SR_OK;
+
+    if ((result = GameToState(Solver, Game, &state)) != SR_OK) return result;
+
+    for (action = 0; action < 3; action++)
+    {
+        direction = TURN(state.direction, action);
+
+        switch (StepState(Solver, &state, direction, &next))
+        {
+            case MO_LOST:
+                break;
+
+            case MO_WON:
+                Values[direction] = 1.0;
+                break;
+
+            default:
+                if ((result = SolveState(Solver, &next, Values + direction)) != SR_OK) return result;
+        }
+    }
+
+    Values[OPPOSITE_DIRECTION(state.direction)] = Values[state.direction];
+    return SR_OK;
+}
+
+double SolverRate(SNAKE_SOLVER* Solver)
+{
+    if (Solver->elapsed <= 0.0) return 0.0;
+
+    return Solver->statesSolved / Solver->elapsed;
+}
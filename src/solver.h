@@ -0,0 +1,137 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include "snake.h"
+#include "symmetry.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define SOLVER_MAX_BLOCKS           48    //Largest field solved, such as 6x8 or 7x6
+#define SOLVER_MEMORY               (1ULL << 28) //Default size of the memo table, 256 MB
+#define SOLVER_PAGE_ENTRIES         128   //Entries read at once from the spill file
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Solved state of the memo table. The tag is the high word of the key with
+//flags for the low word being written and the value being final.
+typedef struct _SOLVER_ENTRY
+{
+    UINT64 tag;
+    UINT64 low;
+    double value;
+} SOLVER_ENTRY;
+
+//Memo table written to the spill file once full, sorted by key. The Bloom
+//filter and the first key of every page stay in memory, so looking a state up
+//reads a single page, and only when it is likely there.
+typedef struct _SOLVER_RUN
+{
+    UINT64  offset;
+    UINT64  count;
+    UINT64* pageKeys;           //High and low word of the first key of every page
+    UINT64* bloom;
+    UINT64  bloomMask;          //Bits of the filter - 1
+} SOLVER_RUN;
+
+//Exact probability of winning under optimal play, the food being placed at
+//random on any empty block as CreateNewFood does. States are memoized by
+//their exact contents seen in the smallest orientation of the field, so the
+//rotations and mirrors of a state are solved once.
+//
+//Moves only grow the snake by eating, so the states of one length only lead
+//to each other or, through the food, to longer ones. Among states of the same
+//length the value is the best of what can be reached, found one strongly
+//connected component at a time; the values of the longer states are the mean
+//over every food placement. Every thread solves the whole game, sharing the
+//memo table, and the food placements another thread is busy with are left
+//for last, so the threads spread over different subtrees.
+typedef struct _SNAKE_SOLVER
+{
+    //Field
+    UINT                   fieldWidth;
+    UINT                   fieldHeight;
+    BOOL                   passThroughWalls;
+    UINT                   blocks;
+    UINT                   symmetries;
+    BYTE                   neighbours[SOLVER_MAX_BLOCKS][4];        //By direction, 0xFF beyond a wall
+    BYTE                   positions[SYMMETRY_COUNT][SOLVER_MAX_BLOCKS];
+    BYTE                   directions[SYMMETRY_COUNT][4];
+
+    //Memo table
+    SOLVER_ENTRY*          entries;
+    UINT64                 mask;        //Entries - 1
+    UINT64                 used;
+    UINT64                 limit;       //Entries used before spilling
+
+    //Spill file
+    FILE*                  spillFile;
+    char                   spillPath[260];
+    SOLVER_RUN*            runs;
+    UINT                   runCount;
+    UINT64                 spillSize;
+
+    //Workers, which all stop at once for the table to be spilled
+    struct _SOLVER_WORKER* workers;
+    UINT                   threadCount;
+    pthread_mutex_t        lock;
+    pthread_cond_t         resumed;
+    UINT                   active;
+    UINT                   parked;
+    UINT64                 spills;
+    int                    spillPending;
+    int                    stop;        //Set by the first worker done with the root
+
+    //Statistics
+    UINT64                 statesSolved;
+    UINT64                 spilledStates;
+    UINT64                 diskReads;
+    double                 elapsed;
+} SNAKE_SOLVER;
+
+
+//*****************************************************************************
+//
+//                              SOLVER FUNCTIONS
+//
+//*****************************************************************************
+
+//Fields may have up to SOLVER_MAX_BLOCKS blocks. Zero threads uses every
+//processor and zero Memory takes SOLVER_MEMORY. The memo table spills to
+//SpillFile, removed by DestroySolver, or to a temporary file when it is NULL.
+SNAKE_RESULT    CreateSolver   (SNAKE_SOLVER* Solver, UINT Width, UINT Height, BOOL PassThroughWalls,
+                                UINT Threads, UINT64 Memory, const char* SpillFile);
+void            DestroySolver  (SNAKE_SOLVER* Solver);
+
+//Probability of winning the game, which must have the field of the solver.
+//With NewFood, the food of the game is ignored and the probability is the mean
+//over every block it could be placed on, as right after Initialize. Commands
+//waiting in the game are ignored.
+SNAKE_RESULT    SolveGame      (SNAKE_SOLVER* Solver, SNAKE_GAME* Game, BOOL NewFood, double* Value);
+
+//Probability of winning after moving the game in each direction. Turning
+//back keeps the snake going straight, just like MoveSnake.
+SNAKE_RESULT    SolveMoves     (SNAKE_SOLVER* Solver, SNAKE_GAME* Game, double Values[4]);
+
+//States solved per second over every solve so far
+double          SolverRate     (SNAKE_SOLVER* Solver);
+
+#endif
@@ -0,0 +1,399 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <string.h>
+#include "symmetry.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define STREAM_WORDS                (128 * 128 / 64 + 2) //Bits of a plane in field order, plus padding
+
+//Directions alternate between the x and y axes, see SNAKE_DIRECTION
+#define IS_HORIZONTAL(d)            (((d) & 1) == 0)
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+//Gathers the even bits of Value into its low half
+static UINT64 CompressEvenBits(UINT64 Value)
+{
+    Value &= 0x5555555555555555ULL;
+    Value  = (Value | Value >> 1)  & 0x3333333333333333ULL;
+    Value  = (Value | Value >> 2)  & 0x0F0F0F0F0F0F0F0FULL;
+    Value  = (Value | Value >> 4)  & 0x00FF00FF00FF00FFULL;
+    Value  = (Value | Value >> 8)  & 0x0000FFFF0000FFFFULL;
+    Value  = (Value | Value >> 16) & 0x00000000FFFFFFFFULL;
+
+    return Value;
+}
+
+//Spreads the low half of Value over its even bits
+static UINT64 SpreadEvenBits(UINT64 Value)
+{
+    Value &= 0x00000000FFFFFFFFULL;
+    Value  = (Value | Value << 16) & 0x0000FFFF0000FFFFULL;
+    Value  = (Value | Value << 8)  & 0x00FF00FF00FF00FFULL;
+    Value  = (Value | Value << 4)  & 0x0F0F0F0F0F0F0F0FULL;
+    Value  = (Value | Value << 2)  & 0x3333333333333333ULL;
+    Value  = (Value | Value << 1)  & 0x5555555555555555ULL;
+
+    return Value;
+}
+
+static UINT64 ReverseBits(UINT64 Value)
+{
+    Value = (Value >> 1 & 0x5555555555555555ULL) | (Value & 0x5555555555555555ULL) << 1;
+    Value = (Value >> 2 & 0x3333333333333333ULL) | (Value & 0x3333333333333333ULL) << 2;
+    Value = (Value >> 4 & 0x0F0F0F0F0F0F0F0FULL) | (Value & 0x0F0F0F0F0F0F0F0FULL) << 4;
+
+    return __builtin_bswap64(Value);
+}
+
+//Count bits of a stream starting at bit Offset, Count being 1 to 64
+static UINT64 GetBits(const UINT64* Stream, UINT Offset, UINT Count)
+{
+    UINT   shift = Offset % 64;
+    UINT64 bits  = Stream[Offset / 64] >> shift;
+
+    if (shift) bits |= Stream[Offset / 64 + 1] << (64 - shift);
+
+    return Count < 64 ? bits & ((1ULL << Count) - 1) : bits;
+}
+
+//Bits must not have any bit set from Count on
+static void PutBits(UINT64* Stream, UINT Offset, UINT64 Bits, UINT Count)
+{
+    UINT shift = Offset % 64;
+
+    Stream[Offset / 64] |= Bits << shift;
+
+    if (shift && shift + Count > 64) Stream[Offset / 64 + 1] |= Bits >> (64 - shift);
+}
+
+//Transposes a Size x Size bit matrix, Size being a power of two up to 64 and
+//bit x of row y being element (x, y), by swapping the off-diagonal blocks of
+//halves, quarters and so on down to single bits
+static void TransposeBits(UINT64* Rows, UINT Size)
+{
+    UINT64 mask = 0xFFFFFFFFFFFFFFFFULL >> (64 - Size / 2);
+    UINT64 swap;
+    UINT   half, block, k;
+
+    for (half = Size / 2; half != 0; half >>= 1, mask ^= mask << half)
+        for (block = 0; block < Size; block += 2 * half)
+            for (k = block; k < block + half; k++)
+            {
+                swap              = ((Rows[k] >> half) ^ Rows[k + half]) & mask;
+                Rows[k]          ^= swap << half;
+                Rows[k + half]   ^= swap;
+            }
+}
+
+static void TransposePlane(UINT64 (*Rows)[2], UINT Width, UINT Height, UINT64 (*Out)[2])
+{
+    UINT64 block[64];
+    UINT   size = 2;
+    UINT   blockRow, blockColumn, i;
+
+    //Fields within 64 blocks only need the smallest power of two covering them
+    while (size < 64 && (size < Width || size < Height)) size *= 2;
+
+    for (i = 0; i < Width; i++) Out[i][0] = Out[i][1] = 0;
+
+    //Block (r, c) of the plane becomes block (c, r) of the output
+    for (blockRow = 0; blockRow * 64 < Height; blockRow++)
+        for (blockColumn = 0; blockColumn * 64 < Width; blockColumn++)
+        {
+            for (i = 0; i < size; i++)
+                block[i] = blockRow * 64 + i < Height ? Rows[blockRow * 64 + i][blockColumn] : 0;
+
+            TransposeBits(block, size);
+
+            for (i = 0; i < size && blockColumn * 64 + i < Width; i++) Out[blockColumn * 64 + i][blockRow] = block[i];
+        }
+}
+
+static void FlipBitBoard(const BIT_BOARD* Board, BOOL FlipX, BOOL FlipY, BIT_BOARD* Out)
+{
+    UINT   width = Board->width;
+    UINT64 low, high;
+    UINT   plane, y, source;
+
+    Out->width  = width;
+    Out->height = Board->height;
+
+    for (plane = 0; plane < 2; plane++)
+        for (y = 0; y < Board->height; y++)
+        {
+            source = FlipY ? Board->height - 1 - y : y;
+            low    = Board->rows[plane][source][0];
+            high   = Board->rows[plane][source][1];
+
+            //Reversing the whole word puts the row at its top, so it's then
+            //shifted back down
+            if (FlipX && width <= 64)
+            {
+                low  = ReverseBits(low) >> (64 - width);
+            }
+            else if (FlipX)
+            {
+                low  = ReverseBits(high) >> (128 - width) | ReverseBits(low) << (width - 64);
+                high = ReverseBits(Board->rows[plane][source][0]) >> (128 - width);
+            }
+
+            Out->rows[plane][y][0] = low;
+            Out->rows[plane][y][1] = high;
+        }
+}
+
+//Compares the rows of two boards of the same size, any of them read from the
+//last row up
+static int CompareRows(const BIT_BOARD* A, BOOL ReverseA, const BIT_BOARD* B, BOOL ReverseB)
+{
+    UINT height = A->height;
+    int  plane, y, word;
+    UINT rowA, rowB;
+
+    for (plane = 1; plane >= 0; plane--)
+        for (y = 0; y < (int) height; y++)
+        {
+            rowA = ReverseA ? height - 1 - y : (UINT) y;
+            rowB = ReverseB ? height - 1 - y : (UINT) y;
+
+            for (word = 1; word >= 0; word--)
+                if (A->rows[plane][rowA][word] != B->rows[plane][rowB][word])
+                    return A->rows[plane][rowA][word] < B->rows[plane][rowB][word] ? -1 : 1;
+        }
+
+    return 0;
+}
+
+
+//*****************************************************************************
+//
+//                             SYMMETRY FUNCTIONS
+//
+//*****************************************************************************
+
+void LoadBitBoard(const BYTE* Packed, UINT Width, UINT Height, BIT_BOARD* Board)
+{
+    UINT64 streams[2][STREAM_WORDS];
+    UINT64 chunk;
+    UINT   bytes = (Width * Height + 3) / 4;
+    UINT   i, y, plane, cell;
+
+    //Eight bytes hold 32 blocks, whose low and high bits are split into the
+    //two streams. Blocks are packed from the low bits up, as in a little
+    //endian word.
+    for (i = 0; i < bytes; i += 8)
+    {
+        chunk = 0;
+        memcpy(&chunk, Packed + i, bytes - i < 8 ? bytes - i : 8);
+
+        cell = i * 4;
+
+        for (plane = 0; plane < 2; plane++)
+        {
+            if (cell % 64 == 0) streams[plane][cell / 64] = 0;
+
+            streams[plane][cell / 64] |= CompressEvenBits(chunk >> plane) << cell % 64;
+        }
+    }
+
+    for (plane = 0; plane < 2; plane++) streams[plane][(bytes * 4 + 63) / 64] = 0;
+
+    Board->width  = Width;
+    Board->height = Height;
+
+    for (plane = 0; plane < 2; plane++)
+        for (y = 0; y < Height; y++)
+        {
+            Board->rows[plane][y][0] = GetBits(streams[plane], y * Width, Width < 64 ? Width : 64);
+            Board->rows[plane][y][1] = Width > 64 ? GetBits(streams[plane], y * Width + 64, Width - 64) : 0;
+        }
+}
+
+void StoreBitBoard(const BIT_BOARD* Board, BYTE* Packed)
+{
+    UINT64 streams[2][STREAM_WORDS];
+    UINT64 chunk;
+    UINT   width = Board->width;
+    UINT   bytes = (width * Board->height + 3) / 4;
+    UINT   i, y, plane, cell;
+
+    memset(streams, 0, sizeof(streams));
+
+    for (plane = 0; plane < 2; plane++)
+        for (y = 0; y < Board->height; y++)
+        {
+            PutBits(streams[plane], y * width, Board->rows[plane][y][0], width < 64 ? width : 64);
+            if (width > 64) PutBits(streams[plane], y * width + 64, Board->rows[plane][y][1], width - 64);
+        }
+
+    for (i = 0; i < bytes; i += 8)
+    {
+        cell  = i * 4;
+        chunk = SpreadEvenBits(streams[0][cell / 64] >> cell % 64) |
+                SpreadEvenBits(streams[1][cell / 64] >> cell % 64) << 1;
+
+        memcpy(Packed + i, &chunk, bytes - i < 8 ? bytes - i : 8);
+    }
+}
+
+void TransformBitBoard(const BIT_BOARD* Board, UINT Symmetry, BIT_BOARD* Out)
+{
+    BIT_BOARD flipped;
+    UINT      plane;
+
+    if (!(Symmetry & SYM_TRANSPOSE))
+    {
+        FlipBitBoard(Board, Symmetry & SYM_FLIP_X, Symmetry & SYM_FLIP_Y, Out);
+        return;
+    }
+
+    FlipBitBoard(Board, Symmetry & SYM_FLIP_X, Symmetry & SYM_FLIP_Y, &flipped);
+
+    Out->width  = Board->height;
+    Out->height = Board->width;
+
+    for (plane = 0; plane < 2; plane++)
+        TransposePlane(flipped.rows[plane], flipped.width, flipped.height, Out->rows[plane]);
+}
+
+WORD TransformPosition(UINT Symmetry, UINT Width, UINT Height, WORD Position)
+{
+    int x = BLOCK_X(Position);
+    int y = BLOCK_Y(Position);
+
+    if (Symmetry & SYM_FLIP_X) x = Width  - 1 - x;
+    if (Symmetry & SYM_FLIP_Y) y = Height - 1 - y;
+
+    return Symmetry & SYM_TRANSPOSE ? BLOCK_POSITION(y, x) : BLOCK_POSITION(x, y);
+}
+
+SNAKE_DIRECTION TransformDirection(UINT Symmetry, SNAKE_DIRECTION Direction)
+{
+    UINT direction = Direction;
+
+    if ((Symmetry & SYM_FLIP_X) &&  IS_HORIZONTAL(direction)) direction ^= 2;
+    if ((Symmetry & SYM_FLIP_Y) && !IS_HORIZONTAL(direction)) direction ^= 2;
+    if  (Symmetry & SYM_TRANSPOSE)                            direction ^= 1;
+
+    return (SNAKE_DIRECTION) direction;
+}
+
+//Mirroring x and then transposing is the same as transposing and then
+//mirroring y, so undoing a transposed symmetry swaps its mirrors
+UINT InverseSymmetry(UINT Symmetry)
+{
+    if (!(Symmetry & SYM_TRANSPOSE)) return Symmetry;
+
+    return SYM_TRANSPOSE | (Symmetry & SYM_FLIP_X ? SYM_FLIP_Y : 0) | (Symmetry & SYM_FLIP_Y ? SYM_FLIP_X : 0);
+}
+
+void CanonicalizeGame(SNAKE_GAME* Game, CANONICAL_STATE* State)
+{
+    BIT_BOARD       boards[4];          //As it is, mirrored in x, transposed, and both
+    BIT_BOARD*      pBest;
+    BIT_BOARD*      pCandidate;
+    SNAKE_ELEMENT*  pTailElement;
+    WORD            tail = Game->headPosition;
+    WORD            candidateTail;
+    SNAKE_DIRECTION candidateDirection;
+    UINT            width  = Game->fieldWidth;
+    UINT            height = Game->fieldHeight;
+    UINT            count  = width == height ? SYMMETRY_COUNT : SYM_TRANSPOSE;
+    BOOL            bestReversed, candidateReversed;
+    UINT64          hash;
+    UINT            symmetry, plane, y;
+    int             order;
+
+    if (Game->hSnakeStack != NULL)
+    {
+        pTailElement = (SNAKE_ELEMENT*) GlobalLock(Game->hSnakeStack);
+        tail         = pTailElement->blockPosition;
+        GlobalUnlock(Game->hSnakeStack);
+    }
+
+    LoadBitBoard((const BYTE*) GlobalLock(Game->hFieldBuffer), width, height, boards);
+    GlobalUnlock(Game->hFieldBuffer);
+
+    FlipBitBoard(boards, TRUE, FALSE, boards + 1);
+
+    if (count > SYM_TRANSPOSE)
+    {
+        TransformBitBoard(boards, SYM_TRANSPOSE, boards + 2);
+        FlipBitBoard(boards + 2, TRUE, FALSE, boards + 3);
+    }
+
+    //Every symmetry is one of the four boards, read from the first or the
+    //last row. Transposing comes last, so a transposed symmetry mirrors the
+    //transposed board on the other axis.
+    pBest        = boards;
+    bestReversed = FALSE;
+
+    State->symmetry     = SYM_IDENTITY;
+    State->direction    = Game->previousDirection;
+    State->tailPosition = tail;
+
+    for (symmetry = 1; symmetry < count; symmetry++)
+    {
+        if (symmetry & SYM_TRANSPOSE)
+        {
+            pCandidate        = boards + (symmetry & SYM_FLIP_Y ? 3 : 2);
+            candidateReversed = (symmetry & SYM_FLIP_X) != 0;
+        }
+        else
+        {
+            pCandidate        = boards + (symmetry & SYM_FLIP_X ? 1 : 0);
+            candidateReversed = (symmetry & SYM_FLIP_Y) != 0;
+        }
+
+        candidateDirection = TransformDirection(symmetry, Game->previousDirection);
+        candidateTail      = TransformPosition(symmetry, width, height, tail);
+
+        order = CompareRows(pCandidate, candidateReversed, pBest, bestReversed);
+
+        if (order == 0) order = (int) candidateDirection - (int) State->direction;
+        if (order == 0) order = (int) candidateTail - (int) State->tailPosition;
+        if (order >= 0) continue;
+
+        pBest        = pCandidate;
+        bestReversed = candidateReversed;
+
+        State->symmetry     = symmetry;
+        State->direction    = candidateDirection;
+        State->tailPosition = candidateTail;
+    }
+
+    FlipBitBoard(pBest, FALSE, bestReversed, &State->board);
+
+    State->headPosition = TransformPosition(State->symmetry, width, height, Game->headPosition);
+
+    //Multiply and shift over every word of the canonical state
+    hash = (UINT64) State->board.width << 40 | (UINT64) State->board.height << 32 |
+           (UINT64) State->direction << 16 | State->tailPosition;
+
+    for (plane = 0; plane < 2; plane++)
+        for (y = 0; y < State->board.height; y++)
+        {
+            hash = (hash ^ State->board.rows[plane][y][0]) * 0x9E3779B97F4A7C15ULL;
+            hash = (hash ^ hash >> 29 ^ State->board.rows[plane][y][1]) * 0xBF58476D1CE4E5B9ULL;
+            hash ^= hash >> 32;
+        }
+
+    State->hash = hash;
+}
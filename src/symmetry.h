@@ -0,0 +1,82 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define BIT_BOARD_ROWS              128   //Rows of a plane, enough for any field
+#define SYMMETRY_COUNT              8
+
+//Symmetries are built from three flags, applied in this order: mirror the x
+//coordinates, mirror the y coordinates, then swap x and y. Fields that aren't
+//square only have the four symmetries without SYM_TRANSPOSE.
+#define SYM_IDENTITY                0
+#define SYM_FLIP_X                  1
+#define SYM_FLIP_Y                  2
+#define SYM_TRANSPOSE               4
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//The field split into two bit planes, the low and the high bit of every
+//BLOCK_STATE. Row y of a plane holds block x at bit x, in two words, and the
+//rows from height on are left undefined.
+typedef struct _BIT_BOARD
+{
+    UINT   width;
+    UINT   height;
+    UINT64 rows[2][BIT_BOARD_ROWS][2];
+} BIT_BOARD;
+
+//A game seen in its canonical orientation: the smallest of its symmetric
+//boards, with the direction and positions mapped the same way
+typedef struct _CANONICAL_STATE
+{
+    BIT_BOARD       board;
+    SNAKE_DIRECTION direction;
+    WORD            headPosition;
+    WORD            tailPosition;
+    UINT            symmetry;           //Takes the game to the canonical state
+    UINT64          hash;               //Equal for every symmetric state, unlike GameHash
+} CANONICAL_STATE;
+
+
+//*****************************************************************************
+//
+//                             SYMMETRY FUNCTIONS
+//
+//*****************************************************************************
+
+//Conversions between the packed field of a game and a bit board. The packed
+//form is the one of hFieldBuffer, FIELD_BUFFER_SIZE bytes of 2-bit blocks.
+void            LoadBitBoard        (const BYTE* Packed, UINT Width, UINT Height, BIT_BOARD* Board);
+void            StoreBitBoard       (const BIT_BOARD* Board, BYTE* Packed);
+
+//Board must not be Out. The width and height of Out are swapped by SYM_TRANSPOSE.
+void            TransformBitBoard   (const BIT_BOARD* Board, UINT Symmetry, BIT_BOARD* Out);
+WORD            TransformPosition   (UINT Symmetry, UINT Width, UINT Height, WORD Position);
+SNAKE_DIRECTION TransformDirection  (UINT Symmetry, SNAKE_DIRECTION Direction);
+UINT            InverseSymmetry     (UINT Symmetry);
+
+//Finds the canonical orientation of a running game, comparing the bit boards
+//first, then the direction and the tail position
+void            CanonicalizeGame    (SNAKE_GAME* Game, CANONICAL_STATE* State);
+
+#endif
@@ -0,0 +1,131 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include "table.h"
+#include "shared.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define BUCKET_SLOTS                2     //Deepest entry, then the latest one
+#define MAX_TABLE_BITS              30
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static UINT64 PackData(float Value, UINT Depth, BYTE Move, BYTE Age)
+{
+    UINT bits;
+
+    memcpy(&bits, &Value, sizeof(bits));
+
+    return (UINT64) bits | (UINT64) (Depth > 0xFFFF ? 0xFFFF : Depth) << 32 |
+           (UINT64) Move << 48 | (UINT64) Age << 56;
+}
+
+static void UnpackData(UINT64 Data, TABLE_DATA* Unpacked)
+{
+    UINT bits = (UINT) Data;
+
+    memcpy(&Unpacked->value, &bits, sizeof(bits));
+
+    Unpacked->depth = (WORD) (Data >> 32);
+    Unpacked->move  = (BYTE) (Data >> 48);
+    Unpacked->age   = (BYTE) (Data >> 56);
+}
+
+
+//*****************************************************************************
+//
+//                              TABLE FUNCTIONS
+//
+//*****************************************************************************
+
+SNAKE_RESULT CreateTable(TRANSPOSITION_TABLE* Table, UINT Bits)
+{
+    if (Bits == 0)             Bits = TABLE_BITS;
+    if (Bits > MAX_TABLE_BITS) Bits = MAX_TABLE_BITS;
+
+    memset(Table, 0, sizeof(TRANSPOSITION_TABLE));
+
+    Table->mask    = ((UINT64) 1 << Bits) - 1;
+    Table->entries = (TABLE_ENTRY*) calloc((size_t) BUCKET_SLOTS << Bits, sizeof(TABLE_ENTRY));
+
+    return Table->entries ? SR_OK : SR_MEMORY_ERROR;
+}
+
+void DestroyTable(TRANSPOSITION_TABLE* Table)
+{
+    free(Table->entries);
+    Table->entries = NULL;
+}
+
+void ClearTable(TRANSPOSITION_TABLE* Table)
+{
+    memset(Table->entries, 0, (size_t) BUCKET_SLOTS * (Table->mask + 1) * sizeof(TABLE_ENTRY));
+
+    Table->generation = 0;
+    Table->probes     = 0;
+    Table->hits       = 0;
+}
+
+void AgeTable(TRANSPOSITION_TABLE* Table)
+{
+    Table->generation++;
+}
+
+BOOL ProbeTable(TRANSPOSITION_TABLE* Table, UINT64 Key, TABLE_DATA* Data)
+{
+    TABLE_ENTRY* bucket = Table->entries + BUCKET_SLOTS * (Key & Table->mask);
+    UINT64       check, data;
+    UINT         i;
+
+    Table->probes++;
+
+    for (i = 0; i < BUCKET_SLOTS; i++)
+    {
+        check = LOAD(&bucket[i].check);
+        data  = LOAD(&bucket[i].data);
+
+        //Empty slots hold zeros, which only match a zero key with no data
+        if ((check ^ data) == Key && (check | data) != 0)
+        {
+            UnpackData(data, Data);
+            Table->hits++;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void StoreTable(TRANSPOSITION_TABLE* Table, UINT64 Key, float Value, UINT Depth, BYTE Move)
+{
+    TABLE_ENTRY* bucket = Table->entries + BUCKET_SLOTS * (Key & Table->mask);
+    UINT64       data   = PackData(Value, Depth, Move, Table->generation);
+    UINT64       check  = LOAD(&bucket[0].check);
+    UINT64       stored = LOAD(&bucket[0].data);
+    TABLE_ENTRY* slot   = bucket + 1;
+
+    //The deep slot takes the entry when it's for the same state, stale or not
+    //as deep, and the latest slot takes it otherwise
+    if ((check ^ stored) == Key || (BYTE) (stored >> 56) != Table->generation ||
+        (WORD) (stored >> 32) <= Depth) slot = bucket;
+
+    STORE(&slot->check, Key ^ data);
+    STORE(&slot->data,  data);
+}
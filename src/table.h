@@ -0,0 +1,78 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define TABLE_BITS                  20    //Default of 2^20 buckets, 32 MB
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//What a search stores about a game state
+typedef struct _TABLE_DATA
+{
+    float  value;
+    WORD   depth;               //Larger depths are kept over smaller ones
+    BYTE   move;                //SNAKE_DIRECTION, or NO_COMMAND
+    BYTE   age;                 //TableGeneration when stored
+} TABLE_DATA;
+
+//Entries keep the key XORed with the data, so an entry torn by two threads
+//writing it at once just fails to match instead of returning wrong data
+typedef struct _TABLE_ENTRY
+{
+    UINT64 check;
+    UINT64 data;
+} TABLE_ENTRY;
+
+//Transposition table keyed by GameHash. Every bucket has a slot for the
+//deepest entry of the current generation and one that is always replaced.
+//Any number of threads may probe and store at once without locks.
+typedef struct _TRANSPOSITION_TABLE
+{
+    TABLE_ENTRY* entries;
+    UINT64       mask;          //Buckets - 1
+    BYTE         generation;
+
+    //Statistics, counted without synchronization
+    UINT64       probes;
+    UINT64       hits;
+} TRANSPOSITION_TABLE;
+
+
+//*****************************************************************************
+//
+//                              TABLE FUNCTIONS
+//
+//*****************************************************************************
+
+//Bits is the base-2 logarithm of the bucket count, or zero for TABLE_BITS
+SNAKE_RESULT    CreateTable    (TRANSPOSITION_TABLE* Table, UINT Bits);
+void            DestroyTable   (TRANSPOSITION_TABLE* Table);
+void            ClearTable     (TRANSPOSITION_TABLE* Table);
+
+//Starts a new search: entries of older generations are replaced first
+void            AgeTable       (TRANSPOSITION_TABLE* Table);
+
+BOOL            ProbeTable     (TRANSPOSITION_TABLE* Table, UINT64 Key, TABLE_DATA* Data);
+void            StoreTable     (TRANSPOSITION_TABLE* Table, UINT64 Key, float Value, UINT Depth, BYTE Move);
+
+#endif
@@ -0,0 +1,376 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL                __declspec(thread)
+#else
+#define THREAD_LOCAL                __thread
+#endif
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+//Each thread appends to its own buffer, so recording never takes a lock. The
+//buffers are chained into a list once, when a thread records its first event.
+typedef struct _TRACE_BUFFER
+{
+    TRACE_EVENT            events[TRACE_CAPACITY];
+    UINT                   count;
+    UINT                   dropped;
+    UINT                   thread;
+    struct _TRACE_BUFFER*  next;
+} TRACE_BUFFER;
+
+typedef struct _TRACE_RECORD
+{
+    TRACE_EVENT event;
+    UINT        thread;
+    UINT        tick;           //Last one its thread traced, so ties in time can't mix them up
+} TRACE_RECORD;
+
+typedef struct _LATENCY_SERIES
+{
+    const char* name;
+    UINT64*     values;
+    UINT        count;
+} LATENCY_SERIES;
+
+
+//*****************************************************************************
+//
+//                              GLOBAL VARIABLES
+//
+//*****************************************************************************
+
+static TRACE_BUFFER*              bufferList;
+static THREAD_LOCAL TRACE_BUFFER* threadBuffer;
+static UINT                       lastTraceId;
+static UINT                       lastTick;
+static UINT                       lastThread;
+
+static const char* directionNames[4] = { "RIGHT", "UP", "LEFT", "DOWN" };
+
+
+//*****************************************************************************
+//
+//                              HELPER FUNCTIONS
+//
+//*****************************************************************************
+
+static UINT64 TraceNow(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (UINT64) (counter.QuadPart / frequency.QuadPart * 1000000 +
+                     counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT64) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+static TRACE_BUFFER* GetThreadBuffer(void)
+{
+    TRACE_BUFFER* buffer = threadBuffer;
+
+    if (buffer != NULL) return buffer;
+
+    buffer = (TRACE_BUFFER*) calloc(1, sizeof(TRACE_BUFFER));
+    if (buffer == NULL) return NULL;
+
+    buffer->thread = __atomic_add_fetch(&lastThread, 1, __ATOMIC_RELAXED);
+    buffer->next   = __atomic_load_n(&bufferList, __ATOMIC_ACQUIRE);
+
+    while (!__atomic_compare_exchange_n(&bufferList, &buffer->next, buffer, FALSE,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+
+    threadBuffer = buffer;
+    return buffer;
+}
+
+static int CompareRecords(const void* A, const void* B)
+{
+    const TRACE_RECORD* a = (const TRACE_RECORD*) A;
+    const TRACE_RECORD* b = (const TRACE_RECORD*) B;
+
+    if (a->event.time != b->event.time) return a->event.time < b->event.time ? -1 : 1;
+
+    return (int) a->event.stage - (int) b->event.stage;
+}
+
+static int CompareLatencies(const void* A, const void* B)
+{
+    UINT64 a = *(const UINT64*) A;
+    UINT64 b = *(const UINT64*) B;
+
+    return a < b ? -1 : a > b;
+}
+
+static double Percentile(LATENCY_SERIES* Series, double Fraction)
+{
+    UINT index;
+
+    if (Series->count == 0) return 0.0;
+
+    index = (UINT) (Fraction * (Series->count - 1) + 0.5);
+    return Series->values[index] / 1000.0;
+}
+
+static void WriteSeries(FILE* File, LATENCY_SERIES* Series, BOOL Json)
+{
+    qsort(Series->values, Series->count, sizeof(UINT64), CompareLatencies);
+
+    fprintf(File, Json ? "\"%s\": {\"count\": %u, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}"
+                       : "%-18s count %6u   p50 %8.3f ms   p90 %8.3f ms   p99 %8.3f ms   max %8.3f ms\n",
+            Series->name, Series->count, Percentile(Series, 0.5), Percentile(Series, 0.9),
+            Percentile(Series, 0.99), Percentile(Series, 1.0));
+}
+
+
+//*****************************************************************************
+//
+//                              TRACE FUNCTIONS
+//
+//*****************************************************************************
+
+UINT NewTraceId(void)
+{
+    return __atomic_add_fetch(&lastTraceId, 1, __ATOMIC_RELAXED);
+}
+
+UINT TraceTicks(void)
+{
+    return __atomic_load_n(&lastTick, __ATOMIC_RELAXED);
+}
+
+void TraceCommand(TRACE_STAGE Stage, UINT Id, SNAKE_DIRECTION Direction, UINT QueueDepth)
+{
+    TRACE_BUFFER* buffer = GetThreadBuffer();
+    TRACE_EVENT*  event;
+
+    if (Stage == TS_TICK) Id = __atomic_add_fetch(&lastTick, 1, __ATOMIC_RELAXED);
+
+    if (buffer == NULL) return;
+
+    if (buffer->count == TRACE_CAPACITY)
+    {
+        buffer->dropped++;
+        return;
+    }
+
+    event             = buffer->events + buffer->count;
+    event->time       = TraceNow();
+    event->id         = Id;
+    event->stage      = (BYTE) Stage;
+    event->direction  = (BYTE) Direction;
+    event->queueDepth = (WORD) QueueDepth;
+
+    //Publishes the event to WriteTrace, which may run on another thread
+    __atomic_store_n(&buffer->count, buffer->count + 1, __ATOMIC_RELEASE);
+}
+
+BOOL WriteTrace(const char* TraceFile, const char* SummaryFile)
+{
+    TRACE_BUFFER*  buffer;
+    TRACE_RECORD*  records;
+    TRACE_RECORD*  record;
+    UINT64*        received;
+    UINT*          pending;
+    UINT*          pendingTicks;        //Tick each pending command was applied in
+    LATENCY_SERIES series[3];
+    UINT           recordCount = 0;
+    UINT           pendingCount = 0;
+    UINT           dropped = 0;
+    UINT           tick;
+    UINT           maxId   = __atomic_load_n(&lastTraceId, __ATOMIC_RELAXED);
+    UINT           i, j, count;
+    FILE*          file;
+    BOOL           first = TRUE;
+
+    for (buffer = __atomic_load_n(&bufferList, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next)
+    {
+        recordCount += __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+        dropped     += buffer->dropped;
+    }
+
+    records  = (TRACE_RECORD*) malloc((recordCount + 1) * sizeof(TRACE_RECORD));
+    received = (UINT64*)       calloc(maxId + 1, sizeof(UINT64));
+    pending      = (UINT*)     malloc((maxId + 1) * sizeof(UINT));
+    pendingTicks = (UINT*)     malloc((maxId + 1) * sizeof(UINT));
+
+    for (i = 0; i < 3; i++) series[i].values = (UINT64*) malloc((maxId + 1) * sizeof(UINT64));
+
+    series[0].name = "inputToDequeue";
+    series[1].name = "inputToMove";
+    series[2].name = "inputToDisplay";
+
+    file = fopen(TraceFile, "w");
+
+    if (!records || !received || !pending || !pendingTicks || !series[0].values || !series[1].values ||
+        !series[2].values || !file)
+    {
+        if (file) fclose(file);
+        free(records);
+        free(received);
+        free(pending);
+        free(pendingTicks);
+        for (i = 0; i < 3; i++) free(series[i].values);
+        return FALSE;
+    }
+
+    //Merge the per-thread buffers in time order
+    recordCount = 0;
+
+    for (buffer = __atomic_load_n(&bufferList, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next)
+    {
+        count = __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+        tick  = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            if (buffer->events[i].stage == TS_TICK) tick = buffer->events[i].id;
+
+            records[recordCount].event  = buffer->events[i];
+            records[recordCount].thread = buffer->thread;
+            records[recordCount].tick   = tick;
+            recordCount++;
+        }
+    }
+
+    qsort(records, recordCount, sizeof(TRACE_RECORD), CompareRecords);
+
+    for (i = 0; i < 3; i++) series[i].count = 0;
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    for (i = 0; i < recordCount; i++)
+    {
+        record = records + i;
+
+        if (!first) fprintf(file, ",\n");
+        first = FALSE;
+
+        //Every command is an async span, from its receipt to the frame showing it
+        switch (record->event.stage)
+        {
+            case TS_RECEIVED:
+                if (record->event.id <= maxId) received[record->event.id] = record->event.time;
+                fprintf(file, "{\"name\": \"command\", \"cat\": \"input\", \"ph\": \"b\", \"id\": %u, \"ts\": %llu, "
+                              "\"pid\": 1, \"tid\": %u, \"args\": {\"direction\": \"%s\", \"queue\": %u}}",
+                        record->event.id, (unsigned long long) record->event.time, record->thread,
+                        directionNames[record->event.direction & 3], record->event.queueDepth);
+                break;
+
+            case TS_DROPPED:
+                fprintf(file, "{\"name\": \"command\", \"cat\": \"input\", \"ph\": \"e\", \"id\": %u, \"ts\": %llu, "
+                              "\"pid\": 1, \"tid\": %u, \"args\": {\"dropped\": true}}",
+                        record->event.id, (unsigned long long) record->event.time, record->thread);
+                break;
+
+            case TS_DEQUEUED:
+            case TS_APPLIED:
+                fprintf(file, "{\"name\": \"command\", \"cat\": \"input\", \"ph\": \"n\", \"id\": %u, \"ts\": %llu, "
+                              "\"pid\": 1, \"tid\": %u, \"args\": {\"stage\": \"%s\", \"queue\": %u}}",
+                        record->event.id, (unsigned long long) record->event.time, record->thread,
+                        record->event.stage == TS_DEQUEUED ? "dequeued" : "applied", record->event.queueDepth);
+
+                if (record->event.id > maxId || received[record->event.id] == 0) break;
+
+                j = record->event.stage == TS_DEQUEUED ? 0 : 1;
+                series[j].values[series[j].count++] = record->event.time - received[record->event.id];
+
+                if (record->event.stage == TS_APPLIED)
+                {
+                    pending[pendingCount]        = record->event.id;
+                    pendingTicks[pendingCount++] = record->tick;
+                }
+                break;
+
+            case TS_TICK:
+                fprintf(file, "{\"name\": \"tick\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %llu, \"pid\": 1, \"tid\": %u}",
+                        (unsigned long long) record->event.time, record->thread);
+                break;
+
+            case TS_FRAME:
+                fprintf(file, "{\"name\": \"frame\", \"ph\": \"i\", \"s\": \"g\", \"ts\": %llu, \"pid\": 1, \"tid\": %u, "
+                              "\"args\": {\"tick\": %u}}",
+                        (unsigned long long) record->event.time, record->thread, record->event.id);
+
+                //The first frame copied after a move is the one that shows it,
+                //moves of later ticks wait for the next one
+                for (j = count = 0; j < pendingCount; j++)
+                {
+                    if (pendingTicks[j] > record->event.id)
+                    {
+                        pending[count]        = pending[j];
+                        pendingTicks[count++] = pendingTicks[j];
+                        continue;
+                    }
+
+                    fprintf(file, ",\n{\"name\": \"command\", \"cat\": \"input\", \"ph\": \"e\", \"id\": %u, \"ts\": %llu, "
+                                  "\"pid\": 1, \"tid\": %u}",
+                            pending[j], (unsigned long long) record->event.time, record->thread);
+
+                    series[2].values[series[2].count++] = record->event.time - received[pending[j]];
+                }
+
+                pendingCount = count;
+                break;
+        }
+    }
+
+    fprintf(file, "\n], \"otherData\": {\"unit\": \"ms\", \"droppedEvents\": %u, ", dropped);
+    WriteSeries(file, series + 0, TRUE);
+    fprintf(file, ", ");
+    WriteSeries(file, series + 1, TRUE);
+    fprintf(file, ", ");
+    WriteSeries(file, series + 2, TRUE);
+    fprintf(file, "}}\n");
+    fclose(file);
+
+    if (SummaryFile != NULL && (file = fopen(SummaryFile, "w")) != NULL)
+    {
+        for (i = 0; i < 3; i++) WriteSeries(file, series + i, FALSE);
+        if (dropped) fprintf(file, "%u events were dropped, raise TRACE_CAPACITY\n", dropped);
+        fclose(file);
+    }
+
+    free(records);
+    free(received);
+    free(pending);
+    free(pendingTicks);
+    for (i = 0; i < 3; i++) free(series[i].values);
+
+    return TRUE;
+}
@@ -0,0 +1,83 @@
+//*****************************************************************************
+//                            SNAKE GAME
+//
+//                    Programmer: André Vicente Milack
+//                    Email: andrevicente.m@gmail.com
+//*****************************************************************************
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "snake.h"
+
+
+//*****************************************************************************
+//
+//                              DEFINES & MACROS
+//
+//*****************************************************************************
+
+#define TRACE_CAPACITY              65536 //Events kept per thread, later ones are dropped
+
+//Tracing is compiled in only when SNAKE_TRACE is defined, so the game loop
+//pays nothing for it otherwise
+#ifdef SNAKE_TRACE
+#define TRACE_COMMAND(s, i, d, q)   TraceCommand(s, i, d, q)
+#define TRACE_TICK()                TraceCommand(TS_TICK, 0, 0, 0)
+#define TRACE_FRAME(t)              TraceCommand(TS_FRAME, t, 0, 0)
+#define TRACE_NEW_ID()              NewTraceId()
+#define TRACE_TICKS()               TraceTicks()
+#else
+#define TRACE_COMMAND(s, i, d, q)   ((void) 0)
+#define TRACE_TICK()                ((void) 0)
+#define TRACE_FRAME(t)              ((void) 0)
+#define TRACE_NEW_ID()              0
+#define TRACE_TICKS()               0
+#endif
+
+
+//*****************************************************************************
+//
+//                              ENUMS & STRUCTS
+//
+//*****************************************************************************
+
+typedef enum _TRACE_STAGE
+{
+    TS_RECEIVED,                //Command handed to ReceiveCommand
+    TS_DROPPED,                 //Command ignored for not being perpendicular
+    TS_DEQUEUED,                //Command taken from the list by PickDirection
+    TS_APPLIED,                 //Head moved in the direction of the command
+    TS_TICK,                    //MoveSnake started, id being the ticks traced so far
+    TS_FRAME                    //A frame reached the window, id being the ticks traced when it was copied
+} TRACE_STAGE;
+
+typedef struct _TRACE_EVENT
+{
+    UINT64 time;                //Microseconds
+    UINT   id;                  //Command id, or tick of ticks and frames
+    BYTE   stage;
+    BYTE   direction;
+    WORD   queueDepth;          //Commands waiting in the list at that moment
+} TRACE_EVENT;
+
+
+//*****************************************************************************
+//
+//                              TRACE FUNCTIONS
+//
+//*****************************************************************************
+
+UINT    NewTraceId   (void);
+
+//Ticks traced so far. A frame copied from the game is stamped with them, so
+//moves made while it is being painted aren't taken as shown by it.
+UINT    TraceTicks   (void);
+void    TraceCommand (TRACE_STAGE Stage, UINT Id, SNAKE_DIRECTION Direction, UINT QueueDepth);
+
+//Writes every recorded event as Chrome trace-event JSON (chrome://tracing or
+//ui.perfetto.dev), with latency percentiles under "otherData", and the same
+//percentiles as plain text when SummaryFile is not NULL.
+BOOL    WriteTrace   (const char* TraceFile, const char* SummaryFile);
+
+#endif